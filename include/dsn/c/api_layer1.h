@@ -158,6 +158,12 @@ with which they control the application in many aspects in a declarative approac
   ; what CPU cores are assigned to this pool, 0 for all
   worker_affinity_mask = 0
 
+  ; what CPU cores are assigned to this pool as a list, e.g., 0-15,32-47, for any core count; overrides worker_affinity_mask
+  worker_cpus =
+
+  ; what NUMA nodes are assigned to this pool, e.g., 0,1; their CPU cores are added to worker_cpus
+  worker_numa_nodes =
+
   ; task aspects names, usually for tooling purpose
   worker_aspects =
 
@@ -167,6 +173,12 @@ with which they control the application in many aspects in a declarative approac
   ; task worker provider name
   worker_factory_name =
 
+  ; how idle workers wait for tasks: WORKER_IDLE_BLOCKING, WORKER_IDLE_SPIN_THEN_PARK, or WORKER_IDLE_BUSY_POLL
+  worker_idle_mode = WORKER_IDLE_BLOCKING
+
+  ; spin budget in microseconds before parking, for WORKER_IDLE_SPIN_THEN_PARK
+  worker_idle_spin_us = 50
+
   ; thread priority
   worker_priority = THREAD_xPRIORITY_NORMAL
 
@@ -922,6 +934,32 @@ extern DSN_API void          dsn_rpc_call_one_way(
 */
 extern DSN_API dsn_message_t dsn_rpc_get_response(dsn_task_t rpc_call);
 
+/*!
+ get the number of member responses collected by a GRPC_TO_ALL call, 
+ which is valid after the response task is completed
+*/
+extern DSN_API int           dsn_rpc_get_group_response_count(dsn_task_t rpc_call);
+
+/*!
+ get the index-th member response of a GRPC_TO_ALL call, note
+ returned msg (nullptr on failure) must be explicitly released using \ref dsn_msg_release_ref
+
+ \param rpc_call the response task of the GRPC_TO_ALL call
+ \param index    in [0, dsn_rpc_get_group_response_count(rpc_call))
+ \param member   output, the group member which sends the response
+ \param err      output, the error code of this member
+
+ \return the response message from the member, which is a new message sharing the
+         received buffer, so that it can always be read from the beginning (e.g., even
+         when the same response is already read by the callback of the call)
+*/
+extern DSN_API dsn_message_t dsn_rpc_get_group_response(
+                                dsn_task_t rpc_call,
+                                int index,
+                                /*out*/ dsn_address_t* member,
+                                /*out*/ dsn_error_t* err
+                                );
+
 /*! this is to mimic a response is received when no real rpc is called */
 extern DSN_API void          dsn_rpc_enqueue_response(
                                 dsn_task_t rpc_call, 
@@ -957,11 +995,20 @@ typedef enum dsn_ctrl_code_t
     CTL_MAX_CON_WRITE_OP_COUNT = 3, ///< (throttling) maximum concurrent write ops
 } dsn_ctrl_code_t;
 
+/*! 
+ open flag for direct I/O which bypasses the page cache of the OS (O_DIRECT on linux,
+ FILE_FLAG_NO_BUFFERING on windows). For such files, the buffer address, the size and
+ the file offset of each read and write must be aligned to DSN_FILE_DIRECT_IO_ALIGNMENT,
+ see \ref dsn_file_alloc_aligned_buffer.
+ */
+# define DSN_O_DIRECT                  0x10000000
+# define DSN_FILE_DIRECT_IO_ALIGNMENT  4096
+
 /*!
  open file
 
  \param file_name filename of the file.
- \param flag      flags such as O_RDONLY | O_BINARY used by ::open 
+ \param flag      flags such as O_RDONLY | O_BINARY used by ::open, plus \ref DSN_O_DIRECT
  \param pmode     permission mode used by ::open
 
  \return file handle
@@ -985,6 +1032,12 @@ extern DSN_API dsn_error_t  dsn_file_flush(
 /*! get native handle: HANDLE for windows, int for non-windows */
 extern DSN_API void*        dsn_file_native_handle(dsn_handle_t file);
 
+/*! allocate a buffer aligned to DSN_FILE_DIRECT_IO_ALIGNMENT, which can be used for direct I/O */
+extern DSN_API void*        dsn_file_alloc_aligned_buffer(size_t size);
+
+/*! free the buffer allocated by \ref dsn_file_alloc_aligned_buffer */
+extern DSN_API void         dsn_file_free_aligned_buffer(void* buffer);
+
 /*!
  create aio task which is executed on completion of the file operations
 
@@ -408,6 +408,24 @@ extern DSN_API void*         dsn_transient_malloc(uint32_t size);
 /*! high-performance free for transient objects, paired with \ref dsn_transient_malloc */
 extern DSN_API void          dsn_transient_free(void* ptr);
 
+/*! hot objects with their own fixed-size object pools, see \ref dsn_object_pool_malloc */
+typedef enum dsn_object_pool_type_t
+{
+    OBJECT_POOL_TASK_C,
+    OBJECT_POOL_RPC_REQUEST_TASK,
+    OBJECT_POOL_MESSAGE_EX,
+    OBJECT_POOL_COUNT
+} dsn_object_pool_type_t;
+
+/*! 
+ malloc from the per-thread object pool of the given type, objects larger than
+ the pool object size are allocated from the heap directly
+ */
+extern DSN_API void*         dsn_object_pool_malloc(dsn_object_pool_type_t type, uint32_t size);
+
+/*! free to the object pool of the owner thread, paired with \ref dsn_object_pool_malloc, can be called on any thread */
+extern DSN_API void          dsn_object_pool_free(dsn_object_pool_type_t type, void* ptr);
+
 /*! common malloc, paird with dsn_free to ensure malloc/free are done by dsn.core */
 extern DSN_API void*         dsn_malloc(uint32_t size);
 
@@ -224,6 +224,19 @@ namespace dsn
         int  total_size() const { return _size; }
         int  get_remaining_size() const { return _remaining_size; }
 
+        // make the buffer held (see blob::has_holder) so that blobs can be sliced from it
+        // without copying, which is called lazily by the decoders on the first blob;
+        // returns false when the buffer cannot be held
+        virtual bool hold_buffer() { return _blob.has_holder(); }
+
+    protected:
+        // replace the buffer with the same one held by holder, the read position is kept
+        void set_buffer_holder(std::shared_ptr<char>&& holder)
+        {
+            dassert(holder.get() == _blob.data(), "holder must point to the beginning of the buffer");
+            _blob = blob(std::move(holder), 0, _blob.length());
+        }
+
     private:
         blob        _blob;
         int         _size;
@@ -70,6 +70,21 @@ namespace dsn {
 
     typedef callocator_object<dsn_transient_malloc, dsn_transient_free> transient_object;
 
+    template <dsn_object_pool_type_t type>
+    void* object_pool_malloc(uint32_t size)
+    {
+        return dsn_object_pool_malloc(type, size);
+    }
+
+    template <dsn_object_pool_type_t type>
+    void object_pool_free(void* p)
+    {
+        dsn_object_pool_free(type, p);
+    }
+
+    template <dsn_object_pool_type_t type>
+    using pooled_object = callocator_object<object_pool_malloc<type>, object_pool_free<type>>;
+
     template <typename T, t_allocate a, t_deallocate d>
     class callocator : public std::allocator<T>
     {
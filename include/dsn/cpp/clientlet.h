@@ -401,6 +401,13 @@ namespace dsn
     */
     namespace file
     {
+        // buffer aligned to DSN_FILE_DIRECT_IO_ALIGNMENT for files opened with DSN_O_DIRECT
+        inline blob create_aligned_buffer(size_t size)
+        {
+            std::shared_ptr<char> buffer((char*)dsn_file_alloc_aligned_buffer(size), dsn_file_free_aligned_buffer);
+            return blob(std::move(buffer), (unsigned int)size);
+        }
+
         task_ptr create_aio_task(
             dsn_task_code_t callback_code,
             clientlet* svc,
@@ -31,10 +31,12 @@
  * Revision history:
  *     Dec., 2015, @Tianyi Wang, first version
  *     Jun., 2016, @Weijie Sun, add support for json decode
+ *     xxxx-xx-xx, author, add json_writer and non-asserting single-pass decoding
  */
 
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <unordered_map>
@@ -43,14 +45,19 @@
 #include <string>
 #include <type_traits>
 #include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <dsn/utility/autoref_ptr.h>
+#include <dsn/cpp/blob.h>
 #include <dsn/cpp/auto_codes.h>
 #include <dsn/cpp/utils.h>
 #include <dsn/cpp/serialization_helper/dsn.layer2.types.h>
 
 #define JsonSplitter "{}[]:,\""
 
-#define JSON_ENCODE_ENTRY(out, prefix, T) out << "\""#T"\":"; ::dsn::json::json_forwarder<std::decay<decltype((prefix).T)>::type>::encode(out, (prefix).T)
+#define JSON_ENCODE_ENTRY(out, prefix, T) out << "\""#T"\":"; ::dsn::json::json_forwarder<typename std::decay<decltype((prefix).T)>::type>::encode(out, (prefix).T)
 #define JSON_ENCODE_ENTRIES2(out, prefix, T1, T2) JSON_ENCODE_ENTRY(out, prefix, T1); out << ","; JSON_ENCODE_ENTRY(out, prefix, T2)
 #define JSON_ENCODE_ENTRIES3(out, prefix, T1, T2, T3) JSON_ENCODE_ENTRIES2(out, prefix, T1, T2); out << ","; JSON_ENCODE_ENTRY(out, prefix, T3)
 #define JSON_ENCODE_ENTRIES4(out, prefix, T1, T2, T3, T4) JSON_ENCODE_ENTRIES3(out, prefix, T1, T2, T3); out << ","; JSON_ENCODE_ENTRY(out, prefix, T4)
@@ -107,13 +114,17 @@ void encode_json_state(std::stringstream& out) const \
 {\
     JSON_ENCODE_ENTRIES(out, *this, __VA_ARGS__);\
 }\
+void encode_json_state(dsn::json::json_writer& out) const \
+{\
+    JSON_ENCODE_ENTRIES(out, *this, __VA_ARGS__);\
+}\
 void decode_json_state(dsn::json::string_tokenizer& in) \
 {\
     JSON_DECODE_ENTRIES(in, *this, __VA_ARGS__);\
 }
 
 #define ENUM_TYPE_SERIALIZATION(EnumType, InvalidEnum) \
-inline void json_encode(std::stringstream& out, const EnumType& enum_variable)\
+template<typename TOut> inline void json_encode(TOut& out, const EnumType& enum_variable)\
 {\
     out << "\"" << enum_to_string(enum_variable) << "\"";\
 }\
@@ -126,12 +137,146 @@ inline void json_decode(dsn::json::string_tokenizer& in, EnumType& enum_variable
 
 namespace dsn { namespace json {
 
+//
+// json_writer appends the encoded text directly into the blocks of a binary_writer,
+// so that large responses are produced without going through std::stringstream and
+// without copying the result again into a std::string.
+//
+// it supports the same "out << ..." usage as std::stringstream, so that all
+// json_encode functions and the JSON_ENCODE_ENTRIES macros work on both of them;
+// numbers and bools are formatted the same way as the default std::ostream does.
+//
+// the space acquired from the writer but not used is returned by flush(),
+// which is also called on destruction.
+//
+class json_writer
+{
+public:
+    explicit json_writer(binary_writer& writer) : _writer(writer), _ptr(nullptr), _end(nullptr) {}
+    ~json_writer() { flush(); }
+
+    void flush()
+    {
+        if (_end != _ptr)
+        {
+            _writer.backup(static_cast<int>(_end - _ptr));
+            _end = _ptr;
+        }
+    }
+
+    void write(const char* data, size_t len)
+    {
+        if (static_cast<size_t>(_end - _ptr) >= len)
+        {
+            memcpy(_ptr, data, len);
+            _ptr += len;
+        }
+        else
+        {
+            write_slow(data, len);
+        }
+    }
+
+    void put(char c)
+    {
+        if (_ptr != _end)
+            *_ptr++ = c;
+        else
+            write_slow(&c, 1);
+    }
+
+    json_writer& operator << (const char* s) { write(s, strlen(s)); return *this; }
+    json_writer& operator << (const std::string& s) { write(s.c_str(), s.length()); return *this; }
+    json_writer& operator << (char c) { put(c); return *this; }
+    json_writer& operator << (bool b) { put(b ? '1' : '0'); return *this; }
+    json_writer& operator << (float v) { write_double(v); return *this; }
+    json_writer& operator << (double v) { write_double(v); return *this; }
+
+    template<typename TInt>
+    typename std::enable_if<std::is_integral<TInt>::value, json_writer&>::type operator << (TInt v)
+    {
+        if (std::is_signed<TInt>::value && v < 0)
+            write_integer(static_cast<uint64_t>(0) - static_cast<uint64_t>(v), true);
+        else
+            write_integer(static_cast<uint64_t>(v), false);
+        return *this;
+    }
+
+private:
+    void write_integer(uint64_t v, bool negative)
+    {
+        char buf[24];
+        char* p = buf + sizeof(buf);
+        do
+        {
+            *--p = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        if (negative)
+            *--p = '-';
+        write(p, buf + sizeof(buf) - p);
+    }
+
+    void write_double(double v)
+    {
+        // same as the default precision of std::ostream
+        char buf[32];
+        int n = snprintf(buf, sizeof(buf), "%g", v);
+        if (n > 0)
+            write(buf, static_cast<size_t>(n) < sizeof(buf) ? n : sizeof(buf) - 1);
+    }
+
+    void write_slow(const char* data, size_t len)
+    {
+        // fill the current region first
+        size_t n = static_cast<size_t>(_end - _ptr);
+        if (n > 0)
+        {
+            memcpy(_ptr, data, n);
+            _ptr = _end;
+            data += n;
+            len -= n;
+        }
+
+        void* ptr;
+        int size;
+        _writer.next(&ptr, &size);
+        _ptr = (char*)ptr;
+        _end = _ptr + size;
+
+        n = std::min(len, static_cast<size_t>(size));
+        memcpy(_ptr, data, n);
+        _ptr += n;
+
+        // let the writer allocate a large enough buffer for the rest
+        if (n < len)
+        {
+            _writer.write(data + n, static_cast<int>(len - n));
+            _end = _ptr;
+        }
+    }
+
+private:
+    binary_writer& _writer;
+    char*          _ptr;
+    char*          _end;
+};
+
+//
+// string_tokenizer decodes the json text in a single pass over the buffer.
+//
+// it never asserts or throws on malformed input: the first error puts the
+// tokenizer into the failed state, after which all operations are no-ops
+// and peek_next() returns '\0', so the decoding loops terminate quickly.
+// callers check good() after decoding.
+//
 class string_tokenizer
 {
 private:
     const char* buffer;
     unsigned pos;
     unsigned length;
+    bool failed;
 public:
     static bool is_json_splitter(char token)
     {
@@ -141,57 +286,60 @@ public:
                 return true;
         return false;
     }
-public:
-    string_tokenizer(const char* b, unsigned offset, unsigned len): buffer(b), pos(offset), length(len)
+    static bool is_blank(char c)
     {
-        dassert(pos<length, "");
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
     }
+public:
+    string_tokenizer(const char* b, unsigned offset, unsigned len): buffer(b), pos(offset), length(len), failed(offset >= len) {}
     string_tokenizer(const dsn::blob& source, unsigned from): string_tokenizer(source.data(), from, source.length()) {}
     string_tokenizer(const dsn::blob& source): string_tokenizer(source.data(), 0, source.length()) {}
     string_tokenizer(const std::string& source, unsigned from): string_tokenizer(source.c_str(), from, source.size()) {}
     string_tokenizer(const std::string& source): string_tokenizer(source.c_str(), 0, source.size()) {}
 
+    bool good() const { return !failed; }
+    void set_error() { failed = true; }
+
     void expect_token(const char* token)
     {
-        while (pos<length && isblank(buffer[pos])) ++pos;
+        if (failed)
+            return;
+        skip_blank();
         int j=0;
         while (pos<length && token[j]!=0 && buffer[pos]==token[j])
             ++pos, ++j;
         if (token[j]!=0)
-        {
-            dassert(false, "invalid buffer:%s at pos %d", buffer, pos);
-        }
+            failed = true;
     }
     void expect_token(char token)
     {
-        while (pos<length && isblank(buffer[pos])) ++pos;
+        if (failed)
+            return;
+        skip_blank();
         if (pos<length && buffer[pos] == token)
             ++pos;
         else
-        {
-            dassert(false, "invalid buffer:%s at pos %d", buffer, pos);
-        }
+            failed = true;
     }
     char peek_next() const
     {
-        int i = pos;
-        while (i<length && isblank(buffer[i])) ++i;
-        return buffer[i];
+        if (failed)
+            return '\0';
+        unsigned i = pos;
+        while (i<length && is_blank(buffer[i])) ++i;
+        return i < length ? buffer[i] : '\0';
     }
     void walk_until(char token)
     {
-        while (pos<length && buffer[pos]!=token) ++pos;
-        if (pos<length && buffer[pos]==token)
+        if (failed)
             return;
-        else
-        {
-            dassert(false, "invalid buffer:%s at pos %d", buffer, pos);
-        }
+        while (pos<length && buffer[pos]!=token) ++pos;
+        if (pos >= length)
+            failed = true;
     }
     void walk_until_json_splitter()
     {
         while (pos<length && !is_json_splitter(buffer[pos])) ++pos;
-        return;
     }
     unsigned tell() const { return pos; }
     void forward() { ++pos; }
@@ -200,59 +348,303 @@ public:
     {
         output.assign(buffer+from, to-from);
     }
+
+    template<typename TInt>
+    void read_integer(TInt& v)
+    {
+        typedef typename std::make_unsigned<TInt>::type utype;
+
+        if (failed)
+            return;
+        skip_blank();
+
+        bool negative = false;
+        if (pos < length && buffer[pos] == '-')
+        {
+            if (!std::is_signed<TInt>::value)
+            {
+                failed = true;
+                return;
+            }
+            negative = true;
+            ++pos;
+        }
+
+        utype limit = static_cast<utype>(std::numeric_limits<TInt>::max());
+        if (negative)
+            limit = static_cast<utype>(limit + 1);
+
+        utype result = 0;
+        unsigned start = pos;
+        while (pos < length && buffer[pos] >= '0' && buffer[pos] <= '9')
+        {
+            utype d = static_cast<utype>(buffer[pos] - '0');
+            if (result > (limit - d) / 10)
+            {
+                failed = true;
+                return;
+            }
+            result = static_cast<utype>(result * 10 + d);
+            ++pos;
+        }
+
+        if (pos == start || !at_value_end())
+        {
+            failed = true;
+            return;
+        }
+        v = negative ? static_cast<TInt>(static_cast<utype>(0) - result) : static_cast<TInt>(result);
+    }
+
+    void read_double(double& v)
+    {
+        if (failed)
+            return;
+        skip_blank();
+
+        unsigned start = pos;
+        while (pos < length && !is_json_splitter(buffer[pos]) && !is_blank(buffer[pos])) ++pos;
+
+        // strtod requires a null-terminated string, while the buffer is not
+        char tmp[64];
+        unsigned len = pos - start;
+        if (len == 0 || len >= sizeof(tmp))
+        {
+            failed = true;
+            return;
+        }
+        memcpy(tmp, buffer + start, len);
+        tmp[len] = '\0';
+
+        char* end;
+        double d = strtod(tmp, &end);
+        if (end != tmp + len)
+        {
+            failed = true;
+            return;
+        }
+        v = d;
+    }
+
+    void read_float(float& v)
+    {
+        double d = 0;
+        read_double(d);
+        if (!failed)
+            v = static_cast<float>(d);
+    }
+
+    void read_bool(bool& v)
+    {
+        if (failed)
+            return;
+        skip_blank();
+
+        if (match_word("1") || match_word("true"))
+            v = true;
+        else if (match_word("0") || match_word("false"))
+            v = false;
+        else
+            failed = true;
+    }
+
+    void read_string(std::string& output)
+    {
+        expect_token('\"');
+        if (failed)
+            return;
+
+        // fast path for strings without escape sequences
+        unsigned start = pos;
+        while (pos < length && buffer[pos] != '\"' && buffer[pos] != '\\') ++pos;
+        output.assign(buffer + start, pos - start);
+        if (pos < length && buffer[pos] == '\"')
+        {
+            ++pos;
+            return;
+        }
+
+        while (pos < length)
+        {
+            char c = buffer[pos++];
+            if (c == '\"')
+                return;
+            if (c != '\\')
+            {
+                output.push_back(c);
+                continue;
+            }
+            if (pos >= length)
+                break;
+
+            c = buffer[pos++];
+            switch (c)
+            {
+            case '\"': case '\\': case '/': output.push_back(c); break;
+            case 'b': output.push_back('\b'); break;
+            case 'f': output.push_back('\f'); break;
+            case 'n': output.push_back('\n'); break;
+            case 'r': output.push_back('\r'); break;
+            case 't': output.push_back('\t'); break;
+            case 'u':
+                if (!read_unicode_escape(output))
+                {
+                    failed = true;
+                    return;
+                }
+                break;
+            default:
+                failed = true;
+                return;
+            }
+        }
+
+        // no closing quote
+        failed = true;
+    }
+
+private:
+    void skip_blank()
+    {
+        while (pos<length && is_blank(buffer[pos])) ++pos;
+    }
+
+    bool at_value_end() const
+    {
+        return pos >= length || is_json_splitter(buffer[pos]) || is_blank(buffer[pos]);
+    }
+
+    bool match_word(const char* word)
+    {
+        unsigned i = pos;
+        for (; *word; ++word, ++i)
+        {
+            if (i >= length || buffer[i] != *word)
+                return false;
+        }
+        if (i < length && !is_json_splitter(buffer[i]) && !is_blank(buffer[i]))
+            return false;
+        pos = i;
+        return true;
+    }
+
+    // \uXXXX in the basic multilingual plane, appended as utf-8
+    bool read_unicode_escape(std::string& output)
+    {
+        if (length - pos < 4)
+            return false;
+
+        unsigned code = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            char c = buffer[pos++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else return false;
+        }
+
+        if (code < 0x80)
+        {
+            output.push_back(static_cast<char>(code));
+        }
+        else if (code < 0x800)
+        {
+            output.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        else
+        {
+            output.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+        return true;
+    }
 };
 
 template<typename> class json_forwarder;
 
-#define DSN_BASE_TYPE_JSON_STATE(TName) \
-inline void json_encode(std::stringstream& out, const TName& t) \
+#define DSN_BASE_TYPE_JSON_STATE(TName, read_func) \
+template<typename TOut> inline void json_encode(TOut& out, const TName& t) \
 {\
-    out << t;\
+    /* unary plus promotes int8_t/uint8_t, so they are printed as numbers rather than characters */ \
+    out << +t;\
 }\
 inline void json_decode(string_tokenizer& in, TName& t)\
 {\
-    int start_pos = in.tell();\
-    in.walk_until_json_splitter();\
-    std::string string_data;\
-    in.assign(start_pos, in.tell(), string_data);\
-    std::istringstream is(string_data);\
-    is >> t;\
+    in.read_func(t);\
+}
+
+DSN_BASE_TYPE_JSON_STATE(bool, read_bool)
+DSN_BASE_TYPE_JSON_STATE(float, read_float)
+DSN_BASE_TYPE_JSON_STATE(double, read_double)
+DSN_BASE_TYPE_JSON_STATE(int8_t, read_integer)
+DSN_BASE_TYPE_JSON_STATE(int16_t, read_integer)
+DSN_BASE_TYPE_JSON_STATE(int32_t, read_integer)
+DSN_BASE_TYPE_JSON_STATE(int64_t, read_integer)
+DSN_BASE_TYPE_JSON_STATE(uint8_t, read_integer)
+DSN_BASE_TYPE_JSON_STATE(uint16_t, read_integer)
+DSN_BASE_TYPE_JSON_STATE(uint32_t, read_integer)
+DSN_BASE_TYPE_JSON_STATE(uint64_t, read_integer)
+
+// quotes and control characters are escaped so that the output is always valid json
+template<typename TOut> inline void json_encode_string(TOut& out, const char* s, size_t len)
+{
+    out << '\"';
+    size_t start = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c >= 0x20 && c != '\"' && c != '\\')
+            continue;
+
+        if (i > start)
+            out.write(s + start, i - start);
+        start = i + 1;
+
+        switch (c)
+        {
+        case '\"': out << "\\\""; break;
+        case '\\': out << "\\\\"; break;
+        case '\b': out << "\\b"; break;
+        case '\f': out << "\\f"; break;
+        case '\n': out << "\\n"; break;
+        case '\r': out << "\\r"; break;
+        case '\t': out << "\\t"; break;
+        default:
+            {
+                char buf[8];
+                snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out << buf;
+            }
+            break;
+        }
+    }
+    if (len > start)
+        out.write(s + start, len - start);
+    out << '\"';
 }
 
-DSN_BASE_TYPE_JSON_STATE(bool)
-DSN_BASE_TYPE_JSON_STATE(float)
-DSN_BASE_TYPE_JSON_STATE(double)
-DSN_BASE_TYPE_JSON_STATE(int8_t)
-DSN_BASE_TYPE_JSON_STATE(int16_t)
-DSN_BASE_TYPE_JSON_STATE(int32_t)
-DSN_BASE_TYPE_JSON_STATE(int64_t)
-DSN_BASE_TYPE_JSON_STATE(uint8_t)
-DSN_BASE_TYPE_JSON_STATE(uint16_t)
-DSN_BASE_TYPE_JSON_STATE(uint32_t)
-DSN_BASE_TYPE_JSON_STATE(uint64_t)
-
-inline void json_encode(std::stringstream& out, const std::string& t)
+template<typename TOut> inline void json_encode(TOut& out, const std::string& t)
 {
-    out << "\"" << t << "\"";
+    json_encode_string(out, t.c_str(), t.length());
 }
 
-inline void json_encode(std::stringstream& out, const char* t)
+template<typename TOut> inline void json_encode(TOut& out, const char* t)
 {
-    out << "\"" << t << "\"";
+    json_encode_string(out, t, strlen(t));
 }
 
 inline void json_decode(string_tokenizer& in, std::string& t)
 {
-    in.expect_token('\"');
-    unsigned start_pos = in.tell();
-    in.walk_until('\"');
-    in.assign(start_pos, in.tell(), t);
-    in.forward();
+    in.read_string(t);
 }
 
 ENUM_TYPE_SERIALIZATION(dsn::app_status::type, dsn::app_status::AS_INVALID)
 
-inline void json_encode(std::stringstream& out, const dsn::gpid& pid)
+template<typename TOut> inline void json_encode(TOut& out, const dsn::gpid& pid)
 {
     out << "\"" << pid.get_app_id() << "." << pid.get_partition_index() << "\"";
 }
@@ -260,12 +652,19 @@ inline void json_decode(dsn::json::string_tokenizer& in, dsn::gpid& pid)
 {
     std::string gpid_message;
     json_decode(in, gpid_message);
+    if (!in.good())
+        return;
+
     dsn_global_partition_id c_gpid;
-    sscanf(gpid_message.c_str(), "%d.%d", &c_gpid.u.app_id, &c_gpid.u.partition_index);
+    if (sscanf(gpid_message.c_str(), "%d.%d", &c_gpid.u.app_id, &c_gpid.u.partition_index) != 2)
+    {
+        in.set_error();
+        return;
+    }
     pid = dsn::gpid(c_gpid);
 }
 
-inline void json_encode(std::stringstream& out, const dsn::rpc_address& address)
+template<typename TOut> inline void json_encode(TOut& out, const dsn::rpc_address& address)
 {
     out << "\"" << address.to_string() << "\"";
 }
@@ -273,15 +672,16 @@ inline void json_decode(dsn::json::string_tokenizer& in, dsn::rpc_address& addre
 {
     std::string rpc_address_string;
     json_decode(in, rpc_address_string);
-    address.from_string_ipv4(rpc_address_string.c_str());
+    if (in.good())
+        address.from_string_ipv4(rpc_address_string.c_str());
 }
 
-inline void json_encode(std::stringstream& out, const dsn::partition_configuration& config);
+template<typename TOut> inline void json_encode(TOut& out, const dsn::partition_configuration& config);
 inline void json_decode(string_tokenizer& in, dsn::partition_configuration& config);
-inline void json_encode(std::stringstream& out, const dsn::app_info& info);
+template<typename TOut> inline void json_encode(TOut& out, const dsn::app_info& info);
 inline void json_decode(string_tokenizer& in, dsn::app_info& info);
 
-template<typename T> inline void json_encode_iterable(std::stringstream& out, const T& t)
+template<typename TOut, typename T> inline void json_encode_iterable(TOut& out, const T& t)
 {
     out << "[";
     for (auto it = t.begin(); it != t.end(); ++it)
@@ -295,7 +695,7 @@ template<typename T> inline void json_encode_iterable(std::stringstream& out, co
     out << "]";
 }
 
-template<typename T> inline void json_encode_map(std::stringstream& out, const T& t)
+template<typename TOut, typename T> inline void json_encode_map(TOut& out, const T& t)
 {
     out << "{";
     for (auto it = t.begin(); it != t.end(); ++it)
@@ -315,7 +715,7 @@ template<typename TMap> inline void json_decode_map(string_tokenizer& in, TMap&
 {
     t.clear();
     in.expect_token('{');
-    while (in.peek_next() != '}')
+    while (in.good() && in.peek_next() != '}')
     {
         if (!t.empty())
         {
@@ -327,15 +727,15 @@ template<typename TMap> inline void json_decode_map(string_tokenizer& in, TMap&
         in.expect_token(':');
         json_forwarder< decltype(value) >::decode(in, value);
 
-        if (!t.emplace(key, value).second)
+        if (in.good() && !t.emplace(std::move(key), std::move(value)).second)
         {
-            throw in.tell();
+            in.set_error();
         }
     }
     in.expect_token('}');
 }
 
-template<typename T> inline void json_encode(std::stringstream& out, const std::vector<T>& t)
+template<typename TOut, typename T> inline void json_encode(TOut& out, const std::vector<T>& t)
 {
     json_encode_iterable(out, t);
 }
@@ -344,7 +744,7 @@ template<typename T> inline void json_decode(string_tokenizer& in, std::vector<T
 {
     t.clear();
     in.expect_token('[');
-    while (in.peek_next() != ']')
+    while (in.good() && in.peek_next() != ']')
     {
         if (!t.empty())
         {
@@ -357,7 +757,7 @@ template<typename T> inline void json_decode(string_tokenizer& in, std::vector<T
     in.expect_token(']');
 }
 
-template<typename T> inline void json_encode(std::stringstream& out, const std::set<T>& t)
+template<typename TOut, typename T> inline void json_encode(TOut& out, const std::set<T>& t)
 {
     json_encode_iterable(out, t);
 }
@@ -366,7 +766,7 @@ template <typename T> inline void json_decode(string_tokenizer& in, std::set<T>&
 {
     t.clear();
     in.expect_token('[');
-    while (in.peek_next() != ']')
+    while (in.good() && in.peek_next() != ']')
     {
         if (!t.empty())
         {
@@ -374,15 +774,15 @@ template <typename T> inline void json_decode(string_tokenizer& in, std::set<T>&
         }
         T result;
         json_forwarder<T>::decode(in, result);
-        if (!t.emplace(std::move(result)).second)
+        if (in.good() && !t.emplace(std::move(result)).second)
         {
-            throw in.tell();
+            in.set_error();
         }
     }
     in.expect_token(']');
 }
 
-template<typename T1, typename T2> inline void json_encode(std::stringstream& out, const std::unordered_map<T1, T2>& t)
+template<typename TOut, typename T1, typename T2> inline void json_encode(TOut& out, const std::unordered_map<T1, T2>& t)
 {
     json_encode_map(out, t);
 }
@@ -392,7 +792,7 @@ template<typename T1, typename T2> inline void json_decode(string_tokenizer& in,
     json_decode_map(in, t);
 }
 
-template<typename T1, typename T2> inline void json_encode(std::stringstream& out, const std::map<T1, T2>& t)
+template<typename TOut, typename T1, typename T2> inline void json_encode(TOut& out, const std::map<T1, T2>& t)
 {
     json_encode_map(out, t);
 }
@@ -402,7 +802,7 @@ template<typename T1, typename T2> inline void json_decode(string_tokenizer& in,
     json_decode_map(in, t);
 }
 
-template<typename T> inline void json_encode(std::stringstream& out, const dsn::ref_ptr<T>& t)
+template<typename TOut, typename T> inline void json_encode(TOut& out, const dsn::ref_ptr<T>& t)
 {
     json_encode(out, *t);
 }
@@ -412,7 +812,7 @@ template<typename T> inline void json_decode(string_tokenizer& in, dsn::ref_ptr<
     json_decode(in, *t);
 }
 
-template<typename T> inline void json_encode(std::stringstream& out, const std::shared_ptr<T>& t)
+template<typename TOut, typename T> inline void json_encode(TOut& out, const std::shared_ptr<T>& t)
 {
     json_encode(out, *t);
 }
@@ -445,19 +845,23 @@ private:
     typedef decltype(p_check_json_state<T>(0)) p_has_json_state;
 
     //internal serialization
-    static void encode_inner(std::stringstream&out, const T& t, std::true_type, std::false_type)
+    template<typename TOut>
+    static void encode_inner(TOut& out, const T& t, std::true_type, std::false_type)
     {
         t.encode_json_state(out);
     }
-    static void encode_inner(std::stringstream&out, const T& t, std::false_type, std::true_type)
+    template<typename TOut>
+    static void encode_inner(TOut& out, const T& t, std::false_type, std::true_type)
     {
         t->encode_json_state(out);
     }
-    static void encode_inner(std::stringstream&out, const T& t, std::true_type, std::true_type)
+    template<typename TOut>
+    static void encode_inner(TOut& out, const T& t, std::true_type, std::true_type)
     {
         t->encode_json_state(out);
     }
-    static void encode_inner(std::stringstream&out, const T& t, std::false_type, std::false_type)
+    template<typename TOut>
+    static void encode_inner(TOut& out, const T& t, std::false_type, std::false_type)
     {
         json_encode(out, t);
     }
@@ -480,16 +884,19 @@ private:
         json_decode(in, t);
     }
 public:
-    static void encode(std::stringstream& out, const T& t)
+    template<typename TOut>
+    static void encode(TOut& out, const T& t)
     {
         encode_inner(out, t, has_json_state{}, p_has_json_state{});
     }
     static dsn::blob encode(const T& t)
     {
-        std::stringstream out;
-        encode_inner(out, t, has_json_state{}, p_has_json_state{});
-        std::string* result = new std::string(out.str());
-        return dsn::blob( std::shared_ptr<char>( const_cast<char*>(result->c_str()), [result](char*){delete result;} ), result->length() );
+        binary_writer writer(4096);
+        {
+            json_writer out(writer);
+            encode_inner(out, t, has_json_state{}, p_has_json_state{});
+        }
+        return writer.get_buffer();
     }
     static void decode(string_tokenizer& in, T& t)
     {
@@ -498,20 +905,12 @@ public:
     static bool decode(const dsn::blob& bb, T& t)
     {
         dsn::json::string_tokenizer tokenizer(bb);
-        try
-        {
-            decode(tokenizer, t);
-            return true;
-        }
-        catch (...)
-        {
-            return false;
-        }
-        return true;
+        decode(tokenizer, t);
+        return tokenizer.good();
     }
 };
 
-inline void json_encode(std::stringstream& out, const dsn::partition_configuration& config)
+template<typename TOut> inline void json_encode(TOut& out, const dsn::partition_configuration& config)
 {
     JSON_ENCODE_ENTRIES(out, config, pid, ballot, max_replica_count, primary, secondaries, last_drops, last_committed_decree);
 }
@@ -519,7 +918,7 @@ inline void json_decode(dsn::json::string_tokenizer& in, dsn::partition_configur
 {
     JSON_DECODE_ENTRIES(in, config, pid, ballot, max_replica_count, primary, secondaries, last_drops, last_committed_decree);
 }
-inline void json_encode(std::stringstream& out, const dsn::app_info& info)
+template<typename TOut> inline void json_encode(TOut& out, const dsn::app_info& info)
 {
     JSON_ENCODE_ENTRIES(out, info, status, app_type, app_name, app_id, partition_count, envs, is_stateful, max_replica_count);
 }
@@ -55,18 +55,24 @@ namespace dsn
         public binary_reader
     {
     public:
-        rpc_read_stream(dsn_message_t msg)
+        // hold_buffer - whether the read buffer may hold a reference of msg, so that the
+        // blobs sliced from it (e.g., by thrift binary decoding) can outlive msg's
+        // other owners; the caller must already hold a reference of msg in this case.
+        // the reference is only taken when a blob is sliced (see binary_reader::hold_buffer)
+        rpc_read_stream(dsn_message_t msg, bool hold_buffer = false)
         {
-            set_read_msg(msg);
+            set_read_msg(msg, hold_buffer);
         }
 
         rpc_read_stream()
+            : _may_hold_buffer(false)
         {        
         }
 
-        void set_read_msg(dsn_message_t msg)
+        void set_read_msg(dsn_message_t msg, bool hold_buffer = false)
         {
             assign(msg, false);
+            _may_hold_buffer = hold_buffer;
 
             void* ptr;
             size_t size;
@@ -77,6 +83,20 @@ namespace dsn
             init(bb);
         }
 
+        virtual bool hold_buffer() override
+        {
+            if (get_buffer().has_holder())
+                return true;
+            if (!_may_hold_buffer)
+                return false;
+
+            auto msg = native_handle();
+            dsn_msg_add_ref(msg);
+            std::shared_ptr<char> holder((char*)get_buffer().data(), [msg](char*) { dsn_msg_release_ref(msg); });
+            set_buffer_holder(std::move(holder));
+            return true;
+        }
+
         ~rpc_read_stream()
         {
             if (native_handle())
@@ -84,6 +104,9 @@ namespace dsn
                 dsn_msg_read_commit(native_handle(), (size_t)(total_size() - get_remaining_size()));
             }
         }
+
+    private:
+        bool _may_hold_buffer;
     };
 
     class rpc_write_stream :
@@ -146,10 +146,13 @@ namespace dsn
         marshall(writer, val, fmt);
     }
 
+    // msg must be referenced by the caller, e.g., requests in rpc handlers and
+    // responses in rpc callbacks, so that blobs in val can share msg's buffer;
+    // msg is only referenced again by the decoded blobs, when there are any
     template<typename T>
     inline void unmarshall(dsn_message_t msg, /*out*/ T& val)
     {
-        ::dsn::rpc_read_stream reader(msg);
+        ::dsn::rpc_read_stream reader(msg, true);
         unmarshall(reader, val, dsn_msg_get_serialize_format(msg));
     }
 }
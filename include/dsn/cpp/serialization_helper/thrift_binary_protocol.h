@@ -0,0 +1,535 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/*
+ * Description:
+ *     thrift binary protocol directly on the contiguous buffers of binary_reader/binary_writer
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+
+# include <dsn/cpp/blob.h>
+
+# include <thrift/Thrift.h>
+# include <thrift/protocol/TVirtualProtocol.h>
+# include <thrift/transport/TTransport.h>
+# include <limits>
+# include <algorithm>
+
+namespace dsn {
+
+    //
+    // thrift_binary_buffer_protocol produces exactly the same bytes as TBinaryProtocol
+    // (strict write, non-strict read), but:
+    //  - it reads from and writes to the buffers of binary_reader/binary_writer directly,
+    //    with bounds checks, instead of going through TVirtualTransport and the
+    //    out-of-line binary_reader/binary_writer read/write for every field;
+    //  - the only virtual call left is the TProtocol interface used by the generated
+    //    code, all the rest is inlined;
+    //  - blob fields are decoded as slices of the input buffer without copying, when the
+    //    input buffer has or can take a holder (see binary_reader::hold_buffer).
+    //
+    // the bytes consumed/produced are committed back to the reader/writer by finish(),
+    // which is also called on destruction.
+    //
+    class thrift_binary_buffer_protocol final
+        : public ::apache::thrift::protocol::TVirtualProtocol<thrift_binary_buffer_protocol>
+    {
+    public:
+        typedef ::apache::thrift::protocol::TType TType;
+        typedef ::apache::thrift::protocol::TMessageType TMessageType;
+        typedef ::apache::thrift::protocol::TProtocolException TProtocolException;
+        typedef ::apache::thrift::transport::TTransportException TTransportException;
+
+        static const int32_t VERSION_MASK = ((int32_t)0xffff0000);
+        static const int32_t VERSION_1 = ((int32_t)0x80010000);
+
+        explicit thrift_binary_buffer_protocol(binary_writer& writer)
+            : TVirtualProtocol<thrift_binary_buffer_protocol>(
+                boost::shared_ptr< ::apache::thrift::transport::TTransport>()),
+            _writer(&writer), _wptr(nullptr), _wend(nullptr),
+            _reader(nullptr), _rbegin(nullptr), _rptr(nullptr), _rend(nullptr)
+        {
+        }
+
+        explicit thrift_binary_buffer_protocol(binary_reader& reader)
+            : TVirtualProtocol<thrift_binary_buffer_protocol>(
+                boost::shared_ptr< ::apache::thrift::transport::TTransport>()),
+            _writer(nullptr), _wptr(nullptr), _wend(nullptr),
+            _reader(&reader), _rbuffer(reader.get_remaining_buffer())
+        {
+            _rbegin = _rptr = _rbuffer.data();
+            _rend = _rbegin + _rbuffer.length();
+        }
+
+        ~thrift_binary_buffer_protocol()
+        {
+            finish();
+        }
+
+        void finish()
+        {
+            if (_writer != nullptr && _wend != _wptr)
+            {
+                _writer->backup(static_cast<int>(_wend - _wptr));
+                _wend = _wptr;
+            }
+
+            if (_reader != nullptr && _rptr != _rbegin)
+            {
+                _reader->skip(static_cast<int>(_rptr - _rbegin));
+                _rbegin = _rptr;
+            }
+        }
+
+        //
+        // writing
+        //
+        uint32_t writeMessageBegin(const std::string& name, const TMessageType messageType, const int32_t seqid)
+        {
+            uint32_t wsize = writeI32(VERSION_1 | ((int32_t)messageType));
+            wsize += writeString(name);
+            wsize += writeI32(seqid);
+            return wsize;
+        }
+
+        uint32_t writeMessageEnd() { return 0; }
+
+        uint32_t writeStructBegin(const char* name) { return 0; }
+
+        uint32_t writeStructEnd() { return 0; }
+
+        uint32_t writeFieldBegin(const char* name, const TType fieldType, const int16_t fieldId)
+        {
+            uint8_t b[3] = { (uint8_t)fieldType, (uint8_t)((uint16_t)fieldId >> 8), (uint8_t)fieldId };
+            write_raw(b, 3);
+            return 3;
+        }
+
+        uint32_t writeFieldEnd() { return 0; }
+
+        uint32_t writeFieldStop()
+        {
+            return writeByte((int8_t)::apache::thrift::protocol::T_STOP);
+        }
+
+        uint32_t writeMapBegin(const TType keyType, const TType valType, const uint32_t size)
+        {
+            uint32_t wsize = writeByte((int8_t)keyType);
+            wsize += writeByte((int8_t)valType);
+            wsize += writeI32((int32_t)size);
+            return wsize;
+        }
+
+        uint32_t writeMapEnd() { return 0; }
+
+        uint32_t writeListBegin(const TType elemType, const uint32_t size)
+        {
+            uint32_t wsize = writeByte((int8_t)elemType);
+            wsize += writeI32((int32_t)size);
+            return wsize;
+        }
+
+        uint32_t writeListEnd() { return 0; }
+
+        uint32_t writeSetBegin(const TType elemType, const uint32_t size)
+        {
+            return writeListBegin(elemType, size);
+        }
+
+        uint32_t writeSetEnd() { return 0; }
+
+        uint32_t writeBool(const bool value)
+        {
+            return writeByte(value ? 1 : 0);
+        }
+
+        uint32_t writeByte(const int8_t byte)
+        {
+            write_raw(&byte, 1);
+            return 1;
+        }
+
+        uint32_t writeI16(const int16_t i16)
+        {
+            uint16_t v = (uint16_t)i16;
+            uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+            write_raw(b, 2);
+            return 2;
+        }
+
+        uint32_t writeI32(const int32_t i32)
+        {
+            uint32_t v = (uint32_t)i32;
+            uint8_t b[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+            write_raw(b, 4);
+            return 4;
+        }
+
+        uint32_t writeI64(const int64_t i64)
+        {
+            uint64_t v = (uint64_t)i64;
+            uint8_t b[8] = {
+                (uint8_t)(v >> 56), (uint8_t)(v >> 48), (uint8_t)(v >> 40), (uint8_t)(v >> 32),
+                (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v 
+            };
+            write_raw(b, 8);
+            return 8;
+        }
+
+        uint32_t writeDouble(const double dub)
+        {
+            static_assert(sizeof(double) == sizeof(uint64_t), "double must be 64 bits");
+            uint64_t bits;
+            memcpy(&bits, &dub, sizeof(bits));
+            return writeI64((int64_t)bits);
+        }
+
+        template<typename StrType>
+        uint32_t writeString(const StrType& str)
+        {
+            if (str.size() > static_cast<size_t>((std::numeric_limits<int32_t>::max)()))
+                throw TProtocolException(TProtocolException::SIZE_LIMIT);
+
+            uint32_t size = static_cast<uint32_t>(str.size());
+            uint32_t result = writeI32((int32_t)size);
+            if (size > 0)
+            {
+                write_raw(str.data(), size);
+            }
+            return result + size;
+        }
+
+        uint32_t writeString(const std::string& str)
+        {
+            return writeString<std::string>(str);
+        }
+
+        uint32_t writeBinary(const std::string& str)
+        {
+            return writeString<std::string>(str);
+        }
+
+        uint32_t write_blob(const blob& data)
+        {
+            uint32_t result = writeI32((int32_t)data.length());
+            if (data.length() > 0)
+            {
+                write_raw(data.data(), data.length());
+            }
+            return result + data.length();
+        }
+
+        //
+        // reading
+        //
+        uint32_t readMessageBegin(std::string& name, TMessageType& messageType, int32_t& seqid)
+        {
+            int32_t sz;
+            uint32_t result = readI32(sz);
+
+            if (sz < 0)
+            {
+                int32_t version = sz & VERSION_MASK;
+                if (version != VERSION_1)
+                {
+                    throw TProtocolException(TProtocolException::BAD_VERSION, "Bad version identifier");
+                }
+                messageType = (TMessageType)(sz & 0x000000ff);
+                result += readString(name);
+                result += readI32(seqid);
+            }
+            else
+            {
+                ensure(static_cast<uint32_t>(sz));
+                name.assign(_rptr, static_cast<size_t>(sz));
+                _rptr += sz;
+                result += static_cast<uint32_t>(sz);
+
+                int8_t type;
+                result += readByte(type);
+                messageType = (TMessageType)type;
+                result += readI32(seqid);
+            }
+            return result;
+        }
+
+        uint32_t readMessageEnd() { return 0; }
+
+        uint32_t readStructBegin(std::string& name)
+        {
+            name = "";
+            return 0;
+        }
+
+        uint32_t readStructEnd() { return 0; }
+
+        uint32_t readFieldBegin(std::string& name, TType& fieldType, int16_t& fieldId)
+        {
+            int8_t type;
+            uint32_t result = readByte(type);
+            fieldType = (TType)type;
+            if (fieldType == ::apache::thrift::protocol::T_STOP)
+            {
+                fieldId = 0;
+                return result;
+            }
+            result += readI16(fieldId);
+            return result;
+        }
+
+        uint32_t readFieldEnd() { return 0; }
+
+        uint32_t readMapBegin(TType& keyType, TType& valType, uint32_t& size)
+        {
+            int8_t k, v;
+            int32_t sizei;
+            uint32_t result = readByte(k);
+            keyType = (TType)k;
+            result += readByte(v);
+            valType = (TType)v;
+            result += readI32(sizei);
+            if (sizei < 0)
+            {
+                throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+            }
+            size = (uint32_t)sizei;
+            return result;
+        }
+
+        uint32_t readMapEnd() { return 0; }
+
+        uint32_t readListBegin(TType& elemType, uint32_t& size)
+        {
+            int8_t e;
+            int32_t sizei;
+            uint32_t result = readByte(e);
+            elemType = (TType)e;
+            result += readI32(sizei);
+            if (sizei < 0)
+            {
+                throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+            }
+            size = (uint32_t)sizei;
+            return result;
+        }
+
+        uint32_t readListEnd() { return 0; }
+
+        uint32_t readSetBegin(TType& elemType, uint32_t& size)
+        {
+            return readListBegin(elemType, size);
+        }
+
+        uint32_t readSetEnd() { return 0; }
+
+        uint32_t readBool(bool& value)
+        {
+            int8_t b;
+            readByte(b);
+            value = (b != 0);
+            return 1;
+        }
+
+        // for std::vector<bool>
+        using TVirtualProtocol<thrift_binary_buffer_protocol>::readBool;
+
+        uint32_t readByte(int8_t& byte)
+        {
+            ensure(1);
+            byte = (int8_t)*_rptr++;
+            return 1;
+        }
+
+        uint32_t readI16(int16_t& i16)
+        {
+            ensure(2);
+            const uint8_t* b = (const uint8_t*)_rptr;
+            i16 = (int16_t)(((uint16_t)b[0] << 8) | (uint16_t)b[1]);
+            _rptr += 2;
+            return 2;
+        }
+
+        uint32_t readI32(int32_t& i32)
+        {
+            ensure(4);
+            const uint8_t* b = (const uint8_t*)_rptr;
+            i32 = (int32_t)(((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | ((uint32_t)b[2] << 8) | (uint32_t)b[3]);
+            _rptr += 4;
+            return 4;
+        }
+
+        uint32_t readI64(int64_t& i64)
+        {
+            ensure(8);
+            const uint8_t* b = (const uint8_t*)_rptr;
+            uint64_t v = 0;
+            for (int i = 0; i < 8; i++)
+            {
+                v = (v << 8) | (uint64_t)b[i];
+            }
+            i64 = (int64_t)v;
+            _rptr += 8;
+            return 8;
+        }
+
+        uint32_t readDouble(double& dub)
+        {
+            int64_t bits;
+            readI64(bits);
+            memcpy(&dub, &bits, sizeof(dub));
+            return 8;
+        }
+
+        template<typename StrType>
+        uint32_t readString(StrType& str)
+        {
+            uint32_t size = read_string_size();
+            str.assign(_rptr, size);
+            _rptr += size;
+            return size + 4;
+        }
+
+        uint32_t readString(std::string& str)
+        {
+            return readString<std::string>(str);
+        }
+
+        uint32_t readBinary(std::string& str)
+        {
+            return readString<std::string>(str);
+        }
+
+        // zero-copy when the input buffer has or can take a holder
+        uint32_t read_blob(blob& data)
+        {
+            uint32_t size = read_string_size();
+            if (!_rbuffer.has_holder() && _reader->hold_buffer())
+            {
+                blob held = _reader->get_buffer();
+                _rbuffer = held.range(static_cast<int>(_rbuffer.data() - held.data()), _rbuffer.length());
+            }
+
+            if (_rbuffer.has_holder())
+            {
+                data = _rbuffer.range(static_cast<int>(_rptr - _rbuffer.data()), size);
+            }
+            else
+            {
+                std::shared_ptr<char> buffer(::dsn::make_shared_array<char>(size));
+                memcpy(buffer.get(), _rptr, size);
+                data.assign(std::move(buffer), 0, size);
+            }
+            _rptr += size;
+            return size + 4;
+        }
+
+    private:
+        void write_raw(const void* data, uint32_t len)
+        {
+            if (static_cast<uint32_t>(_wend - _wptr) >= len)
+            {
+                memcpy(_wptr, data, len);
+                _wptr += len;
+            }
+            else
+            {
+                write_raw_slow((const char*)data, len);
+            }
+        }
+
+        void write_raw_slow(const char* data, uint32_t len)
+        {
+            // fill the current region first
+            uint32_t n = static_cast<uint32_t>(_wend - _wptr);
+            if (n > 0)
+            {
+                memcpy(_wptr, data, n);
+                _wptr = _wend;
+                data += n;
+                len -= n;
+            }
+
+            // acquire the next region only when there is data to write,
+            // so that no empty buffer is left in the writer
+            void* ptr;
+            int size;
+            _writer->next(&ptr, &size);
+            _wptr = (char*)ptr;
+            _wend = _wptr + size;
+
+            n = std::min(len, static_cast<uint32_t>(size));
+            memcpy(_wptr, data, n);
+            _wptr += n;
+
+            // let the writer allocate a large enough buffer for the rest
+            if (n < len)
+            {
+                _writer->write(data + n, static_cast<int>(len - n));
+                _wend = _wptr;
+            }
+        }
+
+        void ensure(uint32_t len) const
+        {
+            if (static_cast<uint32_t>(_rend - _rptr) < len)
+            {
+                throw TTransportException(TTransportException::END_OF_FILE,
+                    "no more data to read after end-of-buffer");
+            }
+        }
+
+        uint32_t read_string_size()
+        {
+            int32_t size;
+            readI32(size);
+            if (size < 0)
+            {
+                throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+            }
+            ensure(static_cast<uint32_t>(size));
+            return static_cast<uint32_t>(size);
+        }
+
+    private:
+        // writing
+        binary_writer* _writer;
+        char*          _wptr;
+        char*          _wend;
+
+        // reading
+        binary_reader* _reader;
+        blob           _rbuffer;
+        const char*    _rbegin;
+        const char*    _rptr;
+        const char*    _rend;
+    };
+}
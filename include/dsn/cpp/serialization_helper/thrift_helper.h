@@ -38,6 +38,7 @@
 
 # include <dsn/cpp/rpc_stream.h>
 # include <dsn/cpp/address.h>
+# include <dsn/cpp/serialization_helper/thrift_binary_protocol.h>
 
 # include <thrift/Thrift.h>
 # include <thrift/protocol/TBinaryProtocol.h>
@@ -46,6 +47,7 @@
 # include <thrift/transport/TVirtualTransport.h>
 # include <thrift/TApplicationException.h>
 # include <type_traits>
+# include <typeinfo>
 
 using namespace ::apache::thrift::transport;
 namespace dsn {
@@ -245,10 +247,23 @@ namespace dsn {
         }
     };
 
+    // thrift_binary_buffer_protocol is final, so a typeid check is enough and
+    // much cheaper than dynamic_cast on every field
+    inline thrift_binary_buffer_protocol* as_buffer_protocol(apache::thrift::protocol::TProtocol* proto)
+    {
+        return typeid(*proto) == typeid(thrift_binary_buffer_protocol) ?
+            static_cast<thrift_binary_buffer_protocol*>(proto) : nullptr;
+    }
+
+    inline bool is_binary_protocol(apache::thrift::protocol::TProtocol* proto)
+    {
+        return as_buffer_protocol(proto) != nullptr
+            || dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(proto) != nullptr;
+    }
+
     inline uint32_t rpc_address::read(apache::thrift::protocol::TProtocol *iprot)
     {
-        apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(iprot);
-        if (binary_proto != nullptr)
+        if (is_binary_protocol(iprot))
         {
             //the protocol is binary protocol
             auto r = iprot->readI64(reinterpret_cast<int64_t&>(_addr.u.value));
@@ -314,8 +329,7 @@ namespace dsn {
 
     inline uint32_t rpc_address::write(apache::thrift::protocol::TProtocol *oprot) const
     {
-        apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(oprot);
-        if (binary_proto != nullptr)
+        if (is_binary_protocol(oprot))
         {
             //the protocol is binary protocol
             dassert(_addr.u.v4.type == HOST_TYPE_INVALID || _addr.u.v4.type == HOST_TYPE_IPV4,
@@ -354,8 +368,7 @@ namespace dsn {
 
     inline uint32_t gpid::read(apache::thrift::protocol::TProtocol *iprot)
     {
-        apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(iprot);
-        if (binary_proto != nullptr)
+        if (is_binary_protocol(iprot))
         {
             //the protocol is binary protocol
             return iprot->readI64(reinterpret_cast<int64_t&>(_value.value));
@@ -404,8 +417,7 @@ namespace dsn {
 
     inline uint32_t gpid::write(apache::thrift::protocol::TProtocol *oprot) const
     {
-        apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(oprot);
-        if (binary_proto != nullptr)
+        if (is_binary_protocol(oprot))
         {
             //the protocol is binary protocol
             return oprot->writeI64((int64_t)_value.value);
@@ -431,8 +443,7 @@ namespace dsn {
     {
         std::string task_code_string;
         uint32_t xfer = 0;
-        apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(iprot);
-        if (binary_proto != nullptr)
+        if (is_binary_protocol(iprot))
         {
             //the protocol is binary protocol
             xfer += iprot->readString(task_code_string);
@@ -481,6 +492,12 @@ namespace dsn {
     inline uint32_t task_code::write(apache::thrift::protocol::TProtocol *oprot) const
     {
         const char* name = to_string();
+        thrift_binary_buffer_protocol* buffer_proto = as_buffer_protocol(oprot);
+        if (buffer_proto != nullptr)
+        {
+            return buffer_proto->writeString<char_ptr>(char_ptr(name, static_cast<int>(strlen(name))));
+        }
+
         apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(oprot);
         if (binary_proto != nullptr)
         {
@@ -505,6 +522,12 @@ namespace dsn {
 
     inline uint32_t blob::read(apache::thrift::protocol::TProtocol *iprot)
     {
+        thrift_binary_buffer_protocol* buffer_proto = as_buffer_protocol(iprot);
+        if (buffer_proto != nullptr)
+        {
+            return buffer_proto->read_blob(*this);
+        }
+
         //for optimization, it is dangerous if the oprot is not a binary proto
         apache::thrift::protocol::TBinaryProtocol* binary_proto = static_cast<apache::thrift::protocol::TBinaryProtocol*>(iprot);
         blob_string str(*this);
@@ -513,6 +536,12 @@ namespace dsn {
 
     inline uint32_t blob::write(apache::thrift::protocol::TProtocol *oprot) const
     {
+        thrift_binary_buffer_protocol* buffer_proto = as_buffer_protocol(oprot);
+        if (buffer_proto != nullptr)
+        {
+            return buffer_proto->write_blob(*this);
+        }
+
         apache::thrift::protocol::TBinaryProtocol* binary_proto = static_cast<apache::thrift::protocol::TBinaryProtocol*>(oprot);
         return binary_proto->writeString<blob_string>(blob_string(const_cast<blob&>(*this)));
     }
@@ -520,9 +549,8 @@ namespace dsn {
     inline uint32_t error_code::read(apache::thrift::protocol::TProtocol *iprot)
     {
         std::string ec_string;
-        apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(iprot);
         uint32_t xfer = 0;
-        if (binary_proto != nullptr)
+        if (is_binary_protocol(iprot))
         {
             //the protocol is binary protocol
             xfer += iprot->readString(ec_string);
@@ -571,6 +599,12 @@ namespace dsn {
     inline uint32_t error_code::write(apache::thrift::protocol::TProtocol *oprot) const
     {
         const char* name = to_string();
+        thrift_binary_buffer_protocol* buffer_proto = as_buffer_protocol(oprot);
+        if (buffer_proto != nullptr)
+        {
+            return buffer_proto->writeString<char_ptr>(char_ptr(name, static_cast<int>(strlen(name))));
+        }
+
         apache::thrift::protocol::TBinaryProtocol* binary_proto = dynamic_cast<apache::thrift::protocol::TBinaryProtocol*>(oprot);
         if (binary_proto != nullptr)
         {
@@ -692,8 +726,9 @@ namespace dsn {
         return ::apache::thrift::protocol::T_STRUCT;
     }
 
-    template<typename T>
-    inline void marshall_thrift_internal(const T &val, ::apache::thrift::protocol::TProtocol *proto)
+    // TProtocol_ is the concrete protocol type, so that the calls here are not virtual
+    template<typename T, typename TProtocol_>
+    inline void marshall_thrift_internal(const T &val, TProtocol_ *proto)
     {
         /* 
          * we treat every element as a whole struct
@@ -706,8 +741,8 @@ namespace dsn {
         proto->writeStructEnd();
     }
 
-    template<typename T>
-    inline void unmarshall_thrift_internal(T &val, ::apache::thrift::protocol::TProtocol *proto)
+    template<typename T, typename TProtocol_>
+    inline void unmarshall_thrift_internal(T &val, TProtocol_ *proto)
     {
         std::string fname;
         ::apache::thrift::protocol::TType ftype;
@@ -728,11 +763,9 @@ namespace dsn {
     template<typename T>
     inline void marshall_thrift_binary(binary_writer& writer, const T& val)
     {
-        ::dsn::binary_writer_transport trans(writer);
-        boost::shared_ptr< ::dsn::binary_writer_transport> transport(&trans, [](::dsn::binary_writer_transport*) {});
-        ::apache::thrift::protocol::TBinaryProtocol proto(transport);
+        ::dsn::thrift_binary_buffer_protocol proto(writer);
         marshall_thrift_internal(val, &proto);
-        proto.getTransport()->flush();
+        proto.finish();
     }
 
     template<typename T>
@@ -748,10 +781,9 @@ namespace dsn {
     template<typename T>
     inline void unmarshall_thrift_binary(binary_reader& reader, T &val)
     {
-        ::dsn::binary_reader_transport trans(reader);
-        boost::shared_ptr< ::dsn::binary_reader_transport> transport(&trans, [](::dsn::binary_reader_transport*) {});
-        ::apache::thrift::protocol::TBinaryProtocol proto(transport);
+        ::dsn::thrift_binary_buffer_protocol proto(reader);
         unmarshall_thrift_internal(val, &proto);
+        proto.finish();
     }
 
     template<typename T>
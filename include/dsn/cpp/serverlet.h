@@ -83,6 +83,12 @@ namespace dsn
             return _response == nullptr;
         }
 
+        // for handlers that append extra payload after the marshalled response
+        dsn_message_t response_message() const
+        {
+            return _response;
+        }
+
     private:
         dsn_message_t _response;
     };
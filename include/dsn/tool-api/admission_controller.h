@@ -51,7 +51,13 @@ public:
     admission_controller(task_queue* q, std::vector<std::string>& sargs) : _queue(q) {}
     virtual ~admission_controller() {}
     
+    // called on enqueue of rpc requests into the bound queue,
+    // the rejected requests are replied with ERR_BUSY
     virtual bool is_task_accepted(task* task) = 0;
+
+    // called by the workers when tasks leave the bound queue,
+    // with task->queue_enter_ts_ns set on enqueue
+    virtual void on_task_dequeued(task* task) {}
         
     task_queue* bound_queue() const { return _queue; }
     
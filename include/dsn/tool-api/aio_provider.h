@@ -78,6 +78,12 @@ public:
     virtual error_code   close(dsn_handle_t fh) = 0;
     virtual error_code   flush(dsn_handle_t fh) = 0;
     virtual void         aio(aio_task* aio) = 0;
+
+    // vectored write of buffers to aio->aio()->file_offset, where aio->aio()->buffer_size
+    // is the total size and aio->aio()->buffer is not used; the buffers array only needs to
+    // live through this call, and false is returned (without completing aio) when it is not
+    // supported, in which case the disk engine merges the buffers and calls aio() instead
+    virtual bool         aio_write_vector(aio_task* aio, const dsn_file_buffer_t* buffers, int buffer_count) { return false; }
     virtual disk_aio*    prepare_aio_context(aio_task*) = 0;
 
     virtual void start(io_modifer& ctx) = 0;
@@ -193,6 +193,11 @@ struct service_spec
     ioe_mode                     nfs_io_mode; // whether nfs is per node or per queue
     ioe_mode                     timer_io_mode; // whether timer is per node or per queue
     int                          io_worker_count; // for disk and rpc when per node
+    int                          disk_read_concurrency_per_file; // concurrent read ops on one file
+    int                          disk_read_merge_max_bytes; // adjacent pending reads are merged up to this size
+    int                          disk_readahead_bytes; // read size for sequential reads, 0 to disable
+    bool                         rpc_scalable_client_matcher; // open-addressing table and coarse timeout sweeping
+    int                          rpc_timeout_tick_milliseconds; // timeout sweeping granularity of the scalable matcher
         
     network_client_configs        network_default_client_cfs; // default network configed by tools
     network_server_configs        network_default_server_cfs; // default network configed by tools
@@ -254,6 +259,16 @@ CONFIG_BEGIN(service_spec)
         "how many disk timer services? IOE_PER_NODE, or IOE_PER_QUEUE")
     CONFIG_FLD(int, uint64, io_worker_count, 2, "io thread count, only for IOE_PER_NODE; "
         "for IOE_PER_QUEUE, task workers are served as io threads")
+    CONFIG_FLD(int, uint64, disk_read_concurrency_per_file, 1, "maximum concurrent read operations issued on one file")
+    CONFIG_FLD(int, uint64, disk_read_merge_max_bytes, 1024 * 1024, "adjacent or overlapping pending reads on one file "
+        "are merged into one read up to this size, 0 to disable")
+    CONFIG_FLD(int, uint64, disk_readahead_bytes, 0, "when sequential reads on one file are detected, "
+        "read this size at least and serve the following reads from memory, 0 to disable; "
+        "only writes through the same file handle invalidate the data read ahead")
+    CONFIG_FLD(bool, bool, rpc_scalable_client_matcher, false, "whether to match rpc responses with a sharded "
+        "open-addressing table and track timeouts in a shared timing wheel swept in batches, instead of a timer per call")
+    CONFIG_FLD(int, uint64, rpc_timeout_tick_milliseconds, 10, "how often (ms) the scalable rpc client matcher "
+        "sweeps timeouts, i.e., the granularity of rpc timeouts")
 CONFIG_END
 
 enum sys_exit_type
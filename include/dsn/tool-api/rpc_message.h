@@ -102,7 +102,7 @@ namespace dsn
     class message_ex :
         public ref_counter, 
         public extensible_object<message_ex, 4>,
-        public transient_object
+        public pooled_object<OBJECT_POOL_MESSAGE_EX>
     {
     public:
         message_header         *header;
@@ -147,6 +147,9 @@ namespace dsn
         DSN_API message_ex* create_response();
         DSN_API message_ex* copy(bool clone_content, bool copy_for_receive);
         DSN_API message_ex* copy_and_prepare_send(bool clone_content);
+        // copy of a send message with its own header (e.g., different request id),
+        // the body buffers are shared
+        DSN_API message_ex* copy_with_private_header();
 
         //
         // routines for buffer management
@@ -159,6 +162,11 @@ namespace dsn
         size_t body_size() { return (size_t)header->body_length; }
         DSN_API void* rw_ptr(size_t offset_begin);
 
+        // replace the buffers (and header) with a private contiguous copy, so that
+        // in-place modifications (e.g., data corruption by fault injector) do not
+        // affect other messages sharing the same buffers
+        DSN_API void make_private_buffers();
+
     private:
         DSN_API message_ex();
         DSN_API void prepare_buffer_header();
@@ -190,9 +190,10 @@ private:
 public:
     // used by task queue only
     task*                  next;
+    uint64_t               queue_enter_ts_ns; // only set for queues with admission controllers
 };
 
-class task_c : public task, public transient_object
+class task_c : public task, public pooled_object<OBJECT_POOL_TASK_C>
 {
 public:
     task_c(
@@ -289,7 +290,7 @@ struct rpc_handler_info
 };
 
 class service_node;
-class rpc_request_task : public task, public transient_object
+class rpc_request_task : public task, public pooled_object<OBJECT_POOL_RPC_REQUEST_TASK>
 {
 public:
     rpc_request_task(message_ex* request, rpc_handler_info* h, service_node* node);
@@ -345,6 +346,16 @@ public:
     DSN_API bool     reset_callback(); // used only when replace_callback is called before, not thread-safe
     task_worker_pool* caller_pool() const { return _caller_pool; }
     void             set_caller_pool(task_worker_pool* pl) { _caller_pool = pl; }
+
+    // per-member results of a GRPC_TO_ALL call, collected before the callback is executed
+    struct group_response
+    {
+        rpc_address member;
+        error_code  err;
+        message_ex* response; // nullptr on failure
+    };
+    const std::vector<group_response>& group_responses() const { return _group_responses; }
+    DSN_API void     add_group_response(rpc_address member, error_code err, message_ex* response); // not thread-safe
     
     void  exec() override
     {
@@ -363,6 +374,7 @@ private:
     message_ex*                _response;
     task_worker_pool *         _caller_pool;
     dsn_rpc_response_handler_t _cb;
+    std::vector<group_response> _group_responses;
 
     friend class rpc_engine;    
 };
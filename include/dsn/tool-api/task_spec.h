@@ -91,6 +91,22 @@ ENUM_BEGIN(worker_priority_t, THREAD_xPRIORITY_INVALID)
     ENUM_REG(THREAD_xPRIORITY_HIGHEST)
 ENUM_END(worker_priority_t)
 
+// how an idle worker waits for new tasks
+enum worker_idle_mode_t
+{
+    WORKER_IDLE_BLOCKING,        // park on the queue semaphore immediately
+    WORKER_IDLE_SPIN_THEN_PARK,  // poll for worker_idle_spin_us before parking
+    WORKER_IDLE_BUSY_POLL,       // never park, for workers with dedicated cores
+    WORKER_IDLE_COUNT,
+    WORKER_IDLE_INVALID
+};
+
+ENUM_BEGIN(worker_idle_mode_t, WORKER_IDLE_INVALID)
+    ENUM_REG(WORKER_IDLE_BLOCKING)
+    ENUM_REG(WORKER_IDLE_SPIN_THEN_PARK)
+    ENUM_REG(WORKER_IDLE_BUSY_POLL)
+ENUM_END(worker_idle_mode_t)
+
 enum task_state
 {
     TASK_STATE_READY,
@@ -207,6 +223,9 @@ public:
     // configurable [
     dsn_task_priority_t    priority;
     grpc_mode_t            grpc_mode; // used when a rpc request is sent to a group address
+    int32_t                grpc_to_all_quorum; // successful member responses to complete a GRPC_TO_ALL call, 0 for all
+    int32_t                grpc_to_any_hedge_delay_milliseconds; // delay before a GRPC_TO_ANY request is duplicated, 0 for disabled
+    bool                   grpc_to_any_hedge_adaptive; // use observed P95 latency as the hedge delay
     dsn_threadpool_code_t  pool_code;
 
     // allow task executed in other thread pools or tasks    
@@ -238,33 +257,33 @@ public:
      @addtogroup tool-api-hooks 
      @{
      */
-    join_point<void, task*, task*>               on_task_create;
+    task_join_point<void, task*, task*>          on_task_create;
 
-    join_point<void, task*, task*>               on_task_enqueue;    
-    join_point<void, task*>                      on_task_begin; // TODO: parent task
-    join_point<void, task*>                      on_task_end;
-    join_point<void, task*>                      on_task_cancelled;
+    task_join_point<void, task*, task*>          on_task_enqueue;    
+    task_join_point<void, task*>                 on_task_begin; // TODO: parent task
+    task_join_point<void, task*>                 on_task_end;
+    task_join_point<void, task*>                 on_task_cancelled;
 
-    join_point<void, task*, task*, uint32_t>     on_task_wait_pre; // waitor, waitee, timeout
-    join_point<void, task*>                      on_task_wait_notified;
-    join_point<void, task*, task*, bool>         on_task_wait_post; // wait succeeded or timedout
-    join_point<void, task*, task*, bool>         on_task_cancel_post; // cancel succeeded or not
+    task_join_point<void, task*, task*, uint32_t>     on_task_wait_pre; // waitor, waitee, timeout
+    task_join_point<void, task*>                 on_task_wait_notified;
+    task_join_point<void, task*, task*, bool>    on_task_wait_post; // wait succeeded or timedout
+    task_join_point<void, task*, task*, bool>    on_task_cancel_post; // cancel succeeded or not
     
 
     // AIO
-    join_point<bool, task*, aio_task*>           on_aio_call; // return true means continue, otherwise early terminate with task::set_error_code
-    join_point<void, aio_task*>                  on_aio_enqueue; // aio done, enqueue callback
+    task_join_point<bool, task*, aio_task*>      on_aio_call; // return true means continue, otherwise early terminate with task::set_error_code
+    task_join_point<void, aio_task*>             on_aio_enqueue; // aio done, enqueue callback
 
     // RPC_REQUEST
-    join_point<bool, task*, message_ex*, rpc_response_task*>  on_rpc_call; // return true means continue, otherwise dropped and (optionally) timedout
-    join_point<bool, rpc_request_task*>          on_rpc_request_enqueue;
+    task_join_point<bool, task*, message_ex*, rpc_response_task*>  on_rpc_call; // return true means continue, otherwise dropped and (optionally) timedout
+    task_join_point<bool, rpc_request_task*>     on_rpc_request_enqueue;
     
     // RPC_RESPONSE
-    join_point<bool, task*, message_ex*>         on_rpc_reply;
-    join_point<bool, rpc_response_task*>         on_rpc_response_enqueue; // response, task
+    task_join_point<bool, task*, message_ex*>    on_rpc_reply; // caller is null when replied outside of tasks, e.g., by task queues and admission controllers
+    task_join_point<bool, rpc_response_task*>    on_rpc_response_enqueue; // response, task
 
     // message data flow
-    join_point<void, message_ex*, message_ex*>   on_rpc_create_response;
+    task_join_point<void, message_ex*, message_ex*>   on_rpc_create_response;
     /*@}*/
 
 public:    
@@ -278,6 +297,9 @@ public:
 CONFIG_BEGIN(task_spec)
     CONFIG_FLD_ENUM(dsn_task_priority_t, priority, TASK_PRIORITY_COMMON, TASK_PRIORITY_INVALID, true, "task priority")
     CONFIG_FLD_ENUM(grpc_mode_t, grpc_mode, GRPC_TO_LEADER, GRPC_INVALID, false, "group rpc mode: GRPC_TO_LEADER, GRPC_TO_ALL, GRPC_TO_ANY")
+    CONFIG_FLD(int32_t, uint64, grpc_to_all_quorum, 0, "for GRPC_TO_ALL, how many successful member responses complete the call: 1 for the first response, k for a quorum of k, 0 for all members")
+    CONFIG_FLD(int32_t, uint64, grpc_to_any_hedge_delay_milliseconds, 0, "for GRPC_TO_ANY, after how many milliseconds without response a duplicate request is sent to another member and the first reply is taken, 0 for disable hedging")
+    CONFIG_FLD(bool, bool, grpc_to_any_hedge_adaptive, false, "for GRPC_TO_ANY, whether to use the observed P95 latency of this rpc as the hedge delay, grpc_to_any_hedge_delay_milliseconds is used before enough latencies are observed")
     CONFIG_FLD_ID(threadpool_code2, pool_code, THREAD_POOL_DEFAULT, true, "thread pool to execute the task")
     CONFIG_FLD(bool, bool, allow_inline, false, 
         "allow task executed in other thread pools or tasks "
@@ -310,6 +332,10 @@ struct threadpool_spec
     worker_priority_t       worker_priority;
     bool                    worker_share_core;
     uint64_t                worker_affinity_mask;
+    safe_string             worker_cpus;
+    safe_string             worker_numa_nodes;
+    worker_idle_mode_t      worker_idle_mode;
+    int                     worker_idle_spin_us;
     int                     dequeue_batch_size;
     bool                    partitioned;         // false by default
     safe_string             queue_factory_name;
@@ -336,6 +362,11 @@ CONFIG_BEGIN(threadpool_spec)
     CONFIG_FLD_ENUM(worker_priority_t, worker_priority, THREAD_xPRIORITY_NORMAL, THREAD_xPRIORITY_INVALID, false, "thread priority")
     CONFIG_FLD(bool, bool, worker_share_core, true, "whether the threads share all assigned cores")
     CONFIG_FLD(uint64_t, uint64, worker_affinity_mask, 0, "what CPU cores are assigned to this pool, 0 for all")
+    CONFIG_FLD_STRING(worker_cpus, "", "what CPU cores are assigned to this pool as a list, e.g., 0-15,32-47, for any core count; overrides worker_affinity_mask")
+    CONFIG_FLD_STRING(worker_numa_nodes, "", "what NUMA nodes are assigned to this pool, e.g., 0,1; their CPU cores are added to worker_cpus")
+    CONFIG_FLD_ENUM(worker_idle_mode_t, worker_idle_mode, WORKER_IDLE_BLOCKING, WORKER_IDLE_INVALID, false,
+        "how idle workers wait for tasks: WORKER_IDLE_BLOCKING, WORKER_IDLE_SPIN_THEN_PARK, or WORKER_IDLE_BUSY_POLL")
+    CONFIG_FLD(int, uint64, worker_idle_spin_us, 50, "spin budget in microseconds before parking, for WORKER_IDLE_SPIN_THEN_PARK")
     CONFIG_FLD(bool, bool, partitioned, false, "whethe the threads share a single queue(partitioned=false) or not; the latter is usually for workload hash partitioning for avoiding locking")
     CONFIG_FLD_STRING(queue_factory_name, "", "task queue provider name")
     CONFIG_FLD_STRING(worker_factory_name, "", "task worker provider name")
@@ -41,6 +41,7 @@
 # include <dsn/utility/dlib.h>
 # include <dsn/tool-api/perf_counter.h>
 # include <thread>
+# include <vector>
 
 namespace dsn {
  
@@ -95,6 +96,7 @@ public:
     DSN_API static void set_name(const char* name);
     DSN_API static void set_priority(worker_priority_t pri);
     DSN_API static void set_affinity(uint64_t affinity);
+    DSN_API static void set_affinity(const std::vector<int>& cpus); // sorted cpu ids, for any core count
 
 private:
     void run_internal();
@@ -36,6 +36,8 @@
 # pragma once
 
 # include <dsn/utility/extensible_object.h>
+# include <atomic>
+# include <tuple>
 
 
 namespace dsn
@@ -54,6 +56,7 @@ public:
     bool put_replace(const char* base, void* fn, const char* name);
 
     const char* name() const { return _name.c_str(); }
+    bool is_empty() const { return _advices.load(std::memory_order_acquire) == nullptr; }
         
 protected:
     struct advice_entry
@@ -65,12 +68,23 @@ protected:
         advice_entry *prev;            
     };
 
+    struct advice_item
+    {
+        void        *func;
+        bool         is_native;
+    };
+
     advice_entry _hdr;
     std::string  _name;
+
+    // flat and immutable copy of the advice list used by execute(), terminated
+    // by an item with null func, or nullptr when there is no advice at all
+    std::atomic<advice_item*> _advices;
     
 private:
     advice_entry* new_entry(void* fn, const char* name, bool is_native);
     advice_entry* get_by_name(const char* name);
+    void rebuild();
 };
 
 struct join_point_unused_type {};
@@ -97,8 +111,11 @@ public:
     TReturn execute(T1 p1, T2 p2, T3 p3, TReturn default_return_value)
     {
         TReturn returnValue = default_return_value;
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return default_return_value;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -108,7 +125,6 @@ public:
             {
                 (*(advice_prototype*)&p->func)(p1, p2, p3);
             }
-            p = p->next;
         }
         return returnValue;
     }
@@ -133,8 +149,11 @@ public:
 
     void execute(T1 p1, T2 p2, T3 p3)
     {
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -144,7 +163,6 @@ public:
             {
                 (*(advice_prototype*)&p->func)(p1, p2, p3);
             }
-            p = p->next;
         }
     }
 };
@@ -169,8 +187,11 @@ public:
     TReturn execute(T1 p1, T2 p2, TReturn default_return_value)
     {
         TReturn returnValue = default_return_value;
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return default_return_value;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -180,7 +201,6 @@ public:
             {
                 (*(advice_prototype*)&p->func)(p1, p2);
             }
-            p = p->next;
         }
         return returnValue;
     }
@@ -205,8 +225,11 @@ public:
 
     void execute(T1 p1, T2 p2)
     {
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -216,7 +239,6 @@ public:
             {
                 (*(advice_prototype*)&p->func)(p1, p2);
             }
-            p = p->next;
         }
     }
 };
@@ -241,8 +263,11 @@ public:
     TReturn execute(T1 p1, TReturn default_return_value)
     {
         TReturn returnValue = default_return_value;
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return default_return_value;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -252,7 +277,6 @@ public:
             {
                 (*(advice_prototype*)&p->func)(p1);
             }
-            p = p->next;
         }
         return returnValue;
     }
@@ -277,8 +301,11 @@ public:
 
     void execute(T1 p1)
     {
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -288,7 +315,6 @@ public:
             {
                 (*(advice_prototype*)&p->func)(p1);
             }
-            p = p->next;
         }
     }
 };
@@ -312,8 +338,11 @@ public:
     TReturn execute(TReturn default_return_value)
     {
         TReturn returnValue = default_return_value;
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return default_return_value;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -323,7 +352,6 @@ public:
             {
                 (*(advice_prototype*)&p->func)();
             }
-            p = p->next;
         }
         return returnValue;
     }
@@ -348,8 +376,11 @@ public:
 
     void execute()
     {
-        advice_entry* p = _hdr.next;
-        while (p != &_hdr)
+        advice_item* p = _advices.load(std::memory_order_acquire);
+        if (p == nullptr)
+            return;
+
+        for (; p->func != nullptr; p++)
         {
             if (p->is_native)
             {
@@ -359,9 +390,77 @@ public:
             {
                 (*(advice_prototype*)&p->func)();
             }
-            p = p->next;
         }
     }
 };
 
+//
+// join point which never executes any advice, so that the calls are compiled out
+//
+template<typename TReturn = void, typename T1 = join_point_unused_type, typename T2 = join_point_unused_type, typename T3 = join_point_unused_type>
+class disabled_join_point : public join_point<TReturn, T1, T2, T3>
+{
+public:
+    typedef join_point<TReturn, T1, T2, T3> base_type;
+
+public:
+    disabled_join_point(const char* name) : base_type(name) {}
+    bool put_native(typename base_type::point_prototype point) { return ignore("native"); }
+    bool put_front(typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_back(typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_before(const char* base, typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_after(const char* base, typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_replace(const char* base, typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+
+    // the last argument is always default_return_value
+    template<typename... TArgs>
+    TReturn execute(TArgs&&... args)
+    {
+        return std::get<sizeof...(TArgs) - 1>(std::forward_as_tuple(args...));
+    }
+
+private:
+    // nothing is installed, which the callers see from the false return value
+    bool ignore(const char* name) { return false; }
+};
+
+template<typename T1, typename T2, typename T3>
+class disabled_join_point<void, T1, T2, T3> : public join_point<void, T1, T2, T3>
+{
+public:
+    typedef join_point<void, T1, T2, T3> base_type;
+
+public:
+    disabled_join_point(const char* name) : base_type(name) {}
+    bool put_native(typename base_type::point_prototype point) { return ignore("native"); }
+    bool put_front(typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_back(typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_before(const char* base, typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_after(const char* base, typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+    bool put_replace(const char* base, typename base_type::advice_prototype fn, const char* name) { return ignore(name); }
+
+    template<typename... TArgs>
+    void execute(TArgs&&... args)
+    {
+    }
+
+private:
+    // nothing is installed, which the callers see from the false return value
+    bool ignore(const char* name) { return false; }
+};
+
+//
+// join points on the hot path of tasks, rpc and aio (see task_spec), which are
+// compiled out when DSN_DISABLE_TASK_JOIN_POINTS is defined (cmake option
+// DISABLE_TASK_JOIN_POINTS). Tools relying on them (e.g., tracer, profiler,
+// fault_injector and the emulator) then no longer work.
+//
+# ifdef DSN_DISABLE_TASK_JOIN_POINTS
+template<typename TReturn = void, typename T1 = join_point_unused_type, typename T2 = join_point_unused_type, typename T3 = join_point_unused_type>
+using task_join_point = disabled_join_point<TReturn, T1, T2, T3>;
+# else
+template<typename TReturn = void, typename T1 = join_point_unused_type, typename T2 = join_point_unused_type, typename T3 = join_point_unused_type>
+using task_join_point = join_point<TReturn, T1, T2, T3>;
+# endif
+
 } // end namespace dsn
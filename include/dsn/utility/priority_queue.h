@@ -37,6 +37,8 @@
 
 # include <queue>
 # include <cassert>
+# include <chrono>
+# include <cstdint>
 # include <dsn/utility/synchronize.h>
 
 namespace dsn { namespace utils {
@@ -112,15 +114,37 @@ protected:
     mutable utils::ex_lock_nr_spin _lock;
 };
 
+// how the consumer gets an item in blocking_priority_queue::dequeue
+enum blocking_queue_wait_t
+{
+    BQ_WAIT_READY,   // an item is available on arrival
+    BQ_WAIT_SPIN,    // an item arrives during spinning
+    BQ_WAIT_PARK,    // the consumer falls back to the semaphore wait, which may still be
+                     // satisfied in its own short spinning before sleeping in the kernel
+    BQ_WAIT_TIMEOUT  // no item before timeout
+};
+
 template<typename T, int priority_count, typename TQueue = std::queue<T>>
 class blocking_priority_queue : public priority_queue<T, priority_count, TQueue>
 {
 public:
     blocking_priority_queue(const std::string& name)
-        : priority_queue<T, priority_count, TQueue>(name)
+        : priority_queue<T, priority_count, TQueue>(name), _idle_spin_ns(0), _busy_poll(false)
     {
     }
 
+    //
+    // how an idle consumer waits for new items:
+    //   spin_microseconds = 0, busy_poll = false: park on the semaphore immediately
+    //   spin_microseconds > 0, busy_poll = false: poll for the given time before parking
+    //   busy_poll = true: never park, usually for workers with dedicated cores
+    //
+    void set_idle_strategy(uint64_t spin_microseconds, bool busy_poll)
+    {
+        _idle_spin_ns = spin_microseconds * 1000ULL;
+        _busy_poll = busy_poll;
+    }
+
     virtual long enqueue(T obj, uint32_t priority)
     { 
         auto r = priority_queue<T, priority_count, TQueue>::enqueue(obj, priority);
@@ -130,16 +154,71 @@ public:
 
     virtual T dequeue(/*out*/ long& ct, int millieseconds = 0xffffffff)
     {
-        if (!_sema.wait(millieseconds))
+        blocking_queue_wait_t wait;
+        return dequeue(ct, millieseconds, wait);
+    }
+
+    T dequeue(/*out*/ long& ct, int millieseconds, /*out*/ blocking_queue_wait_t& wait)
+    {
+        wait = wait_for_item(millieseconds);
+        if (wait == BQ_WAIT_TIMEOUT)
         {
             ct = 0;
             return nullptr;
         }
         return priority_queue<T, priority_count, TQueue>::dequeue(ct);
     }
-    
+
+private:
+    blocking_queue_wait_t wait_for_item(int millieseconds)
+    {
+        if (_sema.try_wait())
+            return BQ_WAIT_READY;
+
+        if (_idle_spin_ns == 0 && !_busy_poll)
+            return _sema.wait(millieseconds) ? BQ_WAIT_PARK : BQ_WAIT_TIMEOUT;
+
+        const bool infinite = (TIME_MS_MAX == static_cast<unsigned int>(millieseconds));
+        uint64_t budget_ns = infinite ? UINT64_MAX : static_cast<uint64_t>(millieseconds) * 1000000ULL;
+        if (!_busy_poll && _idle_spin_ns < budget_ns)
+            budget_ns = _idle_spin_ns;
+
+        // the clock is only checked every 64 rounds to keep the polling loop tight
+        auto start = std::chrono::steady_clock::now();
+        uint64_t elapsed_ns = 0;
+        for (uint32_t i = 1; ; i++)
+        {
+            if (_sema.try_wait())
+                return BQ_WAIT_SPIN;
+
+            cpu_relax();
+
+            if ((i & 63) == 0 && budget_ns != UINT64_MAX)
+            {
+                elapsed_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+                if (elapsed_ns >= budget_ns)
+                    break;
+            }
+        }
+
+        if (_busy_poll)
+            return BQ_WAIT_TIMEOUT;
+
+        if (!infinite)
+        {
+            uint64_t elapsed_ms = elapsed_ns / 1000000ULL;
+            if (elapsed_ms >= static_cast<uint64_t>(millieseconds))
+                return _sema.try_wait() ? BQ_WAIT_SPIN : BQ_WAIT_TIMEOUT;
+            millieseconds -= static_cast<int>(elapsed_ms);
+        }
+        return _sema.wait(millieseconds) ? BQ_WAIT_PARK : BQ_WAIT_TIMEOUT;
+    }
+
 private:
     semaphore _sema;
+    uint64_t  _idle_spin_ns;
+    bool      _busy_poll;
 };
 
 }} // end namespace
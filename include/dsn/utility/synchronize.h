@@ -196,11 +196,28 @@ namespace dsn {
                 return true;
             }
 
+            inline bool try_wait()
+            {
+                return _sema.tryWait();
+            }
+
         private:
             LightweightSemaphore _sema;
         };
 
         //--------------------- helpers --------------------------------------
+        // hint for spin-wait loops
+        inline void cpu_relax()
+        {
+# if defined(_MSC_VER)
+            YieldProcessor();
+# elif defined(__i386__) || defined(__x86_64__)
+            __builtin_ia32_pause();
+# else
+            std::atomic_signal_fence(std::memory_order_seq_cst);
+# endif
+        }
+
         template<typename T>
         class auto_lock
         {
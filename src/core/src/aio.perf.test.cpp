@@ -38,9 +38,12 @@
 #include <dsn/cpp/test_utils.h>
 #include <boost/lexical_cast.hpp>
 
-void aio_testcase(uint64_t block_size, size_t concurrency, bool is_write, bool shared)
+void aio_testcase(uint64_t block_size, size_t concurrency, bool is_write, bool shared, bool direct = false)
 {
-    std::unique_ptr<char[]> buffer(new char[block_size]);
+    // direct I/O requires aligned buffers
+    blob buffer = direct ? 
+        file::create_aligned_buffer((size_t)block_size) :
+        blob(make_shared_array<char>((size_t)block_size), (unsigned int)block_size);
     std::vector<dsn_handle_t> files;
     files.resize(concurrency);
 
@@ -70,10 +73,16 @@ void aio_testcase(uint64_t block_size, size_t concurrency, bool is_write, bool s
         flag = O_RDWR;
     }
 
+    if (direct)
+    {
+        flag |= DSN_O_DIRECT;
+    }
+
     if (shared)
     {
         auto file_handle = dsn_file_open("temp", flag, 0666);
         EXPECT_TRUE(file_handle != nullptr);
+        if (file_handle == nullptr) return;
         for (int i = 0; i < concurrency; i++)
             files[i] = file_handle;
     }
@@ -86,6 +95,7 @@ void aio_testcase(uint64_t block_size, size_t concurrency, bool is_write, bool s
             auto file = ss.str();
             auto file_handle = dsn_file_open(file.c_str(), flag, 0666);
             EXPECT_TRUE(file_handle != nullptr);
+            if (file_handle == nullptr) return;
             files[i] = file_handle;
         }
     }
@@ -116,7 +126,7 @@ void aio_testcase(uint64_t block_size, size_t concurrency, bool is_write, bool s
             cb_flying_count++;
             if (is_write)
             {
-                file::write(files[index], buffer.get(), (int)block_size, offset,
+                file::write(files[index], buffer.data(), (int)block_size, offset,
                     LPC_AIO_TEST, nullptr, [idx = index, &cb, &cb_flying_count](::dsn::error_code code, size_t sz) 
                     {                        
                         if (ERR_OK == code)
@@ -126,7 +136,7 @@ void aio_testcase(uint64_t block_size, size_t concurrency, bool is_write, bool s
             }
             else
             {
-                file::read(files[index], buffer.get(), (int)block_size, offset,
+                file::read(files[index], (char*)buffer.data(), (int)block_size, offset,
                     LPC_AIO_TEST, nullptr, [idx = index, &cb, &cb_flying_count](::dsn::error_code code, size_t sz)
                     {                        
                         if (ERR_OK == code)
@@ -154,6 +164,7 @@ void aio_testcase(uint64_t block_size, size_t concurrency, bool is_write, bool s
     std::cout << "is_write = " << is_write        
         << ", block_size = " << block_size
         << ", shared = " << shared
+        << ", direct = " << direct
         << ", concurrency = " << concurrency
         << ", iops = " << (double)ioc / (double)std::chrono::duration_cast<std::chrono::microseconds>(toc - tic).count() * 1000000.0 << " #/s"
         << ", throughput = " << (double)bytes / std::chrono::duration_cast<std::chrono::microseconds>(toc - tic).count() << " mB/s"
@@ -193,3 +204,13 @@ TEST(perf_core, aio)
                 for (auto concurrency : { 1, 2, 4})
                     aio_testcase(blk_size_bytes, concurrency, is_write, shared);
 }
+
+// buffered vs. direct I/O, the buffered reads are mostly served from the page cache
+TEST(perf_core, aio_direct)
+{
+    for (auto is_write : { true, false })
+        for (auto blk_size_bytes : { 4 * 1024, 64 * 1024 })
+            for (auto concurrency : { 1, 4 })
+                for (auto direct : { false, true })
+                    aio_testcase(blk_size_bytes, concurrency, is_write, false, direct);
+}
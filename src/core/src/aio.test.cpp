@@ -37,6 +37,10 @@
 # include <dsn/service_api_cpp.h>
 # include <gtest/gtest.h>
 # include <dsn/cpp/test_utils.h>
+# include <fcntl.h>
+# if !defined(_WIN32)
+# include <unistd.h>
+# endif
 
 using namespace ::dsn;
 
@@ -144,6 +148,224 @@ TEST(core, aio)
     utils::filesystem::remove_path("tmp");
 }
 
+TEST(core, aio_read_merge)
+{
+    // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
+    if (task::get_current_disk() == nullptr) return;
+
+    const int block = 16;
+    const int count = 64;
+    std::string content;
+    for (int i = 0; i < block * count; i++)
+    {
+        content.push_back((char)('a' + i % 26));
+    }
+
+    auto fp = dsn_file_open("tmp_merge", O_RDWR | O_CREAT | O_BINARY, 0666);
+    EXPECT_TRUE(fp != nullptr);
+    auto t = ::dsn::file::write(fp, content.c_str(), (int)content.size(), 0, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->io_size() == content.size());
+    EXPECT_TRUE(dsn_file_close(fp) == ERR_OK);
+
+    // adjacent and overlapping reads queued together are merged into larger reads,
+    // each caller must still get exactly its own range
+    fp = dsn_file_open("tmp_merge", O_RDONLY | O_BINARY, 0);
+    std::vector<std::string> buffers(count * 2, std::string(block, '\0'));
+    std::vector<task_ptr> tasks;
+    for (int i = 0; i < count * 2; i++)
+    {
+        uint64_t offset = (uint64_t)(i / 2) * block + (i % 2) * (block / 2);
+        tasks.push_back(::dsn::file::read(fp, &buffers[i][0], block, offset, LPC_AIO_TEST, nullptr, dsn::empty_callback));
+    }
+
+    for (int i = 0; i < count * 2; i++)
+    {
+        tasks[i]->wait();
+        uint64_t offset = (uint64_t)(i / 2) * block + (i % 2) * (block / 2);
+        size_t expected = std::min((size_t)block, content.size() - (size_t)offset);
+        EXPECT_TRUE(tasks[i]->error() == ERR_OK);
+        EXPECT_TRUE(tasks[i]->io_size() == expected);
+        EXPECT_TRUE(memcmp(&buffers[i][0], content.c_str() + offset, expected) == 0);
+    }
+
+    // read beyond the end of the file
+    std::string tail(block, '\0');
+    t = ::dsn::file::read(fp, &tail[0], block, content.size(), LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->io_size() == 0);
+
+    EXPECT_TRUE(dsn_file_close(fp) == ERR_OK);
+    utils::filesystem::remove_path("tmp_merge");
+}
+
+TEST(core, aio_readahead)
+{
+    // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
+    if (task::get_current_disk() == nullptr) return;
+
+    // see disk_readahead_bytes in test.config.core.ini
+    const int block = 256;
+    const int count = 64;
+    std::string content;
+    for (int i = 0; i < block * count; i++)
+    {
+        content.push_back((char)('a' + i % 26));
+    }
+
+    auto fp = dsn_file_open("tmp_readahead", O_RDWR | O_CREAT | O_BINARY, 0666);
+    ASSERT_TRUE(fp != nullptr);
+    auto t = ::dsn::file::write(fp, content.c_str(), (int)content.size(), 0, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->io_size() == content.size());
+
+    // sequential reads, the third one reads ahead
+    std::string buffer(block, '\0');
+    for (int i = 0; i < 4; i++)
+    {
+        t = ::dsn::file::read(fp, &buffer[0], block, i * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+        t->wait();
+        EXPECT_TRUE(t->error() == ERR_OK);
+        EXPECT_TRUE(t->io_size() == (size_t)block);
+        EXPECT_TRUE(memcmp(&buffer[0], content.c_str() + i * block, block) == 0);
+    }
+
+    // writes through other handles are not seen by the data read ahead
+    std::string changed(block, 'X');
+    auto fp2 = dsn_file_open("tmp_readahead", O_RDWR | O_BINARY, 0666);
+    ASSERT_TRUE(fp2 != nullptr);
+    t = ::dsn::file::write(fp2, changed.c_str(), block, 4 * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->io_size() == (size_t)block);
+    EXPECT_TRUE(dsn_file_close(fp2) == ERR_OK);
+
+    t = ::dsn::file::read(fp, &buffer[0], block, 4 * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->io_size() == (size_t)block);
+    EXPECT_TRUE(memcmp(&buffer[0], content.c_str() + 4 * block, block) == 0);
+
+    // while writes through the same handle invalidate it
+    t = ::dsn::file::write(fp, changed.c_str(), block, 5 * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->io_size() == (size_t)block);
+
+    t = ::dsn::file::read(fp, &buffer[0], block, 5 * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->io_size() == (size_t)block);
+    EXPECT_TRUE(buffer == changed);
+
+    // readaheads overlapping with writes through the same handle never keep the data
+    // from before the writes, whichever of the two completes first
+    for (int i = 0; i < 8; i++)
+    {
+        int b = 8 + i * 4;
+        for (int j = b; j < b + 2; j++)
+        {
+            t = ::dsn::file::read(fp, &buffer[0], block, j * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+            t->wait();
+            EXPECT_TRUE(t->io_size() == (size_t)block);
+        }
+
+        std::string written(block, (char)('A' + i));
+        auto wt = ::dsn::file::write(fp, written.c_str(), block, (b + 3) * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+        t = ::dsn::file::read(fp, &buffer[0], block, (b + 2) * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+        wt->wait();
+        t->wait();
+        EXPECT_TRUE(wt->io_size() == (size_t)block);
+        EXPECT_TRUE(t->io_size() == (size_t)block);
+
+        t = ::dsn::file::read(fp, &buffer[0], block, (b + 3) * block, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+        t->wait();
+        EXPECT_TRUE(t->io_size() == (size_t)block);
+        EXPECT_TRUE(buffer == written) << "round " << i;
+    }
+
+    // concurrent reads across the end of the file, which may be merged and read ahead together
+    std::vector<std::string> buffers(8, std::string(block, '\0'));
+    std::vector<task_ptr> tasks;
+    for (int i = 0; i < 8; i++)
+    {
+        uint64_t offset = (uint64_t)(count - 6 + i) * block;
+        tasks.push_back(::dsn::file::read(fp, &buffers[i][0], block, offset, LPC_AIO_TEST, nullptr, dsn::empty_callback));
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        tasks[i]->wait();
+        size_t offset = (size_t)(count - 6 + i) * block;
+        if (offset < content.size())
+        {
+            EXPECT_TRUE(tasks[i]->error() == ERR_OK);
+            EXPECT_TRUE(tasks[i]->io_size() == (size_t)block);
+            EXPECT_TRUE(memcmp(&buffers[i][0], content.c_str() + offset, block) == 0);
+        }
+        else
+        {
+            EXPECT_TRUE(tasks[i]->io_size() == 0);
+        }
+    }
+
+    EXPECT_TRUE(dsn_file_close(fp) == ERR_OK);
+    utils::filesystem::remove_path("tmp_readahead");
+}
+
+TEST(core, aio_direct)
+{
+    // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
+    if (task::get_current_disk() == nullptr) return;
+
+    auto fp = dsn_file_open("tmp_direct", O_RDWR | O_CREAT | O_BINARY | DSN_O_DIRECT, 0666);
+    if (fp == nullptr)
+    {
+# if defined(O_DIRECT)
+        // some file systems (e.g., tmpfs) do not support direct I/O,
+        // otherwise the failure is ours
+        int fd = ::open("tmp_direct", O_RDWR | O_CREAT | O_DIRECT, 0666);
+        if (fd >= 0)
+        {
+            ::close(fd);
+            utils::filesystem::remove_path("tmp_direct");
+        }
+        ASSERT_TRUE(fd < 0) << "open with DSN_O_DIRECT failed while the file system supports O_DIRECT";
+# endif
+        dwarn("core.aio_direct is skipped as direct I/O is not supported in the current directory");
+        return;
+    }
+
+    const int len = DSN_FILE_DIRECT_IO_ALIGNMENT;
+    auto buffer = file::create_aligned_buffer(len * 2);
+    EXPECT_TRUE((uintptr_t)buffer.data() % DSN_FILE_DIRECT_IO_ALIGNMENT == 0);
+    memset((void*)buffer.data(), 'x', len * 2);
+
+    auto t = ::dsn::file::write(fp, buffer.data(), len * 2, 0, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->error() == ERR_OK);
+    EXPECT_TRUE(t->io_size() == (size_t)len * 2);
+
+    // misaligned buffer, size or offset
+    t = ::dsn::file::write(fp, buffer.data() + 1, len, 0, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->error() == ERR_INVALID_PARAMETERS);
+
+    t = ::dsn::file::write(fp, buffer.data(), len - 1, 0, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->error() == ERR_INVALID_PARAMETERS);
+
+    t = ::dsn::file::read(fp, (char*)buffer.data(), len, 1, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->error() == ERR_INVALID_PARAMETERS);
+
+    // aligned read
+    auto buffer2 = file::create_aligned_buffer(len);
+    t = ::dsn::file::read(fp, (char*)buffer2.data(), len, len, LPC_AIO_TEST, nullptr, dsn::empty_callback);
+    t->wait();
+    EXPECT_TRUE(t->error() == ERR_OK);
+    EXPECT_TRUE(t->io_size() == (size_t)len);
+    EXPECT_TRUE(memcmp(buffer.data(), buffer2.data(), len) == 0);
+
+    EXPECT_TRUE(dsn_file_close(fp) == ERR_OK);
+    utils::filesystem::remove_path("tmp_direct");
+}
+
 TEST(core, aio_share)
 {
     // if in dsn_mimic_app() and disk_io_mode == IOE_PER_QUEUE
@@ -0,0 +1,231 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cpu and numa topology of the host, used for thread pool placement
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "cpu_topology.h"
+# include <algorithm>
+# include <fstream>
+# include <sstream>
+# include <thread>
+# include <cstdlib>
+
+# ifdef __linux__
+# include <dirent.h>
+# include <unistd.h>
+# include <sys/syscall.h>
+# endif
+
+# ifdef __TITLE__
+# undef __TITLE__
+# endif
+# define __TITLE__ "cpu.topology"
+
+namespace dsn {
+    namespace utils {
+
+        bool parse_cpu_list(const char* list, /*out*/ std::vector<int>& cpus)
+        {
+            cpus.clear();
+
+            const char* p = list;
+            while (*p != '\0')
+            {
+                while (*p == ' ' || *p == ',' || *p == '\n')
+                    p++;
+                if (*p == '\0')
+                    break;
+
+                char* end;
+                long first = strtol(p, &end, 10);
+                if (end == p || first < 0)
+                    return false;
+
+                long last = first;
+                p = end;
+                if (*p == '-')
+                {
+                    last = strtol(p + 1, &end, 10);
+                    if (end == p + 1 || last < first)
+                        return false;
+                    p = end;
+                }
+
+                if (*p != '\0' && *p != ',' && *p != ' ' && *p != '\n')
+                    return false;
+
+                for (long i = first; i <= last; i++)
+                    cpus.push_back(static_cast<int>(i));
+            }
+
+            std::sort(cpus.begin(), cpus.end());
+            cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+            return true;
+        }
+
+        std::string format_cpu_list(const std::vector<int>& cpus)
+        {
+            std::stringstream ss;
+            for (size_t i = 0; i < cpus.size(); )
+            {
+                size_t j = i;
+                while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+                    j++;
+
+                if (i != 0)
+                    ss << ",";
+                ss << cpus[i];
+                if (j != i)
+                    ss << "-" << cpus[j];
+                i = j + 1;
+            }
+            return ss.str();
+        }
+
+        cpu_topology::cpu_topology()
+        {
+            _cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+# ifdef __linux__
+            long online = sysconf(_SC_NPROCESSORS_CONF);
+            if (online > _cpu_count)
+                _cpu_count = static_cast<int>(online);
+
+            DIR* dir = opendir("/sys/devices/system/node");
+            if (dir != nullptr)
+            {
+                struct dirent* entry;
+                while ((entry = readdir(dir)) != nullptr)
+                {
+                    int node;
+                    char tail;
+                    if (sscanf(entry->d_name, "node%d%c", &node, &tail) != 1 || node < 0)
+                        continue;
+
+                    std::ifstream file(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+                    std::string list;
+                    std::vector<int> cpus;
+                    if (!std::getline(file, list) || !parse_cpu_list(list.c_str(), cpus))
+                        continue;
+
+                    if (node >= static_cast<int>(_node_cpus.size()))
+                        _node_cpus.resize(node + 1);
+                    _node_cpus[node] = cpus;
+                    if (!cpus.empty() && cpus.back() >= _cpu_count)
+                        _cpu_count = cpus.back() + 1;
+                }
+                closedir(dir);
+            }
+# endif
+
+            if (_cpu_count <= 0)
+                _cpu_count = 1;
+
+            init_cpu_nodes();
+        }
+
+        cpu_topology::cpu_topology(int cpu_count, const std::vector<std::vector<int>>& node_cpus)
+            : _cpu_count(cpu_count), _node_cpus(node_cpus)
+        {
+            for (auto& cpus : _node_cpus)
+            {
+                if (!cpus.empty() && cpus.back() >= _cpu_count)
+                    _cpu_count = cpus.back() + 1;
+            }
+
+            if (_cpu_count <= 0)
+                _cpu_count = 1;
+
+            init_cpu_nodes();
+        }
+
+        void cpu_topology::init_cpu_nodes()
+        {
+            if (_node_cpus.empty())
+            {
+                _node_cpus.resize(1);
+                for (int i = 0; i < _cpu_count; i++)
+                    _node_cpus[0].push_back(i);
+            }
+
+            _cpu_node.resize(_cpu_count, -1);
+            for (size_t node = 0; node < _node_cpus.size(); node++)
+            {
+                for (auto cpu : _node_cpus[node])
+                    _cpu_node[cpu] = static_cast<int>(node);
+            }
+        }
+
+        int cpu_topology::node_of_cpu(int cpu) const
+        {
+            return (cpu >= 0 && cpu < _cpu_count) ? _cpu_node[cpu] : -1;
+        }
+
+        const std::vector<int>& cpu_topology::cpus_of_node(int node) const
+        {
+            static std::vector<int> empty;
+            return (node >= 0 && node < node_count()) ? _node_cpus[node] : empty;
+        }
+
+        int cpu_topology::node_of_cpus(const std::vector<int>& cpus) const
+        {
+            int node = -1;
+            for (auto cpu : cpus)
+            {
+                int n = node_of_cpu(cpu);
+                if (n == -1 || (node != -1 && n != node))
+                    return -1;
+                node = n;
+            }
+            return node;
+        }
+
+        bool set_thread_preferred_numa_node(int node)
+        {
+# if defined(__linux__) && defined(SYS_set_mempolicy)
+            // see <numaif.h>, which is not always installed
+            const int mpol_default = 0;
+            const int mpol_preferred = 1;
+
+            if (node < 0)
+                return 0 == syscall(SYS_set_mempolicy, mpol_default, nullptr, 0);
+
+            const int bits_per_long = static_cast<int>(sizeof(unsigned long) * 8);
+            std::vector<unsigned long> mask(node / bits_per_long + 1, 0);
+            mask[node / bits_per_long] |= 1UL << (node % bits_per_long);
+            return 0 == syscall(SYS_set_mempolicy, mpol_preferred, mask.data(), mask.size() * bits_per_long + 1);
+# else
+            return false;
+# endif
+        }
+    }
+}
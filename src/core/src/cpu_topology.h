@@ -0,0 +1,90 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cpu and numa topology of the host, used for thread pool placement
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+
+# include <dsn/utility/ports.h>
+# include <dsn/utility/singleton.h>
+# include <vector>
+# include <string>
+
+namespace dsn {
+    namespace utils {
+
+        //
+        // the topology is read once from /sys/devices/system/node on linux;
+        // other platforms (or linux without numa) are seen as a single node
+        // containing all the cpus
+        //
+        class cpu_topology : public singleton<cpu_topology>
+        {
+        public:
+            cpu_topology();
+
+            // a given topology instead of the host's, e.g., for tests
+            cpu_topology(int cpu_count, const std::vector<std::vector<int>>& node_cpus);
+
+            int cpu_count() const { return _cpu_count; }
+            int node_count() const { return static_cast<int>(_node_cpus.size()); }
+
+            // -1 when unknown
+            int node_of_cpu(int cpu) const;
+
+            // empty when the node does not exist
+            const std::vector<int>& cpus_of_node(int node) const;
+
+            // the node shared by all the cpus, or -1 when they span multiple nodes
+            int node_of_cpus(const std::vector<int>& cpus) const;
+
+        private:
+            void init_cpu_nodes();
+
+        private:
+            int                           _cpu_count;
+            std::vector<int>              _cpu_node;
+            std::vector<std::vector<int>> _node_cpus;
+        };
+
+        // parse cpu lists like "0-3,8,10-11" into sorted and unique cpu ids
+        extern bool parse_cpu_list(const char* list, /*out*/ std::vector<int>& cpus);
+
+        // the reverse of parse_cpu_list
+        extern std::string format_cpu_list(const std::vector<int>& cpus);
+
+        // pages allocated by the current thread afterwards prefer the given node,
+        // or the default policy when node = -1; returns false when not supported
+        extern bool set_thread_preferred_numa_node(int node);
+    }
+}
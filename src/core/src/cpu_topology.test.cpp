@@ -0,0 +1,220 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for cpu topology.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "cpu_topology.h"
+# include "task_engine.h"
+# include <gtest/gtest.h>
+
+using namespace ::dsn::utils;
+
+TEST(core, cpu_list)
+{
+    std::vector<int> cpus;
+    ASSERT_TRUE(parse_cpu_list("", cpus));
+    ASSERT_TRUE(cpus.empty());
+
+    ASSERT_TRUE(parse_cpu_list("0-3,8,10-11", cpus));
+    ASSERT_EQ(std::vector<int>({ 0, 1, 2, 3, 8, 10, 11 }), cpus);
+    ASSERT_EQ("0-3,8,10-11", format_cpu_list(cpus));
+
+    ASSERT_TRUE(parse_cpu_list("130-127\n", cpus) == false);
+    ASSERT_TRUE(parse_cpu_list("64-66,1, 65\n", cpus));
+    ASSERT_EQ(std::vector<int>({ 1, 64, 65, 66 }), cpus);
+    ASSERT_EQ("1,64-66", format_cpu_list(cpus));
+
+    ASSERT_FALSE(parse_cpu_list("a", cpus));
+    ASSERT_FALSE(parse_cpu_list("1-", cpus));
+    ASSERT_FALSE(parse_cpu_list("-1", cpus));
+    ASSERT_FALSE(parse_cpu_list("1;2", cpus));
+}
+
+TEST(core, cpu_topology)
+{
+    auto& topo = cpu_topology::instance();
+    ASSERT_GE(topo.cpu_count(), 1);
+    ASSERT_GE(topo.node_count(), 1);
+
+    int cpu_count = 0;
+    for (int node = 0; node < topo.node_count(); node++)
+    {
+        auto& cpus = topo.cpus_of_node(node);
+        cpu_count += static_cast<int>(cpus.size());
+        for (auto cpu : cpus)
+        {
+            ASSERT_EQ(node, topo.node_of_cpu(cpu));
+        }
+        if (!cpus.empty())
+        {
+            ASSERT_EQ(node, topo.node_of_cpus(cpus));
+        }
+    }
+    ASSERT_LE(cpu_count, topo.cpu_count());
+    ASSERT_TRUE(topo.cpus_of_node(topo.node_count()).empty());
+    ASSERT_EQ(-1, topo.node_of_cpu(topo.cpu_count()));
+}
+
+// two nodes with 64 cpus each, i.e., more than a 64-bit affinity mask can describe
+static std::vector<std::vector<int>> two_nodes()
+{
+    std::vector<std::vector<int>> node_cpus(2);
+    for (int i = 0; i < 128; i++)
+        node_cpus[i / 64].push_back(i);
+    return node_cpus;
+}
+
+static ::dsn::threadpool_spec placement_spec(int worker_count, bool share_core, bool partitioned,
+    const char* worker_cpus, const char* worker_numa_nodes)
+{
+    ::dsn::threadpool_spec spec(::dsn::THREAD_POOL_DEFAULT);
+    spec.worker_count = worker_count;
+    spec.worker_share_core = share_core;
+    spec.partitioned = partitioned;
+    spec.worker_affinity_mask = 0;
+    spec.worker_cpus = worker_cpus;
+    spec.worker_numa_nodes = worker_numa_nodes;
+    spec.worker_idle_mode = ::dsn::WORKER_IDLE_BLOCKING;
+    return spec;
+}
+
+TEST(core, cpu_topology_given)
+{
+    cpu_topology topo(128, two_nodes());
+    ASSERT_EQ(128, topo.cpu_count());
+    ASSERT_EQ(2, topo.node_count());
+    ASSERT_EQ(0, topo.node_of_cpu(63));
+    ASSERT_EQ(1, topo.node_of_cpu(64));
+    ASSERT_EQ(1, topo.node_of_cpus(std::vector<int>({ 64, 127 })));
+    ASSERT_EQ(-1, topo.node_of_cpus(std::vector<int>({ 63, 64 })));
+}
+
+TEST(core, worker_placements_shared_cores)
+{
+    cpu_topology topo(128, two_nodes());
+    std::vector<::dsn::worker_placement> placements;
+    std::vector<int> queue_nodes;
+
+    // cpus beyond 64, spanning both nodes
+    ::dsn::task_worker_pool::init_placements(placement_spec(2, true, false, "60-67", ""), topo, placements, queue_nodes);
+    ASSERT_EQ(2u, placements.size());
+    for (auto& p : placements)
+    {
+        ASSERT_EQ("60-67", format_cpu_list(p.cpus));
+        ASSERT_EQ(-1, p.numa_node);
+    }
+    ASSERT_EQ(std::vector<int>({ -1 }), queue_nodes);
+
+    // cpus within node 1 only
+    ::dsn::task_worker_pool::init_placements(placement_spec(2, true, false, "96-127", ""), topo, placements, queue_nodes);
+    for (auto& p : placements)
+    {
+        ASSERT_EQ("96-127", format_cpu_list(p.cpus));
+        ASSERT_EQ(1, p.numa_node);
+    }
+    ASSERT_EQ(std::vector<int>({ 1 }), queue_nodes);
+
+    // nonexistent cpus are dropped
+    ::dsn::task_worker_pool::init_placements(placement_spec(1, true, false, "120-130", ""), topo, placements, queue_nodes);
+    ASSERT_EQ("120-127", format_cpu_list(placements[0].cpus));
+    ASSERT_EQ(1, placements[0].numa_node);
+
+    ::dsn::task_worker_pool::init_placements(placement_spec(1, true, false, "200", ""), topo, placements, queue_nodes);
+    ASSERT_TRUE(placements[0].cpus.empty());
+    ASSERT_EQ(-1, placements[0].numa_node);
+    ASSERT_EQ(std::vector<int>({ -1 }), queue_nodes);
+}
+
+TEST(core, worker_placements_dedicated_cores)
+{
+    cpu_topology topo(128, two_nodes());
+    std::vector<::dsn::worker_placement> placements;
+    std::vector<int> queue_nodes;
+
+    // workers take the cpus round-robin
+    ::dsn::task_worker_pool::init_placements(placement_spec(6, false, true, "62-65", ""), topo, placements, queue_nodes);
+    ASSERT_EQ(6u, placements.size());
+    int expected_cpus[] = { 62, 63, 64, 65, 62, 63 };
+    int expected_nodes[] = { 0, 0, 1, 1, 0, 0 };
+    for (int i = 0; i < 6; i++)
+    {
+        ASSERT_EQ(std::vector<int>({ expected_cpus[i] }), placements[i].cpus);
+        ASSERT_EQ(expected_nodes[i], placements[i].numa_node);
+    }
+    ASSERT_EQ(std::vector<int>({ 0, 0, 1, 1, 0, 0 }), queue_nodes);
+
+    // a shared queue has no preferred node when its workers span nodes
+    ::dsn::task_worker_pool::init_placements(placement_spec(6, false, false, "62-65", ""), topo, placements, queue_nodes);
+    ASSERT_EQ(std::vector<int>({ -1 }), queue_nodes);
+
+    // all the cpus are used when none is assigned
+    ::dsn::task_worker_pool::init_placements(placement_spec(130, false, false, "", ""), topo, placements, queue_nodes);
+    ASSERT_EQ(std::vector<int>({ 127 }), placements[127].cpus);
+    ASSERT_EQ(std::vector<int>({ 1 }), placements[129].cpus);
+}
+
+TEST(core, worker_placements_numa_nodes)
+{
+    cpu_topology topo(128, two_nodes());
+    std::vector<::dsn::worker_placement> placements;
+    std::vector<int> queue_nodes;
+
+    // a node expands to all its cpus
+    ::dsn::task_worker_pool::init_placements(placement_spec(2, true, false, "", "1"), topo, placements, queue_nodes);
+    for (auto& p : placements)
+    {
+        ASSERT_EQ("64-127", format_cpu_list(p.cpus));
+        ASSERT_EQ(1, p.numa_node);
+    }
+    ASSERT_EQ(std::vector<int>({ 1 }), queue_nodes);
+
+    // nodes are added to worker_cpus, and nonexistent nodes are ignored
+    ::dsn::task_worker_pool::init_placements(placement_spec(1, true, false, "100", "0,5"), topo, placements, queue_nodes);
+    ASSERT_EQ("0-63,100", format_cpu_list(placements[0].cpus));
+    ASSERT_EQ(-1, placements[0].numa_node);
+
+    // dedicated cores within one node give the shared queue that node
+    ::dsn::task_worker_pool::init_placements(placement_spec(4, false, false, "", "1"), topo, placements, queue_nodes);
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_EQ(std::vector<int>({ 64 + i }), placements[i].cpus);
+        ASSERT_EQ(1, placements[i].numa_node);
+    }
+    ASSERT_EQ(std::vector<int>({ 1 }), queue_nodes);
+
+    // no memory preference on single node hosts
+    cpu_topology single(8, std::vector<std::vector<int>>());
+    ::dsn::task_worker_pool::init_placements(placement_spec(2, false, false, "0-3", ""), single, placements, queue_nodes);
+    ASSERT_EQ(-1, placements[0].numa_node);
+    ASSERT_EQ(std::vector<int>({ -1 }), queue_nodes);
+}
@@ -37,6 +37,7 @@
 # include <dsn/tool-api/perf_counter.h>
 # include <dsn/tool-api/aio_provider.h>
 # include <dsn/cpp/utils.h>
+# include <dsn/cpp/clientlet.h>
 # include "transient_memory.h"
 
 # ifdef __TITLE__
@@ -49,6 +50,7 @@ using namespace dsn::utils;
 namespace dsn {
 
 DEFINE_TASK_CODE_AIO(LPC_AIO_BATCH_WRITE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE_AIO(LPC_AIO_BATCH_READ, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 
 //----------------- disk_file ------------------------
 aio_task* disk_write_queue::unlink_next_workload(void* plength)
@@ -100,10 +102,63 @@ aio_task* disk_write_queue::unlink_next_workload(void* plength)
     return first;
 }
 
-disk_file::disk_file(dsn_handle_t handle)
-    : _handle(handle)
+aio_task* disk_read_queue::unlink_next_workload(void* plength)
 {
+    uint32_t& sz = *(uint32_t*)plength;
+    aio_task *first = _hdr._first;
+    if (first == nullptr)
+    {
+        sz = 0;
+        return nullptr;
+    }
+
+    uint64_t start = first->aio()->file_offset;
+    uint64_t end = start + first->aio()->buffer_size;
+    aio_task *last = first, *current = (aio_task*)first->next;
+    while (nullptr != current)
+    {
+        auto io = current->aio();
+        uint64_t io_end = io->file_offset + io->buffer_size;
+        uint64_t new_end = std::max(end, io_end);
+
+        // batch condition
+        if (io->file_offset >= start 
+            && io->file_offset <= end
+            && new_end - start <= _max_merge_bytes)
+        {
+            end = new_end;
+        }
+
+        // no batch is possible
+        else
+        {
+            break;
+        }
+
+        last = current;
+        current = (aio_task*)current->next;
+    }
+
+    // unlink [first, last] -> current
+    _hdr._first = current;
+    if (last == _hdr._last)
+        _hdr._last = nullptr;
+    last->next = nullptr;
+
+    sz = static_cast<uint32_t>(end - start);
+    return first;
+}
 
+disk_file::disk_file(dsn_handle_t handle, const disk_file_options& opts)
+    : _handle(handle), _readahead_bytes(opts.readahead_bytes), _direct_io(opts.direct_io)
+{
+    _read_queue.init(opts.read_concurrency, opts.read_merge_max_bytes);
+    _read_queue_depth = 0;
+
+    _last_read_end = 0;
+    _sequential_reads = 0;
+    _write_version = 0;
+    _readahead_offset = 0;
 }
 
 void disk_file::ctrl(dsn_ctrl_code_t code, int param)
@@ -112,30 +167,136 @@ void disk_file::ctrl(dsn_ctrl_code_t code, int param)
     dassert(false, "NOT IMPLEMENTED");
 }
 
-aio_task* disk_file::read(aio_task* tsk)
+aio_task* disk_file::read(aio_task* tsk, void* ctx)
 {
     tsk->add_ref(); // release on completion
-    return _read_queue.add_work(tsk, nullptr);
+    ++_read_queue_depth;
+    return _read_queue.add_work(tsk, ctx);
+}
+
+void disk_file::invalidate_readahead_buffer()
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_readahead_lock);
+    _write_version++;
+    _readahead_buffer = blob();
 }
 
 aio_task* disk_file::write(aio_task* tsk, void* ctx)
 {
+    invalidate_readahead_buffer();
+
     tsk->add_ref(); // release on completion
     return _write_queue.add_work(tsk, ctx);
 }
 
-aio_task* disk_file::on_read_completed(aio_task* wk, error_code err, size_t size)
+aio_task* disk_file::on_read_completed(aio_task* wk, void* ctx, error_code err, size_t size)
 {
     dassert(wk->next == nullptr, "");
-    auto ret = _read_queue.on_work_completed(wk, nullptr);
+    auto ret = _read_queue.on_work_completed(wk, ctx);
+    --_read_queue_depth;
     wk->enqueue(err, size);
     wk->release_ref(); // added in above read
 
     return ret;
 }
 
+aio_task* disk_file::on_batch_read_completed(aio_task* wk, void* ctx, const blob& buffer, uint64_t offset, uint64_t write_version, error_code err, size_t size)
+{
+    auto ret = _read_queue.on_work_completed(wk, ctx);
+
+    uint64_t end = offset;
+    while (wk)
+    {
+        aio_task* next = (aio_task*)wk->next;
+        wk->next = nullptr;
+
+        auto io = wk->aio();
+        if (err == ERR_OK)
+        {
+            // same as a single read, partial read is ok and nothing read is EOF
+            uint64_t pos = io->file_offset - offset;
+            size_t this_size = size > pos ? std::min(size - (size_t)pos, (size_t)io->buffer_size) : 0;
+            if (this_size > 0)
+            {
+                memcpy(io->buffer, buffer.data() + pos, this_size);
+            }
+            wk->enqueue(this_size > 0 ? ERR_OK : ERR_HANDLE_EOF, this_size);
+        }
+        else
+        {
+            wk->enqueue(err, 0);
+        }
+        end = std::max(end, io->file_offset + io->buffer_size);
+
+        --_read_queue_depth;
+        wk->release_ref(); // added in above read
+
+        wk = next;
+    }
+
+    // keep the extra data for the following sequential reads
+    if (err == ERR_OK && size > end - offset)
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_readahead_lock);
+        if (_write_version == write_version)
+        {
+            _readahead_buffer = buffer.range(0, (int)size);
+            _readahead_offset = offset;
+        }
+    }
+
+    return ret;
+}
+
+bool disk_file::read_from_readahead_buffer(aio_task* tsk)
+{
+    if (_readahead_bytes == 0)
+        return false;
+
+    auto io = tsk->aio();
+    {
+        utils::auto_lock<utils::ex_lock_nr_spin> l(_readahead_lock);
+        if (io->file_offset == _last_read_end)
+            _sequential_reads++;
+        else
+            _sequential_reads = 0;
+        _last_read_end = io->file_offset + io->buffer_size;
+
+        if (_readahead_buffer.length() == 0
+            || io->file_offset < _readahead_offset
+            || io->file_offset + io->buffer_size > _readahead_offset + _readahead_buffer.length())
+        {
+            return false;
+        }
+
+        memcpy(io->buffer, _readahead_buffer.data() + (io->file_offset - _readahead_offset), io->buffer_size);
+    }
+
+    tsk->enqueue(ERR_OK, io->buffer_size);
+    return true;
+}
+
+uint32_t disk_file::get_read_size(uint64_t offset, uint32_t size)
+{
+    if (_readahead_bytes == 0 || size >= _readahead_bytes)
+        return size;
+
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_readahead_lock);
+    return _sequential_reads >= 2 ? _readahead_bytes : size;
+}
+
+uint64_t disk_file::write_version()
+{
+    utils::auto_lock<utils::ex_lock_nr_spin> l(_readahead_lock);
+    return _write_version;
+}
+
 aio_task* disk_file::on_write_completed(aio_task* wk, void* ctx, error_code err, size_t size)
 {
+    // again, as the readaheads issued while the write is in flight may have
+    // read (and cached) the data before the write
+    invalidate_readahead_buffer();
+
     auto ret = _write_queue.on_work_completed(wk, ctx);
     
     while (wk)
@@ -180,6 +341,12 @@ disk_engine::disk_engine(service_node* node)
     _is_running = false;    
     _provider = nullptr;
     _node = node;        
+
+    auto& spec = service_engine::fast_instance().spec();
+    _file_opts.read_concurrency = std::max(spec.disk_read_concurrency_per_file, 1);
+    _file_opts.read_merge_max_bytes = static_cast<uint32_t>(spec.disk_read_merge_max_bytes);
+    _file_opts.readahead_bytes = static_cast<uint32_t>(spec.disk_readahead_bytes);
+    _file_opts.direct_io = false;
 }
 
 disk_engine::~disk_engine()
@@ -193,6 +360,14 @@ void disk_engine::start(aio_provider* provider, io_modifer& ctx)
 
     _provider = provider;
     _provider->start(ctx);
+
+    _read_queue_depth = perf_counter::get_counter(_node->name(), "engine", "disk.read.queue.depth",
+        COUNTER_TYPE_NUMBER_PERCENTILES, "pending and running reads on a file when a new read is issued", true);
+    _merged_read_count = perf_counter::get_counter(_node->name(), "engine", "disk.read.merged.count",
+        COUNTER_TYPE_RATE, "reads merged into other reads on the same file", true);
+    _readahead_hit_count = perf_counter::get_counter(_node->name(), "engine", "disk.readahead.hit.count",
+        COUNTER_TYPE_RATE, "reads served from the readahead buffer", true);
+
     _is_running = true;
 }
 
@@ -207,10 +382,27 @@ void disk_engine::ctrl(dsn_handle_t fh, dsn_ctrl_code_t code, int param)
 
 dsn_handle_t disk_engine::open(const char* file_name, int flag, int pmode)
 {            
+    disk_file_options opts = _file_opts;
+    opts.direct_io = ((flag & DSN_O_DIRECT) != 0);
+    if (opts.direct_io)
+    {
+        // no page cache wanted, so no readahead either
+        opts.readahead_bytes = 0;
+
+# if defined(_WIN32)
+        // translated into FILE_FLAG_NO_BUFFERING by the aio provider
+# elif defined(O_DIRECT)
+        flag = (flag & ~DSN_O_DIRECT) | O_DIRECT;
+# else
+        dwarn("direct I/O is not supported on this platform, open %s with buffered I/O", file_name);
+        flag &= ~DSN_O_DIRECT;
+# endif
+    }
+
     dsn_handle_t nh = _provider->open(file_name, flag, pmode);
     if (nh != DSN_INVALID_FILE_HANDLE)
     {
-        return new disk_file(nh);
+        return new disk_file(nh, opts);
     }
     else
     {
@@ -267,20 +459,100 @@ void disk_engine::read(aio_task* aio)
     dio->engine = this;
     dio->type = AIO_Read;
 
-    auto wk = df->read(aio);
+    if (df->is_direct_io() && !check_direct_io_alignment(aio))
+    {
+        aio->enqueue(ERR_INVALID_PARAMETERS, 0);
+        return;
+    }
+
+    if (df->read_from_readahead_buffer(aio))
+    {
+        _readahead_hit_count->increment();
+        return;
+    }
+
+    _read_queue_depth->set(df->read_queue_depth() + 1);
+
+    uint32_t sz;
+    auto wk = df->read(aio, &sz);
     if (wk)
     {
-        return _provider->aio(wk);
+        process_read(wk, sz);
+    }
+}
+
+class batch_read_io_task : public aio_task
+{
+public:
+    batch_read_io_task(aio_task* tasks, uint64_t write_version)
+        : aio_task(LPC_AIO_BATCH_READ, nullptr, tasks, nullptr), _write_version(write_version)
+    {
+    }
+
+    virtual void exec() override
+    {
+        aio_task* tasks = (aio_task*)_context;
+        auto df = (disk_file*)tasks->aio()->file_object;
+        uint32_t sz;
+
+        auto wk = df->on_batch_read_completed(tasks, (void*)&sz, _buffer, aio()->file_offset, _write_version, error(), _transferred_size);
+        if (wk)
+        {
+            wk->aio()->engine->process_read(wk, sz);
+        }
+    }
+
+public:
+    blob         _buffer;
+    uint64_t     _write_version;
+};
+
+void disk_engine::process_read(aio_task* aio, uint32_t sz)
+{
+    auto df = (disk_file*)aio->aio()->file_object;
+    uint64_t version = df->write_version();
+    uint32_t read_size = df->get_read_size(aio->aio()->file_offset, sz);
+
+    // no batching
+    if (aio->next == nullptr && read_size == aio->aio()->buffer_size)
+    {
+        return _provider->aio(aio);
+    }
+
+    // batching and/or readahead
+    else
+    {
+        int merged = 0;
+        for (auto wk = (aio_task*)aio->next; wk; wk = (aio_task*)wk->next)
+            merged++;
+        _merged_read_count->add(merged);
+
+        auto new_task = new batch_read_io_task(aio, version);
+        new_task->_buffer = df->is_direct_io() ?
+            file::create_aligned_buffer(read_size) :
+            blob(dsn::make_shared_array<char>(read_size), read_size);
+
+        auto dio = new_task->aio();
+        dio->buffer = (void*)new_task->_buffer.data();
+        dio->buffer_size = read_size;
+        dio->file_offset = aio->aio()->file_offset;
+
+        dio->file = aio->aio()->file;
+        dio->file_object = aio->aio()->file_object;
+        dio->engine = aio->aio()->engine;
+        dio->type = AIO_Read;
+
+        new_task->add_ref(); // released in complete_io
+        return _provider->aio(new_task);
     }
 }
 
 class batch_write_io_task : public aio_task
 {
 public:
-    batch_write_io_task(aio_task* tasks, blob& buffer)
+    batch_write_io_task(aio_task* tasks)
         : aio_task(LPC_AIO_BATCH_WRITE, nullptr, tasks, nullptr)
     {
-        _buffer = buffer;
     }
     
     virtual void exec() override
@@ -297,7 +569,8 @@ public:
     }
 
 public:
-    blob         _buffer;
+    std::vector<dsn_file_buffer_t> _buffers; // owned by the batched tasks
+    blob         _buffer; // merged buffer when vectored write is not supported
 };
 
 void disk_engine::write(aio_task* aio)
@@ -321,6 +594,12 @@ void disk_engine::write(aio_task* aio)
     dio->engine = this;
     dio->type = AIO_Write;    
 
+    if (df->is_direct_io() && !check_direct_io_alignment(aio))
+    {
+        aio->enqueue(ERR_INVALID_PARAMETERS, 0);
+        return;
+    }
+
     uint32_t sz;
     auto wk = df->write(aio, &sz);
     if (wk)
@@ -329,11 +608,59 @@ void disk_engine::write(aio_task* aio)
     }
 }
 
+bool disk_engine::check_direct_io_alignment(aio_task* aio)
+{
+    auto dio = aio->aio();
+    bool aligned = (dio->file_offset % DSN_FILE_DIRECT_IO_ALIGNMENT == 0)
+        && (dio->buffer_size % DSN_FILE_DIRECT_IO_ALIGNMENT == 0);
+
+    if (aio->_unmerged_write_buffers.empty())
+    {
+        aligned = aligned && ((uintptr_t)dio->buffer % DSN_FILE_DIRECT_IO_ALIGNMENT == 0);
+    }
+    else
+    {
+        for (auto& buffer : aio->_unmerged_write_buffers)
+        {
+            aligned = aligned
+                && ((uintptr_t)buffer.buffer % DSN_FILE_DIRECT_IO_ALIGNMENT == 0)
+                && (buffer.size % DSN_FILE_DIRECT_IO_ALIGNMENT == 0);
+        }
+    }
+
+    if (!aligned)
+    {
+        derror("direct I/O requires %d-byte alignment, task %s with buffer = %p, size = %u, offset = %" PRIu64,
+            DSN_FILE_DIRECT_IO_ALIGNMENT,
+            aio->spec().name.c_str(),
+            dio->buffer,
+            dio->buffer_size,
+            dio->file_offset
+            );
+    }
+    return aligned;
+}
+
 void disk_engine::process_write(aio_task* aio, uint32_t sz)
 {
     // no batching
     if (aio->aio()->buffer_size == sz)
     {
+        if (!aio->_unmerged_write_buffers.empty()
+            && _provider->aio_write_vector(aio, &aio->_unmerged_write_buffers[0], (int)aio->_unmerged_write_buffers.size()))
+        {
+            return;
+        }
+
+        if (!aio->_unmerged_write_buffers.empty() && ((disk_file*)aio->aio()->file_object)->is_direct_io())
+        {
+            auto bb = file::create_aligned_buffer(aio->aio()->buffer_size);
+            aio->copy_to((char*)bb.data());
+            aio->_merged_write_buffer_holder = bb;
+            aio->aio()->buffer = (void*)bb.data();
+            aio->_unmerged_write_buffers.clear();
+        }
+
         aio->collapse();
         return _provider->aio(aio);
     }
@@ -341,27 +668,31 @@ void disk_engine::process_write(aio_task* aio, uint32_t sz)
     // batching
     else
     {
-        // merge the buffers
-        auto bb = tls_trans_mem_alloc_blob((size_t)sz);
-        char* ptr = (char*)bb.data();
+        auto new_task = new batch_write_io_task(aio);
         auto current_wk = aio;
         do
         {
-            current_wk->copy_to(ptr);
-            ptr += current_wk->aio()->buffer_size;
+            if (!current_wk->_unmerged_write_buffers.empty())
+            {
+                new_task->_buffers.insert(
+                    new_task->_buffers.end(),
+                    current_wk->_unmerged_write_buffers.begin(),
+                    current_wk->_unmerged_write_buffers.end()
+                    );
+            }
+            else
+            {
+                dsn_file_buffer_t buffer;
+                buffer.buffer = current_wk->aio()->buffer;
+                buffer.size = (int)current_wk->aio()->buffer_size;
+                new_task->_buffers.push_back(buffer);
+            }
             current_wk = (aio_task*)current_wk->next;
         } while (current_wk);
-        
-
-        dassert(ptr == (char*)bb.data() + bb.length(), "");
 
         // setup io task
-        auto new_task = new batch_write_io_task(
-            aio,
-            bb
-            );
         auto dio = new_task->aio();
-        dio->buffer = (void*)bb.data();
+        dio->buffer = nullptr;
         dio->buffer_size = sz;
         dio->file_offset = aio->aio()->file_offset;
 
@@ -371,6 +702,28 @@ void disk_engine::process_write(aio_task* aio, uint32_t sz)
         dio->type = AIO_Write;
 
         new_task->add_ref(); // released in complete_io
+
+        // write the original buffers directly
+        if (_provider->aio_write_vector(new_task, &new_task->_buffers[0], (int)new_task->_buffers.size()))
+        {
+            return;
+        }
+
+        // merge the buffers
+        auto bb = ((disk_file*)aio->aio()->file_object)->is_direct_io() ?
+            file::create_aligned_buffer((size_t)sz) :
+            tls_trans_mem_alloc_blob((size_t)sz);
+        char* ptr = (char*)bb.data();
+        for (auto& buffer : new_task->_buffers)
+        {
+            memcpy(ptr, buffer.buffer, buffer.size);
+            ptr += buffer.size;
+        }
+
+        dassert(ptr == (char*)bb.data() + bb.length(), "");
+
+        new_task->_buffer = bb;
+        dio->buffer = (void*)bb.data();
         return _provider->aio(new_task);
     }
 }
@@ -388,10 +741,10 @@ void disk_engine::complete_io(aio_task* aio, error_code err, uint32_t bytes, int
     }
     
     // batching
-    if (aio->code() == LPC_AIO_BATCH_WRITE)
+    if (aio->code() == LPC_AIO_BATCH_WRITE || aio->code() == LPC_AIO_BATCH_READ)
     {
         aio->enqueue(err, (size_t)bytes);
-        aio->release_ref(); // added in process_write
+        aio->release_ref(); // added in process_write or process_read
     }
 
     // no batching
@@ -400,10 +753,11 @@ void disk_engine::complete_io(aio_task* aio, error_code err, uint32_t bytes, int
         auto df = (disk_file*)(aio->aio()->file_object);
         if (aio->aio()->type == AIO_Read)
         {
-            auto wk = df->on_read_completed(aio, err, (size_t)bytes);
+            uint32_t sz;
+            auto wk = df->on_read_completed(aio, (void*)&sz, err, (size_t)bytes);
             if (wk)
             {
-                _provider->aio(wk);
+                process_read(wk, sz);
             }            
         }
 
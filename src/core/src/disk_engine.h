@@ -39,6 +39,7 @@
 # include <dsn/utility/synchronize.h>
 # include <dsn/tool-api/aio_provider.h>
 # include <dsn/utility/work_queue.h>
+# include <dsn/tool-api/perf_counter.h>
 
 namespace dsn {
 
@@ -58,23 +59,81 @@ private:
     uint32_t _max_batch_bytes;
 };
 
+class disk_read_queue : public work_queue<aio_task>
+{
+public:
+    disk_read_queue()
+        : work_queue(1)
+    {
+        _max_merge_bytes = 0;
+    }
+
+    void init(int max_concurrent_op, uint32_t max_merge_bytes)
+    {
+        reset_max_concurrent_ops(max_concurrent_op);
+        _max_merge_bytes = max_merge_bytes;
+    }
+
+private:
+    // merge consecutive pending reads whose ranges are adjacent or overlapping
+    virtual aio_task* unlink_next_workload(void* plength) override;
+
+private:
+    uint32_t _max_merge_bytes;
+};
+
+struct disk_file_options
+{
+    int      read_concurrency;
+    uint32_t read_merge_max_bytes;
+    uint32_t readahead_bytes;
+    bool     direct_io;
+};
+
 class disk_file
 {
 public:
-    disk_file(dsn_handle_t handle);
+    disk_file(dsn_handle_t handle, const disk_file_options& opts);
     void ctrl(dsn_ctrl_code_t code, int param);
-    aio_task* read(aio_task* tsk);
+    aio_task* read(aio_task* tsk, void* ctx);
     aio_task* write(aio_task* tsk, void* ctx);
 
-    aio_task* on_read_completed(aio_task* wk, error_code err, size_t size);
+    aio_task* on_read_completed(aio_task* wk, void* ctx, error_code err, size_t size);
+    aio_task* on_batch_read_completed(aio_task* wk, void* ctx, const blob& buffer, uint64_t offset, uint64_t write_version, error_code err, size_t size);
     aio_task* on_write_completed(aio_task* wk, void* ctx, error_code err, size_t size);
+
+    // serve the read from the readahead buffer, and track sequential reads
+    bool      read_from_readahead_buffer(aio_task* tsk);
+    // extend [offset, offset + size) for readahead if the reads are sequential
+    uint32_t  get_read_size(uint64_t offset, uint32_t size);
+    uint64_t  write_version();
     
     dsn_handle_t native_handle() const { return _handle; }
+    bool      is_direct_io() const { return _direct_io; }
+    int       read_queue_depth() const { return _read_queue_depth.load(); }
+
+private:
+    // bump the write version and drop the readahead buffer, on both write submission and completion
+    void      invalidate_readahead_buffer();
 
 private:
     dsn_handle_t     _handle;
     disk_write_queue _write_queue;
-    work_queue<aio_task> _read_queue;
+    disk_read_queue  _read_queue;
+    uint32_t         _readahead_bytes;
+    bool             _direct_io;
+
+    std::atomic<int>      _read_queue_depth; // pending and running reads
+
+    // readahead state, writes invalidate the buffer and bump the version;
+    // only writes through this handle are seen, so the reads may get stale data
+    // when the file is modified through other handles or by other processes
+    ::dsn::utils::ex_lock_nr_spin _readahead_lock;
+    uint64_t         _last_read_end;
+    int              _sequential_reads;
+    uint64_t         _write_version;
+    blob             _readahead_buffer;
+    uint64_t         _readahead_offset;
 };
 
 class disk_engine
@@ -99,13 +158,21 @@ public:
 private:
     friend class aio_provider;
     friend class batch_write_io_task;
+    friend class batch_read_io_task;
     void process_write(aio_task* wk, uint32_t sz);
+    void process_read(aio_task* wk, uint32_t sz);
+    bool check_direct_io_alignment(aio_task* aio);
     void complete_io(aio_task* aio, error_code err, uint32_t bytes, int delay_milliseconds = 0);
 
 private:
     volatile bool   _is_running;
     aio_provider    *_provider;
     service_node    *_node;
+    disk_file_options _file_opts;
+
+    perf_counter_ptr _read_queue_depth;
+    perf_counter_ptr _merged_read_count;
+    perf_counter_ptr _readahead_hit_count;
 };
 
 } // end namespace
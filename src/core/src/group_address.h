@@ -53,6 +53,7 @@ namespace dsn
 
         dsn_group_t handle() const { return (dsn_group_t)this; }
         const std::vector<rpc_address>& members() const { return _members; }
+        std::vector<rpc_address> members_snapshot() const { alr_t l(_lock); return _members; }
         rpc_address random_member() const { alr_t l(_lock); return _members.empty() ? _invalid : _members[dsn_random32(0, (uint32_t)_members.size() - 1)]; }
         rpc_address next(rpc_address current) const;
         rpc_address leader() const { alr_t l(_lock); return _leader_index >= 0 ? _members[_leader_index] : _invalid; }
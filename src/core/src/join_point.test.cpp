@@ -157,3 +157,47 @@ TEST(core, join_point)
     ASSERT_EQ(check_vec, jp_vec);
     }
 }
+
+static std::vector<int> s_executed;
+static void advice_1(int v) { s_executed.push_back(1); }
+static void advice_2(int v) { s_executed.push_back(2); }
+static bool native_3(int v) { s_executed.push_back(3); return v > 0; }
+
+TEST(core, join_point_execute)
+{
+    join_point<bool, int> jp("join_point_execute");
+    ASSERT_TRUE(jp.is_empty());
+    ASSERT_TRUE(jp.execute(1, true));
+    ASSERT_FALSE(jp.execute(1, false));
+
+    jp.put_back(advice_1, "1");
+    jp.put_native(native_3);
+    jp.put_back(advice_2, "2");
+    ASSERT_FALSE(jp.is_empty());
+
+    s_executed.clear();
+    ASSERT_TRUE(jp.execute(1, false));
+    ASSERT_EQ(std::vector<int>({3, 1, 2}), s_executed);
+
+    s_executed.clear();
+    ASSERT_FALSE(jp.execute(0, true));
+    ASSERT_EQ(std::vector<int>({3, 1, 2}), s_executed);
+
+    jp.remove("native");
+    jp.put_replace("2", advice_1, "1-2");
+    s_executed.clear();
+    ASSERT_TRUE(jp.execute(0, true));
+    ASSERT_EQ(std::vector<int>({1, 1}), s_executed);
+
+    jp.remove("1");
+    jp.remove("1-2");
+    ASSERT_TRUE(jp.is_empty());
+
+    // compiled out
+    disabled_join_point<bool, int> djp("disabled_join_point");
+    ASSERT_FALSE(djp.put_back(advice_1, "1"));
+    s_executed.clear();
+    ASSERT_TRUE(djp.execute(0, true));
+    ASSERT_FALSE(djp.execute(1, false));
+    ASSERT_TRUE(s_executed.empty());
+}
@@ -0,0 +1,119 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Performance test for json_helper, comparing std::stringstream with json_writer.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include <dsn/cpp/json_helper.h>
+# include <gtest/gtest.h>
+# include <iostream>
+
+using namespace ::dsn;
+
+struct json_perf_state
+{
+    app_info app;
+    std::vector<partition_configuration> partitions;
+    DEFINE_JSON_SERIALIZATION(app, partitions)
+};
+
+static void json_testcase(int partition_count, int round)
+{
+    json_perf_state st;
+    st.app.status = app_status::AS_AVAILABLE;
+    st.app.app_type = "simple_kv";
+    st.app.app_name = "json.perf.test";
+    st.app.app_id = 1;
+    st.app.partition_count = partition_count;
+    st.app.envs["env.key"] = "env.value";
+    st.app.is_stateful = true;
+    st.app.max_replica_count = 3;
+    for (int i = 0; i < partition_count; i++)
+    {
+        partition_configuration pc;
+        pc.pid = gpid(1, i);
+        pc.ballot = i + 1;
+        pc.max_replica_count = 3;
+        pc.primary = rpc_address("127.0.0.1", 34801 + i % 3);
+        pc.secondaries.push_back(rpc_address("127.0.0.1", 34801 + (i + 1) % 3));
+        pc.secondaries.push_back(rpc_address("127.0.0.1", 34801 + (i + 2) % 3));
+        pc.last_committed_decree = 1000000 + i;
+        st.partitions.push_back(pc);
+    }
+
+    size_t bytes = 0;
+
+    uint64_t nts = dsn_now_ns();
+    for (int i = 0; i < round; i++)
+    {
+        std::stringstream ss;
+        st.encode_json_state(ss);
+        bytes = ss.str().length();
+    }
+    uint64_t stream_ns = dsn_now_ns() - nts;
+
+    blob bb;
+    nts = dsn_now_ns();
+    for (int i = 0; i < round; i++)
+    {
+        bb = json::json_forwarder<json_perf_state>::encode(st);
+    }
+    uint64_t writer_ns = dsn_now_ns() - nts;
+    ASSERT_EQ(bytes, (size_t)bb.length());
+
+    nts = dsn_now_ns();
+    for (int i = 0; i < round; i++)
+    {
+        json_perf_state result;
+        ASSERT_TRUE(json::json_forwarder<json_perf_state>::decode(bb, result));
+        ASSERT_EQ(st.partitions.size(), result.partitions.size());
+    }
+    uint64_t decode_ns = dsn_now_ns() - nts;
+
+    double mb = static_cast<double>(bytes) * round / (1024 * 1024);
+    std::cout
+        << partition_count << "\t\t "
+        << bytes << "\t\t "
+        << mb / stream_ns * 1000000000 << "MB/s\t\t "
+        << mb / writer_ns * 1000000000 << "MB/s\t\t "
+        << mb / decode_ns * 1000000000 << "MB/s"
+        << std::endl;
+}
+
+TEST(perf_core, json)
+{
+    std::cout << "partitions\t bytes\t\t stringstream\t\t json_writer\t\t decode" << std::endl;
+    for (auto partition_count : { 8, 256, 8192 })
+    {
+        json_testcase(partition_count, 1000000 / partition_count);
+    }
+}
@@ -0,0 +1,174 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for json_helper.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include <dsn/cpp/json_helper.h>
+# include <gtest/gtest.h>
+
+using namespace ::dsn;
+
+struct json_test_item
+{
+    std::string name;
+    int8_t small;
+    uint64_t big;
+    int64_t neg;
+    double ratio;
+    DEFINE_JSON_SERIALIZATION(name, small, big, neg, ratio)
+};
+
+struct json_test_state
+{
+    std::vector<json_test_item> items;
+    std::map<std::string, int32_t> names;
+    std::set<int32_t> ids;
+    bool flag;
+    DEFINE_JSON_SERIALIZATION(items, names, ids, flag)
+};
+
+static json_test_state make_state(int count)
+{
+    json_test_state st;
+    for (int i = 0; i < count; i++)
+    {
+        st.items.push_back({ "item." + std::to_string(i), (int8_t)(i % 256 - 128), 
+            (uint64_t)i * 1000000007ULL, -(int64_t)i, i * 0.5 });
+        st.names["name." + std::to_string(i)] = i;
+        st.ids.insert(-i);
+    }
+    st.flag = true;
+    return st;
+}
+
+static std::string blob_to_string(const blob& bb)
+{
+    return std::string(bb.data(), bb.length());
+}
+
+TEST(core, json_writer)
+{
+    // small blocks in the writer so that the output spans many of them
+    for (int reserved : { 7, 256, 4096 })
+    {
+        auto st = make_state(1000);
+
+        std::stringstream ss;
+        st.encode_json_state(ss);
+
+        binary_writer writer(reserved);
+        {
+            json::json_writer out(writer);
+            st.encode_json_state(out);
+        }
+        EXPECT_EQ(ss.str(), blob_to_string(writer.get_buffer()));
+    }
+
+    json_test_item item{ "", -128, 18446744073709551615ULL, -9223372036854775807LL - 1, 1.5 };
+    std::string expected = "{\"name\":\"\",\"small\":-128,\"big\":18446744073709551615,"
+        "\"neg\":-9223372036854775808,\"ratio\":1.5}";
+    EXPECT_EQ(expected, blob_to_string(json::json_forwarder<json_test_item>::encode(item)));
+
+    // escaped string
+    std::stringstream ss;
+    json::json_encode(ss, std::string("a\"b\\c\n\x01"));
+    EXPECT_EQ("\"a\\\"b\\\\c\\n\\u0001\"", ss.str());
+}
+
+TEST(core, json_decode)
+{
+    auto st = make_state(1000);
+    st.items[0].name = "a\"b\\c\n\t\x01";
+    blob bb = json::json_forwarder<json_test_state>::encode(st);
+
+    json_test_state result;
+    ASSERT_TRUE(json::json_forwarder<json_test_state>::decode(bb, result));
+    ASSERT_EQ(st.items.size(), result.items.size());
+    for (size_t i = 0; i < st.items.size(); i++)
+    {
+        EXPECT_EQ(st.items[i].name, result.items[i].name);
+        EXPECT_EQ(st.items[i].small, result.items[i].small);
+        EXPECT_EQ(st.items[i].big, result.items[i].big);
+        EXPECT_EQ(st.items[i].neg, result.items[i].neg);
+        EXPECT_EQ(st.items[i].ratio, result.items[i].ratio);
+    }
+    EXPECT_EQ(st.names, result.names);
+    EXPECT_EQ(st.ids, result.ids);
+    EXPECT_TRUE(result.flag);
+
+    // blanks between tokens and unicode escapes
+    std::string text = " {\n \"items\" : [ ] , \"names\" : { \"\\u00e9\" : 1 } ,"
+        "\t\"ids\" : [ 1 , 2 ] , \"flag\" : false }";
+    ASSERT_TRUE(json::json_forwarder<json_test_state>::decode(blob(text.c_str(), 0, (int)text.length()), result));
+    EXPECT_TRUE(result.items.empty());
+    EXPECT_EQ(1u, result.names.size());
+    EXPECT_EQ("\xc3\xa9", result.names.begin()->first);
+    EXPECT_EQ(2u, result.ids.size());
+    EXPECT_FALSE(result.flag);
+}
+
+TEST(core, json_decode_malformed)
+{
+    const char* inputs[] = {
+        "",
+        "{",
+        "[]",
+        "{\"items\":[",
+        "{\"items\":[{\"name\":\"a\",\"small\":128",
+        "{\"items\":[{\"name\":\"a,\"small\":1",
+        "{\"items\":[],\"names\":{\"a\":1,\"a\":2},\"ids\":[],\"flag\":1}",
+        "{\"items\":[],\"names\":{\"a\":4294967296},\"ids\":[],\"flag\":1}",
+        "{\"items\":[],\"names\":{\"\\q\":1},\"ids\":[],\"flag\":1}",
+        "{\"items\":[],\"names\":{},\"ids\":[1,1],\"flag\":1}",
+        "{\"items\":[],\"names\":{},\"ids\":[1x],\"flag\":1}",
+        "{\"items\":[],\"names\":{},\"ids\":[1 2],\"flag\":1}",
+        "{\"items\":[],\"names\":{},\"ids\":[],\"flag\":2}",
+        "{\"items\":[],\"names\":{},\"ids\":[],\"flag\":1",
+    };
+
+    for (auto input : inputs)
+    {
+        json_test_state result;
+        blob bb(input, 0, (int)strlen(input));
+        EXPECT_FALSE(json::json_forwarder<json_test_state>::decode(bb, result)) << input;
+    }
+
+    std::string text = "{\"items\":[],\"names\":{},\"ids\":[],\"flag\":1}";
+    json_test_state result;
+    for (size_t len = 0; len < text.length(); len++)
+    {
+        blob bb(text.c_str(), 0, (int)len);
+        EXPECT_FALSE(json::json_forwarder<json_test_state>::decode(bb, result)) << len;
+    }
+    EXPECT_TRUE(json::json_forwarder<json_test_state>::decode(blob(text.c_str(), 0, (int)text.length()), result));
+}
@@ -0,0 +1,173 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Performance test for the lock, rwlock and semaphore providers under contention.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include <dsn/tool_api.h>
+# include <dsn/utility/factory_store.h>
+# include <gtest/gtest.h>
+# include <iostream>
+# include <thread>
+
+using namespace ::dsn;
+
+// total lock operations of all threads in each case
+static const int LOCK_TEST_OPS = 1000000;
+
+template<typename TFunc>
+static double run_threads(int thread_count, TFunc&& f)
+{
+    std::vector<std::thread> threads;
+    uint64_t nts = dsn_now_ns();
+    for (int i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(f, i);
+    }
+    for (auto& thr : threads)
+    {
+        thr.join();
+    }
+    return static_cast<double>(dsn_now_ns() - nts);
+}
+
+template<typename TProvider>
+static void exclusive_lock_testcase(const char* name, int thread_count)
+{
+    ilock* l = utils::factory_store<TProvider>::create(name, PROVIDER_TYPE_MAIN, (TProvider*)nullptr);
+    ASSERT_NE(nullptr, l);
+
+    int ops = LOCK_TEST_OPS / thread_count;
+    uint64_t counter = 0;
+    double ns = run_threads(thread_count, [=, &counter](int)
+    {
+        for (int i = 0; i < ops; i++)
+        {
+            l->lock();
+            counter++;
+            l->unlock();
+        }
+    });
+    EXPECT_EQ((uint64_t)ops * thread_count, counter);
+
+    std::cout << name << "\t " << thread_count << "\t\t "
+        << ops * thread_count / ns * 1000 << " Mops/s" << std::endl;
+    delete l;
+}
+
+// 1 write per 10 operations
+static void rwlock_testcase(const char* name, int thread_count)
+{
+    rwlock_nr_provider* l = utils::factory_store<rwlock_nr_provider>::create(
+        name, PROVIDER_TYPE_MAIN, (rwlock_nr_provider*)nullptr);
+    ASSERT_NE(nullptr, l);
+
+    int ops = LOCK_TEST_OPS / thread_count;
+    uint64_t counter = 0;
+    double ns = run_threads(thread_count, [=, &counter](int)
+    {
+        uint64_t sum = 0;
+        for (int i = 0; i < ops; i++)
+        {
+            if (i % 10 == 0)
+            {
+                l->lock_write();
+                counter++;
+                l->unlock_write();
+            }
+            else
+            {
+                l->lock_read();
+                sum += counter;
+                l->unlock_read();
+            }
+        }
+    });
+    EXPECT_EQ((uint64_t)((ops + 9) / 10) * thread_count, counter);
+
+    std::cout << name << "\t " << thread_count << "\t\t "
+        << ops * thread_count / ns * 1000 << " Mops/s" << std::endl;
+    delete l;
+}
+
+// half of the threads signal and the other half wait
+static void semaphore_testcase(const char* name, int thread_count)
+{
+    semaphore_provider* s = utils::factory_store<semaphore_provider>::create(
+        name, PROVIDER_TYPE_MAIN, 0, (semaphore_provider*)nullptr);
+    ASSERT_NE(nullptr, s);
+
+    int pairs = std::max(thread_count / 2, 1);
+    int ops = LOCK_TEST_OPS / 2 / pairs;
+    double ns = run_threads(pairs * 2, [=](int index)
+    {
+        for (int i = 0; i < ops; i++)
+        {
+            if (index < pairs)
+                s->signal(1);
+            else
+                s->wait(TIME_MS_MAX);
+        }
+    });
+    EXPECT_FALSE(s->wait(0));
+
+    std::cout << name << "\t " << pairs * 2 << "\t\t "
+        << ops * pairs / ns * 1000 << " Mops/s" << std::endl;
+    delete s;
+}
+
+TEST(perf_core, lock)
+{
+    auto thread_counts = { 1, 2, 4, 8, 16, 32, 64 };
+
+    std::cout << "provider\t\t\t\t thread_count\t speed" << std::endl;
+    for (auto name : { "dsn::tools::std_lock_provider", "dsn::tools::hpc_lock_provider" })
+    {
+        for (int thread_count : thread_counts)
+            exclusive_lock_testcase<lock_provider>(name, thread_count);
+    }
+    for (auto name : { "dsn::tools::std_lock_nr_provider", "dsn::tools::hpc_lock_nr_provider" })
+    {
+        for (int thread_count : thread_counts)
+            exclusive_lock_testcase<lock_nr_provider>(name, thread_count);
+    }
+    for (auto name : { "dsn::tools::std_rwlock_nr_provider", "dsn::tools::hpc_rwlock_nr_provider" })
+    {
+        for (int thread_count : thread_counts)
+            rwlock_testcase(name, thread_count);
+    }
+    for (auto name : { "dsn::tools::std_semaphore_provider", "dsn::tools::hpc_semaphore_provider" })
+    {
+        for (int thread_count : thread_counts)
+            semaphore_testcase(name, thread_count);
+    }
+}
@@ -55,6 +55,7 @@
 # include "task_engine.h"
 # include "coredump.h"
 # include "transient_memory.h"
+# include "object_pool.h"
 # include "library_utils.h"
 # include <fstream>
 
@@ -380,6 +381,14 @@ bool run(
         "thread local transient memory buffer size (KB), default is 1024"
         );
     ::dsn::tls_trans_mem_init(tls_trans_memory_KB * 1024);
+
+    auto object_pool_cached_KB_per_thread = (size_t)dsn_all.config->get_value<int>(
+        "core", "object_pool_cached_KB_per_thread",
+        1024, // 1 MB
+        "max free objects (KB) cached by each thread for each type of pooled objects (task_c, rpc_request_task, message_ex), "
+        "more are returned to the heap"
+        );
+    ::dsn::object_pool_init(object_pool_cached_KB_per_thread * 1024);
     dsn_all.memory = ::dsn::utils::factory_store< ::dsn::memory_provider>::create(
         spec.tools_memory_factory_name.c_str(), ::dsn::PROVIDER_TYPE_MAIN);
 
@@ -0,0 +1,94 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     NFS file copy performance test
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ */
+
+
+#include <cinttypes>
+#include <ctime>
+#include <gtest/gtest.h>
+#include <dsn/service_api_cpp.h>
+#include <dsn/cpp/test_utils.h>
+
+static void nfs_copy_testcase(uint64_t file_size)
+{
+    const char* file_name = "nfs_perf_file";
+    const char* dst_dir = "nfs_perf_dir";
+
+    utils::filesystem::remove_path(file_name);
+    utils::filesystem::remove_path(dst_dir);
+
+    {
+        std::unique_ptr<char[]> block(new char[1024 * 1024]);
+        memset(block.get(), 'x', 1024 * 1024);
+        FILE* fp = fopen(file_name, "wb");
+        ASSERT_TRUE(fp != nullptr);
+        for (uint64_t written = 0; written < file_size; written += 1024 * 1024)
+            ASSERT_EQ(1u, fwrite(block.get(), 1024 * 1024, 1, fp));
+        fclose(fp);
+    }
+
+    std::vector<std::string> files = { file_name };
+    auto tic = std::chrono::steady_clock::now();
+    auto cpu_tic = std::clock();
+
+    task_ptr t = file::copy_remote_files(rpc_address("localhost", 20101),
+        ".", files, dst_dir, true, LPC_AIO_TEST_NFS, nullptr, [](error_code, size_t) {});
+    ASSERT_TRUE(t->wait(120000));
+    ASSERT_EQ(ERR_OK, t->error());
+
+    auto cpu_toc = std::clock();
+    auto toc = std::chrono::steady_clock::now();
+
+    int64_t sz;
+    ASSERT_TRUE(utils::filesystem::file_size(utils::filesystem::path_combine(dst_dir, file_name), sz));
+    ASSERT_EQ((int64_t)file_size, sz);
+
+    double us = (double)std::chrono::duration_cast<std::chrono::microseconds>(toc - tic).count();
+    double cpu_ms = (double)(cpu_toc - cpu_tic) * 1000.0 / CLOCKS_PER_SEC;
+    std::cout << "nfs copy: file_size = " << file_size
+        << ", throughput = " << (double)file_size / us << " MB/s"
+        << ", cpu_per_gb = " << cpu_ms * 1024.0 * 1024.0 * 1024.0 / (double)file_size << " ms"
+        << std::endl;
+
+    utils::filesystem::remove_path(file_name);
+    utils::filesystem::remove_path(dst_dir);
+}
+
+TEST(perf_core, nfs)
+{
+    // if in dsn_mimic_app() and nfs_io_mode == IOE_PER_QUEUE
+    if (task::get_current_nfs() == nullptr) return;
+
+    for (auto size_mb : { 64, 256 })
+        nfs_copy_testcase((uint64_t)size_mb * 1024 * 1024);
+}
@@ -0,0 +1,279 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/*
+ * Description:
+ *     per-type fixed-size object pools with per-thread caches
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "object_pool.h"
+# include <dsn/tool-api/task.h>
+# include <dsn/tool-api/rpc_message.h>
+# include <dsn/tool-api/command.h>
+# include <sstream>
+
+namespace dsn
+{
+    static __thread object_pool_thread_cache* tls_object_pool_caches[OBJECT_POOL_COUNT];
+
+    template<typename T>
+    static inline void owner_increment(std::atomic<T>& v)
+    {
+        // written by the owner thread only, so no atomic read-modify-write is necessary
+        v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    object_pool::object_pool(dsn_object_pool_type_t type, const char* name, size_t object_size)
+        : _type(type), _name(name), _object_size(object_size)
+    {
+        _max_cached_per_thread = 1024;
+        _caches = nullptr;
+        _cache_count = 0;
+    }
+
+    void object_pool::set_max_cached_bytes_per_thread(size_t bytes)
+    {
+        _max_cached_per_thread = static_cast<int>(bytes / (_object_size + sizeof(object_pool_header)));
+    }
+
+    object_pool_thread_cache* object_pool::get_thread_cache()
+    {
+        auto tc = tls_object_pool_caches[_type];
+        if (tc != nullptr)
+            return tc;
+
+        tc = new object_pool_thread_cache();
+        tc->local = nullptr;
+        tc->local_count = 0;
+        tc->remote.store(nullptr);
+        tc->remote_count.store(0);
+        tc->alloc_count.store(0);
+        tc->free_count.store(0);
+        tc->remote_free_count.store(0);
+        tc->heap_alloc_count.store(0);
+        tc->heap_free_count.store(0);
+        tc->oversize_count.store(0);
+        tc->oversize_free_count.store(0);
+
+        {
+            utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+            tc->next = _caches;
+            _caches = tc;
+            _cache_count++;
+        }
+
+        tls_object_pool_caches[_type] = tc;
+        return tc;
+    }
+
+    void object_pool::cache_or_free(object_pool_thread_cache* tc, object_pool_header* h)
+    {
+        if (tc->local_count < _max_cached_per_thread)
+        {
+            h->next = tc->local;
+            tc->local = h;
+            tc->local_count++;
+        }
+        else
+        {
+            free(h);
+            owner_increment(tc->heap_free_count);
+        }
+    }
+
+    void* object_pool::allocate(size_t size)
+    {
+        auto tc = get_thread_cache();
+        object_pool_header* h;
+
+        if (size > _object_size)
+        {
+            h = (object_pool_header*)malloc(sizeof(object_pool_header) + size);
+            h->owner = nullptr;
+            owner_increment(tc->oversize_count);
+            return (void*)(h + 1);
+        }
+
+        // collect the objects freed by other threads
+        if (tc->local == nullptr)
+        {
+            h = tc->remote.exchange(nullptr, std::memory_order_acquire);
+            int count = 0;
+            while (h)
+            {
+                auto next = h->next;
+                cache_or_free(tc, h);
+                h = next;
+                count++;
+            }
+            if (count > 0)
+                tc->remote_count.fetch_sub(count, std::memory_order_relaxed);
+        }
+
+        h = tc->local;
+        if (h != nullptr)
+        {
+            tc->local = h->next;
+            tc->local_count--;
+        }
+        else
+        {
+            h = (object_pool_header*)malloc(sizeof(object_pool_header) + _object_size);
+            owner_increment(tc->heap_alloc_count);
+        }
+
+        h->owner = tc;
+        owner_increment(tc->alloc_count);
+        return (void*)(h + 1);
+    }
+
+    void object_pool::deallocate(void* ptr)
+    {
+        auto h = (object_pool_header*)ptr - 1;
+        auto owner = h->owner;
+        auto tc = get_thread_cache();
+        if (owner == nullptr)
+        {
+            free(h);
+            owner_increment(tc->oversize_free_count);
+            return;
+        }
+
+        if (owner == tc)
+        {
+            cache_or_free(tc, h);
+            owner_increment(tc->free_count);
+        }
+
+        // the owner is not collecting its remote frees (e.g., it has exited), so do not pile up there
+        else if (owner->remote_count.load(std::memory_order_relaxed) >= _max_cached_per_thread)
+        {
+            free(h);
+            owner_increment(tc->remote_free_count);
+            owner_increment(tc->heap_free_count);
+        }
+
+        // return to the owner thread
+        else
+        {
+            owner->remote_count.fetch_add(1, std::memory_order_relaxed);
+            h->next = owner->remote.load(std::memory_order_relaxed);
+            while (!owner->remote.compare_exchange_weak(h->next, h, 
+                std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+            owner_increment(tc->remote_free_count);
+        }
+    }
+
+    std::string object_pool::get_stats()
+    {
+        uint64_t alloc = 0, freed = 0, remote_freed = 0, heap_alloc = 0, heap_free = 0, oversize = 0, oversize_freed = 0, cached = 0;
+        int threads;
+        {
+            utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+            threads = _cache_count;
+            for (auto tc = _caches; tc; tc = tc->next)
+            {
+                alloc += tc->alloc_count.load(std::memory_order_relaxed);
+                freed += tc->free_count.load(std::memory_order_relaxed);
+                remote_freed += tc->remote_free_count.load(std::memory_order_relaxed);
+                heap_alloc += tc->heap_alloc_count.load(std::memory_order_relaxed);
+                heap_free += tc->heap_free_count.load(std::memory_order_relaxed);
+                oversize += tc->oversize_count.load(std::memory_order_relaxed);
+                oversize_freed += tc->oversize_free_count.load(std::memory_order_relaxed);
+            }
+        }
+
+        // approximate as the counters are updated concurrently
+        uint64_t in_use = alloc > freed + remote_freed ? alloc - freed - remote_freed : 0;
+        uint64_t held = heap_alloc > heap_free ? heap_alloc - heap_free : 0;
+        cached = held > in_use ? held - in_use : 0;
+
+        std::stringstream ss;
+        ss << _name
+            << ": object_size = " << _object_size
+            << ", threads = " << threads
+            << ", alloc = " << alloc
+            << ", free = " << freed
+            << ", remote_free = " << remote_freed
+            << ", in_use = " << in_use
+            << ", cached = " << cached
+            << ", retained_bytes = " << held * (_object_size + sizeof(object_pool_header))
+            << ", oversize_alloc = " << oversize
+            << ", oversize_free = " << oversize_freed
+            << std::endl;
+        return ss.str();
+    }
+
+    object_pool* get_object_pool(dsn_object_pool_type_t type)
+    {
+        // never destroyed as objects may still be freed during process exit
+        static object_pool* pools[OBJECT_POOL_COUNT] = {
+            new object_pool(OBJECT_POOL_TASK_C, "task_c", sizeof(task_c)),
+            new object_pool(OBJECT_POOL_RPC_REQUEST_TASK, "rpc_request_task", sizeof(rpc_request_task)),
+            new object_pool(OBJECT_POOL_MESSAGE_EX, "message_ex", sizeof(message_ex))
+        };
+        return pools[type];
+    }
+
+    void object_pool_init(size_t max_cached_bytes_per_thread)
+    {
+        for (int i = 0; i < OBJECT_POOL_COUNT; i++)
+        {
+            get_object_pool((dsn_object_pool_type_t)i)->set_max_cached_bytes_per_thread(max_cached_bytes_per_thread);
+        }
+
+        ::dsn::register_command("object_pool.stats",
+            "object_pool.stats - allocation and retention stats of the object pools",
+            "object_pool.stats",
+            [](const safe_vector<safe_string>& args)
+            {
+                std::stringstream ss;
+                for (int i = 0; i < OBJECT_POOL_COUNT; i++)
+                {
+                    ss << get_object_pool((dsn_object_pool_type_t)i)->get_stats();
+                }
+                return safe_string(ss.str().c_str());
+            }
+        );
+    }
+}
+
+DSN_API void* dsn_object_pool_malloc(dsn_object_pool_type_t type, uint32_t size)
+{
+    return ::dsn::get_object_pool(type)->allocate((size_t)size);
+}
+
+DSN_API void dsn_object_pool_free(dsn_object_pool_type_t type, void* ptr)
+{
+    return ::dsn::get_object_pool(type)->deallocate(ptr);
+}
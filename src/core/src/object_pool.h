@@ -0,0 +1,108 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/*
+ * Description:
+ *     per-type fixed-size object pools with per-thread caches
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+
+# include <dsn/service_api_c.h>
+# include <dsn/utility/synchronize.h>
+# include <atomic>
+# include <string>
+
+namespace dsn
+{
+    struct object_pool_thread_cache;
+
+    //
+    // each pooled object is prefixed with a header, which records the thread cache
+    // it is allocated from, so that it can always be returned to the same thread
+    //
+    struct object_pool_header
+    {
+        object_pool_thread_cache *owner; // nullptr when allocated from the heap directly
+        object_pool_header       *next;
+    };
+
+    struct object_pool_thread_cache
+    {
+        object_pool_header                *local;  // free objects, touched by the owner thread only
+        int                               local_count;
+        std::atomic<object_pool_header*>  remote; // objects freed by other threads
+        std::atomic<int>                  remote_count; // approximate, to cap the remote list
+        object_pool_thread_cache          *next;   // all caches of the same pool
+
+        // stats, only written by the owner thread
+        std::atomic<uint64_t>             alloc_count;
+        std::atomic<uint64_t>             free_count;
+        std::atomic<uint64_t>             remote_free_count;
+        std::atomic<uint64_t>             heap_alloc_count;  // new objects from the heap
+        std::atomic<uint64_t>             heap_free_count;   // objects returned to the heap due to the cap
+        std::atomic<uint64_t>             oversize_count;    // larger than the object size
+        std::atomic<uint64_t>             oversize_free_count;
+    };
+
+    class object_pool
+    {
+    public:
+        object_pool(dsn_object_pool_type_t type, const char* name, size_t object_size);
+
+        void* allocate(size_t size);
+        void  deallocate(void* ptr);
+
+        // objects cached by one thread over this cap are returned to the heap,
+        // and so are the objects freed by other threads to a thread over this cap
+        void set_max_cached_bytes_per_thread(size_t bytes);
+        size_t get_max_cached_bytes_per_thread() const { return _max_cached_per_thread * (_object_size + sizeof(object_pool_header)); }
+        std::string get_stats();
+
+    private:
+        object_pool_thread_cache* get_thread_cache();
+        void cache_or_free(object_pool_thread_cache* tc, object_pool_header* h);
+
+    private:
+        dsn_object_pool_type_t    _type;
+        std::string               _name;
+        size_t                    _object_size;
+        int                       _max_cached_per_thread;
+
+        // caches of exited threads are never freed as their objects may still be alive
+        ::dsn::utils::ex_lock_nr_spin _lock;
+        object_pool_thread_cache  *_caches;
+        int                       _cache_count;
+    };
+
+    extern object_pool* get_object_pool(dsn_object_pool_type_t type);
+    extern void object_pool_init(size_t max_cached_bytes_per_thread);
+}
@@ -0,0 +1,137 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/*
+ * Description:
+ *     Unit-test for object pools.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "object_pool.h"
+# include <gtest/gtest.h>
+# include <thread>
+# include <mutex>
+# include <condition_variable>
+# include <vector>
+
+using namespace ::dsn;
+
+TEST(core, object_pool)
+{
+    auto pool = get_object_pool(OBJECT_POOL_MESSAGE_EX);
+
+    // freed objects are reused by the same thread
+    void* p1 = pool->allocate(16);
+    pool->deallocate(p1);
+    void* p2 = pool->allocate(16);
+    ASSERT_EQ(p1, p2);
+    pool->deallocate(p2);
+
+    // oversize objects are from the heap directly
+    void* big = pool->allocate(1024 * 1024);
+    ASSERT_NE(nullptr, big);
+    memset(big, 0, 1024 * 1024);
+    pool->deallocate(big);
+
+    // objects freed by other threads go back to the owner thread
+    void* remote = nullptr;
+    void* reused = nullptr;
+    bool allocated = false, freed = false;
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    std::thread owner([&]()
+    {
+        {
+            std::unique_lock<std::mutex> l(mtx);
+            remote = pool->allocate(16);
+            allocated = true;
+            cv.notify_all();
+            cv.wait(l, [&]() { return freed; });
+        }
+        reused = pool->allocate(16);
+        pool->deallocate(reused);
+    });
+
+    {
+        std::unique_lock<std::mutex> l(mtx);
+        cv.wait(l, [&]() { return allocated; });
+        pool->deallocate(remote);
+        freed = true;
+        cv.notify_all();
+    }
+    owner.join();
+    ASSERT_EQ(remote, reused);
+
+    auto stats = pool->get_stats();
+    ASSERT_NE(std::string::npos, stats.find("message_ex"));
+    ASSERT_NE(std::string::npos, stats.find("remote_free = "));
+}
+
+static uint64_t get_stat(const std::string& stats, const char* name)
+{
+    auto pos = stats.find(name);
+    return pos == std::string::npos ? 0 : std::stoull(stats.substr(pos + strlen(name)));
+}
+
+TEST(core, object_pool_remote_cap)
+{
+    auto pool = get_object_pool(OBJECT_POOL_MESSAGE_EX);
+    size_t old_max_cached_bytes = pool->get_max_cached_bytes_per_thread();
+    size_t object_bytes = (size_t)get_stat(pool->get_stats(), "object_size = ") + sizeof(object_pool_header);
+    const int cap = 10;
+    const int count = 200;
+    pool->set_max_cached_bytes_per_thread(cap * object_bytes);
+
+    // objects of an exited thread freed by others are capped at the owner
+    std::vector<void*> objects;
+    std::thread owner([&]()
+    {
+        for (int i = 0; i < count; i++)
+            objects.push_back(pool->allocate(16));
+    });
+    owner.join();
+
+    uint64_t retained = get_stat(pool->get_stats(), "retained_bytes = ");
+    for (auto p : objects)
+        pool->deallocate(p);
+    uint64_t retained2 = get_stat(pool->get_stats(), "retained_bytes = ");
+
+    // all but cap objects are returned to the heap, with some tolerance for the other threads
+    EXPECT_LE(retained2 + (count - cap * 2) * object_bytes, retained);
+
+    // oversize frees are counted
+    uint64_t oversize_freed = get_stat(pool->get_stats(), "oversize_free = ");
+    void* big = pool->allocate(1024 * 1024);
+    pool->deallocate(big);
+    EXPECT_LE(oversize_freed + 1, get_stat(pool->get_stats(), "oversize_free = "));
+
+    pool->set_max_cached_bytes_per_thread(old_max_cached_bytes);
+}
@@ -329,9 +329,13 @@ safe_string perf_counters::list_counter_internal(const safe_vector<safe_string>&
         }
     }
 
-    std::stringstream ss;
-    dsn::json::json_encode(ss, counters);
-    return ss.str().c_str();
+    binary_writer writer(4096);
+    {
+        dsn::json::json_writer out(writer);
+        dsn::json::json_encode(out, counters);
+    }
+    blob bb = writer.get_buffer();
+    return safe_string(bb.data(), bb.length());
 }
 
 safe_string perf_counters::get_counter_value(const safe_vector<safe_string>& args)
@@ -451,8 +455,6 @@ safe_string perf_counters::get_counter_sample_i(const safe_vector<safe_string>&
 
 safe_string perf_counters::get_counter_index(const safe_vector<safe_string>& args)
 {
-    std::stringstream ss;
-
     std::vector<uint64_t> counter_index_list;
 
     for (auto counter_name : args)
@@ -465,8 +467,13 @@ safe_string perf_counters::get_counter_index(const safe_vector<safe_string>& arg
             counter_index_list.push_back(0);
     }
     
-    dsn::json::json_encode(ss, counter_index_list);
-    return ss.str().c_str();
+    binary_writer writer;
+    {
+        dsn::json::json_writer out(writer);
+        dsn::json::json_encode(out, counter_index_list);
+    }
+    blob bb = writer.get_buffer();
+    return safe_string(bb.data(), bb.length());
 }
 
 } // end namespace
@@ -155,3 +155,57 @@ TEST(core, blocking_priority_queue)
     t1.join();
     t2.join();
 }
+
+TEST(core, blocking_priority_queue_idle_strategy)
+{
+    // spin then park
+    {
+        my_blocking_priority_queue q("spin_then_park");
+        q.set_idle_strategy(1000, false);
+
+        long ct;
+        blocking_queue_wait_t wait;
+        ASSERT_EQ(nullptr, q.dequeue(ct, 10, wait));
+        ASSERT_EQ(BQ_WAIT_TIMEOUT, wait);
+
+        q.enqueue(new queue_data(2, 1), 2);
+        queue_data* d = q.dequeue(ct, 10, wait);
+        ASSERT_NE(nullptr, d);
+        ASSERT_EQ(BQ_WAIT_READY, wait);
+        delete d;
+
+        // a long delayed item arrives after the worker is parked
+        std::thread t([&q]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            q.enqueue(new queue_data(1, 2), 1);
+        });
+        d = q.dequeue(ct, TIME_MS_MAX, wait);
+        ASSERT_NE(nullptr, d);
+        ASSERT_EQ(2, d->queue_index);
+        ASSERT_EQ(BQ_WAIT_PARK, wait);
+        delete d;
+        t.join();
+    }
+
+    // busy poll
+    {
+        my_blocking_priority_queue q("busy_poll");
+        q.set_idle_strategy(0, true);
+
+        long ct;
+        blocking_queue_wait_t wait;
+        ASSERT_EQ(nullptr, q.dequeue(ct, 10, wait));
+        ASSERT_EQ(BQ_WAIT_TIMEOUT, wait);
+
+        std::thread t([&q]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            q.enqueue(new queue_data(0, 3), 0);
+        });
+        queue_data* d = q.dequeue(ct, TIME_MS_MAX, wait);
+        ASSERT_NE(nullptr, d);
+        ASSERT_EQ(3, d->queue_index);
+        ASSERT_EQ(BQ_WAIT_SPIN, wait);
+        delete d;
+        t.join();
+    }
+}
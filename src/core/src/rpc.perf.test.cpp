@@ -36,6 +36,8 @@
 #include <dsn/cpp/test_utils.h>
 #include <dsn/service_api_cpp.h>
 #include <boost/lexical_cast.hpp>
+#include "rpc_engine.h"
+#include "scalable_rpc_client_matcher.h"
 
 
 void rpc_testcase(uint64_t block_size, size_t concurrency)
@@ -175,3 +177,80 @@ TEST(perf_core, lpc)
     for (auto concurrency : { 1, 2, 4,10,50,100,200 })
         lpc_testcase(concurrency);
 }
+
+template<typename TMatcher>
+void rpc_matcher_testcase(const char* name, int thread_count, int outstanding_count)
+{
+    auto node = task::get_current_node2();
+    TMatcher* matcher = new TMatcher(task::get_current_rpc());
+    matcher->add_ref();
+
+    // on-the-fly calls which are never sent
+    int calls_per_thread = outstanding_count / thread_count;
+    std::vector<std::vector<rpc_response_task*>> calls(thread_count);
+    for (auto& cs : calls)
+    {
+        for (int i = 0; i < calls_per_thread; i++)
+        {
+            auto call = new rpc_response_task(message_ex::create_request(RPC_TEST_HASH), nullptr, nullptr, nullptr, 0, node);
+            call->add_ref();
+            cs.push_back(call);
+        }
+    }
+
+    auto run = [&](std::function<void(rpc_response_task*)> op)
+    {
+        std::vector<std::thread*> threads;
+        uint64_t nts_start = dsn_now_ns();
+        for (auto& cs : calls)
+        {
+            threads.push_back(new std::thread([&]()
+            {
+                task::set_tls_dsn_context(node, nullptr, nullptr);
+                for (auto call : cs)
+                {
+                    op(call);
+                }
+            }));
+        }
+
+        for (auto& thr : threads)
+        {
+            thr->join();
+            delete thr;
+        }
+        return dsn_now_ns() - nts_start;
+    };
+
+    // register all calls so that they are on the fly together, and then match them
+    uint64_t call_ns = run([matcher](rpc_response_task* call) { matcher->on_call(call->get_request(), call); });
+    uint64_t match_ns = run([matcher](rpc_response_task* call) { matcher->cancel(call->get_request()->header->id); });
+
+    uint64_t total = (uint64_t)calls_per_thread * thread_count;
+    std::cout
+        << "matcher = " << name
+        << ", thread_count = " << thread_count
+        << ", outstanding = " << total
+        << ", on_call = " << (double)total / (double)call_ns * 1000000000.0 << " #/s"
+        << ", match = " << (double)total / (double)match_ns * 1000000000.0 << " #/s"
+        << std::endl;
+
+    for (auto& cs : calls)
+    {
+        for (auto call : cs)
+        {
+            call->release_ref();
+        }
+    }
+    matcher->release_ref();
+}
+
+TEST(perf_core, rpc_matcher)
+{
+    for (auto thread_count : { 1, 4, 16 })
+        for (auto outstanding_count : { 10000, 500000 })
+        {
+            rpc_matcher_testcase<bucket_rpc_client_matcher>("bucket", thread_count, outstanding_count);
+            rpc_matcher_testcase<scalable_rpc_client_matcher>("scalable", thread_count, outstanding_count);
+        }
+}
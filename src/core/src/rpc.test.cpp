@@ -37,11 +37,14 @@
 #include <dsn/service_api_cpp.h>
 #include <dsn/utility/priority_queue.h>
 #include "group_address.h"
+#include "rpc_engine.h"
+#include "scalable_rpc_client_matcher.h"
 #include <dsn/cpp/test_utils.h>
 #include <boost/lexical_cast.hpp>
 #include <vector>
 #include <string>
 #include <queue>
+#include <set>
 
 typedef std::function<void(error_code, dsn_message_t, dsn_message_t)> rpc_reply_handler;
 
@@ -263,3 +266,209 @@ TEST(core, send_to_invalid_address)
     send_message(group, std::string("echo hehehe"), 1, action_on_succeed, action_on_failure);
     destroy_group(group);
 }
+
+TEST(core, group_address_to_all)
+{
+    ::dsn::rpc_address addr = build_group();
+    auto sp = ::dsn::task_spec::get(RPC_TEST_STRING_COMMAND);
+    auto old_mode = sp->grpc_mode;
+    auto old_quorum = sp->grpc_to_all_quorum;
+    sp->grpc_mode = GRPC_TO_ALL;
+
+    // wait for all members
+    sp->grpc_to_all_quorum = 0;
+    error_code rpc_err;
+    std::string rpc_result;
+    auto typed_callback = [&rpc_err, &rpc_result](error_code err_code, const std::string& result) {
+        rpc_err = err_code;
+        rpc_result = result;
+    };
+
+    ::dsn::task_ptr resp_task = ::dsn::rpc::call(addr, dsn_task_code_t(RPC_TEST_STRING_COMMAND),
+        std::string("echo hello"), nullptr, typed_callback);
+    resp_task->wait();
+    EXPECT_EQ(ERR_OK, rpc_err);
+    EXPECT_EQ(std::string("hello"), rpc_result);
+
+    int count = dsn_rpc_get_group_response_count(resp_task->native_handle());
+    EXPECT_EQ(TEST_PORT_END - TEST_PORT_BEGIN + 1, count);
+
+    std::set<uint16_t> ports;
+    for (int i = 0; i < count; i++)
+    {
+        dsn_address_t member;
+        dsn_error_t err;
+        dsn_message_t resp = dsn_rpc_get_group_response(resp_task->native_handle(), i, &member, &err);
+        EXPECT_EQ(ERR_OK, error_code(err));
+        ASSERT_TRUE(resp != nullptr);
+
+        // the response of the call is among them and read already by typed_callback,
+        // and each of them can be read again
+        std::string result;
+        ::dsn::unmarshall(resp, result);
+        EXPECT_EQ(std::string("hello"), result);
+        dsn_msg_release_ref(resp);
+
+        resp = dsn_rpc_get_group_response(resp_task->native_handle(), i, &member, &err);
+        ASSERT_TRUE(resp != nullptr);
+        result.clear();
+        ::dsn::unmarshall(resp, result);
+        EXPECT_EQ(std::string("hello"), result);
+        dsn_msg_release_ref(resp);
+
+        ports.insert(::dsn::rpc_address(member).port());
+    }
+    EXPECT_EQ((size_t)count, ports.size());
+
+    // complete on the first response
+    sp->grpc_to_all_quorum = 1;
+    rpc_err = ERR_UNKNOWN;
+    rpc_result.clear();
+    resp_task = ::dsn::rpc::call(addr, dsn_task_code_t(RPC_TEST_STRING_COMMAND),
+        std::string("echo world"), nullptr, typed_callback);
+    resp_task->wait();
+    EXPECT_EQ(ERR_OK, rpc_err);
+    EXPECT_EQ(std::string("world"), rpc_result);
+    EXPECT_GE(dsn_rpc_get_group_response_count(resp_task->native_handle()), 1);
+
+    sp->grpc_mode = old_mode;
+    sp->grpc_to_all_quorum = old_quorum;
+    destroy_group(addr);
+}
+
+TEST(core, group_address_to_any_hedged)
+{
+    // only the last member replies to "expect_no_reply", so that calls to
+    // the other member complete only when they are hedged
+    ::dsn::rpc_address addr;
+    addr.assign_group(dsn_group_build("server_group.hedge.test"));
+    dsn_group_add(addr.group_handle(), ::dsn::rpc_address("localhost", TEST_PORT_END - 1).c_addr());
+    dsn_group_add(addr.group_handle(), ::dsn::rpc_address("localhost", TEST_PORT_END).c_addr());
+
+    auto sp = ::dsn::task_spec::get(RPC_TEST_STRING_COMMAND);
+    auto old_mode = sp->grpc_mode;
+    auto old_delay = sp->grpc_to_any_hedge_delay_milliseconds;
+    sp->grpc_mode = GRPC_TO_ANY;
+    sp->grpc_to_any_hedge_delay_milliseconds = 10;
+
+    auto rpc = ::dsn::task::get_current_rpc();
+    ASSERT_TRUE(rpc != nullptr);
+    auto stats = rpc->hedge_stats(RPC_TEST_STRING_COMMAND);
+    ASSERT_TRUE(stats != nullptr);
+    uint64_t sent = stats->sent_count.load();
+    uint64_t won = stats->won_count.load();
+    uint64_t observed = stats->latency_count();
+
+    for (int i = 0; i < 20; i++)
+    {
+        error_code rpc_err;
+        std::string rpc_result;
+        ::dsn::task_ptr resp_task = ::dsn::rpc::call(addr, dsn_task_code_t(RPC_TEST_STRING_COMMAND),
+            std::string("expect_no_reply"), nullptr, 
+            [&rpc_err, &rpc_result](error_code err_code, const std::string& result) {
+                rpc_err = err_code;
+                rpc_result = result;
+            });
+        resp_task->wait();
+        EXPECT_EQ(ERR_OK, rpc_err);
+        EXPECT_EQ(TEST_PORT_END, dsn_address_from_string(rpc_result).port());
+    }
+
+    uint64_t sent_delta = stats->sent_count.load() - sent;
+    uint64_t won_delta = stats->won_count.load() - won;
+    EXPECT_GT(won_delta, 0u);
+    EXPECT_GE(sent_delta, won_delta);
+
+    // every primary is observed, including those cancelled as the hedges won
+    EXPECT_EQ(20u, stats->latency_count() - observed);
+
+    sp->grpc_mode = old_mode;
+    sp->grpc_to_any_hedge_delay_milliseconds = old_delay;
+    destroy_group(addr);
+}
+
+TEST(core, scalable_rpc_client_matcher)
+{
+    auto matcher = new scalable_rpc_client_matcher(::dsn::task::get_current_rpc());
+    matcher->add_ref();
+
+    // lots of calls to make the table grow (it never shrinks)
+    std::vector<rpc_response_task*> calls;
+    for (int i = 0; i < 10000; i++)
+    {
+        auto call = new rpc_response_task(message_ex::create_request(RPC_TEST_HASH, 1000), 
+            nullptr, nullptr, nullptr, 0, ::dsn::task::get_current_node2());
+        call->add_ref();
+        matcher->on_call(call->get_request(), call);
+        calls.push_back(call);
+    }
+
+    // match half of them, so others time out
+    for (size_t i = 0; i < calls.size(); i += 2)
+    {
+        EXPECT_TRUE(matcher->cancel(calls[i]->get_request()->header->id));
+        EXPECT_FALSE(matcher->cancel(calls[i]->get_request()->header->id));
+    }
+
+    // some of the others are cancelled by the callers
+    for (size_t i = 3; i < calls.size(); i += 4)
+    {
+        EXPECT_TRUE(calls[i]->cancel(false));
+    }
+
+    matcher->sweep(dsn_now_ms() + 2000);
+    for (size_t i = 0; i < calls.size(); i++)
+    {
+        if (i % 4 == 3)
+        {
+            EXPECT_EQ(TASK_STATE_CANCELLED, calls[i]->state());
+            EXPECT_NE(ERR_TIMEOUT, calls[i]->error());
+            EXPECT_FALSE(matcher->cancel(calls[i]->get_request()->header->id));
+        }
+        else if (i % 2 == 1)
+        {
+            EXPECT_TRUE(calls[i]->wait(10000));
+            EXPECT_EQ(ERR_TIMEOUT, calls[i]->error());
+            EXPECT_FALSE(matcher->cancel(calls[i]->get_request()->header->id));
+        }
+        else
+        {
+            EXPECT_EQ(TASK_STATE_READY, calls[i]->state());
+        }
+        calls[i]->release_ref();
+    }
+
+    matcher->release_ref();
+}
+
+TEST(core, rpc_handler_table)
+{
+    std::unordered_map<std::string, rpc_handler_info*> handlers;
+    std::vector<rpc_handler_info*> infos;
+    for (int i = 0; i < 1000; i++)
+    {
+        auto h = new rpc_handler_info(RPC_TEST_HASH);
+        h->name = ("rpc.test.handler." + boost::lexical_cast<std::string>(i)).c_str();
+        handlers[h->name.c_str()] = h;
+        infos.push_back(h);
+    }
+
+    rpc_handler_table table(handlers);
+    for (auto h : infos)
+    {
+        EXPECT_EQ(h, table.find(h->name.c_str()));
+    }
+    EXPECT_EQ(nullptr, table.find("rpc.test.handler.unknown"));
+    EXPECT_EQ(nullptr, table.find(""));
+    EXPECT_TRUE(nullptr != table.find(RPC_TEST_HASH));
+    EXPECT_EQ(nullptr, table.find(dsn_task_code_max() + 1));
+
+    rpc_handler_table empty_table(std::unordered_map<std::string, rpc_handler_info*>{});
+    EXPECT_EQ(nullptr, empty_table.find("rpc.test.handler.0"));
+    EXPECT_EQ(nullptr, empty_table.find(RPC_TEST_HASH));
+
+    for (auto h : infos)
+    {
+        delete h;
+    }
+}
@@ -44,6 +44,7 @@
 # endif
 
 # include "rpc_engine.h"
+# include "scalable_rpc_client_matcher.h"
 # include "service_engine.h"
 # include "group_address.h"
 # include "uri_address.h"
@@ -52,6 +53,8 @@
 # include <dsn/tool-api/task_queue.h>
 # include <dsn/cpp/serialization.h>
 # include <set>
+# include <algorithm>
+# include <thread>
 # include <dsn/cpp/layer2_handler.h>
 
 # ifdef __TITLE__
@@ -66,7 +69,7 @@ namespace dsn {
     class rpc_timeout_task : public task, public transient_object
     {
     public:
-        rpc_timeout_task(rpc_client_matcher* matcher, uint64_t id, service_node* node) 
+        rpc_timeout_task(bucket_rpc_client_matcher* matcher, uint64_t id, service_node* node) 
             : task(LPC_RPC_TIMEOUT, nullptr, nullptr, 0, node)
         {
             _matcher = matcher;
@@ -82,11 +85,11 @@ namespace dsn {
         // use the following if the matcher is per rpc session
         // rpc_client_matcher_ptr _matcher;
 
-        rpc_client_matcher* _matcher;
+        bucket_rpc_client_matcher* _matcher;
         uint64_t            _id;
     };
 
-    rpc_client_matcher::~rpc_client_matcher()
+    bucket_rpc_client_matcher::~bucket_rpc_client_matcher()
     {
         for (int i = 0; i < MATCHER_BUCKET_NR; i++)
         {
@@ -94,42 +97,44 @@ namespace dsn {
         }
     }
 
-    bool rpc_client_matcher::on_recv_reply(network* net, uint64_t key, message_ex* reply, int delay_ms)
-    {       
-        rpc_response_task* call;
-        task* timeout_task;
-        int bucket_index = key % MATCHER_BUCKET_NR;
+    rpc_client_matcher* rpc_client_matcher::create(rpc_engine* engine)
+    {
+        if (service_engine::fast_instance().spec().rpc_scalable_client_matcher)
+            return new scalable_rpc_client_matcher(engine);
+        else
+            return new bucket_rpc_client_matcher(engine);
+    }
+
+    int rpc_client_matcher::get_timeout(message_ex* request, /*out*/ uint64_t& timeout_ts_ms)
+    {
+        auto sp = task_spec::get(request->local_rpc_code);
+        int timeout_ms = request->header->client.timeout_ms;
+        timeout_ts_ms = 0;
 
+        // reset timeout when resend is enabled
+        if (sp->rpc_request_resend_timeout_milliseconds > 0 && 
+            timeout_ms > sp->rpc_request_resend_timeout_milliseconds
+            )
         {
-            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(_requests_lock[bucket_index]);
-            auto it = _requests[bucket_index].find(key);
-            if (it != _requests[bucket_index].end())
-            {
-                call = it->second.resp_task;
-                timeout_task = it->second.timeout_task;
-                timeout_task->add_ref(); // released below in the same function
-                _requests[bucket_index].erase(it);
-            }
-            else
-            {
-                if (reply)
-                {
-                    dassert(reply->get_count() == 0,
-                        "reply should not be referenced by anybody so far");
-                    delete reply;
-                }
-                return false;
-            }
+            timeout_ts_ms = dsn_now_ms() + timeout_ms; // non-zero for resend
+            timeout_ms = sp->rpc_request_resend_timeout_milliseconds;            
         }
+        return timeout_ms;
+    }
 
-        dbg_dassert(call != nullptr, "rpc response task cannot be empty");
-        dbg_dassert(timeout_task != nullptr, "rpc timeout task cannot be empty");
-
-        if (timeout_task != task::get_current_task())
+    bool rpc_client_matcher::on_recv_reply(network* net, uint64_t key, message_ex* reply, int delay_ms)
+    {       
+        rpc_response_task* call = remove(key);
+        if (call == nullptr)
         {
-            timeout_task->cancel(false); // no need to wait
+            if (reply)
+            {
+                dassert(reply->get_count() == 0,
+                    "reply should not be referenced by anybody so far");
+                delete reply;
+            }
+            return false;
         }
-        timeout_task->release_ref(); // added above in the same function
 
         auto req = call->get_request();
         auto spec = task_spec::get(req->local_rpc_code);
@@ -240,7 +245,46 @@ namespace dsn {
         return true;
     }
 
-    void rpc_client_matcher::on_rpc_timeout(uint64_t key)
+    bool rpc_client_matcher::cancel(uint64_t key)
+    {
+        rpc_response_task* call = remove(key);
+        if (call == nullptr)
+            return false;
+
+        call->release_ref(); // added in on_call
+        return true;
+    }
+
+    rpc_response_task* bucket_rpc_client_matcher::remove(uint64_t key)
+    {
+        rpc_response_task* call;
+        task* timeout_task;
+        int bucket_index = key % MATCHER_BUCKET_NR;
+
+        {
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(_requests_lock[bucket_index]);
+            auto it = _requests[bucket_index].find(key);
+            if (it == _requests[bucket_index].end())
+                return nullptr;
+
+            call = it->second.resp_task;
+            timeout_task = it->second.timeout_task;
+            timeout_task->add_ref(); // released below in the same function
+            _requests[bucket_index].erase(it);
+        }
+
+        dbg_dassert(call != nullptr, "rpc response task cannot be empty");
+        dbg_dassert(timeout_task != nullptr, "rpc timeout task cannot be empty");
+
+        if (timeout_task != task::get_current_task())
+        {
+            timeout_task->cancel(false); // no need to wait
+        }
+        timeout_task->release_ref(); // added above in the same function
+        return call;
+    }
+
+    void bucket_rpc_client_matcher::on_rpc_timeout(uint64_t key)
     {
         rpc_response_task* call;
         int bucket_index = key % MATCHER_BUCKET_NR;        
@@ -350,23 +394,13 @@ namespace dsn {
         call->release_ref(); // added inside the first check of resend
     }
     
-    void rpc_client_matcher::on_call(message_ex* request, rpc_response_task* call)
+    void bucket_rpc_client_matcher::on_call(message_ex* request, rpc_response_task* call)
     {
         task* timeout_task;
         message_header& hdr = *request->header;
         int bucket_index = hdr.id % MATCHER_BUCKET_NR;
-        auto sp = task_spec::get(request->local_rpc_code);
-        int timeout_ms = hdr.client.timeout_ms;
-        uint64_t timeout_ts_ms = 0;
-        
-        // reset timeout when resend is enabled
-        if (sp->rpc_request_resend_timeout_milliseconds > 0 && 
-            timeout_ms > sp->rpc_request_resend_timeout_milliseconds
-            )
-        {
-            timeout_ts_ms = dsn_now_ms() + timeout_ms; // non-zero for resend
-            timeout_ms = sp->rpc_request_resend_timeout_milliseconds;            
-        }
+        uint64_t timeout_ts_ms;
+        int timeout_ms = get_timeout(request, timeout_ts_ms);
 
         dbg_dassert(call != nullptr, "rpc response task cannot be empty");
         timeout_task = (new rpc_timeout_task(this, hdr.id, call->node()));
@@ -383,26 +417,216 @@ namespace dsn {
         call->add_ref(); // released in on_rpc_timeout or on_recv_reply
     }
 
+    //----------------------------------------------------------------------------------------------
+    rpc_hedge_stats::rpc_hedge_stats()
+        : sent_count(0), won_count(0), _latency_count(0)
+    {
+        for (auto& b : _latency_buckets)
+            b.store(0, std::memory_order_relaxed);
+    }
+
+    void rpc_hedge_stats::add_latency(uint64_t latency_us)
+    {
+        int bucket = 0;
+        while (latency_us > 1 && bucket < LATENCY_BUCKET_COUNT - 1)
+        {
+            latency_us >>= 1;
+            bucket++;
+        }
+
+        _latency_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+        // halve all buckets periodically, it is fine to be inaccurate under races
+        if (_latency_count.fetch_add(1, std::memory_order_relaxed) + 1 == DECAY_SAMPLE_COUNT)
+        {
+            uint32_t total = 0;
+            for (auto& b : _latency_buckets)
+            {
+                uint32_t v = b.load(std::memory_order_relaxed) / 2;
+                b.store(v, std::memory_order_relaxed);
+                total += v;
+            }
+            _latency_count.store(total, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t rpc_hedge_stats::latency_percentile_us(double percentile) const
+    {
+        uint32_t counts[LATENCY_BUCKET_COUNT];
+        uint64_t total = 0;
+        for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+        {
+            counts[i] = _latency_buckets[i].load(std::memory_order_relaxed);
+            total += counts[i];
+        }
+
+        if (total < MIN_SAMPLE_COUNT)
+            return 0;
+
+        // upper bound of the bucket where the percentile falls in
+        uint64_t threshold = (uint64_t)(total * percentile);
+        uint64_t sum = 0;
+        for (int i = 0; i < LATENCY_BUCKET_COUNT; i++)
+        {
+            sum += counts[i];
+            if (sum > threshold)
+                return ((uint64_t)1) << (i + 1);
+        }
+        return ((uint64_t)1) << LATENCY_BUCKET_COUNT;
+    }
+
+    //----------------------------------------------------------------------------------------------
+    rpc_handler_table::rpc_handler_table(const std::unordered_map<std::string, rpc_handler_info*>& handlers)
+    {
+        _by_code.resize(dsn_task_code_max() + 1, nullptr);
+        for (auto& kv : handlers)
+        {
+            auto h = kv.second;
+            if (h->code >= (dsn_task_code_t)_by_code.size())
+                _by_code.resize(h->code + 1, nullptr);
+            _by_code[h->code] = h;
+        }
+
+        // 1.25x slots at first, and more slots if the seeds are hard to find
+        uint32_t capacity = (uint32_t)handlers.size() + (uint32_t)handlers.size() / 4 + 1;
+        while (!build_names(handlers, capacity))
+        {
+            capacity *= 2;
+        }
+    }
+
+    uint64_t rpc_handler_table::name_hash(const char* name)
+    {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ULL;
+        for (auto p = (const unsigned char*)name; *p; p++)
+        {
+            h ^= *p;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    uint32_t rpc_handler_table::slot_hash(uint64_t h, uint32_t seed)
+    {
+        h ^= seed * 0x9e3779b97f4a7c15ULL;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return (uint32_t)h;
+    }
+
+    bool rpc_handler_table::build_names(const std::unordered_map<std::string, rpc_handler_info*>& handlers, uint32_t capacity)
+    {
+        uint32_t bucket_count = (uint32_t)handlers.size() / 2 + 1;
+        std::vector<std::vector<const std::pair<const std::string, rpc_handler_info*>*>> buckets(bucket_count);
+        for (auto& kv : handlers)
+        {
+            buckets[name_hash(kv.first.c_str()) % bucket_count].push_back(&kv);
+        }
+
+        // place the largest buckets first when there are more free slots
+        std::vector<uint32_t> order(bucket_count);
+        for (uint32_t i = 0; i < bucket_count; i++)
+            order[i] = i;
+        std::sort(order.begin(), order.end(), [&buckets](uint32_t l, uint32_t r) 
+        {
+            return buckets[l].size() > buckets[r].size();
+        });
+
+        _seeds.assign(bucket_count, 0);
+        _names.assign(capacity, name_entry{ 0, std::string(), nullptr });
+
+        std::vector<uint32_t> slots;
+        for (auto b : order)
+        {
+            auto& bucket = buckets[b];
+            if (bucket.empty())
+                break;
+
+            bool placed = false;
+            for (uint32_t seed = 1; seed < 65536 && !placed; seed++)
+            {
+                slots.clear();
+                placed = true;
+                for (auto kv : bucket)
+                {
+                    uint32_t slot = slot_hash(name_hash(kv->first.c_str()), seed) % capacity;
+                    if (_names[slot].handler != nullptr 
+                        || std::find(slots.begin(), slots.end(), slot) != slots.end())
+                    {
+                        placed = false;
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+
+                if (placed)
+                {
+                    _seeds[b] = seed;
+                    for (size_t i = 0; i < bucket.size(); i++)
+                    {
+                        auto& e = _names[slots[i]];
+                        e.hash = name_hash(bucket[i]->first.c_str());
+                        e.name = bucket[i]->first;
+                        e.handler = bucket[i]->second;
+                    }
+                }
+            }
+
+            if (!placed)
+                return false;
+        }
+        return true;
+    }
+
+    rpc_handler_info* rpc_handler_table::find(const char* name) const
+    {
+        uint64_t h = name_hash(name);
+        uint32_t seed = _seeds[h % _seeds.size()];
+        auto& e = _names[slot_hash(h, seed) % _names.size()];
+        return (e.handler != nullptr && e.hash == h && e.name == name) ? e.handler : nullptr;
+    }
+
     //----------------------------------------------------------------------------------------------
     rpc_server_dispatcher::rpc_server_dispatcher()
+        : _epoch(0)
     {
-        _vhandlers.resize(dsn_task_code_max() + 1);
-        for (auto& h : _vhandlers)
+        for (auto& r : _readers)
         {
-            h = new std::pair<rpc_handler_info*, utils::rw_lock_nr>();
-            h->first = nullptr;
+            r.counts[0].store(0);
+            r.counts[1].store(0);
         }
+        _table.store(new rpc_handler_table(_handlers));
     }
 
     rpc_server_dispatcher::~rpc_server_dispatcher()
     {
-        for (auto& h : _vhandlers)
+        delete _table.load();
+        dassert(_handlers.size() == 0, "please make sure all rpc handlers are unregistered at this point");
+    }
+
+    void rpc_server_dispatcher::synchronize()
+    {
+        // flip twice so that the readers which enter with a stale epoch are also waited
+        for (int i = 0; i < 2; i++)
         {
-            delete h;
+            uint64_t old = _epoch.fetch_add(1);
+            for (auto& r : _readers)
+            {
+                while (r.counts[old & 1].load() != 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
         }
-        _vhandlers.clear();
+    }
 
-        dassert(_handlers.size() == 0, "please make sure all rpc handlers are unregistered at this point");
+    void rpc_server_dispatcher::publish_handlers()
+    {
+        auto old = _table.exchange(new rpc_handler_table(_handlers));
+        synchronize();
+        delete old;
     }
 
     bool rpc_server_dispatcher::register_rpc_handler(rpc_handler_info* handler)
@@ -417,10 +641,7 @@ namespace dsn {
             _handlers[name] = handler;
             _handlers[handler->name.c_str()] = handler;   
 
-            {
-                utils::auto_write_lock l(_vhandlers[handler->code]->second);
-                _vhandlers[handler->code]->first = handler;
-            }
+            publish_handlers();
             return true;
         }
         else
@@ -444,41 +665,45 @@ namespace dsn {
             _handlers.erase(it);
             _handlers.erase(name.c_str());
 
-            {
-                utils::auto_write_lock l(_vhandlers[rpc_code]->second);
-                _vhandlers[rpc_code]->first = nullptr;
-            }
+            // no reader can reference the handler without a ref after this
+            publish_handlers();
         }
 
         ret->unregister();
         return ret;
     }
 
-    rpc_request_task* rpc_server_dispatcher::on_request(message_ex* msg, service_node* node)
+    rpc_handler_info* rpc_server_dispatcher::find_handler(message_ex* msg)
     {
-        rpc_handler_info* handler = nullptr;
-        
+        rpc_handler_info* handler;
+        auto c = enter_read();
+        auto table = _table.load();
+
         if (TASK_CODE_INVALID != msg->local_rpc_code)
         {
-            utils::auto_read_lock l(_vhandlers[msg->local_rpc_code]->second);
-            handler = _vhandlers[msg->local_rpc_code]->first;
-            if (nullptr != handler)
-            {
-                handler->add_ref();
-            }
+            handler = table->find(msg->local_rpc_code);
         }
         else
         {
-            utils::auto_read_lock l(_handlers_lock);
-            auto it = _handlers.find(msg->header->rpc_name);
-            if (it != _handlers.end())
+            handler = table->find(msg->header->rpc_name);
+            if (nullptr != handler)
             {
-                msg->local_rpc_code = it->second->code;
-                handler = it->second;
-                handler->add_ref();
+                msg->local_rpc_code = handler->code;
             }
         }
 
+        if (nullptr != handler)
+        {
+            handler->add_ref();
+        }
+
+        leave_read(c);
+        return handler;
+    }
+
+    rpc_request_task* rpc_server_dispatcher::on_request(message_ex* msg, service_node* node)
+    {
+        rpc_handler_info* handler = find_handler(msg);
         if (handler)
         {
             auto r = new rpc_request_task(msg, handler, node);
@@ -491,29 +716,7 @@ namespace dsn {
 
     void rpc_server_dispatcher::on_request_with_inline_execution(message_ex* msg, service_node* node)
     {
-        rpc_handler_info* handler = nullptr;
-
-        if (TASK_CODE_INVALID != msg->local_rpc_code)
-        {
-            utils::auto_read_lock l(_vhandlers[msg->local_rpc_code]->second);
-            handler = _vhandlers[msg->local_rpc_code]->first;
-            if (nullptr != handler)
-            {
-                handler->add_ref();
-            }
-        }
-        else
-        {
-            utils::auto_read_lock l(_handlers_lock);
-            auto it = _handlers.find(msg->header->rpc_name);
-            if (it != _handlers.end())
-            {
-                msg->local_rpc_code = it->second->code;
-                handler = it->second;
-                handler->add_ref();
-            }
-        }
-
+        rpc_handler_info* handler = find_handler(msg);
         if (handler)
         {
             handler->c_handler(msg, handler->parameter);
@@ -526,13 +729,21 @@ namespace dsn {
 
     //----------------------------------------------------------------------------------------------
     rpc_engine::rpc_engine(configuration_ptr config, service_node* node)
-        : _config(config), _node(node), _rpc_matcher(this)
+        : _config(config), _node(node)
     {
         dassert (_node != nullptr, "");
         dassert (_config != nullptr, "");
 
         _is_running = false;
         _is_serving = false;
+        _rpc_matcher.reset(rpc_client_matcher::create(this));
+
+        // released never as rpc engine lives till the process exits
+        _hedge_stats.resize(dsn_task_code_max() + 1);
+        for (auto& s : _hedge_stats)
+        {
+            s = new rpc_hedge_stats();
+        }
     }
 
     void rpc_engine::get_runtime_info(const safe_string& indent,
@@ -579,6 +790,21 @@ namespace dsn {
             }
         }
 
+        ss << indent2 << "RPC.Hedge:" << std::endl;
+        for (int code = 0; code < (int)_hedge_stats.size(); code++)
+        {
+            auto hs = _hedge_stats[code];
+            if (hs->latency_count() == 0 && hs->sent_count.load() == 0)
+                continue;
+
+            ss << indent3
+                << dsn_task_code_to_string(code)
+                << ": hedge.sent = " << hs->sent_count.load()
+                << ", hedge.won = " << hs->won_count.load()
+                << ", latency.p95(us) = " << hs->latency_percentile_us(0.95)
+                << std::endl;
+        }
+
         ss << indent2 << std::endl;
     }
         
@@ -745,6 +971,11 @@ namespace dsn {
         ddebug("=== service_node=[%s], primary_address=[%s] ===",
             _node->name(), _local_primary_address.to_string());
 
+        _hedge_sent_count = perf_counter::get_counter(_node->name(), "engine", "rpc.hedge.sent.count",
+            COUNTER_TYPE_RATE, "duplicate GRPC_TO_ANY requests sent to another member for hedging", true);
+        _hedge_won_count = perf_counter::get_counter(_node->name(), "engine", "rpc.hedge.won.count",
+            COUNTER_TYPE_RATE, "hedged GRPC_TO_ANY calls completed by the duplicate request", true);
+
         _is_running = true;
         return ERR_OK;
     }
@@ -986,17 +1217,455 @@ namespace dsn {
             call_ip(request->server_address.group_address()->possible_leader(), request, call);
             break;
         case GRPC_TO_ANY:
-            // TODO: performance optimization
-            call_ip(request->server_address.group_address()->random_member(), request, call);
+            if (call != nullptr && (sp->grpc_to_any_hedge_delay_milliseconds > 0 || sp->grpc_to_any_hedge_adaptive))
+            {
+                call_group_hedged(request->server_address.group_address(), request, call);
+            }
+            else
+            {
+                // TODO: performance optimization
+                call_ip(request->server_address.group_address()->random_member(), request, call);
+            }
             break;
         case GRPC_TO_ALL:
-            dassert(false, "to be implemented");
+            call_group_all(request->server_address.group_address(), request, call, sp->grpc_to_all_quorum);
             break;
         default:
             dassert(false, "invalid group rpc mode %d", (int)(sp->grpc_mode));
         }
     }
 
+    // context of a GRPC_TO_ALL call, deleted when all members respond or time out
+    struct group_call_context : public transient_object
+    {
+        rpc_response_task      *call;
+        int                    total;
+        int                    quorum;
+        int                    responded;
+        int                    succeeded;
+        bool                   completed;
+        message_ex             *first_response;
+        error_code             last_error;
+        ::dsn::utils::ex_lock_nr_spin lock;
+    };
+
+    static void on_group_member_response(dsn_error_t err, dsn_message_t req, dsn_message_t resp, void* context)
+    {
+        auto ctx = (group_call_context*)context;
+        auto request = (message_ex*)req;
+        auto response = (message_ex*)resp;
+        bool complete = false;
+        bool last;
+        error_code complete_err;
+
+        {
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(ctx->lock);
+            ctx->responded++;
+
+            // responses after completion are not delivered as the callback may be running
+            if (!ctx->completed)
+            {
+                ctx->call->add_group_response(request->to_address, err, response);
+                if (err == ERR_OK)
+                {
+                    ctx->succeeded++;
+                    if (ctx->first_response == nullptr && response != nullptr)
+                    {
+                        ctx->first_response = response;
+                        response->add_ref(); // released when ctx is deleted
+                    }
+                }
+                else
+                {
+                    ctx->last_error = err;
+                }
+
+                int remaining = ctx->total - ctx->responded;
+                if (ctx->succeeded >= ctx->quorum)
+                {
+                    complete = true;
+                    complete_err = ERR_OK;
+                }
+
+                // wait for all responses when all members are required
+                else if (remaining == 0 
+                    || (ctx->quorum < ctx->total && ctx->succeeded + remaining < ctx->quorum))
+                {
+                    complete = true;
+                    complete_err = ctx->last_error;
+                }
+                ctx->completed = complete;
+            }
+
+            last = (ctx->responded == ctx->total);
+        }
+
+        if (complete)
+        {
+            ctx->call->enqueue(complete_err, complete_err == ERR_OK ? ctx->first_response : nullptr);
+        }
+
+        if (last)
+        {
+            if (ctx->first_response != nullptr)
+                ctx->first_response->release_ref(); // added above
+            ctx->call->release_ref(); // added in call_group_all
+            delete ctx;
+        }
+    }
+
+    void rpc_engine::call_group_all(rpc_group_address* group, message_ex* request, rpc_response_task* call, int quorum)
+    {
+        auto members = group->members_snapshot();
+        if (members.empty())
+        {
+            derror("call group %s failed as it has no members, rpc_name = %s", group->name(), request->header->rpc_name);
+            if (call != nullptr)
+            {
+                call->enqueue(ERR_SERVICE_NOT_FOUND, nullptr);
+            }
+            else
+            {
+                // as ref_count for request may be zero
+                request->add_ref();
+                request->release_ref();
+            }
+            return;
+        }
+
+        group_call_context* ctx = nullptr;
+        if (call != nullptr)
+        {
+            ctx = new group_call_context();
+            ctx->call = call;
+            ctx->total = (int)members.size();
+            ctx->quorum = (quorum <= 0 || quorum > ctx->total) ? ctx->total : quorum;
+            ctx->responded = 0;
+            ctx->succeeded = 0;
+            ctx->completed = false;
+            ctx->first_response = nullptr;
+            ctx->last_error = ERR_TIMEOUT;
+            call->add_ref(); // released in on_group_member_response
+        }
+
+        // the request is serialized once, and each member gets a copy with
+        // a private header (e.g., request id) sharing the same body buffers
+        for (auto& m : members)
+        {
+            auto copy = request->copy_with_private_header();
+            if (call != nullptr)
+            {
+                auto sub = new rpc_response_task(copy, on_group_member_response, ctx, nullptr, 0, call->node());
+                sub->set_caller_pool(call->caller_pool());
+                sub->add_ref(); // released below in the same function
+                call_ip(m, copy, sub, true);
+                sub->release_ref();
+            }
+            else
+            {
+                call_ip(m, copy, nullptr, true);
+            }
+        }
+
+        if (call == nullptr)
+        {
+            // as ref_count for request may be zero
+            request->add_ref();
+            request->release_ref();
+        }
+    }
+
+    DEFINE_TASK_CODE(LPC_RPC_HEDGE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+    //
+    // context of a hedged GRPC_TO_ANY call: the request is sent to a random member first,
+    // and a duplicate is sent to another member if no response is received after the 
+    // hedge delay, with the remaining timeout of the call; the first reply completes the
+    // call, and the losing one is cancelled. The observed latencies (for adaptive hedge
+    // delay) are of the primaries only, where the primaries cancelled, timed out or failed
+    // are recorded with their elapsed time (capped at the call timeout) as censored samples,
+    // so that the percentiles do not miss the tail
+    //
+    class hedged_call_context : public ref_counter
+    {
+    public:
+        hedged_call_context(rpc_engine* engine, rpc_group_address* group, message_ex* request, 
+            rpc_response_task* call, rpc_hedge_stats* stats)
+            : _engine(engine), _group(group), _request(request), _call(call), _stats(stats)
+        {
+            _subs[0] = _subs[1] = nullptr;
+            _sent = 0;
+            _outstanding = 0;
+            _hedge_pending = false;
+            _completed = false;
+            _last_error = ERR_TIMEOUT;
+            _start_ts_ns = dsn_now_ns();
+            _hedge_timer = nullptr;
+            _call->add_ref(); // released in dtor
+        }
+
+        ~hedged_call_context()
+        {
+            for (auto& sub : _subs)
+            {
+                if (sub != nullptr)
+                    sub->release_ref(); // added in send
+            }
+            _call->release_ref(); // added in ctor
+        }
+
+        void start(int hedge_delay_ms);
+        void send_hedge();
+        void on_response(error_code err, message_ex* req, message_ex* resp);
+
+    private:
+        void send(int index, rpc_address addr, int timeout_ms);
+        void observe_primary();
+        
+    private:
+        rpc_engine         *_engine;
+        rpc_group_address  *_group;
+        message_ex         *_request; // held by _call
+        rpc_response_task  *_call;
+        rpc_hedge_stats    *_stats;
+        rpc_address        _primary;
+        rpc_response_task  *_subs[2]; // primary and hedge
+        int                _sent;
+        int                _outstanding;
+        bool               _hedge_pending;
+        bool               _completed;
+        error_code         _last_error;
+        uint64_t           _start_ts_ns;
+        task               *_hedge_timer;
+        ::dsn::utils::ex_lock_nr_spin _lock;
+    };
+
+    class rpc_hedge_task : public task, public transient_object
+    {
+    public:
+        rpc_hedge_task(hedged_call_context* ctx, service_node* node)
+            : task(LPC_RPC_HEDGE, nullptr, nullptr, 0, node), _ctx(ctx)
+        {
+            _ctx->add_ref(); // released in dtor
+        }
+
+        ~rpc_hedge_task()
+        {
+            _ctx->release_ref(); // added in ctor
+        }
+
+        virtual void exec()
+        {
+            _ctx->send_hedge();
+        }
+
+    private:
+        hedged_call_context *_ctx;
+    };
+
+    static void on_hedged_response(dsn_error_t err, dsn_message_t req, dsn_message_t resp, void* context)
+    {
+        auto ctx = (hedged_call_context*)context;
+        ctx->on_response(err, (message_ex*)req, (message_ex*)resp);
+        ctx->release_ref(); // added in send
+    }
+
+    void hedged_call_context::start(int hedge_delay_ms)
+    {
+        task* timer = nullptr;
+        _primary = _group->random_member();
+        if (hedge_delay_ms > 0)
+        {
+            timer = new rpc_hedge_task(this, _call->node());
+            timer->add_ref(); // released below in the same function
+            timer->add_ref(); // released when the timer is fired or cancelled
+            _hedge_timer = timer;
+            _hedge_pending = true;
+        }
+
+        send(0, _primary, _request->header->client.timeout_ms);
+
+        // the call may be completed already (e.g., fault injection) and 
+        // the timer is then cancelled, which is fine for enqueue
+        if (timer)
+        {
+            timer->set_delay(hedge_delay_ms);
+            timer->enqueue();
+            timer->release_ref(); // added above in the same function
+        }
+    }
+
+    void hedged_call_context::send(int index, rpc_address addr, int timeout_ms)
+    {
+        // each copy has its own request id so that the loser can be cancelled in the matcher
+        auto copy = _request->copy_with_private_header();
+        copy->header->client.timeout_ms = timeout_ms;
+        auto sub = new rpc_response_task(copy, on_hedged_response, this, nullptr, 0, _call->node());
+        sub->set_caller_pool(_call->caller_pool());
+        sub->add_ref(); // released in dtor
+        add_ref(); // released in on_hedged_response, or after the sub call is cancelled
+
+        {
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(_lock);
+            _subs[index] = sub;
+            _sent++;
+            _outstanding++;
+        }
+
+        _engine->call_ip(addr, copy, sub, true);
+    }
+
+    void hedged_call_context::observe_primary()
+    {
+        if (_stats == nullptr)
+            return;
+
+        uint64_t elapsed_us = (dsn_now_ns() - _start_ts_ns) / 1000;
+        uint64_t timeout_us = static_cast<uint64_t>(_request->header->client.timeout_ms) * 1000;
+        _stats->add_latency(std::min(elapsed_us, timeout_us));
+    }
+
+    void hedged_call_context::send_hedge()
+    {
+        task* timer;
+        bool hedge_required;
+        {
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(_lock);
+            timer = _hedge_timer;
+            _hedge_timer = nullptr;
+            hedge_required = _hedge_pending && !_completed;
+            _hedge_pending = false;
+        }
+
+        if (timer)
+            timer->release_ref(); // added in start
+
+        if (!hedge_required)
+            return;
+
+        rpc_address hedge = _group->next(_primary);
+        if (hedge.is_invalid() || hedge == _primary)
+            return;
+
+        // so that the call still completes within its own timeout
+        int remaining_ms = _request->header->client.timeout_ms
+            - static_cast<int>((dsn_now_ns() - _start_ts_ns) / 1000000);
+        if (remaining_ms <= 0)
+            return;
+
+        _engine->on_hedge_sent(_stats);
+        send(1, hedge, remaining_ms);
+    }
+
+    void hedged_call_context::on_response(error_code err, message_ex* req, message_ex* resp)
+    {
+        bool complete = false;
+        bool hedge_won = false;
+        task* timer = nullptr;
+        rpc_response_task* loser = nullptr;
+
+        {
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(_lock);
+            _outstanding--;
+
+            // latency of the primary request, even when the hedge has won or it fails
+            if (req == _subs[0]->get_request())
+                observe_primary();
+
+            if (_completed)
+                return;
+
+            if (err == ERR_OK)
+            {
+                complete = true;
+                hedge_won = (_subs[1] != nullptr && req == _subs[1]->get_request());
+                loser = _outstanding > 0 ? _subs[hedge_won ? 0 : 1] : nullptr;
+            }
+            else
+            {
+                // wait for the other on-the-fly request if any
+                _last_error = err;
+                complete = (_outstanding == 0);
+            }
+
+            if (complete)
+            {
+                _completed = true;
+                _hedge_pending = false;
+                timer = _hedge_timer;
+                _hedge_timer = nullptr;
+            }
+        }
+
+        if (!complete)
+            return;
+
+        if (timer)
+        {
+            timer->cancel(false);
+            timer->release_ref(); // added in start
+        }
+
+        // cancel the loser, whose callback is not executed when cancelled in matcher
+        if (loser && _engine->matcher()->cancel(loser->get_request()->header->id))
+        {
+            if (loser == _subs[0])
+                observe_primary();
+            release_ref(); // added in send, as if the loser is responded
+        }
+
+        if (err == ERR_OK)
+        {
+            if (hedge_won)
+                _engine->on_hedge_won(_stats);
+            _call->enqueue(ERR_OK, resp);
+        }
+        else
+        {
+            _call->enqueue(_last_error, nullptr);
+        }
+    }
+
+    void rpc_engine::on_hedge_sent(rpc_hedge_stats* stats)
+    {
+        if (stats)
+            stats->sent_count.fetch_add(1, std::memory_order_relaxed);
+        _hedge_sent_count->increment();
+    }
+
+    void rpc_engine::on_hedge_won(rpc_hedge_stats* stats)
+    {
+        if (stats)
+            stats->won_count.fetch_add(1, std::memory_order_relaxed);
+        _hedge_won_count->increment();
+    }
+
+    void rpc_engine::call_group_hedged(rpc_group_address* group, message_ex* request, rpc_response_task* call)
+    {
+        auto sp = task_spec::get(request->local_rpc_code);
+        auto stats = hedge_stats(request->local_rpc_code);
+
+        int delay_ms = sp->grpc_to_any_hedge_delay_milliseconds;
+        if (sp->grpc_to_any_hedge_adaptive && stats != nullptr)
+        {
+            uint64_t p95_us = stats->latency_percentile_us(0.95);
+            if (p95_us > 0)
+            {
+                delay_ms = static_cast<int>((p95_us + 999) / 1000);
+            }
+        }
+
+        // no hedging for a single member group or before the delay is known,
+        // latencies are still observed in the latter case for adaptive hedging
+        if (group->count() < 2)
+            delay_ms = 0;
+
+        auto ctx = new hedged_call_context(this, group, request, call, stats);
+        ctx->add_ref(); // released below in the same function
+        ctx->start(delay_ms);
+        ctx->release_ref();
+    }
+
     void rpc_engine::call_ip(rpc_address addr, message_ex* request, rpc_response_task* call, bool reset_request_id, bool set_forwarded)
     {
         dbg_dassert(addr.type() == HOST_TYPE_IPV4, "only IPV4 is now supported");
@@ -1070,7 +1739,7 @@ namespace dsn {
             
         if (call != nullptr)
         {
-            _rpc_matcher.on_call(request, call);
+            _rpc_matcher->on_call(request, call);
         }
 
         net->send_message(request);
@@ -40,6 +40,9 @@
 # include <dsn/utility/synchronize.h>
 # include <dsn/tool-api/global_config.h>
 # include <dsn/utility/configuration.h>
+# include <dsn/tool-api/perf_counter.h>
+# include <dsn/cpp/utils.h>
+# include <atomic>
 
 namespace dsn {
 
@@ -59,7 +62,6 @@ class uri_resolver_manager;
 // WE NOW USE option (3) so as to enable more features and the performance should not be degraded (due to 
 // less std::shared_ptr<rpc_client_matcher> operations in rpc_timeout_task
 //
-#define MATCHER_BUCKET_NR 13
 class rpc_client_matcher : public ref_counter
 {
 public:
@@ -69,13 +71,13 @@ public:
 
     }
 
-    ~rpc_client_matcher();
+    virtual ~rpc_client_matcher() {}
 
     //
     // when a two-way RPC call is made, register the requst id and the callback
-    // which also registers a timer for timeout tracking
+    // which also registers the request for timeout tracking
     //
-    void on_call(message_ex* request, rpc_response_task* call);
+    virtual void on_call(message_ex* request, rpc_response_task* call) = 0;
 
     //
     // when a RPC response is received, call this function to trigger calback
@@ -87,12 +89,56 @@ public:
     //
     bool on_recv_reply(network* net, uint64_t key, message_ex* reply, int delay_ms);
 
+    //
+    // remove an on-the-fly call without executing its callback, e.g., the loser of a hedged call
+    // return false when the call is already completed (e.g., timeout or response received)
+    //
+    bool cancel(uint64_t key);
+
+    //
+    // create the matcher as configured in [core] rpc_scalable_client_matcher
+    //
+    static rpc_client_matcher* create(rpc_engine* engine);
+
+protected:
+    //
+    // remove the call from the matcher and stop tracking its timeout,
+    // return nullptr if not found, or the call with the reference added in on_call
+    //
+    virtual rpc_response_task* remove(uint64_t key) = 0;
+
+    // return the timeout (ms) before the first expiration of the call, and
+    // timeout_ts_ms is the final deadline when resend is enabled, or 0 otherwise
+    static int get_timeout(message_ex* request, /*out*/ uint64_t& timeout_ts_ms);
+
+protected:
+    rpc_engine*               _engine;
+};
+
+//
+// the default matcher which uses hashed buckets with locks, and a timer task for each call
+//
+#define MATCHER_BUCKET_NR 13
+class bucket_rpc_client_matcher : public rpc_client_matcher
+{
+public:
+    bucket_rpc_client_matcher(rpc_engine* engine)
+        : rpc_client_matcher(engine)
+    {
+    }
+
+    ~bucket_rpc_client_matcher();
+
+    void on_call(message_ex* request, rpc_response_task* call) override;
+
+protected:
+    rpc_response_task* remove(uint64_t key) override;
+
 private:
     friend class rpc_timeout_task;
     void on_rpc_timeout(uint64_t key);
 
 private:
-    rpc_engine*               _engine;
     struct match_entry
     {
         rpc_response_task*    resp_task;
@@ -104,6 +150,70 @@ private:
     ::dsn::utils::ex_lock_nr_spin _requests_lock[MATCHER_BUCKET_NR];
 };
 
+//
+// per rpc code statistics for hedged GRPC_TO_ANY calls, where the latency
+// is tracked with a log2 histogram (in microseconds) with periodical decay
+// so that the percentiles follow recent calls
+//
+class rpc_hedge_stats
+{
+public:
+    rpc_hedge_stats();
+
+    void add_latency(uint64_t latency_us);
+
+    // return 0 when there are not enough samples
+    uint64_t latency_percentile_us(double percentile) const;
+    
+    uint64_t latency_count() const { return _latency_count.load(std::memory_order_relaxed); }
+
+public:
+    std::atomic<uint64_t> sent_count;
+    std::atomic<uint64_t> won_count;
+
+private:
+    enum { LATENCY_BUCKET_COUNT = 32, MIN_SAMPLE_COUNT = 100, DECAY_SAMPLE_COUNT = 4096 };
+    std::atomic<uint32_t> _latency_buckets[LATENCY_BUCKET_COUNT];
+    std::atomic<uint32_t> _latency_count;
+};
+
+//
+// immutable rpc handler table, which is replaced as a whole upon (un)registration,
+// so that the request path reads it without any lock
+//
+class rpc_handler_table
+{
+public:
+    rpc_handler_table(const std::unordered_map<std::string, rpc_handler_info*>& handlers);
+
+    rpc_handler_info* find(dsn_task_code_t code) const
+    {
+        return code >= 0 && code < (dsn_task_code_t)_by_code.size() ? _by_code[code] : nullptr;
+    }
+
+    // lookup with the rpc name, which is either the task code name or the handler name
+    rpc_handler_info* find(const char* name) const;
+
+private:
+    static uint64_t name_hash(const char* name);
+    static uint32_t slot_hash(uint64_t h, uint32_t seed);
+    bool build_names(const std::unordered_map<std::string, rpc_handler_info*>& handlers, uint32_t capacity);
+
+private:
+    std::vector<rpc_handler_info*> _by_code;
+
+    // perfect hash with hash-and-displace, i.e., a bucket is chosen by the name hash,
+    // and the seed of the bucket places all names in it into distinct slots
+    struct name_entry
+    {
+        uint64_t          hash;
+        std::string       name;
+        rpc_handler_info* handler; // nullptr for empty slot
+    };
+    std::vector<uint32_t>   _seeds; // bucket -> seed
+    std::vector<name_entry> _names; // slot -> name
+};
+
 class rpc_server_dispatcher
 {
 public:
@@ -120,12 +230,45 @@ public:
         return static_cast<int>(_handlers.size()); 
     }
 
+private:
+    // find the handler with reference added, no lock is acquired
+    rpc_handler_info* find_handler(message_ex* msg);
+
+    // replace the handler table with _handlers, _handlers_lock must be held by the caller
+    void publish_handlers();
+
+    //
+    // epoch based reclamation for the handler tables: readers increase the counter
+    // of the current epoch in their stripe, and writers wait until the readers 
+    // of previous epochs leave before the old table is deleted
+    //
+    std::atomic<int64_t>* enter_read()
+    {
+        auto& stripe = _readers[utils::get_current_tid() % READER_STRIPE_COUNT];
+        auto c = &stripe.counts[_epoch.load() & 1];
+        c->fetch_add(1);
+        return c;
+    }
+
+    void leave_read(std::atomic<int64_t>* c) { c->fetch_sub(1); }
+
+    void synchronize();
+
 private:
     typedef std::unordered_map<std::string, rpc_handler_info*> rpc_handlers;
-    rpc_handlers                  _handlers;
+    rpc_handlers                  _handlers; // for writers only
     mutable utils::rw_lock_nr     _handlers_lock;
 
-    std::vector<std::pair<rpc_handler_info*, utils::rw_lock_nr>*  > _vhandlers;
+    std::atomic<rpc_handler_table*> _table;
+
+    enum { READER_STRIPE_COUNT = 64 };
+    struct reader_stripe
+    {
+        std::atomic<int64_t>      counts[2]; // for odd and even epochs
+        char                      padding[48]; // avoid false sharing among stripes
+    };
+    reader_stripe                 _readers[READER_STRIPE_COUNT];
+    std::atomic<uint64_t>         _epoch;
 };
 
 class rpc_engine
@@ -161,7 +304,7 @@ public:
     //
     service_node* node() const { return _node; }
     ::dsn::rpc_address primary_address() const { return _local_primary_address; }
-    rpc_client_matcher* matcher() { return &_rpc_matcher; }
+    rpc_client_matcher* matcher() { return _rpc_matcher.get(); }
     uri_resolver_manager* uri_resolver_mgr() { return _uri_resolver_mgr.get(); }
     void get_runtime_info(const safe_string& indent, const safe_vector<safe_string>& args, /*out*/ safe_sstream& ss);
 
@@ -171,6 +314,20 @@ public:
     // call with group address only
     void call_group(rpc_address addr, message_ex* request, rpc_response_task* call);
 
+    // send to all group members, the request body is shared by all members
+    void call_group_all(rpc_group_address* group, message_ex* request, rpc_response_task* call, int quorum);
+
+    // send to a random group member, and a duplicate to another member after a delay
+    void call_group_hedged(rpc_group_address* group, message_ex* request, rpc_response_task* call);
+
+    // hedge statistics for the given rpc request code, nullptr if not available
+    rpc_hedge_stats* hedge_stats(dsn_task_code_t code) 
+    {
+        return code < (dsn_task_code_t)_hedge_stats.size() ? _hedge_stats[code] : nullptr;
+    }
+    void on_hedge_sent(rpc_hedge_stats* stats);
+    void on_hedge_won(rpc_hedge_stats* stats);
+
     // call with ip address only
     void call_ip(rpc_address addr, message_ex* request, rpc_response_task* call, bool reset_request_id = false, bool set_forwarded = false);
 
@@ -191,10 +348,14 @@ private:
     std::vector<std::vector<network*>>               _client_nets; // <format, <CHANNEL, network*>>
     std::unordered_map<int, std::vector<network*>>   _server_nets; // <port, <CHANNEL, network*>>
     ::dsn::rpc_address                               _local_primary_address;
-    rpc_client_matcher                               _rpc_matcher;
+    std::unique_ptr<rpc_client_matcher>              _rpc_matcher;
     rpc_server_dispatcher                            _rpc_dispatcher;   
 
     std::unique_ptr<uri_resolver_manager>            _uri_resolver_mgr;
+
+    std::vector<rpc_hedge_stats*>                    _hedge_stats; // code -> stats
+    perf_counter_ptr                                 _hedge_sent_count;
+    perf_counter_ptr                                 _hedge_won_count;
     
     volatile bool                                    _is_running;
     volatile bool                                    _is_serving;
@@ -375,11 +375,20 @@ message_ex* message_ex::copy_and_prepare_send(bool clone_content)
 
     if (_is_read)
     {
-        // the message_header is hidden ahead of the buffer, expose it to buffer
-        dassert(buffers.size() == 1, "there must be only one buffer for read msg");
-        dassert((char*)header + sizeof(message_header) == (char*)buffers[0].data(), "header and content must be contigous");
+        // the message_header is standalone in the first buffer, 
+        // see create_receive_message_with_standalone_header
+        if ((char*)header == (char*)buffers[0].data())
+        {
+            dassert(buffers.size() == 2, "there must be only one buffer besides the header for read msg");
+        }
+        else
+        {
+            // the message_header is hidden ahead of the buffer, expose it to buffer
+            dassert(buffers.size() == 1, "there must be only one buffer for read msg");
+            dassert((char*)header + sizeof(message_header) == (char*)buffers[0].data(), "header and content must be contigous");
 
-        copy->buffers[0] = copy->buffers[0].range(-(int)sizeof(message_header));
+            copy->buffers[0] = copy->buffers[0].range(-(int)sizeof(message_header));
+        }
 
         // switch the flag
         copy->_is_read = false;
@@ -388,6 +397,33 @@ message_ex* message_ex::copy_and_prepare_send(bool clone_content)
     return copy;
 }
 
+message_ex* message_ex::copy_with_private_header()
+{
+    dassert(!_is_read && _rw_committed, "only committed send messages can be copied with private header");
+    dassert((char*)header == buffers[0].data(), "header must be in the first buffer of a send message");
+
+    auto msg = copy(false, false);
+
+    std::shared_ptr<char> hdr(dsn::make_shared_array<char>(sizeof(message_header)));
+    memcpy(hdr.get(), (const void*)header, sizeof(message_header));
+    msg->header = (message_header*)hdr.get();
+
+    msg->buffers.clear();
+    msg->buffers.push_back(blob(hdr, (int)sizeof(message_header)));
+    if (buffers[0].length() > sizeof(message_header))
+    {
+        msg->buffers.push_back(buffers[0].range((int)sizeof(message_header)));
+    }
+    for (size_t i = 1; i < buffers.size(); i++)
+    {
+        msg->buffers.push_back(buffers[i]);
+    }
+
+    msg->_rw_index = (int)msg->buffers.size() - 1;
+    msg->_rw_offset = (int)msg->buffers[msg->_rw_index].length();
+    return msg;
+}
+
 message_ex* message_ex::create_request(dsn_task_code_t rpc_code, int timeout_milliseconds, int thread_hash, uint64_t partition_hash)
 {
     message_ex* msg = new message_ex();
@@ -600,7 +636,8 @@ void* message_ex::rw_ptr(size_t offset_begin)
     //printf("%p %s\n", this, __FUNCTION__);
     int i_max = (int)this->buffers.size();
 
-    if (!_is_read)
+    // header is in the first buffer for send message and standalone-header read message
+    if (!_is_read || (char*)header == (char*)this->buffers[0].data())
         offset_begin += sizeof(message_header);
 
     for (int i = 0; i < i_max; i++)
@@ -618,4 +655,45 @@ void* message_ex::rw_ptr(size_t offset_begin)
     return nullptr;
 }
 
+void message_ex::make_private_buffers()
+{
+    dassert(this->_rw_committed, "should not copy the buffers when read/write is not committed");
+
+    int total_length = (int)body_size() + (int)sizeof(message_header);
+    std::shared_ptr<char> buffer(dsn::make_shared_array<char>(total_length));
+    char* ptr = buffer.get();
+
+    if ((const char*)header != buffers[0].data())
+    {
+        memcpy(ptr, (const void*)header, sizeof(message_header));
+        ptr += sizeof(message_header);
+    }
+
+    for (dsn::blob& bb : buffers)
+    {
+        memcpy(ptr, bb.data(), bb.length());
+        ptr += bb.length();
+    }
+    dassert(ptr - buffer.get() == total_length, "");
+
+    auto data = dsn::blob(buffer, total_length);
+
+    header = (message_header*)data.data();
+    buffers.clear();
+    if (_is_read)
+    {
+        // rewind to the beginning, as create_receive_message
+        buffers.push_back(data.range((int)sizeof(message_header)));
+        _rw_index = -1;
+        _rw_offset = 0;
+    }
+    else
+    {
+        // point to the end, as after write_commit
+        buffers.push_back(data);
+        _rw_index = 0;
+        _rw_offset = total_length;
+    }
+}
+
 } // end namespace dsn
@@ -178,6 +178,57 @@ TEST(core, message_ex)
         request->release_ref();
     }
 
+    { // receive with standalone header, and make_private_buffers
+        message_ex* request = message_ex::create_request(RPC_CODE_FOR_TEST, 100, 1);
+        const char* data = "adaoihfeuifgggggisdosghkbvjhzxvdafdiofgeof";
+        size_t data_size = strlen(data);
+
+        void* ptr;
+        size_t sz;
+
+        request->write_next(&ptr, &sz, data_size);
+        memcpy(ptr, data, data_size);
+        request->write_commit(data_size);
+        ASSERT_EQ(1u, request->buffers.size());
+
+        blob body = request->buffers[0].range((int)sizeof(message_header));
+        message_ex* receive = message_ex::create_receive_message_with_standalone_header(body);
+        *receive->header = *request->header;
+        ASSERT_EQ(2u, receive->buffers.size());
+        ASSERT_EQ(body.data(), receive->rw_ptr(0));
+
+        // forward it
+        message_ex* forward = receive->copy_and_prepare_send(false);
+        ASSERT_EQ(2u, forward->buffers.size());
+        ASSERT_EQ(body.data(), forward->rw_ptr(0));
+
+        // the original buffers are no longer shared after make_private_buffers
+        request->make_private_buffers();
+        ASSERT_EQ(1u, request->buffers.size());
+        ASSERT_NE(body.data(), request->rw_ptr(0));
+        ASSERT_EQ(data_size, request->body_size());
+        ASSERT_EQ(std::string(data), std::string((const char*)request->rw_ptr(0), data_size));
+        ((char*)request->rw_ptr(0))[0]++;
+        ASSERT_EQ(std::string(data), std::string(body.data(), data_size));
+
+        receive->make_private_buffers();
+        ASSERT_EQ(1u, receive->buffers.size());
+        ASSERT_TRUE(receive->read_next(&ptr, &sz));
+        ASSERT_EQ(data_size, sz);
+        ASSERT_NE((void*)body.data(), ptr);
+        ASSERT_EQ(std::string(data), std::string((const char*)ptr, sz));
+        receive->read_commit(sz);
+
+        forward->add_ref();
+        forward->release_ref();
+
+        receive->add_ref();
+        receive->release_ref();
+
+        request->add_ref();
+        request->release_ref();
+    }
+
     { // c interface
         dsn_message_t request = dsn_msg_create_request(RPC_CODE_FOR_TEST, 100, 1, 2);
         dsn_msg_options_t opts;
@@ -0,0 +1,341 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     a scalable rpc client matcher for lots of on-the-fly rpc calls
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "scalable_rpc_client_matcher.h"
+# include "service_engine.h"
+# include <thread>
+
+# ifdef __TITLE__
+# undef __TITLE__
+# endif
+# define __TITLE__ "rpc.matcher"
+
+namespace dsn {
+
+    DEFINE_TASK_CODE(LPC_RPC_TIMEOUT_SWEEP, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+    scalable_rpc_client_matcher::scalable_rpc_client_matcher(rpc_engine* engine)
+        : rpc_client_matcher(engine), _sweeper_started(false), _sweep_timer(nullptr)
+    {
+        int cores = static_cast<int>(std::thread::hardware_concurrency());
+        if (cores <= 0)
+            cores = 1;
+
+        // 4 shards per core
+        _shard_bits = 0;
+        while ((1 << _shard_bits) < cores * 4)
+            _shard_bits++;
+        _shard_mask = (1u << _shard_bits) - 1;
+
+        _shards = new shard[_shard_mask + 1];
+        for (uint32_t i = 0; i <= _shard_mask; i++)
+        {
+            auto& s = _shards[i];
+            s.entries = new match_entry[SHARD_INITIAL_CAPACITY];
+            memset(s.entries, 0, sizeof(match_entry) * SHARD_INITIAL_CAPACITY);
+            s.mask = SHARD_INITIAL_CAPACITY - 1;
+            s.count = 0;
+        }
+
+        int tick_ms = service_engine::fast_instance().spec().rpc_timeout_tick_milliseconds;
+        _tick_ms = tick_ms > 0 ? tick_ms : 1;
+        _last_swept_tick.store(dsn_now_ms() / _tick_ms);
+    }
+
+    scalable_rpc_client_matcher::~scalable_rpc_client_matcher()
+    {
+        if (_sweep_timer)
+        {
+            _sweep_timer->cancel(true);
+            _sweep_timer->release_ref(); // added in start_sweeper
+        }
+
+        for (uint32_t i = 0; i <= _shard_mask; i++)
+        {
+            dassert(_shards[i].count == 0, "all rpc entries must be removed before the matcher ends");
+            delete[] _shards[i].entries;
+        }
+        delete[] _shards;
+    }
+
+    uint64_t scalable_rpc_client_matcher::hash(uint64_t key)
+    {
+        // request ids are sequential, so mix the bits (murmur3 finalizer)
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+
+    scalable_rpc_client_matcher::match_entry* scalable_rpc_client_matcher::find(shard& s, uint64_t key)
+    {
+        // load factor is kept below 1/2 so there is always an empty slot
+        for (uint32_t i = home_slot(s, key); ; i = (i + 1) & s.mask)
+        {
+            auto& e = s.entries[i];
+            if (e.key == key)
+                return &e;
+            if (e.key == 0)
+                return nullptr;
+        }
+    }
+
+    void scalable_rpc_client_matcher::insert(shard& s, const match_entry& e)
+    {
+        if ((s.count + 1) * 2 > s.mask + 1)
+        {
+            grow(s);
+        }
+
+        for (uint32_t i = home_slot(s, e.key); ; i = (i + 1) & s.mask)
+        {
+            if (s.entries[i].key == 0)
+            {
+                s.entries[i] = e;
+                s.count++;
+                return;
+            }
+        }
+    }
+
+    void scalable_rpc_client_matcher::erase(shard& s, match_entry* e)
+    {
+        // backward shift deletion, so that no tombstones are needed
+        uint32_t i = static_cast<uint32_t>(e - s.entries);
+        uint32_t j = i;
+        while (true)
+        {
+            j = (j + 1) & s.mask;
+            if (s.entries[j].key == 0)
+                break;
+
+            // entry j can fill the hole only when its home is not in (i, j] cyclically
+            uint32_t k = home_slot(s, s.entries[j].key);
+            bool in_range = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+            if (!in_range)
+            {
+                s.entries[i] = s.entries[j];
+                i = j;
+            }
+        }
+
+        s.entries[i].key = 0;
+        s.entries[i].resp_task = nullptr;
+        s.count--;
+    }
+
+    void scalable_rpc_client_matcher::grow(shard& s)
+    {
+        auto old_entries = s.entries;
+        uint32_t old_capacity = s.mask + 1;
+        uint32_t capacity = old_capacity * 2;
+
+        s.entries = new match_entry[capacity];
+        memset(s.entries, 0, sizeof(match_entry) * capacity);
+        s.mask = capacity - 1;
+        s.count = 0;
+
+        for (uint32_t i = 0; i < old_capacity; i++)
+        {
+            if (old_entries[i].key != 0)
+            {
+                insert(s, old_entries[i]);
+            }
+        }
+        delete[] old_entries;
+    }
+
+    void scalable_rpc_client_matcher::on_call(message_ex* request, rpc_response_task* call)
+    {
+        dbg_dassert(call != nullptr, "rpc response task cannot be empty");
+
+        match_entry e;
+        e.key = request->header->id;
+        e.resp_task = call;
+        e.deadline_ms = dsn_now_ms() + get_timeout(request, e.timeout_ts_ms);
+
+        call->add_ref(); // released in sweep or by the callers of remove
+
+        auto& s = get_shard(e.key);
+        {
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(s.lock);
+            dassert(find(s, e.key) == nullptr, "the message is already on the fly!!!");
+            insert(s, e);
+        }
+
+        schedule(e.key, e.deadline_ms);
+
+        if (!_sweeper_started.load(std::memory_order_relaxed))
+        {
+            start_sweeper();
+        }
+    }
+
+    rpc_response_task* scalable_rpc_client_matcher::remove(uint64_t key)
+    {
+        // the key in the timing wheel is left there and skipped when swept
+        auto& s = get_shard(key);
+        utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(s.lock);
+        auto e = find(s, key);
+        if (e == nullptr)
+            return nullptr;
+
+        auto call = e->resp_task;
+        erase(s, e);
+        return call;
+    }
+
+    void scalable_rpc_client_matcher::schedule(uint64_t key, uint64_t deadline_ms)
+    {
+        uint64_t tick = (deadline_ms + _tick_ms - 1) / _tick_ms;
+        while (true)
+        {
+            // never put into a slot which has been swept for this round
+            uint64_t t = std::max(tick, _last_swept_tick.load() + 1);
+            auto& slot = _wheel[t % WHEEL_SLOT_COUNT];
+
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(slot.lock);
+            if (_last_swept_tick.load() < t)
+            {
+                slot.keys.push_back(key);
+                return;
+            }
+        }
+    }
+
+    void scalable_rpc_client_matcher::start_sweeper()
+    {
+        bool started = false;
+        if (!_sweeper_started.compare_exchange_strong(started, true))
+            return;
+
+        _sweep_timer = new timer_task(LPC_RPC_TIMEOUT_SWEEP, on_sweep_timer, this, nullptr, 
+            _tick_ms, 0, _engine->node());
+        _sweep_timer->add_ref(); // released in dtor
+        _sweep_timer->set_delay(_tick_ms);
+        _sweep_timer->enqueue();
+    }
+
+    void scalable_rpc_client_matcher::on_sweep_timer(void* matcher)
+    {
+        ((scalable_rpc_client_matcher*)matcher)->sweep(dsn_now_ms());
+    }
+
+    void scalable_rpc_client_matcher::sweep(uint64_t now_ms)
+    {
+        // collect the keys in the slots which are expired since last sweep
+        std::vector<uint64_t> keys;
+        {
+            utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(_sweep_lock);
+            uint64_t now_tick = now_ms / _tick_ms;
+            uint64_t last_tick = _last_swept_tick.load();
+            if (now_tick > last_tick + WHEEL_SLOT_COUNT)
+                last_tick = now_tick - WHEEL_SLOT_COUNT;
+
+            for (uint64_t t = last_tick + 1; t <= now_tick; t++)
+            {
+                _last_swept_tick.store(t);
+
+                auto& slot = _wheel[t % WHEEL_SLOT_COUNT];
+                utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l2(slot.lock);
+                keys.insert(keys.end(), slot.keys.begin(), slot.keys.end());
+                slot.keys.clear();
+            }
+        }
+
+        // check calls in batch, and do expensive things outside of the locks
+        std::vector<rpc_response_task*> timeouts;
+        std::vector<rpc_response_task*> resends;
+        for (auto key : keys)
+        {
+            uint64_t deadline_ms;
+            {
+                auto& s = get_shard(key);
+                utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(s.lock);
+                auto e = find(s, key);
+
+                // response is received
+                if (e == nullptr)
+                    continue;
+
+                deadline_ms = e->deadline_ms;
+                if (deadline_ms <= now_ms)
+                {
+                    auto call = e->resp_task;
+
+                    // resend when timeout is not yet, and the call is not cancelled,
+                    // and use rest of the timeout to resend once only
+                    if (e->timeout_ts_ms > now_ms && call->state() == TASK_STATE_READY)
+                    {
+                        deadline_ms = e->deadline_ms = e->timeout_ts_ms;
+                        e->timeout_ts_ms = 0;
+                        call->add_ref(); // released after re-send
+                        resends.push_back(call);
+                    }
+                    else
+                    {
+                        erase(s, e);
+                        timeouts.push_back(call);
+                        continue;
+                    }
+                }
+            }
+
+            // not expired yet (i.e., in later rounds), or resent
+            schedule(key, deadline_ms);
+        }
+
+        for (auto call : timeouts)
+        {
+            // cancelled calls are not to be executed any more
+            if (call->state() != TASK_STATE_CANCELLED)
+                call->enqueue(ERR_TIMEOUT, nullptr);
+            call->release_ref(); // added in on_call
+        }
+
+        for (auto call : resends)
+        {
+            auto req = call->get_request();
+            dinfo("resend request message for rpc trace_id = %016" PRIx64 ", key = %" PRIu64,
+                req->header->trace_id, req->header->id);
+
+            // resend without handling rpc_matcher, use the same request_id
+            _engine->call_ip(req->to_address, req, nullptr);
+            call->release_ref(); // added above in the same function
+        }
+    }
+}
@@ -0,0 +1,122 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     a scalable rpc client matcher for lots of on-the-fly rpc calls
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+
+# include "rpc_engine.h"
+# include <vector>
+
+namespace dsn {
+
+//
+// on-the-fly calls are kept in a sharded open-addressing table (linear probing
+// with backward shift deletion), where the number of shards is scaled with the 
+// core count so that lock contention is rare. Timeouts are tracked in a shared
+// timing wheel with coarse ticks ([core] rpc_timeout_tick_milliseconds) swept 
+// in batches by a single timer, instead of a timer task per call. Entries are 
+// never removed from the wheel upon replies, as the sweeper simply skips the 
+// keys no longer in the table.
+//
+class scalable_rpc_client_matcher : public rpc_client_matcher
+{
+public:
+    scalable_rpc_client_matcher(rpc_engine* engine);
+    ~scalable_rpc_client_matcher();
+
+    void on_call(message_ex* request, rpc_response_task* call) override;
+
+    // check expired calls, exposed for testing
+    void sweep(uint64_t now_ms);
+
+protected:
+    rpc_response_task* remove(uint64_t key) override;
+
+private:
+    struct match_entry
+    {
+        uint64_t              key; // 0 for empty slot
+        rpc_response_task*    resp_task;
+        uint64_t              deadline_ms; // when the next expiration happens
+        uint64_t              timeout_ts_ms; // > 0 for auto-resent msgs
+    };
+
+    struct shard
+    {
+        ::dsn::utils::ex_lock_nr_spin lock;
+        match_entry*          entries;
+        uint32_t              mask; // capacity - 1
+        uint32_t              count;
+        char                  padding[64]; // avoid false sharing among shards
+    };
+
+    struct wheel_slot
+    {
+        ::dsn::utils::ex_lock_nr_spin lock;
+        std::vector<uint64_t> keys;
+    };
+
+    enum 
+    { 
+        WHEEL_SLOT_COUNT = 4096, 
+        SHARD_INITIAL_CAPACITY = 256 
+    };
+
+    static uint64_t hash(uint64_t key);
+    shard& get_shard(uint64_t key) { return _shards[hash(key) & _shard_mask]; }
+    uint32_t home_slot(const shard& s, uint64_t key) const { return (uint32_t)(hash(key) >> _shard_bits) & s.mask; }
+
+    // operations on one shard, where the shard lock is held by the caller
+    match_entry* find(shard& s, uint64_t key);
+    void insert(shard& s, const match_entry& e);
+    void erase(shard& s, match_entry* e);
+    void grow(shard& s);
+
+    void schedule(uint64_t key, uint64_t deadline_ms);
+    void start_sweeper();
+    static void on_sweep_timer(void* matcher);
+
+private:
+    shard*                    _shards;
+    uint32_t                  _shard_mask;
+    int                       _shard_bits;
+    wheel_slot                _wheel[WHEEL_SLOT_COUNT];
+    uint32_t                  _tick_ms;
+    std::atomic<uint64_t>     _last_swept_tick;
+    ::dsn::utils::ex_lock_nr_spin _sweep_lock;
+    std::atomic<bool>         _sweeper_started;
+    task*                     _sweep_timer;
+};
+
+}
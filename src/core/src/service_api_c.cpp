@@ -667,6 +667,34 @@ DSN_API dsn_message_t dsn_rpc_get_response(dsn_task_t rpc_call)
         return nullptr;
 }
 
+DSN_API int dsn_rpc_get_group_response_count(dsn_task_t rpc_call)
+{
+    ::dsn::rpc_response_task* task = (::dsn::rpc_response_task*)rpc_call;
+    dassert(task->spec().type == TASK_TYPE_RPC_RESPONSE, "");
+    return (int)task->group_responses().size();
+}
+
+DSN_API dsn_message_t dsn_rpc_get_group_response(dsn_task_t rpc_call, int index, dsn_address_t* member, dsn_error_t* err)
+{
+    ::dsn::rpc_response_task* task = (::dsn::rpc_response_task*)rpc_call;
+    dassert(task->spec().type == TASK_TYPE_RPC_RESPONSE, "");
+    auto& responses = task->group_responses();
+    dassert(index >= 0 && index < (int)responses.size(),
+        "invalid group response index %d, count = %d", index, (int)responses.size());
+
+    auto& r = responses[index];
+    *member = r.member.c_addr();
+    *err = r.err.get();
+    if (nullptr == r.response)
+        return nullptr;
+
+    // the stored response may be read already (e.g., the first one is also the
+    // response of the call), so return a copy with its own read cursor
+    auto msg = r.response->copy(false, true);
+    msg->add_ref(); // released by callers
+    return msg;
+}
+
 DSN_API void dsn_rpc_enqueue_response(dsn_task_t rpc_call, dsn_error_t err, dsn_message_t response)
 {
     ::dsn::rpc_response_task* task = (::dsn::rpc_response_task*)rpc_call;
@@ -704,6 +732,30 @@ DSN_API void* dsn_file_native_handle(dsn_handle_t file)
     return dfile->native_handle();
 }
 
+DSN_API void* dsn_file_alloc_aligned_buffer(size_t size)
+{
+    // direct I/O requires the size to be aligned as well
+    size = (size + DSN_FILE_DIRECT_IO_ALIGNMENT - 1) / DSN_FILE_DIRECT_IO_ALIGNMENT * DSN_FILE_DIRECT_IO_ALIGNMENT;
+
+# ifdef _WIN32
+    return _aligned_malloc(size, DSN_FILE_DIRECT_IO_ALIGNMENT);
+# else
+    void* ptr = nullptr;
+    if (posix_memalign(&ptr, DSN_FILE_DIRECT_IO_ALIGNMENT, size) != 0)
+        return nullptr;
+    return ptr;
+# endif
+}
+
+DSN_API void dsn_file_free_aligned_buffer(void* buffer)
+{
+# ifdef _WIN32
+    _aligned_free(buffer);
+# else
+    free(buffer);
+# endif
+}
+
 DSN_API dsn_task_t dsn_file_create_aio_task(dsn_task_code_t code, dsn_aio_handler_t cb, void* context, int hash, dsn_task_tracker_t tracker)
 {
     auto t = new ::dsn::aio_task(code, cb, context, nullptr, hash);
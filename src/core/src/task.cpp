@@ -151,6 +151,7 @@ task::task(dsn_task_code_t code, void* context, dsn_task_cancelled_handler_t on_
     _wait_for_cancel = false;
     _is_null = false;
     next = nullptr;
+    queue_enter_ts_ns = 0;
     
     if (node != nullptr)
     {
@@ -616,6 +617,24 @@ rpc_response_task::~rpc_response_task()
 
     if (_response != nullptr)
         _response->release_ref(); // added in enqueue
+
+    for (auto& r : _group_responses)
+    {
+        if (r.response != nullptr)
+            r.response->release_ref(); // added in add_group_response
+    }
+}
+
+void rpc_response_task::add_group_response(rpc_address member, error_code err, message_ex* response)
+{
+    if (response != nullptr)
+        response->add_ref(); // released in dctor
+
+    group_response r;
+    r.member = member;
+    r.err = err;
+    r.response = response;
+    _group_responses.push_back(r);
 }
 
 bool rpc_response_task::enqueue(error_code err, message_ex* reply)
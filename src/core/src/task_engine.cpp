@@ -34,8 +34,10 @@
  */
 
 # include "task_engine.h"
+# include "cpu_topology.h"
 # include <dsn/tool-api/perf_counter.h>
 # include <dsn/utility/factory_store.h>
+# include <algorithm>
 
 # ifdef __TITLE__
 # undef __TITLE__
@@ -54,14 +56,128 @@ task_worker_pool::task_worker_pool(const threadpool_spec& opts, task_engine* own
     _per_node_timer_svc = nullptr;
 }
 
+void task_worker_pool::init_placements(const threadpool_spec& spec, const cpu_topology& topo,
+    /*out*/ std::vector<worker_placement>& placements, /*out*/ std::vector<int>& queue_numa_nodes)
+{
+    std::vector<int> cpus;
+    if (spec.worker_cpus.length() > 0)
+    {
+        dassert(parse_cpu_list(spec.worker_cpus.c_str(), cpus),
+            "invalid worker_cpus '%s' for thread pool %s",
+            spec.worker_cpus.c_str(), spec.name.c_str());
+    }
+
+    if (spec.worker_numa_nodes.length() > 0)
+    {
+        std::vector<int> nodes;
+        dassert(parse_cpu_list(spec.worker_numa_nodes.c_str(), nodes),
+            "invalid worker_numa_nodes '%s' for thread pool %s",
+            spec.worker_numa_nodes.c_str(), spec.name.c_str());
+
+        for (auto node : nodes)
+        {
+            auto& node_cpus = topo.cpus_of_node(node);
+            if (node_cpus.empty())
+            {
+                dwarn("numa node %d of thread pool %s does not exist or has no cpu, ignored",
+                    node, spec.name.c_str());
+            }
+            cpus.insert(cpus.end(), node_cpus.begin(), node_cpus.end());
+        }
+        std::sort(cpus.begin(), cpus.end());
+        cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    }
+
+    if (cpus.empty() && spec.worker_affinity_mask != 0)
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            if ((spec.worker_affinity_mask & ((uint64_t)1 << i)) != 0)
+                cpus.push_back(i);
+        }
+    }
+
+    auto it = std::remove_if(cpus.begin(), cpus.end(), [&topo](int cpu) { return cpu >= topo.cpu_count(); });
+    if (it != cpus.end())
+    {
+        dwarn("thread pool %s is assigned with %d nonexistent cpus, ignored",
+            spec.name.c_str(), static_cast<int>(cpus.end() - it));
+        cpus.erase(it, cpus.end());
+    }
+
+    // dedicated cores are taken from all the cpus when not specified
+    bool cpus_assigned = !cpus.empty();
+    if (cpus.empty() && !spec.worker_share_core)
+    {
+        for (int i = 0; i < topo.cpu_count(); i++)
+            cpus.push_back(i);
+    }
+
+    // busy polling workers never sleep, so each of them should own a core
+    if (spec.worker_idle_mode == WORKER_IDLE_BUSY_POLL)
+    {
+        if (spec.worker_share_core || static_cast<int>(cpus.size()) < spec.worker_count)
+        {
+            dwarn("thread pool %s: busy polling workers are not pinned to one core each, "
+                "consider setting worker_share_core = false with enough worker_cpus",
+                spec.name.c_str());
+        }
+        else if (!cpus_assigned)
+        {
+            dwarn("thread pool %s: busy polling workers may share their cores with other pools, "
+                "consider setting worker_cpus or worker_numa_nodes",
+                spec.name.c_str());
+        }
+    }
+
+    placements.clear();
+    placements.resize(spec.worker_count);
+    for (int i = 0; i < spec.worker_count; i++)
+    {
+        auto& p = placements[i];
+        if (spec.worker_share_core)
+            p.cpus = cpus;
+        else
+            p.cpus.push_back(cpus[i % cpus.size()]);
+        // no memory preference is necessary for single node hosts
+        p.numa_node = (p.cpus.empty() || topo.node_count() == 1) ? -1 : topo.node_of_cpus(p.cpus);
+    }
+
+    // a shared queue has a preferred node only when all its workers are on that node
+    int qCount = spec.partitioned ? spec.worker_count : 1;
+    queue_numa_nodes.resize(qCount);
+    for (int i = 0; i < qCount; i++)
+    {
+        if (spec.partitioned)
+            queue_numa_nodes[i] = placements[i].numa_node;
+        else
+        {
+            int node = placements[0].numa_node;
+            for (auto& p : placements)
+            {
+                if (p.numa_node != node)
+                    node = -1;
+            }
+            queue_numa_nodes[i] = node;
+        }
+    }
+}
+
 void task_worker_pool::create()
 {
     if (_is_running)
         return;
     
+    init_placements(_spec, cpu_topology::instance(), _placements, _queue_numa_nodes);
+
     int qCount = _spec.partitioned ?  _spec.worker_count : 1;
     for (int i = 0; i < qCount; i++)
     {
+        // so that the queue object prefers the node of its workers; the storage the queue
+        // allocates later on enqueue follows the policy of the enqueuing thread instead
+        if (_queue_numa_nodes[i] != -1)
+            set_thread_preferred_numa_node(_queue_numa_nodes[i]);
+
         auto q = factory_store<task_queue>::create(_spec.queue_factory_name.c_str(), PROVIDER_TYPE_MAIN, this, i, nullptr);
         for (auto it = _spec.queue_aspects.begin();
             it != _spec.queue_aspects.end();
@@ -91,6 +207,9 @@ void task_worker_pool::create()
         {
             _controllers.push_back(nullptr);
         }
+
+        if (_queue_numa_nodes[i] != -1)
+            set_thread_preferred_numa_node(-1);
     }
 
     for (int i = 0; i < _spec.worker_count; i++)
@@ -209,11 +328,15 @@ void task_worker_pool::get_runtime_info(const safe_string& indent,
     auto indent2 = indent + "\t";
     ss << indent << "contains " << _workers.size() << " threads with " << _queues.size() << " queues" << std::endl;
     
-    for (auto& q : _queues)
+    for (size_t i = 0; i < _queues.size(); i++)
     {
+        auto q = _queues[i];
         if (q)
         {
-            ss << indent2 << q->get_name() << " now has " << q->count() << " pending tasks" << std::endl;
+            ss << indent2 << q->get_name() << " now has " << q->count() << " pending tasks";
+            if (_queue_numa_nodes[i] != -1)
+                ss << ", preferred numa node " << _queue_numa_nodes[i];
+            ss << std::endl;
         }
     }
 
@@ -221,7 +344,11 @@ void task_worker_pool::get_runtime_info(const safe_string& indent,
     {
         if (wk)
         {
-            ss << indent2 << wk->index() << " (TID = " << wk->native_tid() << ") attached with queue " << wk->queue()->get_name() << std::endl;
+            auto& p = _placements[wk->index()];
+            ss << indent2 << wk->index() << " (TID = " << wk->native_tid() << ") attached with queue " << wk->queue()->get_name()
+                << ", cpus = " << (p.cpus.empty() ? "all" : format_cpu_list(p.cpus).c_str())
+                << ", numa node = " << p.numa_node
+                << std::endl;
         }
     }
 }
@@ -48,6 +48,17 @@ class task_engine;
 class task_worker_pool;
 class task_worker;
 
+namespace utils { class cpu_topology; }
+
+//
+// where a worker runs, see worker_cpus, worker_numa_nodes and worker_affinity_mask
+//
+struct worker_placement
+{
+    std::vector<int> cpus;      // empty when the worker is not pinned
+    int              numa_node; // -1 when the cpus span multiple nodes, or for single node hosts
+};
+
 //
 // a task_worker_pool is a set of TaskWorkers share the same configs;
 // they may even share the same task_queue when partitioned == false
@@ -78,6 +89,12 @@ public:
     std::vector<task_queue*>& queues() { return _queues; }
     std::vector<task_worker*>& workers() { return _workers; }
     std::vector<admission_controller*>& controllers() { return _controllers; }
+    const worker_placement& placement(int worker_index) const { return _placements[worker_index]; }
+
+    // where each worker of the pool runs on the given topology, and the preferred
+    // numa node of each queue (-1 for no preference)
+    static void init_placements(const threadpool_spec& spec, const utils::cpu_topology& topo,
+        /*out*/ std::vector<worker_placement>& placements, /*out*/ std::vector<int>& queue_numa_nodes);
 
 private:
     threadpool_spec                    _spec;
@@ -87,6 +104,8 @@ private:
     std::vector<task_worker*>          _workers;
     std::vector<task_queue*>           _queues;    
     std::vector<admission_controller*> _controllers;
+    std::vector<worker_placement>      _placements; // per worker
+    std::vector<int>                   _queue_numa_nodes; // per queue, -1 for no preference
 
     // cached ptrs for fast access
     timer_service*                     _per_node_timer_svc;
@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     join point overhead and empty task throughput
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include <dsn/service_api_cpp.h>
+# include <dsn/tool_api.h>
+# include <dsn/cpp/test_utils.h>
+# include <gtest/gtest.h>
+# include <chrono>
+
+using namespace ::dsn;
+
+DEFINE_TASK_CODE(LPC_PERF_EMPTY_TASK, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+// with is_trace and is_profile off in test.config.core.perf.ini, so no hook is installed
+DEFINE_TASK_CODE(LPC_PERF_EMPTY_TASK_NO_HOOK, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+static std::atomic<uint64_t> s_advice_count(0);
+static void perf_advice(task* t) { s_advice_count++; }
+
+template<typename TJoinPoint>
+static double join_point_cost_ns(TJoinPoint& jp, uint64_t count)
+{
+    auto tic = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < count; i++)
+    {
+        jp.execute(nullptr);
+    }
+    auto toc = std::chrono::steady_clock::now();
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(toc - tic).count() / (double)count;
+}
+
+static void empty_task_testcase(dsn_task_code_t code, int producers, uint64_t tasks_per_producer)
+{
+    std::atomic<uint64_t> done(0);
+    uint64_t total = (uint64_t)producers * tasks_per_producer;
+
+    auto tic = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; i++)
+    {
+        threads.emplace_back([&]()
+        {
+            for (uint64_t j = 0; j < tasks_per_producer; j++)
+            {
+                tasking::enqueue(code, nullptr, [&done]() { done++; });
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    while (done.load() < total)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    auto toc = std::chrono::steady_clock::now();
+
+    std::cout << dsn_task_code_to_string(code)
+        << ": producers = " << producers
+        << ", tasks = " << total
+        << ", throughput = " << (double)total / (double)std::chrono::duration_cast<std::chrono::microseconds>(toc - tic).count() * 1000000.0 << " #/s"
+        << std::endl;
+}
+
+TEST(perf_core, empty_task)
+{
+    const uint64_t count = 10000000;
+
+    join_point<void, task*> jp("perf_join_point");
+    std::cout << "join point without advice: " << join_point_cost_ns(jp, count) << " ns/call" << std::endl;
+
+    jp.put_back(perf_advice, "perf_advice");
+    std::cout << "join point with one advice: " << join_point_cost_ns(jp, count) << " ns/call" << std::endl;
+    EXPECT_EQ(count, s_advice_count.load());
+
+    disabled_join_point<void, task*> djp("perf_disabled_join_point");
+    std::cout << "disabled join point: " << join_point_cost_ns(djp, count) << " ns/call" << std::endl;
+
+    // the same empty tasks with and without the hooks of the toollets
+    for (auto code : { LPC_PERF_EMPTY_TASK, LPC_PERF_EMPTY_TASK_NO_HOOK })
+    {
+        auto spec = task_spec::get(code);
+        std::cout << "hooks on " << spec->name << ": on_task_enqueue "
+            << (spec->on_task_enqueue.is_empty() ? "empty" : "installed")
+            << ", on_task_begin " << (spec->on_task_begin.is_empty() ? "empty" : "installed")
+            << ", on_task_end " << (spec->on_task_end.is_empty() ? "empty" : "installed")
+            << std::endl;
+
+        for (auto producers : { 1, 2, 4 })
+            empty_task_testcase(code, producers, 1000000);
+    }
+
+    // the comparison above relies on the configuration
+    auto spec = task_spec::get(LPC_PERF_EMPTY_TASK_NO_HOOK);
+    EXPECT_TRUE(spec->on_task_enqueue.is_empty());
+    EXPECT_TRUE(spec->on_task_begin.is_empty());
+    EXPECT_TRUE(spec->on_task_end.is_empty());
+}
@@ -66,6 +66,11 @@ task_queue::~task_queue()
     perf_counter::remove_counter(_queue_length_counter->full_name());
 }
 
+const char* task_queue::node_name() const
+{
+    return _pool->node()->name();
+}
+
 void task_queue::enqueue_internal(task* task)
 {
     auto& sp = task->spec();
@@ -119,6 +124,26 @@ void task_queue::enqueue_internal(task* task)
         }
     }
 
+    if (_controller != nullptr)
+    {
+        task->queue_enter_ts_ns = dsn_now_ns();
+        if (sp.type == TASK_TYPE_RPC_REQUEST && !_controller->is_task_accepted(task))
+        {
+            auto rtask = static_cast<rpc_request_task*>(task);
+            auto resp = rtask->get_request()->create_response();
+            task::get_current_rpc()->reply(resp, ERR_BUSY);
+
+            dinfo("admission controller of %s rejects message from %s with trace_id = %016" PRIx64,
+                _name.c_str(),
+                rtask->get_request()->header->from_address.to_string(),
+                rtask->get_request()->header->trace_id
+                );
+
+            task->release_ref(); // added in task::enqueue(pool)
+            return;
+        }
+    }
+
     tls_dsn.last_worker_queue_size = increase_count();
     enqueue(task);
 }
@@ -39,6 +39,8 @@
 #include <dsn/cpp/test_utils.h>
 #include <mutex>
 #include <condition_variable>
+#include <algorithm>
+#include <atomic>
 
 //worker = 1
 DEFINE_THREAD_POOL_CODE(THREAD_POOL_TEST_TASK_QUEUE_1);
@@ -207,6 +209,66 @@ void tic_tock_iterating(const int enqueue_time)
         ctx.cv.wait(_lk, [&] {return ctx.done;});
     }
 }
+
+// the producer enqueues one timestamp after every idle gap, and the
+// consumer records how long it takes to get the item
+void wakeup_latency(const char* mode, uint64_t spin_us, bool busy_poll, int gap_us, const int count)
+{
+    typedef ::dsn::utils::blocking_priority_queue<uint64_t*, 1> tqueue;
+    tqueue q(mode);
+    q.set_idle_strategy(spin_us, busy_poll);
+
+    auto now_ns = []() {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+
+    std::vector<uint64_t> stamps(count), latencies(count);
+    std::atomic<int> received(0);
+    int spin_hits = 0, sema_waits = 0; // see blocking_queue_wait_t
+
+    std::thread consumer([&]() {
+        for (int i = 0; i < count; i++)
+        {
+            long ct;
+            ::dsn::utils::blocking_queue_wait_t wait;
+            auto stamp = q.dequeue(ct, TIME_MS_MAX, wait);
+            latencies[i] = now_ns() - *stamp;
+            if (wait == ::dsn::utils::BQ_WAIT_SPIN)
+                spin_hits++;
+            else if (wait == ::dsn::utils::BQ_WAIT_PARK)
+                sema_waits++;
+            received.store(i + 1, std::memory_order_release);
+        }
+    });
+
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t until = now_ns() + gap_us * 1000ULL;
+        while (now_ns() < until)
+        {
+        }
+
+        stamps[i] = now_ns();
+        q.enqueue(&stamps[i], 0);
+        while (received.load(std::memory_order_acquire) <= i)
+            std::this_thread::yield();
+    }
+    consumer.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t total = 0;
+    for (auto l : latencies)
+        total += l;
+
+    std::cout << "wake-up latency test(" << mode << ", gap = " << gap_us << "us): "
+        << "avg = " << total / count << "ns, "
+        << "p50 = " << latencies[count / 2] << "ns, "
+        << "p99 = " << latencies[count * 99 / 100] << "ns, "
+        << "spin hits = " << spin_hits << ", semaphore waits = " << sema_waits
+        << std::endl;
+}
+
 TEST(perf_core, task_queue)
 {
     const int enqueue_time = 10000000;
@@ -215,4 +277,11 @@ TEST(perf_core, task_queue)
     external_blocking(enqueue_time / 10);
     self_iterating(enqueue_time);
     tic_tock_iterating(enqueue_time / 10);
+
+    for (int gap_us : { 10, 200 })
+    {
+        wakeup_latency("blocking", 0, false, gap_us, 10000);
+        wakeup_latency("spin-then-park", 50, false, gap_us, 10000);
+        wakeup_latency("busy-poll", 0, true, gap_us, 10000);
+    }
 }
\ No newline at end of file
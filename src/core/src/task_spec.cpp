@@ -141,6 +141,9 @@ task_spec::task_spec(int code, const char* name, dsn_task_type_t type, dsn_task_
         );
 
     rejection_handler = nullptr;
+    grpc_to_all_quorum = 0;
+    grpc_to_any_hedge_delay_milliseconds = 0;
+    grpc_to_any_hedge_adaptive = false;
     rpc_call_channel = RPC_CHANNEL_TCP;
     rpc_timeout_milliseconds = 5 * 1000; // 5 seconds
 }
@@ -276,11 +279,6 @@ bool threadpool_spec::init(/*out*/ safe_vector<threadpool_spec>& specs)
         if ("" == spec.name) 
             spec.name = dsn_threadpool_code_to_string(code);
 
-        if (false == spec.worker_share_core && 0 == spec.worker_affinity_mask)
-        {
-            spec.worker_affinity_mask = (1 << std::thread::hardware_concurrency()) - 1;
-        }
-
         specs.push_back(spec);
     }
 
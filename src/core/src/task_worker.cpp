@@ -35,6 +35,7 @@
 
 # include <dsn/tool-api/task_worker.h>
 # include "task_engine.h"
+# include "cpu_topology.h"
 # include <sstream>
 # include <errno.h>
 
@@ -242,13 +243,42 @@ void task_worker::set_affinity(uint64_t affinity)
             "There are %d cpus in total, while setting thread affinity to a nonexistent one.", nr_cpu);
     }
 
+    std::vector<int> cpus;
+    for (int i = 0; i < 64; i++)
+    {
+        if ((affinity & ((uint64_t)1 << i)) != 0)
+        {
+            cpus.push_back(i);
+        }
+    }
+    set_affinity(cpus);
+}
+
+void task_worker::set_affinity(const std::vector<int>& cpus)
+{
+    dassert(cpus.size() > 0, "affinity cannot be empty.");
+
     int err = 0;
-# ifdef _WIN32
+# if defined(_WIN32) || defined(__APPLE__)
+    // only the first 64 cpus (i.e., the first processor group on windows) are supported
+    uint64_t affinity = 0;
+    for (auto cpu : cpus)
+    {
+        if (cpu < 64)
+            affinity |= ((uint64_t)1 << cpu);
+    }
+    if (affinity == 0)
+    {
+        dwarn("Fail to set thread affinity as cpus beyond 64 are not supported on this platform.");
+        return;
+    }
+
+    # ifdef _WIN32
     if (::SetThreadAffinityMask(::GetCurrentThread(), static_cast<DWORD_PTR>(affinity)) == 0)
     {
         err = static_cast<int>(::GetLastError());
     }
-# elif defined(__APPLE__)
+    # else
     thread_affinity_policy_data_t policy;
     policy.affinity_tag = static_cast<integer_t>(affinity);
     err = static_cast<int>(thread_policy_set(
@@ -257,6 +287,20 @@ void task_worker::set_affinity(uint64_t affinity)
         (thread_policy_t)&policy,
         THREAD_AFFINITY_POLICY_COUNT
         ));
+    # endif
+# elif defined(__linux__)
+    // dynamically sized so that hosts with more than CPU_SETSIZE cpus are supported
+    int nr_cpu = cpus.back() + 1;
+    cpu_set_t* cpuset = CPU_ALLOC(nr_cpu);
+    size_t size = CPU_ALLOC_SIZE(nr_cpu);
+
+    CPU_ZERO_S(size, cpuset);
+    for (auto cpu : cpus)
+    {
+        CPU_SET_S(cpu, size, cpuset);
+    }
+    err = pthread_setaffinity_np(pthread_self(), size, cpuset);
+    CPU_FREE(cpuset);
 # else
     # ifdef __FreeBSD__
         # ifndef cpu_set_t
@@ -264,14 +308,13 @@ void task_worker::set_affinity(uint64_t affinity)
         # endif
     # endif
     cpu_set_t cpuset;
-    int nr_bits = std::min(nr_cpu, static_cast<int>(sizeof(affinity) * 8));
 
     CPU_ZERO(&cpuset);
-    for (int i = 0; i < nr_bits; i++)
+    for (auto cpu : cpus)
     {
-        if ((affinity & ((uint64_t)1 << i)) != 0)
+        if (cpu < CPU_SETSIZE)
         {
-            CPU_SET(i, &cpuset);
+            CPU_SET(cpu, &cpuset);
         }
     }
     err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
@@ -296,35 +339,16 @@ void task_worker::run_internal()
     set_name(name().c_str());
     set_priority(pool_spec().worker_priority);
     
-    if (true == pool_spec().worker_share_core)
+    // pages allocated by this worker afterwards (e.g., transient memory blocks)
+    // come from its local numa node
+    auto& placement = pool()->placement(_index);
+    if (!placement.cpus.empty())
     {
-        if (pool_spec().worker_affinity_mask > 0) 
-        {
-            set_affinity(pool_spec().worker_affinity_mask);
-        }
+        set_affinity(placement.cpus);
     }
-    else
+    if (placement.numa_node != -1 && !utils::set_thread_preferred_numa_node(placement.numa_node))
     {
-        uint64_t current_mask = pool_spec().worker_affinity_mask;
-        if (0 == current_mask)
-        {
-            derror("mask for %s is set to 0x0, mostly due to that #core > 64, set to 64 now",
-                pool_spec().name.c_str()
-                );
-
-            current_mask = ~((uint64_t)0);
-        }
-        for (int i = 0; i < _index; ++i)
-        {            
-            current_mask &= (current_mask - 1);
-            if (0 == current_mask)
-            {
-                current_mask = pool_spec().worker_affinity_mask;
-            }
-        }
-        current_mask -= (current_mask & (current_mask - 1));
-
-        set_affinity(current_mask);
+        dwarn("%s: fail to set preferred numa node to %d", name().c_str(), placement.numa_node);
     }
 
     _started.notify();
@@ -337,6 +361,7 @@ void task_worker::run_internal()
 void task_worker::loop()
 {
     task_queue* q = queue();
+    admission_controller* controller = q->controller();
     int best_batch_size = pool_spec().dequeue_batch_size;
 
     //try {
@@ -354,6 +379,8 @@ void task_worker::loop()
             {                
                 next = task->next;
                 task->next = nullptr;
+                if (controller)
+                    controller->on_task_dequeued(task);
                 task->exec_internal();                
                 task = next;
 # ifndef NDEBUG
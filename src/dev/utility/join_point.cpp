@@ -44,6 +44,7 @@ join_point_base::join_point_base(const char* name)
     _name = std::string(name);
     _hdr.next = _hdr.prev = &_hdr;
     _hdr.name = "";
+    _advices.store(nullptr);
 }
 
 bool join_point_base::put_front(void* fn, const char* name, bool is_native)
@@ -56,6 +57,7 @@ bool join_point_base::put_front(void* fn, const char* name, bool is_native)
     e1->prev = e;
     e->prev = &_hdr;
 
+    rebuild();
     return true;
 }
 
@@ -69,6 +71,7 @@ bool join_point_base::put_back(void* fn, const char* name, bool is_native)
     _hdr.prev = e;
     e->prev = e1;
 
+    rebuild();
     return true;
 }
 
@@ -90,6 +93,7 @@ bool join_point_base::put_before(const char* base, void* fn, const char* name, b
     e0->prev = e;
     e->prev = e1;
     
+    rebuild();
     return true;
 }
 
@@ -111,6 +115,7 @@ bool join_point_base::put_after(const char* base, void* fn, const char* name, bo
     e0->next = e;
     e->next = e1;
     
+    rebuild();
     return true;
 }
 
@@ -127,6 +132,7 @@ bool join_point_base::put_replace(const char* base, void* fn, const char* name)
     {
         e0->func = fn;
         e0->name = name;
+        rebuild();
         return true;
     }
 }
@@ -144,6 +150,7 @@ bool join_point_base::remove(const char* name)
     e0->next->prev = e0->prev;
     e0->prev->next = e0->next;
 
+    rebuild();
     return true;
 }
 
@@ -157,6 +164,31 @@ join_point_base::advice_entry* join_point_base::new_entry(void* fn, const char*
     return e;
 }
 
+void join_point_base::rebuild()
+{
+    int count = 0;
+    for (auto p = _hdr.next; p != &_hdr; p = p->next)
+        count++;
+
+    advice_item* items = nullptr;
+    if (count > 0)
+    {
+        items = new advice_item[count + 1];
+        int i = 0;
+        for (auto p = _hdr.next; p != &_hdr; p = p->next, i++)
+        {
+            items[i].func = p->func;
+            items[i].is_native = p->is_native;
+        }
+        items[count].func = nullptr;
+        items[count].is_native = false;
+    }
+
+    // the old array is not freed as concurrent execute() may still be using it,
+    // which is fine as advices are only registered a few times during start-up
+    _advices.store(items, std::memory_order_release);
+}
+
 join_point_base::advice_entry* join_point_base::get_by_name(const char* name)
 {
     auto p = _hdr.next;
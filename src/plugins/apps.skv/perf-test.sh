@@ -5,6 +5,7 @@ set -e
 tcp_network_providers="dsn::tools::sim_network_provider dsn::tools::asio_network_provider dsn::tools::hpc_network_provider"
 udp_network_providers="dsn::tools::sim_network_provider dsn::tools::asio_udp_provider"
 aio_providers="dsn::tools::empty_aio_provider dsn::tools::native_aio_provider"
+request_batch_disabled_options="false true"
 
 
 mkdir -p perf-result
@@ -18,9 +19,12 @@ for rep_cnt in {1..3};do
         for udp in ${udp_network_providers};do
             #%aio_provider% - what kind of aio provider we use
             for aio in ${aio_providers};do
-                ./dsn.app.simple_kv perf-config.ini -cargs replica_count=${rep_cnt},tcp_network_provider=${tcp},udp_network_provider=${udp},aio_provider=${aio}
-                cp data/client.perf.test/perf-result-* ./perf-result/
-                rm -rf data
+                #%request_batch_disabled% - whether write requests are batched (group commit) on replicas
+                for batch_disabled in ${request_batch_disabled_options};do
+                    ./dsn.app.simple_kv perf-config.ini -cargs replica_count=${rep_cnt},tcp_network_provider=${tcp},udp_network_provider=${udp},aio_provider=${aio},request_batch_disabled=${batch_disabled}
+                    cp data/client.perf.test/perf-result-* ./perf-result/
+                    rm -rf data
+                done
             done
         done
     done
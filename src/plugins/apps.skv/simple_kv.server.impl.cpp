@@ -101,6 +101,58 @@ namespace dsn {
                 reply(0);
             }
             
+            void simple_kv_service_impl::on_batched_write_requests(int64_t decree, dsn_message_t* requests, int count)
+            {
+                // decode all requests before taking the lock
+                std::vector<kv_pair> prs(count);
+                std::vector<bool> is_append(count, false);
+                for (int i = 0; i < count; i++)
+                {
+                    auto code = dsn_msg_task_code(requests[i]);
+                    if (code == RPC_SIMPLE_KV_SIMPLE_KV_WRITE)
+                    {
+                        ::dsn::unmarshall(requests[i], prs[i]);
+                    }
+                    else if (code == RPC_SIMPLE_KV_SIMPLE_KV_APPEND)
+                    {
+                        ::dsn::unmarshall(requests[i], prs[i]);
+                        is_append[i] = true;
+                    }
+                    else
+                    {
+                        dassert(false, "invalid write request %s in batch with decree %" PRId64,
+                            dsn_task_code_to_string(code), decree);
+                    }
+                }
+
+                {
+                    zauto_lock l(_lock);
+                    for (int i = 0; i < count; i++)
+                    {
+                        auto& pr = prs[i];
+                        if (is_append[i])
+                        {
+                            auto it = _store.find(pr.key);
+                            if (it != _store.end())
+                                it->second.append(pr.value);
+                            else
+                                _store[pr.key] = std::move(pr.value);
+                        }
+                        else
+                        {
+                            _store[pr.key] = std::move(pr.value);
+                        }
+                    }
+                }
+
+                dinfo("batched write %d requests with decree %" PRId64, count, decree);
+                for (int i = 0; i < count; i++)
+                {
+                    ::dsn::rpc_replier<int32_t> reply(dsn_msg_create_response(requests[i]));
+                    reply(0);
+                }
+            }
+            
             ::dsn::error_code simple_kv_service_impl::start(int argc, char** argv)
             {
                 _data_dir = dsn_get_app_data_dir(get_gpid());
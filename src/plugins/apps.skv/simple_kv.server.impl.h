@@ -55,6 +55,10 @@ namespace dsn {
                 // RPC_SIMPLE_KV_APPEND
                 virtual void on_append(const kv_pair& pr, ::dsn::rpc_replier<int32_t>& reply);
 
+                // RPC_SIMPLE_KV_WRITE and RPC_SIMPLE_KV_APPEND in one batch (group commit),
+                // applied under a single _lock acquisition and replied together
+                virtual void on_batched_write_requests(int64_t decree, dsn_message_t* requests, int count) override;
+
                 virtual ::dsn::error_code start(int argc, char** argv) override;
 
                 virtual ::dsn::error_code stop(bool cleanup = false) override;
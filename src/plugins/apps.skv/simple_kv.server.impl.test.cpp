@@ -0,0 +1,128 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the batched writes of simple kv.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "simple_kv.server.impl.h"
+# include <gtest/gtest.h>
+
+using namespace ::dsn;
+using namespace ::dsn::replication::application;
+
+// requests are made as received ones without a from-address, so that
+// their replies are dropped by the rpc engine
+static dsn_message_t create_received_request(dsn_task_code_t code, const kv_pair& pr)
+{
+    auto msg = dsn_msg_create_request(code);
+    ::dsn::marshall(msg, pr);
+    auto received = dsn_msg_copy(msg, true, true);
+    dsn_msg_add_ref(msg);
+    dsn_msg_release_ref(msg);
+    return received;
+}
+
+static std::string read_value(simple_kv_service_impl& kv, const std::string& key)
+{
+    auto request = dsn_msg_create_request(RPC_SIMPLE_KV_SIMPLE_KV_READ);
+    auto response = dsn_msg_create_response(request);
+    dsn_msg_add_ref(response); // read below after the reply
+    ::dsn::rpc_replier<std::string> reply(response);
+    kv.on_read(key, reply);
+
+    std::string value;
+    auto received = dsn_msg_copy(response, true, true);
+    ::dsn::unmarshall(received, value);
+    dsn_msg_release_ref(received);
+    dsn_msg_release_ref(response);
+    dsn_msg_add_ref(request);
+    dsn_msg_release_ref(request);
+    return value;
+}
+
+static void batched_write(simple_kv_service_impl& kv, int64_t decree, const std::vector<std::pair<dsn_task_code_t, kv_pair>>& writes)
+{
+    std::vector<dsn_message_t> requests;
+    for (auto& w : writes)
+    {
+        requests.push_back(create_received_request(w.first, w.second));
+    }
+
+    kv.on_batched_write_requests(decree, &requests[0], (int)requests.size());
+
+    for (auto& r : requests)
+    {
+        dsn_msg_release_ref(r);
+    }
+}
+
+static kv_pair make_kv(const std::string& key, const std::string& value)
+{
+    kv_pair pr;
+    pr.key = key;
+    pr.value = value;
+    return pr;
+}
+
+TEST(apps_skv, batched_write_requests)
+{
+    simple_kv_service_impl kv(dsn_gpid{ 0 });
+
+    // writes to the same key are applied in the batch order
+    batched_write(kv, 1, {
+        { RPC_SIMPLE_KV_SIMPLE_KV_WRITE, make_kv("k1", "a") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_APPEND, make_kv("k1", "b") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_WRITE, make_kv("k2", "x") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_APPEND, make_kv("k1", "c") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_WRITE, make_kv("k2", "y") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_APPEND, make_kv("k3", "z") }
+        });
+    EXPECT_EQ("abc", read_value(kv, "k1"));
+    EXPECT_EQ("y", read_value(kv, "k2"));
+    EXPECT_EQ("z", read_value(kv, "k3"));
+
+    // a later write overrides the earlier appends in the same batch
+    batched_write(kv, 2, {
+        { RPC_SIMPLE_KV_SIMPLE_KV_APPEND, make_kv("k1", "d") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_WRITE, make_kv("k1", "e") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_APPEND, make_kv("k1", "f") },
+        { RPC_SIMPLE_KV_SIMPLE_KV_APPEND, make_kv("k2", "y") }
+        });
+    EXPECT_EQ("ef", read_value(kv, "k1"));
+    EXPECT_EQ("yy", read_value(kv, "k2"));
+    EXPECT_EQ("z", read_value(kv, "k3"));
+
+    // a batch of one is the same as a single write
+    batched_write(kv, 3, { { RPC_SIMPLE_KV_SIMPLE_KV_WRITE, make_kv("k3", "w") } });
+    EXPECT_EQ("w", read_value(kv, "k3"));
+    EXPECT_EQ("", read_value(kv, "k4"));
+}
@@ -35,6 +35,7 @@
 
 # include "partition_resolver_simple.h"
 # include <dsn/cpp/utils.h>
+# include <atomic>
 
 # ifdef __TITLE__
 # undef __TITLE__
@@ -48,13 +49,59 @@ namespace dsn
         //------------------------------------------------------------------------------------
         using namespace service;
 
+        //
+        // the resolved addresses of each partition are kept in a seqlock protected slot, 
+        // so that resolve does not acquire any lock when the address is cached
+        //
+        enum { MAX_CACHED_ADDRESSES = 8 };
+        struct partition_slot
+        {
+            std::atomic<uint32_t> version; // odd when being updated
+            std::atomic<int>      address_count; // -1 when not cached
+            std::atomic<uint64_t> addresses[MAX_CACHED_ADDRESSES];
+        };
+
+        struct partition_resolver_simple::config_snapshot
+        {
+            std::atomic<partition_slot*> slots; // allocated once partition count is known
+            std::atomic<int>             partition_count;
+            std::atomic<uint64_t>        hit_count; // since last timer tick
+            std::atomic<uint64_t>        miss_count;
+            std::atomic<bool>            timer_started;
+
+            config_snapshot() : slots(nullptr), partition_count(-1), hit_count(0), miss_count(0), timer_started(false) {}
+            ~config_snapshot() { delete[] slots.load(); }
+        };
+
         partition_resolver_simple::partition_resolver_simple(
             rpc_address meta_server,
             const char* app_path
             )
             : partition_resolver(meta_server, app_path),
-            _app_id(-1), _app_partition_count(-1), _app_is_stateful(true)
+            _app_id(-1), _app_partition_count(-1), _app_is_stateful(true),
+            _refresh_all_required(false), _last_refresh_ms(0)
         {
+            _snapshot = new config_snapshot();
+
+            _batch_query_max_partitions = (int)dsn_config_get_value_uint64("uri-resolver.partition_resolver_simple",
+                "batch_query_max_partitions", 64,
+                "max partitions in one configuration query to meta server, beyond which all partitions are queried"
+                );
+            _refresh_interval_seconds = (int)dsn_config_get_value_uint64("uri-resolver.partition_resolver_simple",
+                "refresh_interval_seconds", 0,
+                "interval for refreshing all partition configurations in background, 0 for disabled; "
+                "note every client then queries the meta server periodically"
+                );
+
+            std::string prefix = std::string(app_path) + ".";
+            _cache_hit_count.init("uri.resolver", (prefix + "cache.hit.count").c_str(), COUNTER_TYPE_RATE,
+                "resolve requests served by the partition configuration cache");
+            _cache_miss_count.init("uri.resolver", (prefix + "cache.miss.count").c_str(), COUNTER_TYPE_RATE,
+                "resolve requests waiting for partition configuration from meta server");
+            _cache_hit_percent.init("uri.resolver", (prefix + "cache.hit.percent").c_str(), COUNTER_TYPE_NUMBER,
+                "hit percentage of the partition configuration cache in the recent second");
+            _meta_query_count.init("uri.resolver", (prefix + "meta.query.count").c_str(), COUNTER_TYPE_RATE,
+                "configuration queries sent to meta server");
         }
 
         void partition_resolver_simple::resolve(
@@ -63,13 +110,20 @@ namespace dsn
             int timeout_ms
             )
         {
+            if (!_snapshot->timer_started.load(std::memory_order_relaxed))
+            {
+                start_timer();
+            }
+
             int idx = -1;
-            if (_app_partition_count != -1)
+            int partition_count = _snapshot->partition_count.load(std::memory_order_acquire);
+            if (partition_count != -1)
             {
-                idx = get_partition_index(_app_partition_count, partition_hash);
+                idx = get_partition_index(partition_count, partition_hash);
                 rpc_address target;
                 if (ERR_OK == get_address(idx, target))
                 {
+                    _snapshot->hit_count.fetch_add(1, std::memory_order_relaxed);
                     callback(resolve_result{
                         ERR_OK,
                         target,
@@ -78,6 +132,7 @@ namespace dsn
                     return;
                 }
             }
+            _snapshot->miss_count.fetch_add(1, std::memory_order_relaxed);
 
             auto rc = new request_context();
             rc->partition_hash = partition_hash;
@@ -107,27 +162,43 @@ namespace dsn
                     if (it != _config_cache.end())
                     {
                         _config_cache.erase(it);
+                        update_snapshot(partition_index, nullptr);
                     }
                 }
+
+                // refresh proactively before the partition is used again
+                {
+                    zauto_lock l(_requests_lock);
+                    _partitions_to_refresh.insert(partition_index);
+                    query_config_if_necessary();
+                }
             }
         }
 
         partition_resolver_simple::~partition_resolver_simple()
         {
+            if (_timer != nullptr)
+            {
+                _timer->cancel(true);
+            }
             clear_all_pending_requests();
             dsn_group_destroy(_meta_server.group_handle());
+            delete _snapshot;
         }
 
         void partition_resolver_simple::clear_all_pending_requests()
         {
             dinfo("%s.client: clear all pending tasks", _app_path.c_str());
             zauto_lock l(_requests_lock);
+            if (_query_config_task != nullptr)
+            {
+                _query_config_task->cancel(true);
+                _query_config_task = nullptr;
+            }
+
             //clear _pending_requests
             for (auto& pc : _pending_requests)
             {
-                if (pc.second->query_config_task != nullptr)
-                    pc.second->query_config_task->cancel(true);
-
                 for (auto& rc : pc.second->requests)
                 {
                     end_request(std::move(rc), ERR_TIMEOUT, rpc_address());
@@ -164,6 +235,56 @@ namespace dsn
 
         DEFINE_TASK_CODE(LPC_REPLICATION_CLIENT_REQUEST_TIMEOUT, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
         DEFINE_TASK_CODE(LPC_REPLICATION_DELAY_QUERY_CONFIG, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+        DEFINE_TASK_CODE(LPC_PARTITION_RESOLVER_TIMER, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+        void partition_resolver_simple::start_timer()
+        {
+            bool started = false;
+            if (!_snapshot->timer_started.compare_exchange_strong(started, true))
+                return;
+
+            _last_refresh_ms = dsn_now_ms();
+            _timer = tasking::enqueue_timer(
+                LPC_PARTITION_RESOLVER_TIMER,
+                this,
+                [this]() { on_timer(); },
+                std::chrono::seconds(1),
+                0,
+                std::chrono::seconds(1)
+                );
+        }
+
+        void partition_resolver_simple::on_timer()
+        {
+            uint64_t hits = _snapshot->hit_count.exchange(0, std::memory_order_relaxed);
+            uint64_t misses = _snapshot->miss_count.exchange(0, std::memory_order_relaxed);
+            _cache_hit_count.add(hits);
+            _cache_miss_count.add(misses);
+            if (hits + misses > 0)
+            {
+                _cache_hit_percent.set(hits * 100 / (hits + misses));
+            }
+
+            // refresh all partition configurations in background, so that the 
+            // changed configurations are known before the partitions are accessed
+            bool refresh_all = false;
+            if (_refresh_interval_seconds > 0 && _app_partition_count != -1)
+            {
+                uint64_t now = dsn_now_ms();
+                if (now >= _last_refresh_ms + (uint64_t)_refresh_interval_seconds * 1000)
+                {
+                    _last_refresh_ms = now;
+                    refresh_all = true;
+                }
+            }
+
+            // also retry the partitions of the failed queries
+            zauto_lock l(_requests_lock);
+            if (refresh_all)
+                _refresh_all_required = true;
+            if (_refresh_all_required || !_partitions_to_refresh.empty())
+                query_config_if_necessary();
+        }
 
         void partition_resolver_simple::call(request_context_ptr&& request, bool from_meta_ack)
         {
@@ -244,52 +365,77 @@ namespace dsn
                         it = _pending_requests.emplace(pindex, pc).first;
                     }
                     it->second->requests.push_back(std::move(request));
-
-                    // init configuration query task if necessary
-                    if (nullptr == it->second->query_config_task)
-                    {
-                        it->second->query_config_task = query_config(pindex);
-                    }
                 }
                 else
                 {
                     _pending_requests_before_partition_count_unknown.push_back(std::move(request));
-                    if (_pending_requests_before_partition_count_unknown.size() == 1)
-                    {
-                        _query_config_task = query_config(pindex);
-                    }
                 }
+
+                query_config_if_necessary();
+            }
+        }
+
+        void partition_resolver_simple::query_config_if_necessary()
+        {
+            // the partitions wanted by then are queried when the on-the-fly query is replied
+            if (_query_config_task != nullptr)
+                return;
+
+            bool query_all = _refresh_all_required
+                || _app_partition_count == -1
+                || !_pending_requests_before_partition_count_unknown.empty();
+
+            std::vector<int> partition_indices;
+            if (!query_all)
+            {
+                std::set<int> partitions(_partitions_to_refresh);
+                for (auto& pc : _pending_requests)
+                {
+                    partitions.insert(pc.first);
+                }
+
+                if (partitions.empty())
+                    return;
+
+                if ((int)partitions.size() > _batch_query_max_partitions)
+                    query_all = true;
+                else
+                    partition_indices.assign(partitions.begin(), partitions.end());
             }
+
+            _refresh_all_required = false;
+            _partitions_to_refresh.clear();
+            _query_config_task = query_config(partition_indices);
         }
 
         /*send rpc*/
         DEFINE_TASK_CODE_RPC(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 
-        task_ptr partition_resolver_simple::query_config(int partition_index)
+        task_ptr partition_resolver_simple::query_config(const std::vector<int>& partition_indices)
         {
-            dinfo("%s.client: start query config, gpid = %d.%d", _app_path.c_str(), _app_id, partition_index);
+            dinfo("%s.client: start query config, app_id = %d, partition count = %d (0 for all)",
+                _app_path.c_str(), _app_id, (int)partition_indices.size());
             auto msg = dsn_msg_create_request(RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX);
 
             configuration_query_by_index_request req;
             req.app_name = _app_path.c_str();
-            if (partition_index != -1)
-            {
-                req.partition_indices.push_back(partition_index);
-            }
+            req.partition_indices = partition_indices;
             marshall(msg, req);
 
+            _meta_query_count.increment();
+
             return rpc::call(
                 _meta_server,
                 msg,
                 this,
-                [this, partition_index](error_code err, dsn_message_t req, dsn_message_t resp)
+                [this, partition_indices](error_code err, dsn_message_t req, dsn_message_t resp)
                 {
-                    query_config_reply(err, req, resp, partition_index);
+                    query_config_reply(err, req, resp, partition_indices);
                 }
                 );
         }
 
-        void partition_resolver_simple::query_config_reply(error_code err, dsn_message_t request, dsn_message_t response, int partition_index)
+        void partition_resolver_simple::query_config_reply(error_code err, dsn_message_t request, dsn_message_t response, const std::vector<int>& partition_indices)
         {
             auto client_err = ERR_OK;
 
@@ -315,6 +461,17 @@ namespace dsn
                     _app_partition_count = resp.partition_count;
                     _app_is_stateful = resp.is_stateful;
 
+                    if (_snapshot->slots.load() == nullptr && _app_partition_count > 0)
+                    {
+                        auto slots = new partition_slot[_app_partition_count];
+                        for (int i = 0; i < _app_partition_count; i++)
+                        {
+                            slots[i].version.store(0);
+                            slots[i].address_count.store(-1);
+                        }
+                        _snapshot->slots.store(slots, std::memory_order_release);
+                    }
+
                     for (auto it = resp.partitions.begin(); it != resp.partitions.end(); ++it)
                     {
                         auto& new_config = *it;
@@ -333,7 +490,7 @@ namespace dsn
                             std::unique_ptr<partition_info> pi(new partition_info);
                             pi->timeout_count = 0;
                             pi->config = new_config;
-                            _config_cache.emplace(new_config.pid.get_partition_index(), std::move(pi));
+                            it2 = _config_cache.emplace(new_config.pid.get_partition_index(), std::move(pi)).first;
                         }
                         else if (_app_is_stateful && it2->second->config.ballot < new_config.ballot)
                         {
@@ -348,15 +505,20 @@ namespace dsn
                         else
                         {
                             // nothing to do
+                            continue;
                         }
+
+                        update_snapshot(it2->first, &it2->second->config);
                     }
+
+                    // publish partition count after the slots are ready
+                    _snapshot->partition_count.store(_app_partition_count, std::memory_order_release);
                 }
                 else if (resp.err == ERR_OBJECT_NOT_FOUND)
                 {
-                    derror("%s.client: query config reply, gpid = %d.%d, err = %s",
+                    derror("%s.client: query config reply, app_id = %d, err = %s",
                         _app_path.c_str(),
                         _app_id,
-                        partition_index,
                         resp.err.to_string()
                         );
 
@@ -364,10 +526,9 @@ namespace dsn
                 }
                 else
                 {
-                    derror("%s.client: query config reply, gpid = %d.%d, err = %s",
+                    derror("%s.client: query config reply, app_id = %d, err = %s",
                         _app_path.c_str(),
                         _app_id,
-                        partition_index,
                         resp.err.to_string()
                         );
 
@@ -376,66 +537,76 @@ namespace dsn
             }
             else
             {
-                derror("%s.client: query config reply, gpid = %d.%d, err = %s",
+                derror("%s.client: query config reply, app_id = %d, err = %s",
                     _app_path.c_str(),
                     _app_id,
-                    partition_index,
                     err.to_string()
                     );
             }
 
-            // get specific or all partition update
-            if (partition_index != -1)
+            // take the requests for the queried partitions, and query
+            // again for the partitions wanted during this query
+            pending_replica_requests reqs;
+            std::deque<request_context_ptr> reqs2;
             {
-                partition_context* pc = nullptr;
+                zauto_lock l(_requests_lock);
+                _query_config_task = nullptr;
+
+                // get all partition update
+                if (partition_indices.empty())
                 {
-                    zauto_lock l(_requests_lock);
-                    auto it = _pending_requests.find(partition_index);
-                    if (it != _pending_requests.end())
+                    reqs.swap(_pending_requests);
+                    reqs2.swap(_pending_requests_before_partition_count_unknown);
+                }
+
+                // get specific partition update
+                else
+                {
+                    for (auto pidx : partition_indices)
                     {
-                        pc = it->second;
-                        _pending_requests.erase(partition_index);
+                        auto it = _pending_requests.find(pidx);
+                        if (it != _pending_requests.end())
+                        {
+                            reqs.emplace(pidx, it->second);
+                            _pending_requests.erase(it);
+                        }
                     }
                 }
 
-                if (pc)
+                // the queried partitions are still to be refreshed when the query fails,
+                // which is retried by the timer so that the meta server is not flooded
+                if (err != ERR_OK || (client_err != ERR_OK && client_err != ERR_APP_NOT_EXIST))
                 {
-                    handle_pending_requests(pc->requests, client_err);
-                    delete pc;
+                    if (!partition_indices.empty())
+                        _partitions_to_refresh.insert(partition_indices.begin(), partition_indices.end());
+                    else if (_app_partition_count != -1)
+                        _refresh_all_required = true;
                 }
-            }
-
-            // get all partition update
-            else
-            {
-                pending_replica_requests reqs;
-                std::deque<request_context_ptr> reqs2;
+                else if (client_err == ERR_OK)
                 {
-                    zauto_lock l(_requests_lock);
-                    reqs.swap(_pending_requests);
-                    reqs2.swap(_pending_requests_before_partition_count_unknown);
+                    query_config_if_necessary();
                 }
+            }
              
-                if (!reqs2.empty())
+            if (!reqs2.empty())
+            {
+                if (_app_partition_count != -1)
                 {
-                    if (_app_partition_count != -1)
+                    for (auto& req : reqs2)
                     {
-                        for (auto& req : reqs2)
-                        {
-                            dassert(req->partition_index == -1, "");
-                            req->partition_index = get_partition_index(_app_partition_count, req->partition_hash);
-                        }
+                        dassert(req->partition_index == -1, "");
+                        req->partition_index = get_partition_index(_app_partition_count, req->partition_hash);
                     }
-                    handle_pending_requests(reqs2, client_err);
                 }
+                handle_pending_requests(reqs2, client_err);
+            }
 
-                for (auto& r : reqs)
+            for (auto& r : reqs)
+            {
+                if (r.second)
                 {
-                    if (r.second)
-                    {
-                        handle_pending_requests(r.second->requests, client_err);
-                        delete r.second;
-                    }
+                    handle_pending_requests(r.second->requests, client_err);
+                    delete r.second;
                 }
             }
         }
@@ -517,28 +688,79 @@ namespace dsn
         //ERR_OK                in cache and valid
         error_code partition_resolver_simple::get_address(int partition_index, /*out*/ rpc_address& addr)
         {
-            //partition_configuration config;
+            partition_slot* slots = _snapshot->slots.load(std::memory_order_acquire);
+            if (slots == nullptr)
+                return ERR_OBJECT_NOT_FOUND;
+
+            auto& slot = slots[partition_index];
+            dsn_address_t candidates[MAX_CACHED_ADDRESSES];
+            int count;
+            uint32_t v1, v2;
+            do
             {
-                zauto_read_lock l(_config_lock);
-                auto it = _config_cache.find(partition_index);
-                if (it != _config_cache.end())
+                v1 = slot.version.load(std::memory_order_acquire);
+                if (v1 & 0x1)
+                    continue;
+
+                count = slot.address_count.load(std::memory_order_relaxed);
+                for (int i = 0; i < count; i++)
                 {
-                    //config = it->second->config;
-                    addr = get_address(it->second->config);
-                    if (addr.is_invalid())
-                    {
-                        return ERR_IO_PENDING;
-                    }
-                    else
-                    {
-                        return ERR_OK;
-                    }
+                    candidates[i].u.value = slot.addresses[i].load(std::memory_order_relaxed);
+                }
+
+                std::atomic_thread_fence(std::memory_order_acquire);
+                v2 = slot.version.load(std::memory_order_relaxed);
+            } while ((v1 & 0x1) || v1 != v2);
+
+            if (count == -1)
+                return ERR_OBJECT_NOT_FOUND;
+            else if (count == 0)
+                return ERR_IO_PENDING;
+            
+            addr = candidates[count == 1 ? 0 : dsn_random32(0, count - 1)];
+            return ERR_OK;
+        }
+
+        // called with _config_lock write locked, so there is only one writer
+        void partition_resolver_simple::update_snapshot(int partition_index, const partition_configuration* config)
+        {
+            partition_slot* slots = _snapshot->slots.load(std::memory_order_relaxed);
+            if (slots == nullptr)
+                return;
+
+            int count = -1;
+            uint64_t addresses[MAX_CACHED_ADDRESSES];
+            if (config != nullptr)
+            {
+                count = 0;
+                if (_app_is_stateful)
+                {
+                    if (!config->primary.is_invalid())
+                        addresses[count++] = config->primary.c_addr().u.value;
                 }
                 else
                 {
-                    return ERR_OBJECT_NOT_FOUND;
+                    for (auto& addr : config->last_drops)
+                    {
+                        if (count == MAX_CACHED_ADDRESSES)
+                            break;
+                        addresses[count++] = addr.c_addr().u.value;
+                    }
                 }
             }
+
+            auto& slot = slots[partition_index];
+            uint32_t v = slot.version.load(std::memory_order_relaxed);
+            slot.version.store(v + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            slot.address_count.store(count, std::memory_order_relaxed);
+            for (int i = 0; i < count; i++)
+            {
+                slot.addresses[i].store(addresses[i], std::memory_order_relaxed);
+            }
+
+            slot.version.store(v + 2, std::memory_order_release);
         }
 
         int partition_resolver_simple::get_partition_index(int partition_count, uint64_t partition_hash)
@@ -37,6 +37,9 @@
 
 # include <dsn/tool-api/partition_resolver.h>
 # include <dsn/cpp/zlocks.h>
+# include <dsn/cpp/perf_counter_.h>
+# include <set>
+# include <deque>
 
 namespace dsn
 {
@@ -72,13 +75,18 @@ namespace dsn
                 int timeout_count;
                 ::dsn::partition_configuration config;
             };
-            mutable dsn::service::zrwlock_nr     _config_lock;
+            mutable dsn::service::zrwlock_nr     _config_lock; // for updating the cache only
             std::unordered_map<int, std::unique_ptr<partition_info> > _config_cache;
 
             int                                  _app_id;
             int                                  _app_partition_count;
             bool                                 _app_is_stateful;
 
+            // lock-free snapshot of _config_cache for the read path, defined in cpp
+            // as the atomics inside should not be packed
+            struct config_snapshot;
+            config_snapshot*                     _snapshot;
+
             typedef std::function<void(resolve_result&&)> callback_t;
             struct request_context : ref_counter, transient_object
             {
@@ -97,7 +105,6 @@ namespace dsn
 
             struct partition_context
             {
-                task_ptr query_config_task;
                 std::deque<request_context_ptr> requests;
             };
 
@@ -106,13 +113,31 @@ namespace dsn
             mutable service::zlock           _requests_lock;
             pending_replica_requests         _pending_requests;
             std::deque<request_context_ptr>  _pending_requests_before_partition_count_unknown;
+
+            // at most one query to meta server is on the fly, which batches all partitions
+            // wanted by then, and other partitions are queried when it is replied
             task_ptr                         _query_config_task;
+            std::set<int>                    _partitions_to_refresh; // without pending requests, or failed to query
+            bool                             _refresh_all_required;
+            int                              _batch_query_max_partitions;
+
+            // background refresh and metrics
+            task_ptr                         _timer;
+            int                              _refresh_interval_seconds;
+            uint64_t                         _last_refresh_ms;
+            perf_counter_                    _cache_hit_count;
+            perf_counter_                    _cache_miss_count;
+            perf_counter_                    _cache_hit_percent;
+            perf_counter_                    _meta_query_count;
 
             // local routines
             rpc_address get_address(const partition_configuration& config) const;
             error_code get_address(int partition_index, /*out*/ rpc_address& addr);
+            void update_snapshot(int partition_index, const partition_configuration* config);
             void handle_pending_requests(std::deque<request_context_ptr>& reqs, error_code err);
             void clear_all_pending_requests();
+            void start_timer();
+            void on_timer();
 
             // with replica
             void call(request_context_ptr&& request, bool from_meta_ack = false);
@@ -120,9 +145,10 @@ namespace dsn
             void end_request(request_context_ptr&& request, error_code err, rpc_address addr, bool called_by_timer = false) const;
             void on_timeout(request_context_ptr&& rc) const;
 
-            // with meta server
-            task_ptr query_config(int partition_index);
-            void query_config_reply(error_code err, dsn_message_t request, dsn_message_t response, int partition_index);
+            // with meta server, _requests_lock must be held by the caller
+            void query_config_if_necessary();
+            task_ptr query_config(const std::vector<int>& partition_indices);
+            void query_config_reply(error_code err, dsn_message_t request, dsn_message_t response, const std::vector<int>& partition_indices);
         };
 #pragma pack(pop)
     }
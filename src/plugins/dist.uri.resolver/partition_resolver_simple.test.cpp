@@ -0,0 +1,368 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the simple partition resolver, with a fake meta server
+ *     running on the test client node.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "partition_resolver_simple.h"
+# include <dsn/cpp/serverlet.h>
+# include <dsn/cpp/test_utils.h>
+# include <gtest/gtest.h>
+# include <atomic>
+# include <thread>
+# include <chrono>
+
+using namespace ::dsn;
+using namespace ::dsn::dist;
+using namespace ::dsn::service;
+
+// the same code as the resolver queries with
+DEFINE_NAMED_TASK_CODE_RPC(RPC_FAKE_META_QUERY_CONFIG, RPC_CM_QUERY_PARTITION_CONFIG_BY_INDEX, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE(LPC_RESOLVER_TEST_READER, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+static const int test_partition_count = 8;
+static const int test_app_id = 1;
+
+class fake_meta : public serverlet<fake_meta>
+{
+public:
+    fake_meta()
+        : serverlet<fake_meta>("fake_meta"), _hold(false), _fail_count(0), _port_base(30000), _ballot(1)
+    {
+        register_rpc_handler(RPC_FAKE_META_QUERY_CONFIG, "fake.meta.query.config", &fake_meta::on_query_config);
+    }
+
+    ~fake_meta()
+    {
+        unregister_rpc_handler(RPC_FAKE_META_QUERY_CONFIG);
+        release_held();
+    }
+
+    // the replies are held until release_held is called
+    void set_hold(bool hold) { zauto_lock l(_lock); _hold = hold; }
+
+    // the next count queries are replied with ERR_BUSY
+    void fail_next(int count) { zauto_lock l(_lock); _fail_count = count; }
+
+    // primaries move to new ports with a higher ballot
+    void move_primaries(int port_base) { zauto_lock l(_lock); _port_base = port_base; _ballot++; }
+
+    int held_count() const { zauto_lock l(_lock); return (int)_held.size(); }
+
+    int query_count() const { zauto_lock l(_lock); return (int)_queries.size(); }
+
+    std::vector<int> query(int i) const { zauto_lock l(_lock); return _queries[i]; }
+
+    void release_held()
+    {
+        std::vector<dsn_message_t> held;
+        {
+            zauto_lock l(_lock);
+            held.swap(_held);
+        }
+        for (auto& msg : held)
+        {
+            do_reply(msg);
+            dsn_msg_release_ref(msg);
+        }
+    }
+
+private:
+    void on_query_config(dsn_message_t request)
+    {
+        configuration_query_by_index_request req;
+        ::dsn::unmarshall(request, req);
+
+        {
+            zauto_lock l(_lock);
+            _queries.push_back(req.partition_indices);
+            if (_hold)
+            {
+                dsn_msg_add_ref(request);
+                _held.push_back(request);
+                return;
+            }
+        }
+        do_reply(request);
+    }
+
+    void do_reply(dsn_message_t request)
+    {
+        configuration_query_by_index_request req;
+        ::dsn::unmarshall(request, req);
+
+        configuration_query_by_index_response resp;
+        {
+            zauto_lock l(_lock);
+            if (_fail_count > 0)
+            {
+                _fail_count--;
+                resp.err = ERR_BUSY;
+                reply(request, resp);
+                return;
+            }
+
+            resp.err = ERR_OK;
+            resp.app_id = test_app_id;
+            resp.partition_count = test_partition_count;
+            resp.is_stateful = true;
+
+            std::vector<int> indices(req.partition_indices.begin(), req.partition_indices.end());
+            if (indices.empty())
+            {
+                for (int i = 0; i < test_partition_count; i++)
+                    indices.push_back(i);
+            }
+            for (auto i : indices)
+            {
+                partition_configuration pc;
+                pc.pid = gpid(test_app_id, i);
+                pc.ballot = _ballot;
+                pc.primary = rpc_address("localhost", (uint16_t)(_port_base + i));
+                resp.partitions.push_back(pc);
+            }
+        }
+        reply(request, resp);
+    }
+
+private:
+    mutable zlock                 _lock;
+    bool                          _hold;
+    int                           _fail_count;
+    int                           _port_base;
+    int64_t                       _ballot;
+    std::vector<std::vector<int>> _queries;
+    std::vector<dsn_message_t>    _held;
+};
+
+static rpc_address fake_meta_address()
+{
+    rpc_address meta;
+    meta.assign_group(dsn_group_build("fake_meta.test"));
+    dsn_group_add(meta.group_handle(), rpc_address("localhost", 20001).c_addr());
+    return meta;
+}
+
+static bool wait_for(std::function<bool()> cond, int timeout_ms)
+{
+    for (int i = 0; i < timeout_ms / 10; i++)
+    {
+        if (cond())
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return cond();
+}
+
+struct resolve_state
+{
+    std::atomic<bool> done;
+    error_code        err;
+    rpc_address       address;
+    int               partition_index;
+
+    resolve_state() : done(false), partition_index(-1) {}
+};
+
+// returns whether the partition is resolved by the cache, i.e., synchronously
+static bool resolve(partition_resolver_simple* r, uint64_t hash, std::shared_ptr<resolve_state>& state)
+{
+    state.reset(new resolve_state());
+    auto s = state;
+    r->resolve(hash, [s](partition_resolver::resolve_result&& result)
+        {
+            s->err = result.err;
+            s->address = result.address;
+            s->partition_index = result.pid.u.partition_index;
+            s->done.store(true);
+        },
+        5000);
+    return state->done.load();
+}
+
+static bool resolved_from_cache(partition_resolver_simple* r, int partition_index, int port_base)
+{
+    std::shared_ptr<resolve_state> s;
+    return resolve(r, partition_index, s)
+        && s->err == ERR_OK
+        && s->address == rpc_address("localhost", (uint16_t)(port_base + partition_index));
+}
+
+TEST(dist_uri_resolver, cache_and_batch)
+{
+    fake_meta meta;
+    partition_resolver_ptr resolver(new partition_resolver_simple(fake_meta_address(), "resolver.test.batch"));
+    auto r = static_cast<partition_resolver_simple*>(resolver.get());
+
+    // the first resolve queries all partitions
+    std::shared_ptr<resolve_state> s;
+    EXPECT_FALSE(resolve(r, 3, s));
+    ASSERT_TRUE(wait_for([&]() { return s->done.load(); }, 5000));
+    EXPECT_EQ(ERR_OK, s->err);
+    EXPECT_EQ(3, s->partition_index);
+    EXPECT_EQ(rpc_address("localhost", 30003), s->address);
+    EXPECT_EQ(test_partition_count, r->get_partition_count());
+    ASSERT_EQ(1, meta.query_count());
+    EXPECT_TRUE(meta.query(0).empty());
+
+    // then all partitions are resolved from the cache without querying meta server
+    for (int i = 0; i < test_partition_count * 2; i++)
+    {
+        EXPECT_TRUE(resolved_from_cache(r, i, 30000));
+    }
+    EXPECT_EQ(1, meta.query_count());
+
+    // partitions failed during a query are batched into the next query
+    meta.set_hold(true);
+    r->on_access_failure(1, ERR_TIMEOUT);
+    ASSERT_TRUE(wait_for([&]() { return meta.held_count() == 1; }, 5000));
+    r->on_access_failure(2, ERR_TIMEOUT);
+    r->on_access_failure(3, ERR_TIMEOUT);
+    EXPECT_FALSE(resolve(r, 2, s));
+
+    // no query for the failures not related to the configuration
+    r->on_access_failure(4, ERR_CAPACITY_EXCEEDED);
+    EXPECT_TRUE(resolved_from_cache(r, 4, 30000));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(2, meta.query_count());
+    EXPECT_EQ(std::vector<int>({ 1 }), meta.query(1));
+
+    meta.set_hold(false);
+    meta.release_held();
+    ASSERT_TRUE(wait_for([&]() { return meta.query_count() == 3; }, 5000));
+    EXPECT_EQ(std::vector<int>({ 2, 3 }), meta.query(2));
+
+    ASSERT_TRUE(wait_for([&]() { return s->done.load(); }, 5000));
+    EXPECT_EQ(ERR_OK, s->err);
+    EXPECT_EQ(rpc_address("localhost", 30002), s->address);
+    EXPECT_TRUE(resolved_from_cache(r, 3, 30000));
+    EXPECT_TRUE(resolved_from_cache(r, 1, 30000));
+
+    // partitions of a failed query are queried again by the timer
+    meta.fail_next(1);
+    r->on_access_failure(5, ERR_TIMEOUT);
+    ASSERT_TRUE(wait_for([&]() { return meta.query_count() == 4; }, 5000));
+    EXPECT_EQ(std::vector<int>({ 5 }), meta.query(3));
+    ASSERT_TRUE(wait_for([&]() { return meta.query_count() == 5; }, 5000));
+    EXPECT_EQ(std::vector<int>({ 5 }), meta.query(4));
+
+    // nothing is left to query
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    EXPECT_EQ(5, meta.query_count());
+    EXPECT_TRUE(resolved_from_cache(r, 5, 30000));
+}
+
+TEST(dist_uri_resolver, concurrent_resolve)
+{
+    fake_meta meta;
+    partition_resolver_ptr resolver(new partition_resolver_simple(fake_meta_address(), "resolver.test.concurrent"));
+    auto r = static_cast<partition_resolver_simple*>(resolver.get());
+
+    std::shared_ptr<resolve_state> s;
+    resolve(r, 0, s);
+    ASSERT_TRUE(wait_for([&]() { return s->done.load(); }, 5000));
+    ASSERT_EQ(ERR_OK, s->err);
+
+    // readers resolve while the partition slots are updated, and must
+    // always see an address of the resolved partition
+    const int reader_count = 2;
+    const int resolve_count = 200000;
+    std::atomic<int> finished(0);
+    std::atomic<int> completed(0);
+    std::atomic<int> failed(0);
+    std::atomic<int> invalid(0);
+    for (int i = 0; i < reader_count; i++)
+    {
+        tasking::enqueue(LPC_RESOLVER_TEST_READER, nullptr, [&, i]()
+        {
+            for (int j = 0; j < resolve_count; j++)
+            {
+                r->resolve((uint64_t)(i + j), [&](partition_resolver::resolve_result&& result)
+                    {
+                        if (result.err != ERR_OK)
+                            failed++;
+                        else
+                        {
+                            int port = result.address.port() - result.pid.u.partition_index;
+                            if (result.address.ip() != rpc_address("localhost", 0).ip()
+                                || (port != 30000 && port != 31000)
+                                || result.pid.u.app_id != test_app_id)
+                                invalid++;
+                        }
+                        completed++;
+                    },
+                    5000);
+            }
+            finished++;
+        });
+    }
+
+    int round = 0;
+    while (finished.load() < reader_count)
+    {
+        if (round % test_partition_count == 0)
+            meta.move_primaries(round % (test_partition_count * 2) == 0 ? 31000 : 30000);
+        r->on_access_failure(round % test_partition_count, ERR_TIMEOUT);
+        round++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_TRUE(wait_for([&]() { return completed.load() == reader_count * resolve_count; }, 10000));
+    EXPECT_EQ(0, failed.load());
+    EXPECT_EQ(0, invalid.load());
+}
+
+TEST(dist_uri_resolver_refresh, periodic_refresh)
+{
+    fake_meta meta;
+    partition_resolver_ptr resolver(new partition_resolver_simple(fake_meta_address(), "resolver.test.refresh"));
+    auto r = static_cast<partition_resolver_simple*>(resolver.get());
+
+    std::shared_ptr<resolve_state> s;
+    resolve(r, 0, s);
+    ASSERT_TRUE(wait_for([&]() { return s->done.load(); }, 5000));
+    ASSERT_EQ(1, meta.query_count());
+
+    // changed configurations are known without any access failure
+    meta.move_primaries(31000);
+    ASSERT_TRUE(wait_for([&]() { return meta.query_count() >= 3; }, 5000));
+    for (int i = 0; i < meta.query_count(); i++)
+    {
+        EXPECT_TRUE(meta.query(i).empty());
+    }
+    for (int i = 0; i < test_partition_count; i++)
+    {
+        EXPECT_TRUE(resolved_from_cache(r, i, 31000));
+    }
+}
@@ -0,0 +1,184 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     admission controller which sheds load based on the queueing delay (CoDel)
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "codel_admission_controller.h"
+# include <dsn/tool-api/network.h>
+# include <cmath>
+
+# ifdef __TITLE__
+# undef __TITLE__
+# endif
+# define __TITLE__ "admission.codel"
+
+namespace dsn {
+    namespace tools {
+
+        codel_detector::codel_detector(uint64_t target_ns, uint64_t interval_ns, uint64_t now_ns)
+            : _target_ns(target_ns), _interval_ns(interval_ns), _overloaded_intervals(0)
+        {
+            _interval_end_ns.store(now_ns + interval_ns);
+            _interval_min_ns.store(UINT64_MAX);
+            _last_sojourn_ns.store(0);
+            _overloaded.store(false);
+        }
+
+        bool codel_detector::on_sojourn(uint64_t now_ns, uint64_t sojourn_ns, /*out*/ uint64_t& interval_min_ns)
+        {
+            _last_sojourn_ns.store(sojourn_ns, std::memory_order_relaxed);
+
+            uint64_t min_ns = _interval_min_ns.load(std::memory_order_relaxed);
+            while (sojourn_ns < min_ns
+                && !_interval_min_ns.compare_exchange_weak(min_ns, sojourn_ns, std::memory_order_relaxed))
+            {
+            }
+
+            uint64_t end_ns = _interval_end_ns.load(std::memory_order_relaxed);
+            if (now_ns < end_ns)
+                return false;
+
+            // only one thread closes the interval, others see UINT64_MAX until it is done
+            if (!_interval_end_ns.compare_exchange_strong(end_ns, UINT64_MAX, std::memory_order_acquire))
+                return false;
+
+            min_ns = _interval_min_ns.exchange(UINT64_MAX, std::memory_order_relaxed);
+            bool overloaded = (min_ns != UINT64_MAX && min_ns > _target_ns);
+
+            uint64_t next_ns = _interval_ns;
+            if (overloaded)
+            {
+                _overloaded_intervals++;
+                next_ns = static_cast<uint64_t>(_interval_ns / std::sqrt(static_cast<double>(_overloaded_intervals)));
+                if (next_ns < _target_ns)
+                    next_ns = _target_ns;
+            }
+            else
+            {
+                _overloaded_intervals = 0;
+            }
+
+            _overloaded.store(overloaded, std::memory_order_relaxed);
+            _interval_end_ns.store(now_ns + next_ns, std::memory_order_release);
+
+            interval_min_ns = (min_ns == UINT64_MAX ? 0 : min_ns);
+            return true;
+        }
+
+        // arguments: target_ms interval_ms [reject|delay] [delay_ms]
+        codel_admission_controller::codel_admission_controller(task_queue* q, std::vector<std::string>& sargs)
+            : admission_controller(q, sargs)
+        {
+            int target_ms = sargs.size() > 0 ? atoi(sargs[0].c_str()) : 5;
+            int interval_ms = sargs.size() > 1 ? atoi(sargs[1].c_str()) : 100;
+            std::string mode = sargs.size() > 2 ? sargs[2] : "reject";
+            _delay_ms = sargs.size() > 3 ? atoi(sargs[3].c_str()) : target_ms;
+
+            dassert(target_ms > 0 && interval_ms > target_ms && _delay_ms > 0 && (mode == "reject" || mode == "delay"),
+                "invalid arguments for codel_admission_controller of %s: target_ms interval_ms [reject|delay] [delay_ms]",
+                q->get_name().c_str()
+                );
+
+            _detector.reset(new codel_detector(
+                static_cast<uint64_t>(target_ms) * 1000000ULL,
+                static_cast<uint64_t>(interval_ms) * 1000000ULL,
+                dsn_now_ns()
+                ));
+            _delay_mode = (mode == "delay");
+
+            _min_sojourn_counter = perf_counter::get_counter(q->node_name(), "engine",
+                (q->get_name() + ".codel.min_sojourn_us").c_str(), COUNTER_TYPE_NUMBER,
+                "minimum sojourn time of the tasks in the queue during the last interval", true);
+            _overloaded_counter = perf_counter::get_counter(q->node_name(), "engine",
+                (q->get_name() + ".codel.overloaded").c_str(), COUNTER_TYPE_NUMBER,
+                "whether the queue is overloaded, i.e., minimum sojourn time stays above target", true);
+
+            _reject_counters.reset(new task_code_counters(q->node_name(), (q->get_name() + ".codel.rejected.").c_str(),
+                "how many requests of this task code are rejected or delayed per second"));
+
+            ddebug("codel admission controller of %s: target = %d ms, interval = %d ms, mode = %s",
+                q->get_name().c_str(), target_ms, interval_ms, mode.c_str());
+        }
+
+        codel_admission_controller::~codel_admission_controller()
+        {
+            perf_counter::remove_counter(_min_sojourn_counter->full_name());
+            perf_counter::remove_counter(_overloaded_counter->full_name());
+        }
+
+        bool codel_admission_controller::is_task_accepted(task* task)
+        {
+            if (!_detector->should_shed())
+                return true;
+
+            // the queue is drained, which is not observed by on_task_dequeued yet
+            if (bound_queue()->count() == 0)
+                return true;
+
+            _reject_counters->increment(task);
+
+            if (_delay_mode)
+            {
+                auto session = static_cast<rpc_request_task*>(task)->get_request()->io_session;
+                if (session != nullptr)
+                    session->delay_recv(_delay_ms);
+                return true;
+            }
+            return false;
+        }
+
+        void codel_admission_controller::on_task_dequeued(task* task)
+        {
+            if (task->queue_enter_ts_ns == 0)
+                return;
+
+            uint64_t now = dsn_now_ns();
+            uint64_t sojourn = now > task->queue_enter_ts_ns ? now - task->queue_enter_ts_ns : 0;
+            bool was_overloaded = _detector->is_overloaded();
+
+            uint64_t min_ns;
+            if (_detector->on_sojourn(now, sojourn, min_ns))
+            {
+                bool overloaded = _detector->is_overloaded();
+                _min_sojourn_counter->set(min_ns / 1000);
+                _overloaded_counter->set(overloaded ? 1 : 0);
+
+                if (overloaded && !was_overloaded)
+                {
+                    dwarn("%s is overloaded, minimum sojourn time = %" PRIu64 " us during the last interval",
+                        bound_queue()->get_name().c_str(), min_ns / 1000);
+                }
+            }
+        }
+    }
+}
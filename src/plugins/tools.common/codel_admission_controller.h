@@ -0,0 +1,114 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     admission controller which sheds load based on the queueing delay (CoDel)
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+
+# include <dsn/tool_api.h>
+# include <dsn/tool-api/admission_controller.h>
+# include "task_code_counters.h"
+# include <atomic>
+# include <memory>
+
+namespace dsn {
+    namespace tools {
+
+        //
+        // tracks the minimum sojourn time of the tasks in a queue for each interval,
+        // and decides whether the queue is overloaded, i.e., a standing queue is formed
+        // rather than a burst that drains by itself; thread-safe
+        //
+        class codel_detector
+        {
+        public:
+            codel_detector(uint64_t target_ns, uint64_t interval_ns, uint64_t now_ns);
+
+            // return true when the interval is closed by this call, with its minimum sojourn time
+            bool on_sojourn(uint64_t now_ns, uint64_t sojourn_ns, /*out*/ uint64_t& interval_min_ns);
+
+            bool is_overloaded() const { return _overloaded.load(std::memory_order_relaxed); }
+
+            // overloaded, and the latest tasks are not served in time
+            bool should_shed() const
+            {
+                return _overloaded.load(std::memory_order_relaxed)
+                    && _last_sojourn_ns.load(std::memory_order_relaxed) > 2 * _target_ns;
+            }
+
+        private:
+            uint64_t              _target_ns;
+            uint64_t              _interval_ns;
+
+            std::atomic<uint64_t> _interval_end_ns;
+            std::atomic<uint64_t> _interval_min_ns;
+            std::atomic<uint64_t> _last_sojourn_ns;
+            std::atomic<bool>     _overloaded;
+            int                   _overloaded_intervals; // updated by the interval closer only
+        };
+
+        //
+        // CoDel style admission control, see "Controlling Queue Delay" (Nichols and Jacobson).
+        //
+        // When the minimum sojourn time of the tasks in the bound queue stays above target
+        // for a whole interval, new rpc requests are rejected with ERR_BUSY (or their sessions
+        // are delayed) as long as the latest observed sojourn time is above 2 * target.
+        // The intervals are shortened as interval / sqrt(n) during consecutive overloaded
+        // intervals, as the CoDel control law.
+        //
+        // [threadpool.THREAD_POOL_XXX]
+        // admission_controller_factory_name = dsn::tools::codel_admission_controller
+        // ; target_ms interval_ms [reject|delay] [delay_ms]
+        // admission_controller_arguments = 5 100 reject
+        //
+        class codel_admission_controller : public admission_controller
+        {
+        public:
+            codel_admission_controller(task_queue* q, std::vector<std::string>& sargs);
+            virtual ~codel_admission_controller();
+
+            virtual bool is_task_accepted(task* task) override;
+            virtual void on_task_dequeued(task* task) override;
+
+        private:
+            std::unique_ptr<codel_detector> _detector;
+            bool                  _delay_mode;
+            int                   _delay_ms;
+
+            perf_counter_ptr      _min_sojourn_counter;
+            perf_counter_ptr      _overloaded_counter;
+
+            std::unique_ptr<task_code_counters> _reject_counters;
+        };
+    }
+}
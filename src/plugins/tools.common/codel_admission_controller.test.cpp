@@ -0,0 +1,276 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the codel admission controller.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "codel_admission_controller.h"
+#include <dsn/tool-api/rpc_message.h>
+#include <dsn/cpp/clientlet.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+using namespace dsn;
+using namespace dsn::tools;
+
+// see THREAD_POOL_FOR_CODEL_TEST in test.config.tools.common.ini
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_FOR_CODEL_TEST)
+DEFINE_TASK_CODE(LPC_CODEL_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_FOR_CODEL_TEST)
+DEFINE_TASK_CODE_RPC(RPC_CODEL_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_FOR_CODEL_TEST)
+
+TEST(tools_common, codel_detector)
+{
+    const uint64_t ms = 1000000ULL;
+    uint64_t now = 1000 * ms;
+    uint64_t min_ns;
+
+    // target = 5ms, interval = 100ms
+    codel_detector d(5 * ms, 100 * ms, now);
+    ASSERT_FALSE(d.is_overloaded());
+
+    // a burst with long sojourn time, which drains within the interval
+    ASSERT_FALSE(d.on_sojourn(now + 10 * ms, 50 * ms, min_ns));
+    ASSERT_FALSE(d.on_sojourn(now + 20 * ms, 1 * ms, min_ns));
+    ASSERT_TRUE(d.on_sojourn(now + 100 * ms, 30 * ms, min_ns));
+    ASSERT_EQ(1 * ms, min_ns);
+    ASSERT_FALSE(d.is_overloaded());
+    ASSERT_FALSE(d.should_shed());
+
+    // a standing queue
+    now += 100 * ms;
+    for (int i = 1; i < 10; i++)
+        ASSERT_FALSE(d.on_sojourn(now + i * 10 * ms, 20 * ms, min_ns));
+    ASSERT_TRUE(d.on_sojourn(now + 100 * ms, 20 * ms, min_ns));
+    ASSERT_EQ(20 * ms, min_ns);
+    ASSERT_TRUE(d.is_overloaded());
+    ASSERT_TRUE(d.should_shed());
+
+    // consecutive overloaded intervals are shortened as interval / sqrt(n)
+    now += 100 * ms;
+    ASSERT_FALSE(d.on_sojourn(now + 99 * ms, 20 * ms, min_ns));
+    ASSERT_TRUE(d.on_sojourn(now + 100 * ms, 20 * ms, min_ns));
+    ASSERT_TRUE(d.is_overloaded());
+
+    now += 100 * ms;
+    ASSERT_FALSE(d.on_sojourn(now + 70 * ms, 8 * ms, min_ns));
+    ASSERT_FALSE(d.should_shed());
+    ASSERT_TRUE(d.on_sojourn(now + 71 * ms, 20 * ms, min_ns));
+    ASSERT_EQ(8 * ms, min_ns);
+    ASSERT_TRUE(d.is_overloaded());
+
+    // recovered
+    now += 71 * ms;
+    ASSERT_FALSE(d.on_sojourn(now + 10 * ms, 2 * ms, min_ns));
+    ASSERT_TRUE(d.on_sojourn(now + 100 * ms, 20 * ms, min_ns));
+    ASSERT_EQ(2 * ms, min_ns);
+    ASSERT_FALSE(d.is_overloaded());
+    ASSERT_FALSE(d.should_shed());
+}
+
+// controllers under test are bound to a queue of THREAD_POOL_FOR_CODEL_TEST, with an index
+// beyond the queues of the pool itself so that their counters do not collide
+static const int TEST_QUEUE_INDEX = 100;
+
+class codel_test_queue : public task_queue
+{
+public:
+    codel_test_queue(task_worker_pool* pool) : task_queue(pool, TEST_QUEUE_INDEX, nullptr) {}
+
+    // the tasks are counted only, with increase_count and decrease_count
+    virtual void  enqueue(task* task) override { dassert(false, "not supported"); }
+    virtual task* dequeue(/*inout*/int& batch_size) override { dassert(false, "not supported"); return nullptr; }
+};
+
+// the input queue of the worker of THREAD_POOL_FOR_CODEL_TEST
+static task_queue* get_codel_test_pool_queue()
+{
+    task_queue* q = nullptr;
+    auto t = tasking::enqueue(LPC_CODEL_TEST, nullptr, [&q]() {
+        q = task::get_current_worker()->queue();
+    });
+    t->wait();
+    return q;
+}
+
+static task_worker_pool* get_codel_test_pool()
+{
+    return get_codel_test_pool_queue()->pool();
+}
+
+static void on_codel_test_request(dsn_message_t req, void* param)
+{
+}
+
+// requests are made as received ones, and their replies are captured by the join point below
+static task* create_codel_test_request()
+{
+    static rpc_handler_info* handler = nullptr;
+    if (handler == nullptr)
+    {
+        handler = new rpc_handler_info(RPC_CODEL_TEST);
+        handler->name = "RPC_CODEL_TEST";
+        handler->c_handler = on_codel_test_request;
+        handler->add_ref(); // never released
+    }
+
+    auto msg = dsn_msg_create_request(RPC_CODEL_TEST);
+    auto received = (message_ex*)dsn_msg_copy(msg, true, true);
+    dsn_msg_add_ref(msg);
+    dsn_msg_release_ref(msg);
+
+    // replies to requests without from-address are dropped before the join points
+    received->header->from_address = rpc_address("127.0.0.1", 1);
+    received->to_address = rpc_address(dsn_primary_address());
+
+    handler->add_ref(); // released in run, when the request is executed
+    return new rpc_request_task(received, handler, nullptr);
+}
+
+// error names of the replies
+static std::vector<std::string> s_codel_replies;
+
+static bool on_codel_test_reply(task* caller, message_ex* response)
+{
+    s_codel_replies.push_back(response->header->server.error_name);
+    return false; // drop it
+}
+
+static double get_queue_counter(task_queue& q, const char* name, dsn_perf_counter_type_t type)
+{
+    auto c = perf_counter::get_counter(q.node_name(), "engine", (std::string(q.get_name().c_str()) + name).c_str(), type, "");
+    return c == nullptr ? -1.0 : c->get_value();
+}
+
+static bool has_queue_counter(task_queue& q, const char* name, dsn_perf_counter_type_t type)
+{
+    return nullptr != perf_counter::get_counter(q.node_name(), "engine", (std::string(q.get_name().c_str()) + name).c_str(), type, "");
+}
+
+// feed the controller with tasks staying in the queue for 50 ms, across one interval (20 ms)
+static void overload(codel_admission_controller& c)
+{
+    task_c t(LPC_CODEL_TEST, [](void*) {}, nullptr, nullptr);
+    for (int i = 0; i < 2; i++)
+    {
+        t.queue_enter_ts_ns = dsn_now_ns() - 50000000ULL;
+        c.on_task_dequeued(&t);
+        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    }
+}
+
+TEST(tools_common, codel_admission_controller_reject)
+{
+    codel_test_queue q(get_codel_test_pool());
+    std::vector<std::string> args = { "5", "20", "reject" };
+    codel_admission_controller c(&q, args);
+
+    ref_ptr<task> r(create_codel_test_request());
+    EXPECT_TRUE(c.is_task_accepted(r.get()));
+    EXPECT_DOUBLE_EQ(0.0, get_queue_counter(q, ".codel.overloaded", COUNTER_TYPE_NUMBER));
+
+    overload(c);
+    EXPECT_DOUBLE_EQ(1.0, get_queue_counter(q, ".codel.overloaded", COUNTER_TYPE_NUMBER));
+    EXPECT_GE(get_queue_counter(q, ".codel.min_sojourn_us", COUNTER_TYPE_NUMBER), 50000.0);
+
+    // the queue is drained, which is not observed by the controller yet
+    EXPECT_TRUE(c.is_task_accepted(r.get()));
+    EXPECT_FALSE(has_queue_counter(q, ".codel.rejected.RPC_CODEL_TEST", COUNTER_TYPE_RATE));
+
+    q.increase_count();
+    EXPECT_FALSE(c.is_task_accepted(r.get()));
+    EXPECT_TRUE(has_queue_counter(q, ".codel.rejected.RPC_CODEL_TEST", COUNTER_TYPE_RATE));
+    EXPECT_FALSE(has_queue_counter(q, ".codel.rejected.LPC_CODEL_TEST", COUNTER_TYPE_RATE));
+
+    // recovered when the tasks are served in time again
+    task_c t(LPC_CODEL_TEST, [](void*) {}, nullptr, nullptr);
+    for (int i = 0; i < 2; i++)
+    {
+        t.queue_enter_ts_ns = dsn_now_ns();
+        c.on_task_dequeued(&t);
+        std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    }
+    EXPECT_DOUBLE_EQ(0.0, get_queue_counter(q, ".codel.overloaded", COUNTER_TYPE_NUMBER));
+    EXPECT_TRUE(c.is_task_accepted(r.get()));
+    q.decrease_count();
+}
+
+TEST(tools_common, codel_admission_controller_delay)
+{
+    codel_test_queue q(get_codel_test_pool());
+    std::vector<std::string> args = { "5", "20", "delay", "10" };
+    codel_admission_controller c(&q, args);
+
+    overload(c);
+    q.increase_count();
+
+    // accepted, with the session (if any) delayed, and counted
+    ref_ptr<task> r(create_codel_test_request());
+    EXPECT_TRUE(c.is_task_accepted(r.get()));
+    EXPECT_TRUE(has_queue_counter(q, ".codel.rejected.RPC_CODEL_TEST", COUNTER_TYPE_RATE));
+    q.decrease_count();
+}
+
+TEST(tools_common, codel_admission_controller_in_pool)
+{
+    // the pool has one worker, and its queue is bound to a codel admission controller
+    // with target = 5 ms and interval = 20 ms
+    auto spec = task_spec::get(RPC_CODEL_TEST_ACK);
+    s_codel_replies.clear();
+    ASSERT_TRUE(spec->on_rpc_reply.put_native(on_codel_test_reply));
+    auto& q = *get_codel_test_pool_queue();
+
+    // let the current interval end, so that it is closed by a with a short sojourn time
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+
+    // the worker is blocked by a, so that b waits in the queue for 100 ms, and c for longer
+    auto a = tasking::enqueue(LPC_CODEL_TEST, nullptr, []() { std::this_thread::sleep_for(std::chrono::milliseconds(100)); });
+    auto b = tasking::enqueue(LPC_CODEL_TEST, nullptr, []() { std::this_thread::sleep_for(std::chrono::milliseconds(100)); });
+    auto c = tasking::enqueue(LPC_CODEL_TEST, nullptr, []() {});
+
+    // the sojourn time of b is fed to the controller by the worker when b is dequeued,
+    // which closes the interval as overloaded
+    a->wait();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_DOUBLE_EQ(1.0, get_queue_counter(q, ".codel.overloaded", COUNTER_TYPE_NUMBER));
+
+    // so the requests are rejected with ERR_BUSY while c is still in the queue
+    auto r = create_codel_test_request();
+    r->enqueue();
+    ASSERT_EQ(1u, s_codel_replies.size());
+    EXPECT_EQ(std::string(ERR_BUSY.to_string()), s_codel_replies[0]);
+    EXPECT_TRUE(has_queue_counter(q, ".codel.rejected.RPC_CODEL_TEST", COUNTER_TYPE_RATE));
+
+    b->wait();
+    c->wait();
+    spec->on_rpc_reply.remove("native");
+}
@@ -0,0 +1,513 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cpu time accounting per task code and thread pool
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "cpu_accounting.h"
+# include "shared_io_service.h"
+# include <dsn/tool-api/command.h>
+# include <dsn/tool-api/perf_counter.h>
+# include <dsn/tool-api/task_worker.h>
+# include <dsn/utility/synchronize.h>
+# include <algorithm>
+# include <iomanip>
+# include <sstream>
+
+# ifdef _WIN32
+# include <Windows.h>
+# else
+# include <time.h>
+# include <sys/resource.h>
+# endif
+
+# ifdef __TITLE__
+# undef __TITLE__
+# endif
+# define __TITLE__ "toollet.cpu_accounting"
+
+namespace dsn {
+    namespace tools {
+
+        void sample_thread_cpu(/*out*/ thread_cpu_sample& sample, bool with_context_switches)
+        {
+# ifdef _WIN32
+            FILETIME create_time, exit_time, kernel_time, user_time;
+            if (::GetThreadTimes(::GetCurrentThread(), &create_time, &exit_time, &kernel_time, &user_time))
+            {
+                uint64_t k = ((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime;
+                uint64_t u = ((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime;
+                sample.cpu_ns = (k + u) * 100;
+            }
+            else
+                sample.cpu_ns = 0;
+
+            // not exposed per thread on windows
+            sample.involuntary_switches = 0;
+# else
+            struct timespec ts;
+            if (::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+                sample.cpu_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+            else
+                sample.cpu_ns = 0;
+
+            sample.involuntary_switches = 0;
+#   ifdef RUSAGE_THREAD
+            if (with_context_switches)
+            {
+                struct rusage ru;
+                if (::getrusage(RUSAGE_THREAD, &ru) == 0)
+                    sample.involuntary_switches = (uint64_t)ru.ru_nivcsw;
+            }
+#   endif
+# endif
+        }
+
+        pool_cpu_stats::pool_cpu_stats()
+            : _window_start_ns(0), _window_task_count(0), _window_busy_ns(0), _window_cpu_ns(0), _window_switches(0),
+            _total_task_count(0), _total_busy_ns(0), _total_cpu_ns(0), _total_switches(0)
+        {
+        }
+
+        void pool_cpu_stats::add_task(uint64_t busy_ns, uint64_t cpu_ns, uint64_t involuntary_switches)
+        {
+            _window_task_count.fetch_add(1, std::memory_order_relaxed);
+            _window_busy_ns.fetch_add(busy_ns, std::memory_order_relaxed);
+            _window_cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+            _window_switches.fetch_add(involuntary_switches, std::memory_order_relaxed);
+
+            _total_task_count.fetch_add(1, std::memory_order_relaxed);
+            _total_busy_ns.fetch_add(busy_ns, std::memory_order_relaxed);
+            _total_cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+            _total_switches.fetch_add(involuntary_switches, std::memory_order_relaxed);
+        }
+
+        bool pool_cpu_stats::roll_window(uint64_t now_ns, uint64_t window_ns, int capacity, /*out*/ pool_utilization& result)
+        {
+            uint64_t start = _window_start_ns.load(std::memory_order_relaxed);
+            if (start == 0)
+            {
+                // the first call only opens the window
+                _window_start_ns.compare_exchange_strong(start, now_ns);
+                return false;
+            }
+
+            if (now_ns < start + window_ns)
+                return false;
+
+            if (!_window_start_ns.compare_exchange_strong(start, now_ns))
+                return false;
+
+            // tasks ending from here on are counted in the next window
+            result.capacity = capacity;
+            result.window_ns = now_ns - start;
+            result.task_count = _window_task_count.exchange(0, std::memory_order_relaxed);
+            uint64_t busy_ns = _window_busy_ns.exchange(0, std::memory_order_relaxed);
+            uint64_t cpu_ns = _window_cpu_ns.exchange(0, std::memory_order_relaxed);
+            result.involuntary_switches = _window_switches.exchange(0, std::memory_order_relaxed);
+
+            double total_ns = (double)result.window_ns * (capacity > 0 ? capacity : 1);
+            // a task is charged to the window where it ends, so a long task may push the ratio over 100%
+            result.utilization = std::min(100.0, busy_ns * 100.0 / total_ns);
+            result.cpu_utilization = std::min(100.0, cpu_ns * 100.0 / total_ns);
+            result.idle = 100.0 - result.utilization;
+            return true;
+        }
+
+        //----------------------------------------------------------------------------------------
+
+        struct code_cpu_accounting
+        {
+            bool          enabled;
+            perf_counter* cpu_ns;       // cpu time per task, in percentiles
+            perf_counter* cpu_rate;     // cpu ns consumed per second, i.e., 1e9 means one core
+            perf_counter* switches;     // involuntary context switches per second
+        };
+
+        struct pool_accounting
+        {
+            pool_cpu_stats        stats;
+            int                   worker_count;
+            std::atomic<uint64_t> node_mask;  // nodes whose workers serve this pool
+
+            perf_counter*         utilization;
+            perf_counter*         cpu_utilization;
+            perf_counter*         idle;
+            perf_counter*         switches;
+
+            ::dsn::utils::ex_lock_nr_spin lock;
+            pool_utilization      last;       // protected by lock
+            bool                  has_last;
+        };
+
+        // the samples when the task (or its latest resumption after nested tasks) begins,
+        // plus what the task has consumed before nested tasks preempt it
+        struct cpu_accounting_frame
+        {
+            uint64_t start_wall_ns;
+            uint64_t start_cpu_ns;
+            uint64_t start_switches;
+            uint64_t used_wall_ns;
+            uint64_t used_cpu_ns;
+            uint64_t used_switches;
+        };
+
+        # define MAX_CPU_ACCOUNTING_DEPTH 16
+        struct cpu_accounting_tls
+        {
+            int                  depth;
+            cpu_accounting_frame frames[MAX_CPU_ACCOUNTING_DEPTH];
+        };
+
+        static __thread cpu_accounting_tls s_tls;
+
+        static code_cpu_accounting* s_codes = nullptr;
+        static pool_accounting*     s_pools = nullptr;
+        static int                  s_pool_count = 0;
+        static bool                 s_collect_switches = true;
+        static uint64_t             s_window_ns = 1000000000ULL;
+        static std::shared_ptr<boost::asio::deadline_timer> s_timer;
+
+        static void on_cpu_accounting_task_begin(task* this_)
+        {
+            int depth = s_tls.depth++;
+            if (depth >= MAX_CPU_ACCOUNTING_DEPTH)
+                return;
+
+            thread_cpu_sample sample;
+            sample_thread_cpu(sample, s_collect_switches);
+            uint64_t now = dsn_now_ns();
+
+            if (depth > 0)
+            {
+                // the enclosing task is preempted by this one
+                auto& parent = s_tls.frames[depth - 1];
+                parent.used_wall_ns += now - parent.start_wall_ns;
+                parent.used_cpu_ns += sample.cpu_ns - parent.start_cpu_ns;
+                parent.used_switches += sample.involuntary_switches - parent.start_switches;
+            }
+
+            auto& frame = s_tls.frames[depth];
+            frame.start_wall_ns = now;
+            frame.start_cpu_ns = sample.cpu_ns;
+            frame.start_switches = sample.involuntary_switches;
+            frame.used_wall_ns = 0;
+            frame.used_cpu_ns = 0;
+            frame.used_switches = 0;
+        }
+
+        static void on_cpu_accounting_task_end(task* this_)
+        {
+            int depth = --s_tls.depth;
+            if (depth >= MAX_CPU_ACCOUNTING_DEPTH || depth < 0)
+            {
+                if (depth < 0)
+                    s_tls.depth = 0;
+                return;
+            }
+
+            thread_cpu_sample sample;
+            sample_thread_cpu(sample, s_collect_switches);
+            uint64_t now = dsn_now_ns();
+
+            auto& frame = s_tls.frames[depth];
+            uint64_t wall_ns = frame.used_wall_ns + (now - frame.start_wall_ns);
+            uint64_t cpu_ns = frame.used_cpu_ns + (sample.cpu_ns - frame.start_cpu_ns);
+            uint64_t switches = frame.used_switches + (sample.involuntary_switches - frame.start_switches);
+
+            if (depth > 0)
+            {
+                // the enclosing task resumes
+                auto& parent = s_tls.frames[depth - 1];
+                parent.start_wall_ns = now;
+                parent.start_cpu_ns = sample.cpu_ns;
+                parent.start_switches = sample.involuntary_switches;
+            }
+
+            auto& code = s_codes[this_->spec().code];
+            if (code.enabled)
+            {
+                code.cpu_ns->set(cpu_ns);
+                code.cpu_rate->add(cpu_ns);
+                if (switches > 0)
+                    code.switches->add(switches);
+            }
+
+            // utilization is about the threads, so the time is charged to the pool of the current
+            // worker, or the pool of the task when it runs inline in a non-worker thread
+            auto worker = task::get_current_worker2();
+            dsn_threadpool_code_t pool_code = worker ? worker->pool_spec().pool_code : this_->spec().pool_code;
+            if (pool_code < 0 || pool_code >= s_pool_count)
+                return;
+
+            auto& pool = s_pools[pool_code];
+            pool.stats.add_task(wall_ns, cpu_ns, switches);
+
+            int node_id = task::get_current_node_id();
+            if (node_id > 0)
+            {
+                uint64_t bit = 1ULL << ((node_id - 1) % 64);
+                if ((pool.node_mask.load(std::memory_order_relaxed) & bit) == 0)
+                    pool.node_mask.fetch_or(bit, std::memory_order_relaxed);
+            }
+        }
+
+        static int pool_capacity(pool_accounting& pool)
+        {
+            uint64_t mask = pool.node_mask.load(std::memory_order_relaxed);
+            int nodes = 0;
+            for (; mask != 0; mask &= mask - 1)
+                nodes++;
+            return pool.worker_count * (nodes > 0 ? nodes : 1);
+        }
+
+        static void roll_pool_windows()
+        {
+            uint64_t now = dsn_now_ns();
+            for (int i = 0; i < s_pool_count; i++)
+            {
+                auto& pool = s_pools[i];
+                if (pool.utilization == nullptr)
+                    continue;
+
+                pool_utilization u;
+                if (!pool.stats.roll_window(now, s_window_ns, pool_capacity(pool), u))
+                    continue;
+
+                pool.utilization->set((uint64_t)(u.utilization + 0.5));
+                pool.cpu_utilization->set((uint64_t)(u.cpu_utilization + 0.5));
+                pool.idle->set((uint64_t)(u.idle + 0.5));
+                if (u.involuntary_switches > 0)
+                    pool.switches->add(u.involuntary_switches);
+
+                ::dsn::utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(pool.lock);
+                pool.last = u;
+                pool.has_last = true;
+            }
+        }
+
+        static void on_cpu_accounting_timer(const boost::system::error_code& ec)
+        {
+            if (ec)
+                return;
+
+            roll_pool_windows();
+
+            s_timer->expires_from_now(boost::posix_time::microseconds(s_window_ns / 1000));
+            s_timer->async_wait(on_cpu_accounting_timer);
+        }
+
+        safe_string pool_utilization_command(const safe_vector<safe_string>& args)
+        {
+            if (s_pools == nullptr)
+                return "cpu_accounting toollet is not enabled";
+
+            if (args.size() > 1)
+                return "invalid arguments, usage: pool.utilization [pool_name]";
+
+            std::stringstream ss;
+            ss << "window = " << s_window_ns / 1000000 << " ms" << std::endl;
+            ss << std::left << std::setw(32) << "pool"
+                << std::right
+                << std::setw(8) << "workers"
+                << std::setw(10) << "util(%)"
+                << std::setw(10) << "cpu(%)"
+                << std::setw(10) << "idle(%)"
+                << std::setw(12) << "tasks/s"
+                << std::setw(12) << "nivcsw/s"
+                << std::setw(16) << "total.cpu(ms)"
+                << std::setw(16) << "total.busy(ms)"
+                << std::setw(16) << "total.nivcsw"
+                << std::endl;
+
+            ss << std::fixed << std::setprecision(1);
+            bool found = false;
+            for (int i = 0; i < s_pool_count; i++)
+            {
+                auto& pool = s_pools[i];
+                if (pool.utilization == nullptr)
+                    continue;
+
+                const char* name = dsn_threadpool_code_to_string(i);
+                if (args.size() == 1)
+                {
+                    if (args[0] != name)
+                        continue;
+                }
+                else if (pool.stats.total_task_count() == 0)
+                {
+                    // pools not started (or not used) by any node
+                    continue;
+                }
+                found = true;
+
+                pool_utilization u;
+                bool has_last;
+                {
+                    ::dsn::utils::auto_lock< ::dsn::utils::ex_lock_nr_spin> l(pool.lock);
+                    u = pool.last;
+                    has_last = pool.has_last;
+                }
+
+                ss << std::left << std::setw(32) << name << std::right;
+                if (has_last)
+                {
+                    double seconds = u.window_ns / 1e9;
+                    ss << std::setw(8) << u.capacity
+                        << std::setw(10) << u.utilization
+                        << std::setw(10) << u.cpu_utilization
+                        << std::setw(10) << u.idle
+                        << std::setw(12) << u.task_count / seconds
+                        << std::setw(12) << u.involuntary_switches / seconds;
+                }
+                else
+                {
+                    ss << std::setw(8) << pool_capacity(pool)
+                        << std::setw(10) << "-"
+                        << std::setw(10) << "-"
+                        << std::setw(10) << "-"
+                        << std::setw(12) << "-"
+                        << std::setw(12) << "-";
+                }
+                ss << std::setw(16) << pool.stats.total_cpu_ns() / 1000000
+                    << std::setw(16) << pool.stats.total_busy_ns() / 1000000
+                    << std::setw(16) << pool.stats.total_involuntary_switches()
+                    << std::endl;
+            }
+
+            if (args.size() == 1 && !found)
+                return safe_string("pool ") + args[0] + " is not found";
+
+            auto r = ss.str();
+            return safe_string(r.c_str(), r.length());
+        }
+
+        void cpu_accounting::install(service_spec& spec)
+        {
+            s_window_ns = dsn_config_get_value_uint64("tools.cpu_accounting", "window_ms", 1000,
+                "window for the pool utilization counters") * 1000000ULL;
+            if (s_window_ns == 0)
+                s_window_ns = 1000000000ULL;
+            s_collect_switches = dsn_config_get_value_bool("tools.cpu_accounting", "collect_context_switches", true,
+                "whether to sample the involuntary context switches, which costs one more syscall per task");
+
+            auto enabled = dsn_config_get_value_bool("task..default", "is_cpu_accounting", true,
+                "whether to collect the cpu time of this kind of task");
+
+            s_codes = new code_cpu_accounting[dsn_task_code_max() + 1];
+            for (int i = 0; i <= dsn_task_code_max(); i++)
+            {
+                auto& code = s_codes[i];
+                code.enabled = false;
+                code.cpu_ns = code.cpu_rate = code.switches = nullptr;
+
+                if (i == TASK_CODE_INVALID)
+                    continue;
+
+                std::string name(dsn_task_code_to_string(i));
+                std::string section_name = std::string("task.") + name;
+                task_spec* tspec = task_spec::get(i);
+                dassert(tspec != nullptr, "task_spec cannot be null");
+
+                // pool accounting needs all tasks, so the hooks are always installed
+                tspec->on_task_begin.put_back(on_cpu_accounting_task_begin, "cpu_accounting");
+                tspec->on_task_end.put_back(on_cpu_accounting_task_end, "cpu_accounting");
+
+                code.enabled = dsn_config_get_value_bool(section_name.c_str(), "is_cpu_accounting", enabled,
+                    "whether to collect the cpu time of this kind of task");
+                if (!code.enabled)
+                    continue;
+
+                // raw pointers are kept for the hot path, with a reference so that the counters won't go
+                code.cpu_ns = perf_counter::get_counter("tools", "cpu_accounting", (name + ".cpu(ns)").c_str(),
+                    COUNTER_TYPE_NUMBER_PERCENTILES, "cpu time of the task", true).get();
+                code.cpu_rate = perf_counter::get_counter("tools", "cpu_accounting", (name + ".cpu.rate(ns/s)").c_str(),
+                    COUNTER_TYPE_RATE, "cpu time consumed by this kind of tasks per second", true).get();
+                code.switches = perf_counter::get_counter("tools", "cpu_accounting", (name + ".nivcsw(#/s)").c_str(),
+                    COUNTER_TYPE_RATE, "involuntary context switches when running this kind of tasks", true).get();
+                code.cpu_ns->add_ref();
+                code.cpu_rate->add_ref();
+                code.switches->add_ref();
+            }
+
+            s_pool_count = dsn_threadpool_code_max() + 1;
+            s_pools = new pool_accounting[s_pool_count];
+            for (int i = 0; i < s_pool_count; i++)
+            {
+                auto& pool = s_pools[i];
+                pool.worker_count = 0;
+                pool.node_mask.store(0);
+                pool.utilization = pool.cpu_utilization = pool.idle = pool.switches = nullptr;
+                pool.has_last = false;
+                memset(&pool.last, 0, sizeof(pool.last));
+
+                if (i >= (int)spec.threadpool_specs.size() || spec.threadpool_specs[i].name.empty())
+                    continue;
+
+                auto& pspec = spec.threadpool_specs[i];
+                pool.worker_count = pspec.worker_count;
+
+                std::string name(pspec.name.c_str());
+                pool.utilization = perf_counter::get_counter("tools", "cpu_accounting", (name + ".utilization(%)").c_str(),
+                    COUNTER_TYPE_NUMBER, "fraction of worker time spent in tasks", true).get();
+                pool.cpu_utilization = perf_counter::get_counter("tools", "cpu_accounting", (name + ".cpu.utilization(%)").c_str(),
+                    COUNTER_TYPE_NUMBER, "fraction of worker time spent on cpu in tasks", true).get();
+                pool.idle = perf_counter::get_counter("tools", "cpu_accounting", (name + ".idle(%)").c_str(),
+                    COUNTER_TYPE_NUMBER, "fraction of worker time spent waiting for tasks", true).get();
+                pool.switches = perf_counter::get_counter("tools", "cpu_accounting", (name + ".nivcsw(#/s)").c_str(),
+                    COUNTER_TYPE_RATE, "involuntary context switches of the pool workers", true).get();
+                pool.utilization->add_ref();
+                pool.cpu_utilization->add_ref();
+                pool.idle->add_ref();
+                pool.switches->add_ref();
+            }
+
+            // open the windows, and roll them on a timer so that idle pools are refreshed as well
+            roll_pool_windows();
+            s_timer.reset(new boost::asio::deadline_timer(shared_io_service::instance().ios));
+            s_timer->expires_from_now(boost::posix_time::microseconds(s_window_ns / 1000));
+            s_timer->async_wait(on_cpu_accounting_timer);
+
+            ::dsn::register_command(
+                "pool.utilization",
+                "pool.utilization - show the utilization, cpu utilization and idle ratio of the thread pools",
+                "pool.utilization [pool_name]: numbers of the last window, plus the totals since start",
+                pool_utilization_command
+                );
+        }
+
+        cpu_accounting::cpu_accounting(const char* name)
+            : toollet(name)
+        {
+        }
+    }
+}
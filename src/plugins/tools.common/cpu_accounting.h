@@ -0,0 +1,150 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     cpu time accounting per task code and thread pool
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/tool_api.h>
+#include <atomic>
+
+/*!
+@defgroup cpu-accounting CPU Accounting
+@ingroup tools
+
+CPU accounting toollet
+
+The profiler measures the wall time between task begin and task end, which also
+counts the time a task is blocked (on locks, disk, waiting for other tasks, or
+preempted). This toollet samples the per-thread cpu clock (and the involuntary
+context switch count) at the task boundaries instead, so that for each task code
+we know how much cpu it really burns, and for each thread pool we know
+
+- utilization: the fraction of worker time spent inside tasks,
+- cpu utilization: the fraction of worker time spent on cpu inside tasks,
+- idle: the fraction of worker time spent outside tasks (waiting for work).
+
+A pool with high utilization but low cpu utilization is blocked a lot, and more
+workers may help; a pool with low utilization is over-provisioned. The values
+are computed per window and exposed as perf counters and via the
+"pool.utilization" command.
+
+When tasks run nested (e.g., inline execution), the cpu time is charged to the
+innermost task only.
+
+<PRE>
+
+[core]
+
+toollets = cpu_accounting
+
+[tools.cpu_accounting]
+; window for the pool utilization counters
+window_ms = 1000
+; whether to sample the involuntary context switches, which costs one more syscall per task
+collect_context_switches = true
+
+[task..default]
+is_cpu_accounting = true
+
+[task.RPC_PING]
+is_cpu_accounting = false
+
+</PRE>
+*/
+
+namespace dsn {
+    namespace tools {
+
+        struct thread_cpu_sample
+        {
+            uint64_t cpu_ns;
+            uint64_t involuntary_switches;
+        };
+
+        // sample the cpu time and (optionally) the involuntary context switches of the calling thread
+        extern void sample_thread_cpu(/*out*/ thread_cpu_sample& sample, bool with_context_switches);
+
+        struct pool_utilization
+        {
+            int      capacity;     // workers assumed to serve the pool in the window
+            uint64_t window_ns;
+            uint64_t task_count;
+            double   utilization;  // busy time / (capacity * window), in percentage
+            double   cpu_utilization;
+            double   idle;
+            uint64_t involuntary_switches;
+        };
+
+        //
+        // the accounting of one thread pool, updated by its workers at task end with
+        // atomic adds, and rolled into a pool_utilization window by any of them
+        //
+        class pool_cpu_stats
+        {
+        public:
+            pool_cpu_stats();
+
+            void add_task(uint64_t busy_ns, uint64_t cpu_ns, uint64_t involuntary_switches);
+
+            // close the current window if it started at least window_ns before now,
+            // return false if the window is not yet due or another thread closes it
+            bool roll_window(uint64_t now_ns, uint64_t window_ns, int capacity, /*out*/ pool_utilization& result);
+
+            // since the accounting starts
+            uint64_t total_task_count() const { return _total_task_count.load(std::memory_order_relaxed); }
+            uint64_t total_busy_ns() const { return _total_busy_ns.load(std::memory_order_relaxed); }
+            uint64_t total_cpu_ns() const { return _total_cpu_ns.load(std::memory_order_relaxed); }
+            uint64_t total_involuntary_switches() const { return _total_switches.load(std::memory_order_relaxed); }
+
+        private:
+            std::atomic<uint64_t> _window_start_ns;
+            std::atomic<uint64_t> _window_task_count;
+            std::atomic<uint64_t> _window_busy_ns;
+            std::atomic<uint64_t> _window_cpu_ns;
+            std::atomic<uint64_t> _window_switches;
+
+            std::atomic<uint64_t> _total_task_count;
+            std::atomic<uint64_t> _total_busy_ns;
+            std::atomic<uint64_t> _total_cpu_ns;
+            std::atomic<uint64_t> _total_switches;
+        };
+
+        class cpu_accounting : public toollet
+        {
+        public:
+            cpu_accounting(const char* name);
+            virtual void install(service_spec& spec);
+        };
+    }
+}
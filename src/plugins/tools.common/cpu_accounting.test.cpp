@@ -0,0 +1,216 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the cpu accounting toollet.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "cpu_accounting.h"
+#include <dsn/cpp/clientlet.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+using namespace dsn;
+using namespace dsn::tools;
+
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_FOR_TEST_1)
+DEFINE_THREAD_POOL_CODE(THREAD_POOL_FOR_TEST_2)
+DEFINE_TASK_CODE(LPC_CPU_ACCOUNTING_TEST_1, TASK_PRIORITY_COMMON, THREAD_POOL_FOR_TEST_1)
+DEFINE_TASK_CODE(LPC_CPU_ACCOUNTING_TEST_2, TASK_PRIORITY_COMMON, THREAD_POOL_FOR_TEST_2)
+
+TEST(tools_common, cpu_accounting_thread_cpu)
+{
+    thread_cpu_sample s1, s2, s3;
+    sample_thread_cpu(s1, true);
+
+    // sleeping burns (almost) no cpu
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sample_thread_cpu(s2, true);
+    EXPECT_LT(s2.cpu_ns - s1.cpu_ns, 20000000u);
+    EXPECT_GE(s2.involuntary_switches, s1.involuntary_switches);
+
+    // spinning does
+    auto start = std::chrono::steady_clock::now();
+    volatile uint64_t x = 0;
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50))
+        x = x + 1;
+    sample_thread_cpu(s3, false);
+    EXPECT_GT(s3.cpu_ns - s2.cpu_ns, 20000000u);
+    EXPECT_EQ(0u, s3.involuntary_switches);
+}
+
+TEST(tools_common, cpu_accounting_pool_window)
+{
+    const uint64_t ms = 1000000;
+    pool_cpu_stats stats;
+    pool_utilization u;
+
+    // the first roll opens the window
+    EXPECT_FALSE(stats.roll_window(1000 * ms, 100 * ms, 4, u));
+
+    stats.add_task(100 * ms, 50 * ms, 2);
+    stats.add_task(60 * ms, 30 * ms, 1);
+    EXPECT_FALSE(stats.roll_window(1050 * ms, 100 * ms, 4, u));
+
+    // 4 workers in 100 ms: 160 ms busy, 80 ms on cpu
+    EXPECT_TRUE(stats.roll_window(1100 * ms, 100 * ms, 4, u));
+    EXPECT_EQ(4, u.capacity);
+    EXPECT_EQ(100 * ms, u.window_ns);
+    EXPECT_EQ(2u, u.task_count);
+    EXPECT_DOUBLE_EQ(40.0, u.utilization);
+    EXPECT_DOUBLE_EQ(20.0, u.cpu_utilization);
+    EXPECT_DOUBLE_EQ(60.0, u.idle);
+    EXPECT_EQ(3u, u.involuntary_switches);
+
+    // an empty window is all idle, while the totals are kept
+    EXPECT_TRUE(stats.roll_window(1300 * ms, 100 * ms, 4, u));
+    EXPECT_EQ(200 * ms, u.window_ns);
+    EXPECT_EQ(0u, u.task_count);
+    EXPECT_DOUBLE_EQ(100.0, u.idle);
+    EXPECT_EQ(2u, stats.total_task_count());
+    EXPECT_EQ(160 * ms, stats.total_busy_ns());
+    EXPECT_EQ(80 * ms, stats.total_cpu_ns());
+    EXPECT_EQ(3u, stats.total_involuntary_switches());
+}
+
+// burn the given cpu time in the calling thread
+static void burn_cpu(uint64_t ms)
+{
+    thread_cpu_sample start, now;
+    sample_thread_cpu(start, false);
+    do
+    {
+        sample_thread_cpu(now, false);
+    } while (now.cpu_ns - start.cpu_ns < ms * 1000000);
+}
+
+struct pool_row
+{
+    int      workers;
+    bool     has_window;
+    uint64_t total_cpu_ms;
+    uint64_t total_busy_ms;
+};
+
+// parse the output of "pool.utilization <pool_name>"
+static bool query_pool(const char* pool_name, /*out*/ pool_row& row)
+{
+    std::string command = std::string("pool.utilization ") + pool_name;
+    auto output = dsn_cli_run(command.c_str());
+    std::stringstream ss(output);
+    dsn_cli_free(output);
+
+    std::string line;
+    std::getline(ss, line);
+    if (line.compare(0, 9, "window = ") != 0)
+        return false;
+    std::getline(ss, line); // column names
+    std::getline(ss, line);
+
+    // pool, workers, util, cpu, idle, tasks/s, nivcsw/s, total.cpu, total.busy, total.nivcsw
+    std::stringstream cs(line);
+    std::vector<std::string> columns;
+    std::string c;
+    while (cs >> c)
+        columns.push_back(c);
+    if (columns.size() != 10 || columns[0] != pool_name)
+        return false;
+
+    row.workers = atoi(columns[1].c_str());
+    row.has_window = (columns[2] != "-");
+    row.total_cpu_ms = strtoull(columns[7].c_str(), nullptr, 10);
+    row.total_busy_ms = strtoull(columns[8].c_str(), nullptr, 10);
+    return true;
+}
+
+TEST(tools_common, cpu_accounting_hooks)
+{
+    pool_row p1_before, p2_before, p1, p2;
+    ASSERT_TRUE(query_pool("THREAD_POOL_FOR_TEST_1", p1_before));
+    ASSERT_TRUE(query_pool("THREAD_POOL_FOR_TEST_2", p2_before));
+
+    // a task of pool 2 runs nested in a task of pool 1, the cpu is charged exclusively
+    // (100 ms to the outer task and 100 ms to the inner one), and all to pool 1 whose
+    // worker runs them
+    auto t = tasking::enqueue(LPC_CPU_ACCOUNTING_TEST_1, nullptr, []() {
+        burn_cpu(50);
+        auto inner = new task_c(LPC_CPU_ACCOUNTING_TEST_2, [](void*) { burn_cpu(100); }, nullptr, nullptr);
+        inner->add_ref(); // released in exec_internal
+        inner->exec_internal();
+        burn_cpu(50);
+    });
+    t->wait();
+
+    ASSERT_TRUE(query_pool("THREAD_POOL_FOR_TEST_1", p1));
+    ASSERT_TRUE(query_pool("THREAD_POOL_FOR_TEST_2", p2));
+    EXPECT_GE(p1.total_cpu_ms - p1_before.total_cpu_ms, 198u);
+    EXPECT_LT(p1.total_cpu_ms - p1_before.total_cpu_ms, 290u); // 300 if the inner task is charged twice
+    EXPECT_GE(p1.total_busy_ms - p1_before.total_busy_ms, 198u);
+    EXPECT_EQ(p2_before.total_cpu_ms, p2.total_cpu_ms);
+    EXPECT_EQ(p2_before.total_busy_ms, p2.total_busy_ms);
+
+    // a task running inline in a non-worker thread is charged to its own pool
+    auto node = task::get_current_node();
+    auto inline_task = new task_c(LPC_CPU_ACCOUNTING_TEST_2, [](void*) { burn_cpu(50); }, nullptr, nullptr);
+    inline_task->add_ref(); // released in exec_internal
+    std::thread th([node, inline_task]() {
+        task::set_tls_dsn_context(node, nullptr, nullptr);
+        inline_task->exec_internal();
+    });
+    th.join();
+
+    p1_before = p1;
+    p2_before = p2;
+    ASSERT_TRUE(query_pool("THREAD_POOL_FOR_TEST_1", p1));
+    ASSERT_TRUE(query_pool("THREAD_POOL_FOR_TEST_2", p2));
+    EXPECT_EQ(p1_before.total_cpu_ms, p1.total_cpu_ms);
+    EXPECT_GE(p2.total_cpu_ms - p2_before.total_cpu_ms, 48u);
+    EXPECT_LT(p2.total_cpu_ms - p2_before.total_cpu_ms, 100u);
+
+    // the windows are rolled by the timer (window_ms = 100 in the config)
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_TRUE(query_pool("THREAD_POOL_FOR_TEST_1", p1));
+    EXPECT_TRUE(p1.has_window);
+    EXPECT_EQ(2, p1.workers);
+
+    // all pools with tasks are listed without pool name
+    auto output = dsn_cli_run("pool.utilization");
+    std::string all(output);
+    dsn_cli_free(output);
+    EXPECT_NE(std::string::npos, all.find("THREAD_POOL_FOR_TEST_1"));
+    EXPECT_NE(std::string::npos, all.find("THREAD_POOL_FOR_TEST_2"));
+
+    output = dsn_cli_run("pool.utilization THREAD_POOL_NOT_EXIST");
+    EXPECT_EQ(std::string("pool THREAD_POOL_NOT_EXIST is not found"), std::string(output));
+    dsn_cli_free(output);
+}
@@ -0,0 +1,151 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     task queue which schedules rpc requests by their deadlines (EDF)
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "deadline_task_queue.h"
+# include <dsn/tool-api/rpc_message.h>
+
+# ifdef __TITLE__
+# undef __TITLE__
+# endif
+# define __TITLE__ "task.queue.deadline"
+
+namespace dsn
+{
+    namespace tools
+    {
+        deadline_task_queue::deadline_task_queue(task_worker_pool* pool, int index, task_queue* inner_provider)
+            : task_queue(pool, index, inner_provider), _sequence(0),
+            _expired_counters(node_name(), (get_name() + ".queue.expired.").c_str(),
+                "how many requests of this task code are dropped per second as their deadlines are passed")
+        {
+        }
+
+        void deadline_task_queue::enqueue(task* task)
+        {
+            uint64_t now = dsn_now_ns();
+
+            entry e;
+            e.deadline_ns = 0;
+            e.order_ns = now;
+            e.t = task;
+            if (task->spec().type == TASK_TYPE_RPC_REQUEST)
+            {
+                auto timeout_ms = static_cast<rpc_request_task*>(task)->get_request()->header->client.timeout_ms;
+                if (timeout_ms > 0)
+                {
+                    e.deadline_ns = now + static_cast<uint64_t>(timeout_ms) * 1000000ULL;
+                    e.order_ns = e.deadline_ns;
+                }
+            }
+
+            int priority = static_cast<int>(task->spec().priority);
+            std::vector<dsn::task*> expired;
+            {
+                utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+                e.sequence = _sequence++;
+                pop_expired(priority, now, expired);
+                _queues[priority].push(e);
+            }
+            _sema.signal();
+
+            if (!expired.empty())
+                drop_expired(expired);
+        }
+
+        // always return 1 task so far
+        task* deadline_task_queue::dequeue(/*inout*/int& batch_size)
+        {
+            std::vector<task*> expired;
+            task* t = nullptr;
+
+            // the semaphore is signaled for each enqueued task, so the count may
+            // be more than the tasks when expired ones are dropped on enqueue
+            while (t == nullptr)
+            {
+                _sema.wait();
+
+                uint64_t now = dsn_now_ns();
+                utils::auto_lock<utils::ex_lock_nr_spin> l(_lock);
+                for (int priority = TASK_PRIORITY_COUNT - 1; priority >= 0; priority--)
+                {
+                    pop_expired(priority, now, expired);
+                    if (!_queues[priority].empty())
+                    {
+                        t = _queues[priority].top().t;
+                        _queues[priority].pop();
+                        break;
+                    }
+                }
+            }
+
+            if (!expired.empty())
+                drop_expired(expired);
+
+            batch_size = 1;
+            return t;
+        }
+
+        void deadline_task_queue::pop_expired(int priority, uint64_t now_ns, /*out*/ std::vector<task*>& expired)
+        {
+            auto& q = _queues[priority];
+            while (!q.empty() && q.top().deadline_ns != 0 && q.top().deadline_ns <= now_ns)
+            {
+                expired.push_back(q.top().t);
+                q.pop();
+            }
+        }
+
+        void deadline_task_queue::drop_expired(std::vector<task*>& expired)
+        {
+            for (auto t : expired)
+            {
+                auto rtask = static_cast<rpc_request_task*>(t);
+                auto resp = rtask->get_request()->create_response();
+                dsn_rpc_reply(resp, ERR_TIMEOUT);
+
+                dinfo("%s: drop expired request %s from %s with trace_id = %016" PRIx64,
+                    get_name().c_str(),
+                    t->spec().name.c_str(),
+                    rtask->get_request()->header->from_address.to_string(),
+                    rtask->get_request()->header->trace_id
+                    );
+
+                _expired_counters.increment(t);
+                decrease_count();
+                t->release_ref(); // added in task::enqueue(pool)
+            }
+        }
+    }
+}
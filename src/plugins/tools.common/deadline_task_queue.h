@@ -0,0 +1,100 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     task queue which schedules rpc requests by their deadlines (EDF)
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+
+# include <dsn/tool_api.h>
+# include <dsn/utility/synchronize.h>
+# include "task_code_counters.h"
+# include <queue>
+# include <vector>
+
+namespace dsn {
+    namespace tools {
+
+        //
+        // Tasks of the same priority are executed in the order of their deadlines (earliest
+        // deadline first). The deadline of an rpc request is its enqueue time plus the timeout
+        // of the client (header->client.timeout_ms); other tasks (and requests without timeout)
+        // use their enqueue time, i.e., they are executed before the requests enqueued at the
+        // same time, and remain FIFO among themselves.
+        //
+        // Expired requests, whose clients have given up, are replied with ERR_TIMEOUT and
+        // dropped when they reach the head of the queue, at both enqueue and dequeue.
+        //
+        // [threadpool.THREAD_POOL_XXX]
+        // queue_factory_name = dsn::tools::deadline_task_queue
+        //
+        class deadline_task_queue : public task_queue
+        {
+        public:
+            deadline_task_queue(task_worker_pool* pool, int index, task_queue* inner_provider);
+
+            virtual void     enqueue(task* task) override;
+            virtual task*    dequeue(/*inout*/int& batch_size) override;
+
+        private:
+            struct entry
+            {
+                uint64_t deadline_ns; // 0 for tasks without deadline
+                uint64_t order_ns;    // ordering key
+                uint64_t sequence;    // FIFO for the same key
+                task*    t;
+            };
+
+            struct entry_later
+            {
+                bool operator()(const entry& l, const entry& r) const
+                {
+                    return l.order_ns != r.order_ns ? l.order_ns > r.order_ns : l.sequence > r.sequence;
+                }
+            };
+
+            typedef std::priority_queue<entry, std::vector<entry>, entry_later> edf_queue;
+
+            // pop the expired heads of the given priority, must be called with _lock held
+            void pop_expired(int priority, uint64_t now_ns, /*out*/ std::vector<task*>& expired);
+            void drop_expired(std::vector<task*>& expired);
+
+        private:
+            mutable utils::ex_lock_nr_spin _lock;
+            edf_queue                      _queues[TASK_PRIORITY_COUNT];
+            uint64_t                       _sequence;
+            utils::semaphore               _sema;
+
+            task_code_counters             _expired_counters;
+        };
+    }
+}
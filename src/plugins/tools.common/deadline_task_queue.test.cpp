@@ -0,0 +1,245 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the deadline task queue.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "deadline_task_queue.h"
+#include <dsn/tool-api/rpc_message.h>
+#include <dsn/cpp/clientlet.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+using namespace dsn;
+using namespace dsn::tools;
+
+DEFINE_TASK_CODE(LPC_DEADLINE_QUEUE_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE(LPC_DEADLINE_QUEUE_TEST_LOW, TASK_PRIORITY_LOW, THREAD_POOL_DEFAULT)
+DEFINE_TASK_CODE_RPC(RPC_DEADLINE_QUEUE_TEST, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+// the tested queue is attached to THREAD_POOL_DEFAULT of the test node, with an index
+// beyond the queues of the pool itself so that their counters do not collide
+static const int TEST_QUEUE_INDEX = 100;
+
+static task_worker_pool* get_default_pool()
+{
+    task_worker_pool* pool = nullptr;
+    auto t = tasking::enqueue(LPC_DEADLINE_QUEUE_TEST, nullptr, [&pool]() {
+        pool = task::get_current_worker()->pool();
+    });
+    t->wait();
+    return pool;
+}
+
+// replies of the expired requests, as <trace_id, error_name>
+static std::vector<std::pair<uint64_t, std::string>> s_replies;
+
+static bool on_test_reply(task* caller, message_ex* response)
+{
+    s_replies.emplace_back(response->header->trace_id, response->header->server.error_name);
+    return false; // drop it
+}
+
+class deadline_queue_tester
+{
+public:
+    deadline_queue_tester()
+        : _queue(get_default_pool(), TEST_QUEUE_INDEX, nullptr), _handler(RPC_DEADLINE_QUEUE_TEST)
+    {
+        // the replies are captured and dropped by the join point, which runs together
+        // with the default aspects (e.g., the tracer and the profiler) of the test config
+        s_replies.clear();
+        _reply_hooked = task_spec::get(RPC_DEADLINE_QUEUE_TEST_ACK)->on_rpc_reply.put_native(on_test_reply);
+    }
+
+    ~deadline_queue_tester()
+    {
+        if (_reply_hooked)
+            task_spec::get(RPC_DEADLINE_QUEUE_TEST_ACK)->on_rpc_reply.remove("native");
+    }
+
+    deadline_task_queue& queue() { return _queue; }
+    bool reply_hooked() const { return _reply_hooked; }
+
+    task* create_task(dsn_task_code_t code)
+    {
+        return new task_c(code, [](void*) {}, nullptr, nullptr);
+    }
+
+    // timeout_ms = 0 for requests without deadline
+    task* create_request(int timeout_ms)
+    {
+        auto msg = dsn_msg_create_request(RPC_DEADLINE_QUEUE_TEST);
+        auto received = (message_ex*)dsn_msg_copy(msg, true, true);
+        dsn_msg_add_ref(msg);
+        dsn_msg_release_ref(msg);
+
+        // replies to requests without from-address are dropped before the join points
+        received->header->client.timeout_ms = timeout_ms;
+        received->header->from_address = rpc_address("127.0.0.1", 1);
+        received->to_address = rpc_address(dsn_primary_address());
+        return new rpc_request_task(received, &_handler, nullptr);
+    }
+
+    // as task_worker_pool does
+    void enqueue(task* t)
+    {
+        t->add_ref();
+        _queue.increase_count();
+        _queue.enqueue(t);
+    }
+
+    // as task_worker does, the returned task is released
+    task* dequeue()
+    {
+        int batch_size = 1;
+        task* t = _queue.dequeue(batch_size);
+        EXPECT_EQ(1, batch_size);
+        _queue.decrease_count(batch_size);
+        t->release_ref();
+        return t;
+    }
+
+    uint64_t trace_id(task* request) const
+    {
+        return static_cast<rpc_request_task*>(request)->get_request()->header->trace_id;
+    }
+
+private:
+    deadline_task_queue _queue;
+    rpc_handler_info    _handler;
+    bool                _reply_hooked;
+};
+
+TEST(tools_common, deadline_task_queue_order)
+{
+    deadline_queue_tester tester;
+    auto& q = tester.queue();
+
+    // the returned tasks are compared by address only, so keep them alive
+    std::vector<task*> tasks = {
+        tester.create_task(LPC_DEADLINE_QUEUE_TEST_LOW),
+        tester.create_task(LPC_DEADLINE_QUEUE_TEST),
+        tester.create_request(30000),
+        tester.create_task(LPC_DEADLINE_QUEUE_TEST),
+        tester.create_request(10000),
+        tester.create_request(0),
+        tester.create_request(20000),
+        tester.create_task(LPC_DEADLINE_QUEUE_TEST)
+    };
+    for (auto t : tasks)
+    {
+        t->add_ref();
+        tester.enqueue(t);
+    }
+    EXPECT_EQ(8, q.count());
+
+    // higher priority first, then the tasks without deadline in FIFO order,
+    // and the requests in the order of their deadlines
+    std::vector<task*> expected = {
+        tasks[1], tasks[3], tasks[5], tasks[7], tasks[4], tasks[6], tasks[2], tasks[0]
+    };
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        EXPECT_EQ(expected[i], tester.dequeue()) << "at " << i;
+        EXPECT_EQ(static_cast<int>(expected.size() - i - 1), q.count());
+    }
+
+    EXPECT_TRUE(s_replies.empty());
+    for (auto t : tasks)
+    {
+        t->release_ref();
+    }
+}
+
+TEST(tools_common, deadline_task_queue_expired)
+{
+    deadline_queue_tester tester;
+    auto& q = tester.queue();
+    std::vector<uint64_t> dropped;
+    ASSERT_TRUE(tester.reply_hooked());
+
+    // dropped on enqueue, when the expired request is at the head of the same priority
+    auto r1 = tester.create_request(50);
+    dropped.push_back(tester.trace_id(r1));
+    tester.enqueue(r1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    auto a = tester.create_task(LPC_DEADLINE_QUEUE_TEST);
+    a->add_ref();
+    tester.enqueue(a);
+    EXPECT_EQ(1, q.count());
+    EXPECT_EQ(a, tester.dequeue());
+    EXPECT_EQ(0, q.count());
+    a->release_ref();
+
+    // dropped on dequeue, while looking for tasks of lower priority
+    auto r2 = tester.create_request(50);
+    auto r3 = tester.create_request(50);
+    dropped.push_back(tester.trace_id(r2));
+    dropped.push_back(tester.trace_id(r3));
+    tester.enqueue(r2);
+    tester.enqueue(r3);
+
+    auto b = tester.create_task(LPC_DEADLINE_QUEUE_TEST_LOW);
+    b->add_ref();
+    tester.enqueue(b);
+    EXPECT_EQ(3, q.count());
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    EXPECT_EQ(b, tester.dequeue());
+    EXPECT_EQ(0, q.count());
+    b->release_ref();
+
+    // requests in time are kept
+    auto r4 = tester.create_request(30000);
+    r4->add_ref();
+    tester.enqueue(r4);
+    EXPECT_EQ(r4, tester.dequeue());
+    r4->release_ref();
+
+    // each dropped request is replied with ERR_TIMEOUT
+    ASSERT_EQ(dropped.size(), s_replies.size());
+    for (size_t i = 0; i < dropped.size(); i++)
+    {
+        EXPECT_EQ(dropped[i], s_replies[i].first);
+        EXPECT_EQ(std::string(ERR_TIMEOUT.to_string()), s_replies[i].second);
+    }
+
+    // and counted per task code
+    auto expired_name = std::string(q.get_name().c_str()) + ".queue.expired.";
+    EXPECT_TRUE(nullptr != perf_counter::get_counter(q.node_name(), "engine",
+        (expired_name + "RPC_DEADLINE_QUEUE_TEST").c_str(), COUNTER_TYPE_RATE, ""));
+    EXPECT_TRUE(nullptr == perf_counter::get_counter(q.node_name(), "engine",
+        (expired_name + "LPC_DEADLINE_QUEUE_TEST").c_str(), COUNTER_TYPE_RATE, ""));
+}
@@ -68,6 +68,12 @@ namespace dsn {
             complete_io(aio, ERR_OK, aio->aio()->buffer_size, 0);
         }
 
+        bool empty_aio_provider::aio_write_vector(aio_task* aio, const dsn_file_buffer_t* buffers, int buffer_count)
+        {
+            complete_io(aio, ERR_OK, aio->aio()->buffer_size, 0);
+            return true;
+        }
+
         disk_aio* empty_aio_provider::prepare_aio_context(aio_task* tsk)
         {
             return new disk_aio();
@@ -51,6 +51,7 @@ namespace dsn {
             virtual error_code close(dsn_handle_t fh) override;
             virtual error_code flush(dsn_handle_t fh) override;
             virtual void       aio(aio_task* aio) override;
+            virtual bool       aio_write_vector(aio_task* aio, const dsn_file_buffer_t* buffers, int buffer_count) override;
             virtual disk_aio* prepare_aio_context(aio_task* tsk) override;
 
             virtual void start(io_modifer& ctx) override {}
@@ -201,6 +201,10 @@ namespace dsn {
 
         static void corrupt_data(message_ex* request, const std::string& corrupt_type)
         {
+            // corrupt on a private copy, as the buffers may be shared with 
+            // others (e.g., received messages in emulator with zero_copy_message)
+            request->make_private_buffers();
+
             if (corrupt_type == "header")
                 replace_value(request->buffers, dsn_random32(0, sizeof(message_header)-1));
             else if (corrupt_type == "body")
@@ -0,0 +1,396 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     lock aspects that profile the contention of zlock/zrwlock_nr
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "lock_contention.h"
+# include <dsn/tool-api/command.h>
+# include <dsn/utility/synchronize.h>
+# include <unordered_map>
+# include <unordered_set>
+# include <algorithm>
+# include <sstream>
+# include <iomanip>
+# include <mutex>
+# include <cstdlib>
+
+# if defined(__linux__) || defined(__APPLE__)
+# include <execinfo.h>
+# include <dlfcn.h>
+# include <cxxabi.h>
+# endif
+
+# ifdef __TITLE__
+# undef __TITLE__
+# endif
+# define __TITLE__ "lock.contention"
+
+namespace dsn {
+    namespace tools {
+
+        void lock_contention_stats::reset()
+        {
+            acquire_count.store(0, std::memory_order_relaxed);
+            contention_count.store(0, std::memory_order_relaxed);
+            wait_ns.store(0, std::memory_order_relaxed);
+            max_wait_ns.store(0, std::memory_order_relaxed);
+            hold_sample_count.store(0, std::memory_order_relaxed);
+            hold_ns.store(0, std::memory_order_relaxed);
+            max_hold_ns.store(0, std::memory_order_relaxed);
+        }
+
+        void lock_contention_stats::merge_to(lock_contention_stats& target) const
+        {
+            target.acquire_count += acquire_count.load(std::memory_order_relaxed);
+            target.contention_count += contention_count.load(std::memory_order_relaxed);
+            target.wait_ns += wait_ns.load(std::memory_order_relaxed);
+            target.hold_sample_count += hold_sample_count.load(std::memory_order_relaxed);
+            target.hold_ns += hold_ns.load(std::memory_order_relaxed);
+
+            uint64_t v = max_wait_ns.load(std::memory_order_relaxed);
+            if (v > target.max_wait_ns.load(std::memory_order_relaxed))
+                target.max_wait_ns.store(v, std::memory_order_relaxed);
+
+            v = max_hold_ns.load(std::memory_order_relaxed);
+            if (v > target.max_hold_ns.load(std::memory_order_relaxed))
+                target.max_hold_ns.store(v, std::memory_order_relaxed);
+        }
+
+        struct lock_contention_site
+        {
+            std::string           name;
+            int                   live_count;
+            lock_contention_stats history; // of the locks already destroyed
+        };
+
+        //
+        // the registry is protected by a native lock, as zlocks
+        // created here would be profiled by themselves
+        //
+        class lock_contention_registry : public utils::singleton<lock_contention_registry>
+        {
+        public:
+            void add(lock_contention_recorder* r)
+            {
+                uint64_t key;
+                void* frames[max_frame_count];
+                int count = capture_frames(frames, key);
+
+                utils::auto_lock<utils::ex_lock_nr> l(_lock);
+                auto it = _sites.find(key);
+                if (it == _sites.end())
+                {
+                    auto site = new lock_contention_site();
+                    site->name = symbolize(frames, count);
+                    site->live_count = 0;
+                    it = _sites.emplace(key, site).first;
+                }
+
+                r->_site = it->second;
+                r->_site->live_count++;
+                _recorders.insert(r);
+            }
+
+            void remove(lock_contention_recorder* r)
+            {
+                utils::auto_lock<utils::ex_lock_nr> l(_lock);
+                _recorders.erase(r);
+                r->_stats.merge_to(r->_site->history);
+                r->_site->live_count--;
+            }
+
+            std::string query(int top_count, bool reset);
+
+        private:
+            enum { max_frame_count = 24 };
+
+            static int capture_frames(void** frames, /*out*/ uint64_t& key)
+            {
+                int count = 0;
+# if defined(__linux__) || defined(__APPLE__)
+                count = ::backtrace(frames, max_frame_count);
+# endif
+                // FNV-1a over the return addresses
+                key = 14695981039346656037ULL;
+                for (int i = 0; i < count; i++)
+                {
+                    key ^= (uint64_t)(uintptr_t)frames[i];
+                    key *= 1099511628211ULL;
+                }
+                return count;
+            }
+
+            static std::string symbolize(void** frames, int count);
+
+        private:
+            utils::ex_lock_nr                                        _lock;
+            std::unordered_map<uint64_t, lock_contention_site*>      _sites;
+            std::unordered_set<lock_contention_recorder*>            _recorders;
+        };
+
+        std::string lock_contention_registry::symbolize(void** frames, int count)
+        {
+# if defined(__linux__) || defined(__APPLE__)
+            // frames inside the lock framework are skipped so that
+            // the site points to the code creating the zlock
+            static const char* skipped[] = {
+                "dsn::tools::lock_contention",
+                "dsn::tools::lock_nr_contention",
+                "dsn::tools::rwlock_nr_contention",
+                "dsn::utils::factory_store",
+                "dsn::service::zlock::",
+                "dsn::service::zrwlock_nr::",
+                "provider::create",
+                "dsn_exlock_create",
+                "dsn_rwlock_nr_create",
+                nullptr
+            };
+
+            std::string fallback;
+            for (int i = 1; i < count; i++)
+            {
+                Dl_info info;
+                if (0 == ::dladdr(frames[i], &info))
+                    continue;
+
+                std::string name;
+                if (info.dli_sname)
+                {
+                    int status = 0;
+                    char* demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+                    name = (status == 0 && demangled) ? demangled : info.dli_sname;
+                    free(demangled);
+                }
+
+                bool skip = false;
+                for (const char** s = skipped; *s != nullptr && !name.empty(); s++)
+                {
+                    if (name.find(*s) != std::string::npos)
+                    {
+                        skip = true;
+                        break;
+                    }
+                }
+                if (skip)
+                    continue;
+
+                std::stringstream ss;
+                if (!name.empty())
+                    ss << name << "+0x" << std::hex << ((uintptr_t)frames[i] - (uintptr_t)info.dli_saddr);
+                else
+                {
+                    const char* module = info.dli_fname ? info.dli_fname : "?";
+                    const char* slash = strrchr(module, '/');
+                    ss << (slash ? slash + 1 : module) << "+0x" << std::hex << ((uintptr_t)frames[i] - (uintptr_t)info.dli_fbase);
+                }
+
+                // unnamed frames (e.g., static functions) are only used when nothing better is found
+                if (!name.empty())
+                    return ss.str();
+                else if (fallback.empty())
+                    fallback = ss.str();
+            }
+            return fallback.empty() ? "unknown" : fallback;
+# else
+            return "unknown";
+# endif
+        }
+
+        std::string lock_contention_registry::query(int top_count, bool reset)
+        {
+            struct site_summary
+            {
+                std::string           name;
+                int                   lock_count;
+                lock_contention_stats stats;
+            };
+
+            std::vector<site_summary*> summaries;
+            {
+                std::unordered_map<std::string, site_summary*> by_name;
+                auto get_summary = [&](lock_contention_site* site)
+                {
+                    auto& s = by_name[site->name];
+                    if (s == nullptr)
+                    {
+                        s = new site_summary();
+                        s->name = site->name;
+                        s->lock_count = 0;
+                        summaries.push_back(s);
+                    }
+                    return s;
+                };
+
+                utils::auto_lock<utils::ex_lock_nr> l(_lock);
+                for (auto& kv : _sites)
+                {
+                    auto s = get_summary(kv.second);
+                    s->lock_count += kv.second->live_count;
+                    kv.second->history.merge_to(s->stats);
+                    if (reset)
+                        kv.second->history.reset();
+                }
+
+                for (auto r : _recorders)
+                {
+                    r->_stats.merge_to(get_summary(r->_site)->stats);
+                    if (reset)
+                        r->_stats.reset();
+                }
+            }
+
+            std::sort(summaries.begin(), summaries.end(), [](site_summary* l, site_summary* r)
+            {
+                uint64_t lw = l->stats.wait_ns.load(), rw = r->stats.wait_ns.load();
+                if (lw != rw)
+                    return lw > rw;
+                return l->stats.contention_count.load() > r->stats.contention_count.load();
+            });
+
+            std::stringstream ss;
+            ss << std::left << std::setw(60) << "site"
+                << std::right
+                << std::setw(8) << "locks"
+                << std::setw(14) << "acquires"
+                << std::setw(12) << "contended"
+                << std::setw(10) << "contend%"
+                << std::setw(12) << "wait_ms"
+                << std::setw(14) << "max_wait_us"
+                << std::setw(14) << "avg_hold_us"
+                << std::setw(14) << "max_hold_us"
+                << std::endl;
+
+            int i = 0;
+            ss << std::fixed << std::setprecision(2);
+            for (auto s : summaries)
+            {
+                if (i++ < top_count && s->stats.acquire_count.load() > 0)
+                {
+                    auto& st = s->stats;
+                    uint64_t acquires = st.acquire_count.load();
+                    uint64_t hold_samples = st.hold_sample_count.load();
+                    std::string name = s->name.length() > 58 ? s->name.substr(0, 55) + "..." : s->name;
+
+                    ss << std::left << std::setw(60) << name
+                        << std::right
+                        << std::setw(8) << s->lock_count
+                        << std::setw(14) << acquires
+                        << std::setw(12) << st.contention_count.load()
+                        << std::setw(10) << (100.0 * st.contention_count.load() / acquires)
+                        << std::setw(12) << (st.wait_ns.load() / 1000000.0)
+                        << std::setw(14) << (st.max_wait_ns.load() / 1000.0)
+                        << std::setw(14) << (hold_samples ? st.hold_ns.load() / 1000.0 / hold_samples : 0.0)
+                        << std::setw(14) << (st.max_hold_ns.load() / 1000.0)
+                        << std::endl;
+                }
+                delete s;
+            }
+
+            if (reset)
+                ss << "statistics are reset" << std::endl;
+            return ss.str();
+        }
+
+        static uint64_t hold_sample_mask()
+        {
+            static uint64_t s_mask = []() -> uint64_t
+            {
+                uint64_t interval = dsn_config_get_value_uint64(
+                    "tools.lock_contention",
+                    "hold_time_sample_interval",
+                    16,
+                    "measure the hold time for one of every N acquisitions (rounded up to power of 2), 0 to disable"
+                    );
+                if (interval == 0)
+                    return ~0ULL;
+
+                uint64_t pow2 = 1;
+                while (pow2 < interval && pow2 < (1ULL << 62))
+                    pow2 <<= 1;
+                return pow2 - 1;
+            }();
+            return s_mask;
+        }
+
+        safe_string lock_contention_command(const safe_vector<safe_string>& args)
+        {
+            int top_count = 10;
+            bool reset = false;
+            for (auto& arg : args)
+            {
+                if (arg == "reset")
+                    reset = true;
+                else
+                {
+                    top_count = atoi(arg.c_str());
+                    if (top_count <= 0)
+                        return "invalid arguments, usage: lock.contention [top_count=10] [reset]";
+                }
+            }
+
+            auto r = lock_contention_registry::instance().query(top_count, reset);
+            return safe_string(r.c_str(), r.length());
+        }
+
+        static void register_lock_contention_command()
+        {
+            static std::once_flag flag;
+            std::call_once(flag, []()
+            {
+                ::dsn::register_command(
+                    "lock.contention",
+                    "lock.contention - list the lock creation sites with the most contention",
+                    "lock.contention [top_count=10] [reset]: sort by total wait time, reset clears the statistics after query",
+                    lock_contention_command
+                    );
+            });
+        }
+
+        lock_contention_recorder::lock_contention_recorder()
+            : _site(nullptr), _hold_sample_mask(hold_sample_mask()), _hold_start_ns(0), _depth(0)
+        {
+            register_lock_contention_command();
+            lock_contention_registry::instance().add(this);
+        }
+
+        lock_contention_recorder::~lock_contention_recorder()
+        {
+            lock_contention_registry::instance().remove(this);
+        }
+
+        const char* lock_contention_recorder::site_name() const
+        {
+            return _site->name.c_str();
+        }
+    }
+}
@@ -0,0 +1,316 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     lock aspects that profile the contention of zlock/zrwlock_nr
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/tool_api.h>
+#include <atomic>
+
+/*!
+@defgroup lock-contention Lock Contention Profiler
+@ingroup tools
+
+Lock contention aspects
+
+These aspects wrap the lock providers and record, for each lock, how many times
+it is acquired, how many of the acquisitions have to wait, how long they wait,
+and (sampled) how long the lock is held. Each lock is tagged with the call site
+where it is created, and the statistics are aggregated per creation site by the
+"lock.contention" command.
+
+An uncontended acquisition costs one extra try_lock and a counter update;
+the clock is only read when the lock is contended or the hold time is sampled.
+
+<PRE>
+
+[core]
+
+lock_aspects = dsn::tools::lock_contention_aspect
+lock_nr_aspects = dsn::tools::lock_nr_contention_aspect
+rwlock_nr_aspects = dsn::tools::rwlock_nr_contention_aspect
+
+[tools.lock_contention]
+; measure the hold time for one of every N acquisitions (rounded up to power of 2), 0 to disable
+hold_time_sample_interval = 16
+
+</PRE>
+*/
+
+namespace dsn {
+    namespace tools {
+
+        struct lock_contention_site;
+
+        //
+        // the statistics are only updated by the lock holder (exclusive locks) or with
+        // atomic adds (shared locks), and are read by the "lock.contention" command
+        //
+        struct lock_contention_stats
+        {
+            std::atomic<uint64_t> acquire_count;
+            std::atomic<uint64_t> contention_count;
+            std::atomic<uint64_t> wait_ns;
+            std::atomic<uint64_t> max_wait_ns;
+            std::atomic<uint64_t> hold_sample_count;
+            std::atomic<uint64_t> hold_ns;
+            std::atomic<uint64_t> max_hold_ns;
+
+            lock_contention_stats() { reset(); }
+            void reset();
+            void merge_to(lock_contention_stats& target) const;
+        };
+
+        //
+        // statistics of one lock, registered to the global registry
+        // during its lifetime and merged into its creation site afterwards
+        //
+        class lock_contention_recorder
+        {
+        public:
+            lock_contention_recorder();
+            ~lock_contention_recorder();
+
+            const lock_contention_stats& stats() const { return _stats; }
+            const char* site_name() const;
+
+            // exclusive acquisitions, called with the lock held
+            void on_acquired(uint64_t wait_ns)
+            {
+                if (_depth++ != 0)
+                    return;
+
+                uint64_t count = _stats.acquire_count.load(std::memory_order_relaxed) + 1;
+                _stats.acquire_count.store(count, std::memory_order_relaxed);
+                if (wait_ns != 0)
+                    add_wait(wait_ns);
+
+                _hold_start_ns = (count & _hold_sample_mask) == 0 ? dsn_now_ns() : 0;
+            }
+
+            void on_released()
+            {
+                if (--_depth != 0)
+                    return;
+
+                if (_hold_start_ns != 0)
+                {
+                    uint64_t hold = dsn_now_ns() - _hold_start_ns;
+                    _stats.hold_sample_count.store(_stats.hold_sample_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                    _stats.hold_ns.store(_stats.hold_ns.load(std::memory_order_relaxed) + hold, std::memory_order_relaxed);
+                    if (hold > _stats.max_hold_ns.load(std::memory_order_relaxed))
+                        _stats.max_hold_ns.store(hold, std::memory_order_relaxed);
+                }
+            }
+
+            // shared acquisitions, may be called concurrently
+            void on_shared_acquired(uint64_t wait_ns)
+            {
+                _stats.acquire_count.fetch_add(1, std::memory_order_relaxed);
+                if (wait_ns != 0)
+                {
+                    _stats.contention_count.fetch_add(1, std::memory_order_relaxed);
+                    _stats.wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+
+                    uint64_t max_wait = _stats.max_wait_ns.load(std::memory_order_relaxed);
+                    while (wait_ns > max_wait
+                        && !_stats.max_wait_ns.compare_exchange_weak(max_wait, wait_ns, std::memory_order_relaxed))
+                    {
+                    }
+                }
+            }
+
+        private:
+            void add_wait(uint64_t wait_ns)
+            {
+                _stats.contention_count.store(_stats.contention_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                _stats.wait_ns.store(_stats.wait_ns.load(std::memory_order_relaxed) + wait_ns, std::memory_order_relaxed);
+                if (wait_ns > _stats.max_wait_ns.load(std::memory_order_relaxed))
+                    _stats.max_wait_ns.store(wait_ns, std::memory_order_relaxed);
+            }
+
+        private:
+            friend class lock_contention_registry;
+
+            lock_contention_stats  _stats;
+            lock_contention_site*  _site;
+            uint64_t               _hold_sample_mask;
+            uint64_t               _hold_start_ns;
+            int                    _depth;
+        };
+
+        // wait_ns is 0 when the lock is acquired without waiting
+        template<typename TLock>
+        inline uint64_t lock_with_timing(TLock* l)
+        {
+            if (l->try_lock())
+                return 0;
+
+            uint64_t start = dsn_now_ns();
+            l->lock();
+            uint64_t wait = dsn_now_ns() - start;
+            return wait != 0 ? wait : 1;
+        }
+
+        class lock_contention_aspect : public lock_provider
+        {
+        public:
+            lock_contention_aspect(lock_provider* inner_provider) : lock_provider(inner_provider) {}
+            virtual ~lock_contention_aspect() {}
+
+            virtual void lock() override
+            {
+                uint64_t wait = lock_with_timing(get_inner_provider());
+                _recorder.on_acquired(wait);
+            }
+
+            virtual bool try_lock() override
+            {
+                if (!get_inner_provider()->try_lock())
+                    return false;
+                _recorder.on_acquired(0);
+                return true;
+            }
+
+            virtual void unlock() override
+            {
+                _recorder.on_released();
+                get_inner_provider()->unlock();
+            }
+
+            const lock_contention_recorder& recorder() const { return _recorder; }
+
+        private:
+            lock_contention_recorder _recorder;
+        };
+
+        class lock_nr_contention_aspect : public lock_nr_provider
+        {
+        public:
+            lock_nr_contention_aspect(lock_nr_provider* inner_provider) : lock_nr_provider(inner_provider) {}
+            virtual ~lock_nr_contention_aspect() {}
+
+            virtual void lock() override
+            {
+                uint64_t wait = lock_with_timing(get_inner_provider());
+                _recorder.on_acquired(wait);
+            }
+
+            virtual bool try_lock() override
+            {
+                if (!get_inner_provider()->try_lock())
+                    return false;
+                _recorder.on_acquired(0);
+                return true;
+            }
+
+            virtual void unlock() override
+            {
+                _recorder.on_released();
+                get_inner_provider()->unlock();
+            }
+
+            const lock_contention_recorder& recorder() const { return _recorder; }
+
+        private:
+            lock_contention_recorder _recorder;
+        };
+
+        // hold time is only sampled for writers, as readers hold the lock concurrently
+        class rwlock_nr_contention_aspect : public rwlock_nr_provider
+        {
+        public:
+            rwlock_nr_contention_aspect(rwlock_nr_provider* inner_provider) : rwlock_nr_provider(inner_provider) {}
+            virtual ~rwlock_nr_contention_aspect() {}
+
+            virtual void lock_read() override
+            {
+                auto inner = get_inner_provider();
+                uint64_t wait = 0;
+                if (!inner->try_lock_read())
+                {
+                    uint64_t start = dsn_now_ns();
+                    inner->lock_read();
+                    wait = std::max<uint64_t>(dsn_now_ns() - start, 1);
+                }
+                _recorder.on_shared_acquired(wait);
+            }
+
+            virtual void unlock_read() override { get_inner_provider()->unlock_read(); }
+
+            virtual bool try_lock_read() override
+            {
+                if (!get_inner_provider()->try_lock_read())
+                    return false;
+                _recorder.on_shared_acquired(0);
+                return true;
+            }
+
+            virtual void lock_write() override
+            {
+                auto inner = get_inner_provider();
+                uint64_t wait = 0;
+                if (!inner->try_lock_write())
+                {
+                    uint64_t start = dsn_now_ns();
+                    inner->lock_write();
+                    wait = std::max<uint64_t>(dsn_now_ns() - start, 1);
+                }
+                _recorder.on_acquired(wait);
+            }
+
+            virtual void unlock_write() override
+            {
+                _recorder.on_released();
+                get_inner_provider()->unlock_write();
+            }
+
+            virtual bool try_lock_write() override
+            {
+                if (!get_inner_provider()->try_lock_write())
+                    return false;
+                _recorder.on_acquired(0);
+                return true;
+            }
+
+            const lock_contention_recorder& recorder() const { return _recorder; }
+
+        private:
+            lock_contention_recorder _recorder;
+        };
+
+        // handler of the "lock.contention" command
+        safe_string lock_contention_command(const safe_vector<safe_string>& args);
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the lock contention aspects.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "lock_contention.h"
+#include "lockp.std.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <sstream>
+
+using namespace dsn;
+using namespace dsn::tools;
+
+// finds the row of the given site in the lock.contention output
+static bool find_site_row(const std::string& output, const std::string& site, /*out*/ int& locks, /*out*/ uint64_t& acquires)
+{
+    std::string name = site.length() > 58 ? site.substr(0, 55) : site;
+    std::istringstream is(output);
+    std::string line;
+    while (std::getline(is, line))
+    {
+        if (line.compare(0, name.length(), name) == 0 && line.length() > 60)
+        {
+            std::istringstream row(line.substr(60));
+            row >> locks >> acquires;
+            return !row.fail();
+        }
+    }
+    return false;
+}
+
+TEST(tools_common, lock_contention_aspect)
+{
+    lock_contention_aspect* lock = new lock_contention_aspect(new std_lock_provider(nullptr));
+    lock->lock();
+    EXPECT_TRUE(lock->try_lock());
+    lock->unlock();
+    lock->unlock();
+    EXPECT_EQ(1u, lock->recorder().stats().acquire_count.load());
+    EXPECT_EQ(0u, lock->recorder().stats().contention_count.load());
+    EXPECT_TRUE(lock->recorder().site_name() != nullptr);
+
+    lock_nr_contention_aspect* nr_lock = new lock_nr_contention_aspect(new std_lock_nr_provider(nullptr));
+    nr_lock->lock();
+    EXPECT_FALSE(nr_lock->try_lock());
+    nr_lock->unlock();
+    EXPECT_TRUE(nr_lock->try_lock());
+    nr_lock->unlock();
+    EXPECT_EQ(2u, nr_lock->recorder().stats().acquire_count.load());
+
+    rwlock_nr_contention_aspect* rwlock = new rwlock_nr_contention_aspect(new std_rwlock_nr_provider(nullptr));
+    rwlock->lock_read();
+    EXPECT_TRUE(rwlock->try_lock_read());
+    EXPECT_FALSE(rwlock->try_lock_write());
+    rwlock->unlock_read();
+    rwlock->unlock_read();
+    rwlock->lock_write();
+    rwlock->unlock_write();
+    EXPECT_EQ(3u, rwlock->recorder().stats().acquire_count.load());
+
+    delete lock;
+    delete nr_lock;
+    delete rwlock;
+}
+
+TEST(tools_common, lock_contention_command)
+{
+    lock_nr_contention_aspect* lock = new lock_nr_contention_aspect(new std_lock_nr_provider(nullptr));
+
+    const int thread_count = 4;
+    const int loop_count = 10000;
+    int value = 0;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int j = 0; j < loop_count; j++)
+            {
+                lock->lock();
+                value++;
+                lock->unlock();
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    auto& stats = lock->recorder().stats();
+    EXPECT_EQ(thread_count * loop_count, value);
+    EXPECT_EQ((uint64_t)(thread_count * loop_count), stats.acquire_count.load());
+    EXPECT_LE(stats.contention_count.load(), stats.acquire_count.load());
+    EXPECT_LE(stats.max_wait_ns.load(), stats.wait_ns.load());
+
+    safe_vector<safe_string> args;
+    auto output = lock_contention_command(args);
+    std::string site = lock->recorder().site_name();
+    int locks = 0;
+    uint64_t acquires = 0;
+    ASSERT_TRUE(find_site_row(output.c_str(), site, locks, acquires)) << output.c_str();
+    EXPECT_EQ(1, locks);
+    EXPECT_EQ((uint64_t)(thread_count * loop_count), acquires);
+
+    // statistics of the destroyed locks are kept by their creation site
+    delete lock;
+    output = lock_contention_command(args);
+    ASSERT_TRUE(find_site_row(output.c_str(), site, locks, acquires)) << output.c_str();
+    EXPECT_EQ(0, locks);
+    EXPECT_EQ((uint64_t)(thread_count * loop_count), acquires);
+
+    // until they are reset
+    args.push_back("reset");
+    output = lock_contention_command(args);
+    EXPECT_NE(std::string::npos, output.find("reset"));
+    EXPECT_TRUE(find_site_row(output.c_str(), site, locks, acquires));
+    args.clear();
+    output = lock_contention_command(args);
+    EXPECT_FALSE(find_site_row(output.c_str(), site, locks, acquires));
+
+    args.clear();
+    args.push_back("-1");
+    output = lock_contention_command(args);
+    EXPECT_NE(std::string::npos, output.find("invalid"));
+}
@@ -0,0 +1,444 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     lock, rwlock and semaphore providers built directly on futex
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#pragma once
+
+#include <dsn/tool_api.h>
+#include <dsn/utility/synchronize.h>
+#include <atomic>
+
+# ifdef __linux__
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+# include <climits>
+# include <ctime>
+# endif
+
+namespace dsn { namespace tools {
+
+// how many times a contended lock or an empty semaphore is re-checked
+// before the thread goes to sleep in the kernel,
+// see [tools.hpc_locks] spin_count
+extern int hpc_lock_spin_count();
+
+# ifdef __linux__
+
+//
+// the primitives below keep all their state in a single 32-bit word and only
+// enter the kernel (futex) when a thread really has to sleep or to wake others,
+// while the std providers pair an atomic counter with a separate POSIX semaphore
+//
+namespace futex {
+
+    static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex requires a plain 32-bit word");
+
+    inline void wait(std::atomic<int>* addr, int expected, int timeout_milliseconds = -1)
+    {
+        struct timespec ts, *pts = nullptr;
+        if (timeout_milliseconds >= 0)
+        {
+            ts.tv_sec = timeout_milliseconds / 1000;
+            ts.tv_nsec = (timeout_milliseconds % 1000) * 1000000L;
+            pts = &ts;
+        }
+        ::syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAIT_PRIVATE, expected, pts, nullptr, 0);
+    }
+
+    inline void wake(std::atomic<int>* addr, int count)
+    {
+        ::syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    inline void cpu_relax()
+    {
+        ::dsn::utils::cpu_relax();
+    }
+}
+
+class futex_lock_nr
+{
+public:
+    futex_lock_nr() : _state(0) {}
+
+    bool try_lock()
+    {
+        int c = 0;
+        return _state.compare_exchange_strong(c, 1, std::memory_order_acquire);
+    }
+
+    void lock()
+    {
+        int c = 0;
+        if (_state.compare_exchange_strong(c, 1, std::memory_order_acquire))
+            return;
+
+        // the critical sections are usually short, so spin for a while first
+        for (int i = hpc_lock_spin_count(); i > 0; --i)
+        {
+            futex::cpu_relax();
+            c = _state.load(std::memory_order_relaxed);
+            if (c == 2)
+                break;
+            if (c == 0 && _state.compare_exchange_weak(c, 1, std::memory_order_acquire))
+                return;
+        }
+
+        // mark the lock as contended so that the owner wakes us up on unlock
+        if (c != 2)
+            c = _state.exchange(2, std::memory_order_acquire);
+        while (c != 0)
+        {
+            futex::wait(&_state, 2);
+            c = _state.exchange(2, std::memory_order_acquire);
+        }
+    }
+
+    void unlock()
+    {
+        if (_state.fetch_sub(1, std::memory_order_release) != 1)
+        {
+            _state.store(0, std::memory_order_release);
+            futex::wake(&_state, 1);
+        }
+    }
+
+private:
+    std::atomic<int> _state; // 0: unlocked, 1: locked, 2: locked with (possible) waiters
+};
+
+class futex_lock
+{
+public:
+    futex_lock() : _owner(utils::get_invalid_tid()), _recursion(0) {}
+
+    bool try_lock()
+    {
+        auto tid = utils::get_current_tid();
+        if (_owner.load(std::memory_order_relaxed) != tid)
+        {
+            if (!_lock.try_lock())
+                return false;
+            _owner.store(tid, std::memory_order_relaxed);
+        }
+        ++_recursion;
+        return true;
+    }
+
+    void lock()
+    {
+        auto tid = utils::get_current_tid();
+        if (_owner.load(std::memory_order_relaxed) != tid)
+        {
+            _lock.lock();
+            _owner.store(tid, std::memory_order_relaxed);
+        }
+        ++_recursion;
+    }
+
+    void unlock()
+    {
+        if (--_recursion == 0)
+        {
+            _owner.store(utils::get_invalid_tid(), std::memory_order_relaxed);
+            _lock.unlock();
+        }
+    }
+
+private:
+    futex_lock_nr    _lock;
+    std::atomic<int> _owner;
+    int              _recursion;
+};
+
+//
+// writers are preferred: new readers are blocked once a writer is waiting;
+// waiters sleep on the state word itself and all of them are woken up
+// when the lock is released, which is fine as long as waiting is rare
+//
+class futex_rwlock_nr
+{
+public:
+    futex_rwlock_nr() : _state(0), _waiters(0) {}
+
+    bool try_lock_read()
+    {
+        int s = _state.load(std::memory_order_relaxed);
+        while ((s & (WRITER | WRITER_WAITING)) == 0)
+        {
+            if (_state.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+                return true;
+        }
+        return false;
+    }
+
+    void lock_read()
+    {
+        int spin = hpc_lock_spin_count();
+        while (true)
+        {
+            int s = _state.load(std::memory_order_relaxed);
+            if ((s & (WRITER | WRITER_WAITING)) == 0)
+            {
+                if (_state.compare_exchange_weak(s, s + 1, std::memory_order_acquire))
+                    return;
+            }
+            else if (spin > 0)
+            {
+                --spin;
+                futex::cpu_relax();
+            }
+            else
+            {
+                sleep_on(s);
+            }
+        }
+    }
+
+    void unlock_read()
+    {
+        int s = _state.fetch_sub(1) - 1;
+        if ((s & READER_MASK) == 0 && _waiters.load() > 0)
+            futex::wake(&_state, INT_MAX);
+    }
+
+    bool try_lock_write()
+    {
+        int s = _state.load(std::memory_order_relaxed);
+        while ((s & (READER_MASK | WRITER)) == 0)
+        {
+            if (_state.compare_exchange_weak(s, WRITER, std::memory_order_acquire))
+                return true;
+        }
+        return false;
+    }
+
+    void lock_write()
+    {
+        int spin = hpc_lock_spin_count();
+        while (true)
+        {
+            int s = _state.load(std::memory_order_relaxed);
+            if ((s & (READER_MASK | WRITER)) == 0)
+            {
+                // clears WRITER_WAITING, other waiting writers set it again when they retry
+                if (_state.compare_exchange_weak(s, WRITER, std::memory_order_acquire))
+                    return;
+            }
+            else if (spin > 0)
+            {
+                --spin;
+                futex::cpu_relax();
+            }
+            else if ((s & WRITER_WAITING) == 0)
+            {
+                _state.compare_exchange_weak(s, s | WRITER_WAITING, std::memory_order_relaxed);
+            }
+            else
+            {
+                sleep_on(s);
+            }
+        }
+    }
+
+    void unlock_write()
+    {
+        _state.fetch_and(~WRITER);
+        if (_waiters.load() > 0)
+            futex::wake(&_state, INT_MAX);
+    }
+
+private:
+    void sleep_on(int s)
+    {
+        // the waiter count is published before sleeping, and the releasers
+        // change the state before checking it, so either the releaser sees us,
+        // or futex::wait sees a changed state and returns immediately
+        _waiters.fetch_add(1);
+        futex::wait(&_state, s);
+        _waiters.fetch_sub(1);
+    }
+
+private:
+    enum
+    {
+        READER_MASK = (1 << 29) - 1,
+        WRITER_WAITING = 1 << 29,
+        WRITER = 1 << 30
+    };
+
+    std::atomic<int> _state;
+    std::atomic<int> _waiters;
+};
+
+class futex_semaphore
+{
+public:
+    futex_semaphore(int initial_count = 0) : _count(initial_count), _waiters(0) {}
+
+    void signal(int count)
+    {
+        _count.fetch_add(count);
+        if (_waiters.load() > 0)
+            futex::wake(&_count, count);
+    }
+
+    bool wait(int timeout_milliseconds)
+    {
+        for (int i = hpc_lock_spin_count(); i >= 0; --i)
+        {
+            if (try_wait())
+                return true;
+            futex::cpu_relax();
+        }
+
+        bool infinite = (TIME_MS_MAX == static_cast<unsigned int>(timeout_milliseconds));
+        uint64_t deadline_ms = infinite ? 0 : dsn_now_ms() + timeout_milliseconds;
+
+        bool r = false;
+        _waiters.fetch_add(1);
+        while (true)
+        {
+            if (try_wait())
+            {
+                r = true;
+                break;
+            }
+
+            int timeout = -1;
+            if (!infinite)
+            {
+                uint64_t now_ms = dsn_now_ms();
+                if (now_ms >= deadline_ms)
+                    break;
+                timeout = static_cast<int>(deadline_ms - now_ms);
+            }
+            futex::wait(&_count, 0, timeout);
+        }
+        _waiters.fetch_sub(1);
+        return r;
+    }
+
+private:
+    bool try_wait()
+    {
+        int c = _count.load(std::memory_order_relaxed);
+        while (c > 0)
+        {
+            if (_count.compare_exchange_weak(c, c - 1, std::memory_order_acquire))
+                return true;
+        }
+        return false;
+    }
+
+private:
+    std::atomic<int> _count;
+    std::atomic<int> _waiters;
+};
+
+# else
+
+// no futex on this platform, fall back to the same primitives used by the std providers
+typedef utils::ex_lock_nr  futex_lock_nr;
+typedef utils::ex_lock     futex_lock;
+typedef utils::rw_lock_nr  futex_rwlock_nr;
+typedef utils::semaphore   futex_semaphore;
+
+# endif
+
+class hpc_lock_provider : public lock_provider
+{
+public:
+    hpc_lock_provider(lock_provider* inner_provider) : lock_provider(inner_provider) {}
+    virtual ~hpc_lock_provider() {}
+
+    virtual void lock() { _lock.lock(); }
+    virtual bool try_lock() { return _lock.try_lock(); }
+    virtual void unlock() { _lock.unlock(); }
+
+private:
+    futex_lock _lock;
+};
+
+class hpc_lock_nr_provider : public lock_nr_provider
+{
+public:
+    hpc_lock_nr_provider(lock_nr_provider* inner_provider) : lock_nr_provider(inner_provider) {}
+    virtual ~hpc_lock_nr_provider() {}
+
+    virtual void lock() { _lock.lock(); }
+    virtual bool try_lock() { return _lock.try_lock(); }
+    virtual void unlock() { _lock.unlock(); }
+
+private:
+    futex_lock_nr _lock;
+};
+
+class hpc_rwlock_nr_provider : public rwlock_nr_provider
+{
+public:
+    hpc_rwlock_nr_provider(rwlock_nr_provider* inner_provider) : rwlock_nr_provider(inner_provider) {}
+    virtual ~hpc_rwlock_nr_provider() {}
+
+    virtual void lock_read() { _lock.lock_read(); }
+    virtual void unlock_read() { _lock.unlock_read(); }
+    virtual bool try_lock_read() { return _lock.try_lock_read(); }
+
+    virtual void lock_write() { _lock.lock_write(); }
+    virtual void unlock_write() { _lock.unlock_write(); }
+    virtual bool try_lock_write() { return _lock.try_lock_write(); }
+
+private:
+    futex_rwlock_nr _lock;
+};
+
+class hpc_semaphore_provider : public semaphore_provider
+{
+public:
+    hpc_semaphore_provider(int initial_count, semaphore_provider *inner_provider)
+        : semaphore_provider(initial_count, inner_provider), _sema(initial_count)
+    {
+    }
+    virtual ~hpc_semaphore_provider() {}
+
+public:
+    virtual void signal(int count) { _sema.signal(count); }
+    virtual bool wait(int timeout_milliseconds) { return _sema.wait(timeout_milliseconds); }
+
+private:
+    futex_semaphore _sema;
+};
+
+}} // end namespace dsn::tools
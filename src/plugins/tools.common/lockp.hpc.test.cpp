@@ -0,0 +1,141 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the hpc lock providers.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+#include "lockp.hpc.h"
+#include <gtest/gtest.h>
+#include <thread>
+
+using namespace dsn;
+using namespace dsn::tools;
+
+TEST(tools_common, hpc_lock_provider)
+{
+    hpc_lock_provider* lock = new hpc_lock_provider(nullptr);
+    lock->lock();
+    EXPECT_TRUE(lock->try_lock());
+    lock->unlock();
+    lock->unlock();
+
+    hpc_lock_nr_provider* nr_lock = new hpc_lock_nr_provider(nullptr);
+    nr_lock->lock();
+    EXPECT_FALSE(nr_lock->try_lock());
+    nr_lock->unlock();
+    EXPECT_TRUE(nr_lock->try_lock());
+    nr_lock->unlock();
+
+    hpc_rwlock_nr_provider* rwlock = new hpc_rwlock_nr_provider(nullptr);
+    rwlock->lock_read();
+    EXPECT_TRUE(rwlock->try_lock_read());
+    EXPECT_FALSE(rwlock->try_lock_write());
+    rwlock->unlock_read();
+    rwlock->unlock_read();
+    rwlock->lock_write();
+    EXPECT_FALSE(rwlock->try_lock_read());
+    EXPECT_FALSE(rwlock->try_lock_write());
+    rwlock->unlock_write();
+
+    hpc_semaphore_provider* sema = new hpc_semaphore_provider(0, nullptr);
+    std::thread t([](hpc_semaphore_provider* s){
+        s->wait(1000000);
+    }, sema);
+    sema->signal(1);
+    t.join();
+    EXPECT_FALSE(sema->wait(10));
+    sema->signal(2);
+    EXPECT_TRUE(sema->wait(0));
+    EXPECT_TRUE(sema->wait(0));
+    EXPECT_FALSE(sema->wait(0));
+
+    delete lock;
+    delete nr_lock;
+    delete rwlock;
+    delete sema;
+}
+
+TEST(tools_common, hpc_lock_provider_contention)
+{
+    const int thread_count = 8;
+    const int round = 10000;
+
+    hpc_lock_nr_provider lock(nullptr);
+    hpc_rwlock_nr_provider rwlock(nullptr);
+    hpc_semaphore_provider sema(0, nullptr);
+    int counter = 0;
+    int rw_counter = 0;
+    std::atomic<int> readers(0);
+    std::atomic<int> bad_reads(0);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back([&]()
+        {
+            for (int j = 0; j < round; j++)
+            {
+                lock.lock();
+                counter++;
+                lock.unlock();
+
+                if (j % 10 == 0)
+                {
+                    rwlock.lock_write();
+                    if (readers.load() != 0)
+                        bad_reads++;
+                    rw_counter++;
+                    rwlock.unlock_write();
+                }
+                else
+                {
+                    rwlock.lock_read();
+                    readers++;
+                    readers--;
+                    rwlock.unlock_read();
+                }
+
+                sema.signal(1);
+                sema.wait(TIME_MS_MAX);
+            }
+        });
+    }
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    EXPECT_EQ(thread_count * round, counter);
+    EXPECT_EQ(thread_count * round / 10, rw_counter);
+    EXPECT_EQ(0, bad_reads.load());
+    EXPECT_FALSE(sema.wait(0));
+}
@@ -122,6 +122,24 @@ namespace dsn {
             err.end_tracking();
         }
 
+        bool native_linux_aio_provider::aio_write_vector(aio_task* aio_tsk, const dsn_file_buffer_t* buffers, int buffer_count)
+        {
+            if (buffer_count > IOV_MAX)
+                return false;
+
+            auto aio = (linux_disk_aio_context *)aio_tsk->aio();
+            aio->iovs.resize(buffer_count);
+            for (int i = 0; i < buffer_count; i++)
+            {
+                aio->iovs[i].iov_base = buffers[i].buffer;
+                aio->iovs[i].iov_len = buffers[i].size;
+            }
+
+            auto err = aio_internal(aio_tsk, true);
+            err.end_tracking();
+            return true;
+        }
+
         void native_linux_aio_provider::get_event()
         {
             struct io_event events[1];
@@ -193,7 +211,15 @@ namespace dsn {
                 io_prep_pread(&aio->cb, static_cast<int>((ssize_t)aio->file), aio->buffer, aio->buffer_size, aio->file_offset);
                 break;
             case AIO_Write:
-                io_prep_pwrite(&aio->cb, static_cast<int>((ssize_t)aio->file), aio->buffer, aio->buffer_size, aio->file_offset);
+                if (!aio->iovs.empty())
+                {
+                    // the kernel copies the iovecs on submission
+                    io_prep_pwritev(&aio->cb, static_cast<int>((ssize_t)aio->file), &aio->iovs[0], (int)aio->iovs.size(), aio->file_offset);
+                }
+                else
+                {
+                    io_prep_pwrite(&aio->cb, static_cast<int>((ssize_t)aio->file), aio->buffer, aio->buffer_size, aio->file_offset);
+                }
                 break;
             default:
                 derror("unknown aio type %u", static_cast<int>(aio->type));
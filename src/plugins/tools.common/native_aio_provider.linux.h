@@ -47,6 +47,8 @@
 # include <sys/syscall.h> /* for __NR_* definitions */
 # include <libaio.h>
 # include <fcntl.h>       /* O_RDWR */
+# include <sys/uio.h>     /* iovec, IOV_MAX */
+# include <climits>
 
 namespace dsn {
     namespace tools {
@@ -61,6 +63,7 @@ namespace dsn {
             virtual error_code close(dsn_handle_t fh) override;
             virtual error_code flush(dsn_handle_t fh) override;
             virtual void    aio(aio_task* aio) override;
+            virtual bool    aio_write_vector(aio_task* aio, const dsn_file_buffer_t* buffers, int buffer_count) override;
             virtual disk_aio* prepare_aio_context(aio_task* tsk) override;
 
             virtual void start(io_modifer& ctx) override;
@@ -73,6 +76,7 @@ namespace dsn {
                 utils::notify_event* evt;
                 error_code err;
                 uint32_t bytes;
+                std::vector<struct iovec> iovs; // for vectored write
             };
 
         protected:
@@ -246,10 +246,14 @@ namespace dsn {
         // return true means continue, otherwise early terminate with task::set_error_code
         static void profiler_on_rpc_reply(task* caller, message_ex* msg)
         {
-            auto& prof = s_spec_profilers[caller->spec().code];
-            if (prof.collect_call_count)
+            // e.g., expired or rejected requests replied by the task queues
+            if (caller != nullptr)
             {
-                prof.call_counts[msg->local_rpc_code]++;
+                auto& prof = s_spec_profilers[caller->spec().code];
+                if (prof.collect_call_count)
+                {
+                    prof.call_counts[msg->local_rpc_code]++;
+                }
             }
 
             uint64_t qts = message_ext_for_profiler::get(msg);
@@ -38,6 +38,8 @@
 # include "asio_net_provider.h"
 # include "providers.common.h"
 # include "lockp.std.h"
+# include "lockp.hpc.h"
+# include "lock_contention.h"
 # include "native_aio_provider.win.h"
 # include "native_aio_provider.posix.h"
 # include "native_aio_provider.linux.h"
@@ -45,6 +47,8 @@
 # include "simple_perf_counter_v2_atomic.h"
 # include "simple_perf_counter_v2_fast.h"
 # include "simple_task_queue.h"
+# include "deadline_task_queue.h"
+# include "codel_admission_controller.h"
 # include "simple_logger.h"
 # include "empty_aio_provider.h"
 # include "dsn_message_parser.h"
@@ -55,6 +59,7 @@
 # include "nativerun.h"
 # include "tracer.h"
 # include "profiler.h"
+# include "cpu_accounting.h"
 # include "fault_injector.h"
 
 namespace dsn {
@@ -70,10 +75,19 @@ namespace dsn {
             register_component_provider<std_lock_nr_provider>("dsn::tools::std_lock_nr_provider");
             register_component_provider<std_rwlock_nr_provider>("dsn::tools::std_rwlock_nr_provider");
             register_component_provider<std_semaphore_provider>("dsn::tools::std_semaphore_provider");            
+            register_component_provider<hpc_lock_provider>("dsn::tools::hpc_lock_provider");
+            register_component_provider<hpc_lock_nr_provider>("dsn::tools::hpc_lock_nr_provider");
+            register_component_provider<hpc_rwlock_nr_provider>("dsn::tools::hpc_rwlock_nr_provider");
+            register_component_provider<hpc_semaphore_provider>("dsn::tools::hpc_semaphore_provider");
+            register_component_aspect<lock_contention_aspect>("dsn::tools::lock_contention_aspect");
+            register_component_aspect<lock_nr_contention_aspect>("dsn::tools::lock_nr_contention_aspect");
+            register_component_aspect<rwlock_nr_contention_aspect>("dsn::tools::rwlock_nr_contention_aspect");
             register_component_provider<asio_network_provider>("dsn::tools::asio_network_provider");
             register_component_provider<asio_udp_provider>("dsn::tools::asio_udp_provider");
             register_component_provider<simple_task_queue>("dsn::tools::simple_task_queue");
+            register_component_provider<deadline_task_queue>("dsn::tools::deadline_task_queue");
             register_component_provider<simple_timer_service>("dsn::tools::simple_timer_service");
+            register_component_provider<codel_admission_controller>("dsn::tools::codel_admission_controller");
             
             register_message_header_parser<dsn_message_parser>(NET_HDR_DSN, {"RDSN"});
             register_message_header_parser<thrift_message_parser>(NET_HDR_THRIFT, {"THFT"});
@@ -114,5 +128,6 @@ MODULE_INIT_BEGIN(tools_common)
     dsn::tools::register_tool<dsn::tools::nativerun>("nativerun");
     dsn::tools::register_toollet<dsn::tools::tracer>("tracer");
     dsn::tools::register_toollet<dsn::tools::profiler>("profiler");
+    dsn::tools::register_toollet<dsn::tools::cpu_accounting>("cpu_accounting");
     dsn::tools::register_toollet<dsn::tools::fault_injector>("fault_injector");
 MODULE_INIT_END
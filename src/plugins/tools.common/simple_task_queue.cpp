@@ -96,6 +96,33 @@ namespace dsn
         simple_task_queue::simple_task_queue(task_worker_pool* pool, int index, task_queue* inner_provider)
             : task_queue(pool, index, inner_provider), _samples("")
         {
+            auto& spec = this->spec();
+            switch (spec.worker_idle_mode)
+            {
+            case WORKER_IDLE_SPIN_THEN_PARK:
+                _samples.set_idle_strategy(spec.worker_idle_spin_us, false);
+                break;
+            case WORKER_IDLE_BUSY_POLL:
+                // the worker placement is checked by task_worker_pool
+                _samples.set_idle_strategy(0, true);
+                break;
+            default:
+                break;
+            }
+
+            _sema_wait_counter = perf_counter::get_counter(node_name(), "engine",
+                (get_name() + ".queue.sema_wait.rate").c_str(), COUNTER_TYPE_RATE,
+                "how many times per second idle workers get tasks by waiting on the queue semaphore, "
+                "which still spins briefly before sleeping, so not all of them are kernel wakeups", true);
+            _spin_hit_counter = perf_counter::get_counter(node_name(), "engine",
+                (get_name() + ".queue.spin_hit.rate").c_str(), COUNTER_TYPE_RATE,
+                "how many times per second idle workers get tasks during spinning", true);
+        }
+
+        simple_task_queue::~simple_task_queue()
+        {
+            perf_counter::remove_counter(_sema_wait_counter->full_name());
+            perf_counter::remove_counter(_spin_hit_counter->full_name());
         }
 
         void simple_task_queue::enqueue(task* task)
@@ -107,8 +134,14 @@ namespace dsn
         task* simple_task_queue::dequeue(/*inout*/int& batch_size)
         {
             long c = 0;
-            auto t = _samples.dequeue(c);
+            utils::blocking_queue_wait_t wait;
+            auto t = _samples.dequeue(c, TIME_MS_MAX, wait);
             dassert(t != nullptr, "dequeue does not return empty tasks");
+
+            if (wait == utils::BQ_WAIT_PARK)
+                _sema_wait_counter->increment();
+            else if (wait == utils::BQ_WAIT_SPIN)
+                _spin_hit_counter->increment();
             batch_size = 1;
             return t;
         }
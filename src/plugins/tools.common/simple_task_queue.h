@@ -45,6 +45,7 @@ namespace dsn {
         {
         public:
             simple_task_queue(task_worker_pool* pool, int index, task_queue* inner_provider);
+            virtual ~simple_task_queue();
 
             virtual void     enqueue(task* task) override;
             virtual task*    dequeue(/*inout*/int& batch_size) override;
@@ -52,6 +53,10 @@ namespace dsn {
         private:
             typedef utils::blocking_priority_queue<task*, TASK_PRIORITY_COUNT> tqueue;
             tqueue _samples;
+
+            // how idle workers get their tasks, see worker_idle_mode_t
+            perf_counter_ptr _sema_wait_counter;
+            perf_counter_ptr _spin_hit_counter;
         };
 
         class simple_timer_service : public timer_service
@@ -0,0 +1,106 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     rate counters per task code, created on first use
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+
+# include <dsn/tool_api.h>
+# include <dsn/utility/synchronize.h>
+# include <atomic>
+# include <memory>
+
+namespace dsn {
+    namespace tools {
+
+        //
+        // counters are named as <prefix><task code name>, and only created for the
+        // task codes really seen, so that the hot path is a single atomic load
+        //
+        class task_code_counters
+        {
+        public:
+            task_code_counters(const char* app, const std::string& prefix, const char* dsptr)
+                : _app(app), _prefix(prefix), _dsptr(dsptr), _count(dsn_task_code_max() + 1),
+                _counters(new std::atomic<perf_counter*>[_count])
+            {
+                for (int i = 0; i < _count; i++)
+                    _counters[i].store(nullptr);
+            }
+
+            ~task_code_counters()
+            {
+                for (auto& c : _refs)
+                    perf_counter::remove_counter(c->full_name());
+            }
+
+            void increment(task* t)
+            {
+                int code = static_cast<int>(t->code());
+                if (code < 0 || code >= _count)
+                    return;
+
+                perf_counter* c = _counters[code].load(std::memory_order_acquire);
+                if (c == nullptr)
+                    c = create(code, t->spec().name.c_str());
+                c->increment();
+            }
+
+        private:
+            perf_counter* create(int code, const char* name)
+            {
+                utils::auto_lock<utils::ex_lock_nr> l(_lock);
+                perf_counter* c = _counters[code].load(std::memory_order_relaxed);
+                if (c == nullptr)
+                {
+                    auto ptr = perf_counter::get_counter(_app.c_str(), "engine",
+                        (_prefix + name).c_str(), COUNTER_TYPE_RATE, _dsptr.c_str(), true);
+                    _refs.push_back(ptr);
+                    c = ptr.get();
+                    _counters[code].store(c, std::memory_order_release);
+                }
+                return c;
+            }
+
+        private:
+            std::string                                   _app;
+            std::string                                   _prefix;
+            std::string                                   _dsptr;
+            int                                           _count;
+            std::unique_ptr<std::atomic<perf_counter*>[]> _counters;
+
+            utils::ex_lock_nr                             _lock;
+            std::vector<perf_counter_ptr>                 _refs;
+        };
+    }
+}
@@ -0,0 +1,154 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Performance test for the emulator event wheel.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include <dsn/service_api_c.h>
+# include <dsn/tool_api.h>
+# include <gtest/gtest.h>
+# include <chrono>
+# include <iostream>
+# include <map>
+
+# include "scheduler.h"
+
+using namespace ::dsn;
+using namespace ::dsn::tools;
+
+static task* fake_task(uint64_t i)
+{
+    return reinterpret_cast<task*>(static_cast<uintptr_t>(i + 1));
+}
+
+// the previous implementation, kept here as the baseline for the benchmark
+class map_event_wheel
+{
+public:
+    ~map_event_wheel()
+    {
+        for (auto& kv : _events)
+            delete kv.second;
+    }
+
+    void add_event(uint64_t ts, task* t)
+    {
+        utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
+        std::vector<event_entry>* evts;
+        auto itr = _events.find(ts);
+        if (itr != _events.end())
+            evts = itr->second;
+        else
+        {
+            evts = new std::vector<event_entry>();
+            _events.insert(std::make_pair(ts, evts));
+        }
+
+        event_entry entry;
+        entry.app_task = t;
+        evts->push_back(entry);
+    }
+
+    std::vector<event_entry>* pop_next_events(/*out*/ uint64_t& ts)
+    {
+        utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
+        std::vector<event_entry>* evts = nullptr;
+        auto itr = _events.begin();
+        if (itr != _events.end())
+        {
+            evts = itr->second;
+            ts = itr->first;
+            _events.erase(itr);
+        }
+        return evts;
+    }
+
+private:
+    std::map<uint64_t, std::vector<event_entry>*> _events;
+    ::dsn::utils::ex_lock _lock;
+};
+
+// simulates the emulator pattern: keep a window of pending events,
+// pop the earliest batch and schedule new events at now + random delay
+template<typename TWheel, typename TPop, typename TFree>
+static void event_wheel_benchmark(const char* name, TWheel& wheel, TPop pop, TFree free_events)
+{
+    const int pending_count = 10000;
+    const int event_count = 1000000;
+
+    uint64_t now = 0;
+    uint64_t seed = 1;
+    auto next_delay = [&seed]()
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (seed >> 33) % 1000;
+    };
+
+    for (int i = 0; i < pending_count; i++)
+        wheel.add_event(now + next_delay(), fake_task(i));
+
+    int processed = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (processed < event_count)
+    {
+        auto evts = pop(wheel, now);
+        for (size_t i = 0; i < evts->size(); i++)
+            wheel.add_event(now + next_delay(), fake_task(processed + i));
+        processed += static_cast<int>(evts->size());
+        free_events(wheel, evts);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << name << " throughput = "
+        << static_cast<uint64_t>(processed) * 1000 * 1000 / (us > 0 ? us : 1)
+        << " events/s" << std::endl;
+}
+
+TEST(perf_tools_emulator, event_wheel)
+{
+    {
+        map_event_wheel wheel;
+        event_wheel_benchmark("map event wheel", wheel,
+            [](map_event_wheel& w, uint64_t& ts) { return w.pop_next_events(ts); },
+            [](map_event_wheel& w, std::vector<event_entry>* evts) { delete evts; }
+            );
+    }
+
+    {
+        event_wheel wheel;
+        event_wheel_benchmark("pooled event wheel", wheel,
+            [](event_wheel& w, uint64_t& ts) { return w.pop_next_events(ts); },
+            [](event_wheel& w, event_batch* evts) { w.free_events(evts); }
+            );
+    }
+}
@@ -0,0 +1,102 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ *
+ * -=- Robust Distributed System Nucleus (rDSN) -=-
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the emulator event wheel.
+ *
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include <dsn/service_api_c.h>
+# include <dsn/tool_api.h>
+# include <gtest/gtest.h>
+
+# include "scheduler.h"
+
+using namespace ::dsn;
+using namespace ::dsn::tools;
+
+static task* fake_task(uint64_t i)
+{
+    return reinterpret_cast<task*>(static_cast<uintptr_t>(i + 1));
+}
+
+TEST(tools_emulator, event_wheel_order)
+{
+    event_wheel wheel;
+    uint64_t ts = 0;
+    ASSERT_EQ(nullptr, wheel.pop_next_events(ts));
+    ASSERT_FALSE(wheel.has_more_events());
+
+    wheel.add_event(30, fake_task(0));
+    wheel.add_event(10, fake_task(1));
+    wheel.add_event(30, fake_task(2));
+    int sys_called = 0;
+    wheel.add_system_event(10, [&sys_called]() { ++sys_called; });
+    wheel.add_event(20, fake_task(4));
+    wheel.add_event(10, fake_task(5));
+    ASSERT_TRUE(wheel.has_more_events());
+
+    // events with the same ts come out together and in insertion order
+    auto evts = wheel.pop_next_events(ts);
+    ASSERT_NE(nullptr, evts);
+    EXPECT_EQ(10u, ts);
+    ASSERT_EQ(3u, evts->size());
+    EXPECT_EQ(fake_task(1), (*evts)[0]->app_task);
+    EXPECT_EQ(nullptr, (*evts)[1]->app_task);
+    (*evts)[1]->system_task();
+    EXPECT_EQ(1, sys_called);
+    EXPECT_EQ(fake_task(5), (*evts)[2]->app_task);
+    wheel.free_events(evts);
+
+    evts = wheel.pop_next_events(ts);
+    ASSERT_NE(nullptr, evts);
+    EXPECT_EQ(20u, ts);
+    ASSERT_EQ(1u, evts->size());
+    EXPECT_EQ(fake_task(4), (*evts)[0]->app_task);
+
+    // batches in flight are independent from each other
+    auto evts2 = wheel.pop_next_events(ts);
+    ASSERT_NE(nullptr, evts2);
+    EXPECT_EQ(30u, ts);
+    ASSERT_EQ(2u, evts2->size());
+    EXPECT_EQ(fake_task(0), (*evts2)[0]->app_task);
+    EXPECT_EQ(fake_task(2), (*evts2)[1]->app_task);
+    EXPECT_EQ(fake_task(4), (*evts)[0]->app_task);
+    wheel.free_events(evts);
+    wheel.free_events(evts2);
+
+    ASSERT_FALSE(wheel.has_more_events());
+    ASSERT_EQ(nullptr, wheel.pop_next_events(ts));
+
+    wheel.add_event(5, fake_task(6));
+    wheel.clear();
+    ASSERT_FALSE(wheel.has_more_events());
+}
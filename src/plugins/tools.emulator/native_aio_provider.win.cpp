@@ -170,6 +170,10 @@ dsn_handle_t native_win_aio_provider::open(const char* file_name, int oflag, int
         derror("Invalid open flag");
     }
 
+    if (oflag & DSN_O_DIRECT) {
+        dwFlagsAndAttributes |= FILE_FLAG_NO_BUFFERING;
+    }
+
     /*
     * try to open/create the file
     */
@@ -67,19 +67,44 @@ namespace dsn { namespace tools {
            set_connected();
     }
 
-    static message_ex* virtual_send_message(message_ex* msg)
+    static message_ex* virtual_send_message(message_ex* msg, bool zero_copy)
     {
-        std::shared_ptr<char> buffer(dsn::make_shared_array<char>(msg->header->body_length + sizeof(message_header)));
-        char* tmp = buffer.get();
+        message_ex* recv_msg = nullptr;
+        if (zero_copy)
+        {
+            // the body is handed over by reference when it is contiguous, while the 
+            // header is always copied as it is mutable on both the sender and receiver side
+            blob body;
+            bool contiguous = true;
+            if (msg->buffers.size() == 1)
+                body = msg->buffers[0].range((int)sizeof(message_header));
+            else if (msg->buffers.size() == 2 && msg->buffers[0].length() == (int)sizeof(message_header))
+                body = msg->buffers[1];
+            else
+                contiguous = false;
+
+            if (contiguous)
+            {
+                recv_msg = message_ex::create_receive_message_with_standalone_header(body);
+                memcpy((void*)recv_msg->header, (const void*)msg->header, sizeof(message_header));
+            }
+        }
 
-        for (auto& buf : msg->buffers)
+        if (recv_msg == nullptr)
         {
-            memcpy((void*)tmp, (const void*)buf.data(), (size_t)buf.length());
-            tmp += buf.length();
+            std::shared_ptr<char> buffer(dsn::make_shared_array<char>(msg->header->body_length + sizeof(message_header)));
+            char* tmp = buffer.get();
+
+            for (auto& buf : msg->buffers)
+            {
+                memcpy((void*)tmp, (const void*)buf.data(), (size_t)buf.length());
+                tmp += buf.length();
+            }
+
+            blob bb(buffer, 0, msg->header->body_length + sizeof(message_header));
+            recv_msg = message_ex::create_receive_message(bb);
         }
 
-        blob bb(buffer, 0, msg->header->body_length + sizeof(message_header));
-        message_ex* recv_msg = message_ex::create_receive_message(bb);
         recv_msg->to_address = msg->to_address;
 
         msg->copy_to(*recv_msg); // extensible object state move
@@ -111,7 +136,8 @@ namespace dsn { namespace tools {
                     rnet->on_server_session_accepted(server_session);
                 }
 
-                message_ex* recv_msg = virtual_send_message(msg);
+                message_ex* recv_msg = virtual_send_message(msg, 
+                    (static_cast<sim_network_provider*>(&_net))->is_zero_copy());
 
                 {
                     node_scoper ns(rnet->node());
@@ -143,7 +169,8 @@ namespace dsn { namespace tools {
     {
         for (auto& msg : _sending_msgs)
         {
-            message_ex* recv_msg = virtual_send_message(msg);
+            message_ex* recv_msg = virtual_send_message(msg, 
+                (static_cast<sim_network_provider*>(&_net))->is_zero_copy());
 
             {
                 node_scoper ns(_client->net().node());
@@ -173,6 +200,9 @@ namespace dsn { namespace tools {
         _max_message_delay_microseconds = (uint32_t)dsn_config_get_value_uint64("tools.emulator",
             "max_message_delay_microseconds", _max_message_delay_microseconds,
             "max message delay (us)");
+        _zero_copy = dsn_config_get_value_bool("tools.emulator",
+            "zero_copy_message", false,
+            "whether to hand the sender's message buffers over to the receiver by reference instead of copying them");
     }
 
     error_code sim_network_provider::start(rpc_channel channel, int port, bool client_only, io_modifer& ctx)
@@ -97,11 +97,13 @@ namespace dsn { namespace tools {
         }
 
         uint32_t net_delay_milliseconds() const;
+        bool is_zero_copy() const { return _zero_copy; }
 
     private:
         ::dsn::rpc_address    _address;
         uint32_t     _min_message_delay_microseconds;
         uint32_t     _max_message_delay_microseconds;
+        bool         _zero_copy;
     };
         
     //------------- inline implementations -------------
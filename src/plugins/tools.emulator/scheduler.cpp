@@ -39,6 +39,7 @@
 # include "scheduler.h"
 # include "env.sim.h"
 # include <set>
+# include <algorithm>
 
 # ifdef __TITLE__
 # undef __TITLE__
@@ -47,63 +48,198 @@
 
 namespace dsn { namespace tools {
 
-void event_wheel::add_event(uint64_t ts, task* t)
+event_wheel::event_wheel()
 {
-    utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
+    _free_entries = nullptr;
+    _free_slots = nullptr;
+    _buckets.resize(BLOCK_SIZE, nullptr);
+}
 
-    std::vector<event_entry>* evts;
-    auto itr = _events.find(ts);
-    if (itr != _events.end())
-        evts = itr->second;
-    else
+event_wheel::~event_wheel()
+{
+    clear();
+
+    for (auto& b : _free_batches)
+        delete b;
+    for (auto& blk : _entry_blocks)
+        delete[] blk;
+    for (auto& blk : _slot_blocks)
+        delete[] blk;
+}
+
+// lock held by caller
+event_entry* event_wheel::alloc_entry()
+{
+    if (_free_entries == nullptr)
     {
-        evts = new std::vector<event_entry>();
-        _events.insert(std::make_pair(ts, evts));
+        auto blk = new event_entry[BLOCK_SIZE];
+        _entry_blocks.push_back(blk);
+        for (int i = 0; i < BLOCK_SIZE; i++)
+        {
+            blk[i].next = _free_entries;
+            _free_entries = &blk[i];
+        }
     }
-    
-    event_entry entry;
-    entry.app_task = t;
-    evts->push_back(entry);
+
+    auto e = _free_entries;
+    _free_entries = e->next;
+    e->next = nullptr;
+    e->app_task = nullptr;
+    return e;
+}
+
+// lock held by caller
+void event_wheel::free_entry(event_entry* e)
+{
+    // release the states captured by system tasks early
+    if (e->system_task != nullptr)
+        e->system_task = nullptr;
+    e->app_task = nullptr;
+    e->next = _free_entries;
+    _free_entries = e;
+}
+
+// lock held by caller
+void event_wheel::add_entry(uint64_t ts, event_entry* e)
+{
+    auto b = bucket(ts);
+    auto slot = *b;
+    while (slot != nullptr && slot->ts != ts)
+        slot = slot->next;
+
+    if (slot != nullptr)
+    {
+        slot->last->next = e;
+        slot->last = e;
+        return;
+    }
+
+    if (_heap.size() >= _buckets.size())
+    {
+        rehash(_buckets.size() * 2);
+        b = bucket(ts);
+    }
+
+    if (_free_slots == nullptr)
+    {
+        auto blk = new event_slot[BLOCK_SIZE];
+        _slot_blocks.push_back(blk);
+        for (int i = 0; i < BLOCK_SIZE; i++)
+        {
+            blk[i].next = _free_slots;
+            _free_slots = &blk[i];
+        }
+    }
+
+    slot = _free_slots;
+    _free_slots = slot->next;
+
+    slot->ts = ts;
+    slot->first = slot->last = e;
+    slot->next = *b;
+    *b = slot;
+
+    _heap.push_back(slot);
+    std::push_heap(_heap.begin(), _heap.end(), later);
+}
+
+// lock held by caller
+void event_wheel::rehash(size_t bucket_count)
+{
+    std::fill(_buckets.begin(), _buckets.end(), nullptr);
+    _buckets.resize(bucket_count, nullptr);
+
+    for (auto& slot : _heap)
+    {
+        auto b = bucket(slot->ts);
+        slot->next = *b;
+        *b = slot;
+    }
+}
+
+void event_wheel::add_event(uint64_t ts, task* t)
+{
+    utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
+
+    auto e = alloc_entry();
+    e->app_task = t;
+    add_entry(ts, e);
 }
 
 void event_wheel::add_system_event(uint64_t ts, std::function<void()> t)
 {
     utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
 
-    std::vector<event_entry>* evts;
-    auto itr = _events.find(ts);
-    if (itr != _events.end())
-        evts = itr->second;
+    auto e = alloc_entry();
+    e->system_task = std::move(t);
+    add_entry(ts, e);
+}
+
+event_batch* event_wheel::pop_next_events(/*out*/ uint64_t& ts)
+{
+    utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
+
+    if (_heap.empty())
+        return nullptr;
+
+    std::pop_heap(_heap.begin(), _heap.end(), later);
+    auto slot = _heap.back();
+    _heap.pop_back();
+
+    auto b = bucket(slot->ts);
+    while (*b != slot)
+        b = &(*b)->next;
+    *b = slot->next;
+
+    event_batch* evts;
+    if (_free_batches.size() > 0)
+    {
+        evts = _free_batches.back();
+        _free_batches.pop_back();
+    }
     else
     {
-        evts = new std::vector<event_entry>();
-        _events.insert(std::make_pair(ts, evts));
+        evts = new event_batch();
     }
 
-    event_entry entry;
-    entry.system_task = std::move(t);
-    entry.app_task = nullptr;
-    evts->push_back(entry);
+    ts = slot->ts;
+    for (auto e = slot->first; e != nullptr; e = e->next)
+        evts->push_back(e);
+
+    slot->next = _free_slots;
+    _free_slots = slot;
+    return evts;
 }
 
-std::vector<event_entry>* event_wheel::pop_next_events(/*out*/ uint64_t& ts)
+void event_wheel::free_events(event_batch* evts)
 {
     utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
 
-    std::vector<event_entry>* evts = NULL;
-    auto itr = _events.begin();
-    if (itr != _events.end()){
-        evts = itr->second;
-        ts = itr->first;
-        _events.erase(itr);
-    }
-    return evts;
+    for (auto& e : *evts)
+        free_entry(e);
+    evts->clear();
+    _free_batches.push_back(evts);
 }
 
 void event_wheel::clear()
 {
     utils::auto_lock< ::dsn::utils::ex_lock> l(_lock);
-    _events.clear();
+
+    for (auto& slot : _heap)
+    {
+        auto e = slot->first;
+        while (e != nullptr)
+        {
+            auto next = e->next;
+            free_entry(e);
+            e = next;
+        }
+
+        slot->next = _free_slots;
+        _free_slots = slot;
+    }
+    _heap.clear();
+    std::fill(_buckets.begin(), _buckets.end(), nullptr);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////
@@ -194,7 +330,7 @@ void scheduler::add_task(task* tsk, task_queue* q)
 
 void scheduler::add_system_event(uint64_t ts_ns, std::function<void()> t)
 {
-    _wheel.add_system_event(ts_ns, t);
+    _wheel.add_system_event(ts_ns, std::move(t));
 }
 
 void scheduler::start()
@@ -295,9 +431,9 @@ void scheduler::schedule()
 
             for (auto e : *events)
             {
-                if (e.app_task != nullptr)
+                if (e->app_task != nullptr)
                 {
-                    task* t = e.app_task;
+                    task* t = e->app_task;
 
                     {
                         node_scoper ns(t->node());
@@ -308,12 +444,12 @@ void scheduler::schedule()
                 }
                 else
                 {
-                    dassert(e.system_task != nullptr, "app and system tasks cannot be both empty");
-                    e.system_task();
+                    dassert(e->system_task != nullptr, "app and system tasks cannot be both empty");
+                    e->system_task();
                 }
             }
 
-            delete events;
+            _wheel.free_events(events);
             continue;
         }
 
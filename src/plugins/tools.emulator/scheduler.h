@@ -44,22 +44,63 @@ struct event_entry
 {
     task*                 app_task;
     std::function<void()> system_task;
+    event_entry*          next;
 };
 
+typedef std::vector<event_entry*> event_batch;
+
+//
+// event_wheel keeps all events of the same timestamp in an intrusive slot,
+// slots are indexed by a hash table on ts, and ordered by a min-heap on ts;
+// entries, slots and batches are all pooled so that app task events need no
+// memory allocation in steady state; system events are moved into the pooled
+// entry, but a std::function whose captures exceed its small buffer still
+// allocates when it is constructed by the caller
+//
 class event_wheel
 {
 public:
-    ~event_wheel() { clear(); }
+    event_wheel();
+    ~event_wheel();
 
     void add_event(uint64_t ts, task* t);
     void add_system_event(uint64_t ts, std::function<void()> t);
-    std::vector<event_entry>* pop_next_events(/*out*/ uint64_t& ts);
+
+    // pop all events with the smallest timestamp, in the order they were added,
+    // the returned batch must be given back by free_events after use
+    event_batch* pop_next_events(/*out*/ uint64_t& ts);
+    void free_events(event_batch* evts);
+
     void clear();
-    bool has_more_events() const {  utils::auto_lock< ::dsn::utils::ex_lock> l(_lock); return _events.size() > 0; }
+    bool has_more_events() const {  utils::auto_lock< ::dsn::utils::ex_lock> l(_lock); return _heap.size() > 0; }
+
+private:
+    struct event_slot
+    {
+        uint64_t     ts;
+        event_entry* first;
+        event_entry* last;
+        event_slot*  next; // hash chain, or free list
+    };
+
+    event_entry* alloc_entry();
+    void free_entry(event_entry* e);
+    void add_entry(uint64_t ts, event_entry* e);
+    void rehash(size_t bucket_count);
+    event_slot** bucket(uint64_t ts) { return &_buckets[(ts ^ (ts >> 20)) & (_buckets.size() - 1)]; }
+
+    static bool later(const event_slot* l, const event_slot* r) { return l->ts > r->ts; }
 
 private:
-    typedef std::map<uint64_t, std::vector<event_entry>*>  Events;
-    Events _events;
+    enum { BLOCK_SIZE = 1024 };
+
+    std::vector<event_slot*>      _heap;
+    std::vector<event_slot*>      _buckets;
+    event_entry*                  _free_entries;
+    event_slot*                   _free_slots;
+    std::vector<event_entry*>     _entry_blocks;
+    std::vector<event_slot*>      _slot_blocks;
+    std::vector<event_batch*>     _free_batches;
     mutable ::dsn::utils::ex_lock _lock;
 };
 
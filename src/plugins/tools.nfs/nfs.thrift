@@ -12,6 +12,10 @@ struct copy_request
     6: i32 size;
     7: bool is_last;
     8: bool overwrite;
+    9: bool append_content; // file content follows copy_response in the same message
+    10: bool need_checksum; // return crc64 of the block in copy_response.checksum
+    11: bool has_dst_checksum;
+    12: i64 dst_checksum; // crc64 of the block at the destination, content is omitted if unchanged
 }
 
 struct copy_response
@@ -20,6 +24,8 @@ struct copy_response
     2: dsn.blob file_content;
     3: i64 offset;
     4: i32 size;
+    5: i64 checksum;
+    6: bool is_same; // block is identical to the destination one, file_content is empty
 }
 
 struct get_file_size_request
@@ -92,19 +92,46 @@ namespace dsn {
                 return;
             }
 
+            std::vector< ::dsn::ref_ptr<copy_request_ex> > new_requests;
             for (size_t i = 0; i < resp.size_list.size(); i++) // file list
             {
                 file_context *filec;
                 uint64_t size = resp.size_list[i];
+                std::string file_path = utils::filesystem::path_combine(ureq->file_size_req.dst_dir, resp.file_list[i]);
 
                 filec = new file_context(ureq, resp.file_list[i], resp.size_list[i]);
-                ureq->file_context_map.insert(std::pair<std::string, file_context*>(
-                    utils::filesystem::path_combine(ureq->file_size_req.dst_dir, resp.file_list[i]), 
-                    filec
-                    ));
+                ureq->file_context_map.insert(std::pair<std::string, file_context*>(file_path, filec));
 
                 //dinfo("this file size is %d, name is %s", size, resp.file_list[i].c_str());
 
+                int resumed_segments = _opts.resume_copy
+                    ? _resume.restore(
+                        file_path,
+                        ureq->file_size_req.source.to_string(),
+                        utils::filesystem::path_combine(ureq->file_size_req.source_dir, resp.file_list[i]),
+                        size
+                        )
+                    : 0;
+
+                // for delta copy and resume, blocks already at the destination are compared by checksum
+                // first, so that they are neither transferred nor rewritten when they are the same
+                int64_t dst_size = 0;
+                if ((_opts.delta_copy || resumed_segments > 0) && utils::filesystem::file_size(file_path, dst_size))
+                {
+                    if (dst_size > (int64_t)size)
+                    {
+                        utils::filesystem::remove_path(file_path);
+                        resumed_segments = 0;
+                        dst_size = 0;
+                    }
+                    else
+                    {
+                        filec->file = dsn_file_open(file_path.c_str(), O_RDWR | O_BINARY, 0666);
+                        if (!filec->file)
+                            dst_size = 0;
+                    }
+                }
+
                 // new all the copy requests                
 
                 uint64_t req_offset = 0;
@@ -117,14 +144,9 @@ namespace dsn {
                 int idx = 0;
                 for (;;) // send one file with multi-round rpc
                 {
-                    auto req = dsn::ref_ptr<copy_request_ex>(new copy_request_ex(filec, idx++));
+                    auto req = dsn::ref_ptr<copy_request_ex>(new copy_request_ex(filec, idx));
                     filec->copy_requests.push_back(req);
 
-                    {
-                        zauto_lock l(_copy_requests_lock);
-                        _copy_requests.push(req);
-                    }
-
                     req->copy_req.source = ureq->file_size_req.source;
                     req->copy_req.file_name = resp.file_list[i];
                     req->copy_req.offset = req_offset;
@@ -133,6 +155,12 @@ namespace dsn {
                     req->copy_req.source_dir = ureq->file_size_req.source_dir;
                     req->copy_req.overwrite = ureq->file_size_req.overwrite;
                     req->copy_req.is_last = (size <= req_size);
+                    req->copy_req.append_content = _opts.append_copy_content;
+                    req->copy_req.need_checksum = _opts.verify_copy_checksum;
+                    req->need_dst_checksum = (_opts.delta_copy || idx < resumed_segments)
+                        && req_size > 0 && req_offset + req_size <= (uint64_t)dst_size;
+                    new_requests.push_back(req);
+                    idx++;
 
                     req_offset += req_size;
                     size -= req_size;
@@ -147,6 +175,20 @@ namespace dsn {
                     else
                         req_size = static_cast<uint32_t>(size);
                 }
+
+                filec->segment_written.resize(filec->copy_requests.size(), false);
+            }
+
+            if (ureq->file_context_map.empty())
+            {
+                handle_completion(ureq, ERR_OK);
+                return;
+            }
+
+            {
+                zauto_lock l(_copy_requests_lock);
+                for (auto& req : new_requests)
+                    _copy_requests.push(req);
             }
 
             continue_copy(0);
@@ -160,7 +202,7 @@ namespace dsn {
                 _concurrent_copy_request_count -= done_count;
             }
 
-            if (++_concurrent_copy_request_count > _opts.max_concurrent_remote_copy_requests)
+            if (++_concurrent_copy_request_count > _copy_window.get())
             {
                 --_concurrent_copy_request_count;
                 return;
@@ -188,19 +230,37 @@ namespace dsn {
                     if (req->is_valid)
                     {
                         req->add_ref();
-                        req->remote_copy_task = copy(
-                            req->copy_req,
-                            [=](error_code err, copy_response&& resp)
-                            {
-                                end_copy(err, std::move(resp), req.get());
-                            },
-                            std::chrono::milliseconds(0),
-                            0,
-                            0,
-                            0,
-                            req->file_ctx->user_req->file_size_req.source);
-
-                        if (++_concurrent_copy_request_count > _opts.max_concurrent_remote_copy_requests)
+                        uint64_t delay_ms = acquire_bandwidth(req->file_ctx->user_req->file_size_req.source, req->copy_req.size);
+                        if (delay_ms > 0)
+                        {
+                            // the slot is kept while waiting so that no other copy passes the limit
+                            req->remote_copy_task = tasking::enqueue(
+                                LPC_NFS_COPY_THROTTLING,
+                                this,
+                                [this, req]()
+                                {
+                                    {
+                                        zauto_lock l(req->lock);
+                                        if (req->is_valid)
+                                        {
+                                            start_copy_request(req);
+                                            return;
+                                        }
+                                    }
+
+                                    req->release_ref();
+                                    continue_copy(1);
+                                },
+                                0,
+                                std::chrono::milliseconds(delay_ms)
+                                );
+                        }
+                        else
+                        {
+                            start_copy_request(req);
+                        }
+
+                        if (++_concurrent_copy_request_count > _copy_window.get())
                         {
                             --_concurrent_copy_request_count;
                             break;
@@ -210,6 +270,160 @@ namespace dsn {
             }
         }
 
+        void nfs_client_impl::start_copy_request(::dsn::ref_ptr<copy_request_ex> req)
+        {
+            if (req->need_dst_checksum)
+            {
+                // read the destination block first, see end_read_dst_block
+                req->dst_buffer = _buffer_pool.get(req->copy_req.size);
+                req->remote_copy_task = file::read(
+                    req->file_ctx->file.load(),
+                    req->dst_buffer.get(),
+                    req->copy_req.size,
+                    req->copy_req.offset,
+                    LPC_NFS_READ,
+                    this,
+                    [this, req](error_code err, int sz)
+                    {
+                        end_read_dst_block(err, sz, req);
+                    }
+                    );
+            }
+            else
+            {
+                send_copy_request(req);
+            }
+        }
+
+        uint64_t nfs_client_impl::acquire_bandwidth(::dsn::rpc_address remote, uint64_t bytes)
+        {
+            if (_opts.max_copy_bytes_per_second_per_remote == 0)
+                return 0;
+
+            token_bucket* limiter;
+            {
+                zauto_lock l(_bandwidth_limiters_lock);
+                auto& ptr = _bandwidth_limiters[remote];
+                if (ptr == nullptr)
+                    ptr.reset(new token_bucket(_opts.max_copy_bytes_per_second_per_remote));
+                limiter = ptr.get();
+            }
+            return limiter->acquire(bytes);
+        }
+
+        void nfs_client_impl::send_copy_request(::dsn::ref_ptr<copy_request_ex> req)
+        {
+            req->copy_start_us = dsn_now_us();
+            req->remote_copy_task = ::dsn::rpc::call(
+                req->file_ctx->user_req->file_size_req.source,
+                RPC_NFS_COPY,
+                req->copy_req,
+                this,
+                [=](error_code err, dsn_message_t request, dsn_message_t response)
+                {
+                    copy_response resp;
+                    if (err == ERR_OK)
+                    {
+                        err = unmarshall_copy_response(response, resp);
+                    }
+                    end_copy(err, std::move(resp), req.get());
+                });
+        }
+
+        void nfs_client_impl::end_read_dst_block(error_code err, size_t sz, ::dsn::ref_ptr<copy_request_ex> req)
+        {
+            {
+                zauto_lock l(req->lock);
+                if (req->is_valid)
+                {
+                    // on read failure the block is simply copied as a whole
+                    if (err == ERR_OK && sz == (size_t)req->copy_req.size)
+                    {
+                        req->copy_req.has_dst_checksum = true;
+                        req->copy_req.dst_checksum = static_cast<int64_t>(dsn_crc64_compute(req->dst_buffer.get(), sz, 0));
+                    }
+                    req->dst_buffer = nullptr;
+                    send_copy_request(req);
+                    return;
+                }
+            }
+
+            req->release_ref();
+            continue_copy(1);
+        }
+
+        ::dsn::error_code nfs_client_impl::unmarshall_copy_response(dsn_message_t response, /*out*/ copy_response& resp)
+        {
+            ::dsn::rpc_read_stream reader(response);
+            unmarshall(reader, resp, dsn_msg_get_serialize_format(response));
+
+            // old servers or failed reads carry the content (if any) inside copy_response,
+            // and unchanged blocks carry no content at all
+            if (resp.error != ERR_OK || resp.size <= 0 || resp.is_same || resp.file_content.length() > 0)
+                return ERR_OK;
+
+            auto content = reader.get_remaining_buffer();
+            if (static_cast<int64_t>(content.length()) < resp.size)
+            {
+                derror("nfs: invalid copy response, appended content size %u < expected size %d",
+                    content.length(),
+                    resp.size
+                    );
+                return ERR_INVALID_DATA;
+            }
+
+            // the received message owns the content, so keep it alive as long as the blob
+            reader.skip(resp.size);
+            dsn_msg_add_ref(response);
+            std::shared_ptr<char> holder(
+                const_cast<char*>(content.data()),
+                [response](char*) { dsn_msg_release_ref(response); }
+                );
+            resp.file_content = blob(std::move(holder), resp.size);
+            return ERR_OK;
+        }
+
+        ::dsn::error_code nfs_client_impl::verify_copy_response(const copy_request& req, const copy_response& resp)
+        {
+            if (resp.error != ERR_OK)
+                return resp.error;
+
+            // is_same is only a valid answer when the destination checksum is sent
+            if (resp.offset != req.offset
+                || (resp.is_same && !req.has_dst_checksum)
+                || resp.size < 0
+                || resp.size > req.size
+                || (!resp.is_same && static_cast<int64_t>(resp.file_content.length()) != resp.size))
+            {
+                derror("nfs: invalid copy response for %s [%" PRId64 ", %" PRId64 "), got [%" PRId64 ", %" PRId64 ") is_same = %s",
+                    req.file_name.c_str(),
+                    req.offset,
+                    req.offset + req.size,
+                    resp.offset,
+                    resp.offset + resp.size,
+                    resp.is_same ? "true" : "false"
+                    );
+                return ERR_INVALID_DATA;
+            }
+
+            // old servers do not return checksums
+            if (!resp.is_same && req.need_checksum && resp.__isset.checksum)
+            {
+                auto crc = static_cast<int64_t>(dsn_crc64_compute(resp.file_content.data(), resp.size, 0));
+                if (crc != resp.checksum)
+                {
+                    derror("nfs: checksum mismatch for %s [%" PRId64 ", %" PRId64 ")",
+                        req.file_name.c_str(),
+                        resp.offset,
+                        resp.offset + resp.size
+                        );
+                    return ERR_WRONG_CHECKSUM;
+                }
+            }
+
+            return ERR_OK;
+        }
+
         void nfs_client_impl::end_copy(
             ::dsn::error_code err,
             const copy_response& resp,
@@ -228,12 +442,64 @@ namespace dsn {
                 err = resp.error;
             }
 
+            if (err == ERR_OK)
+            {
+                err = verify_copy_response(reqc->copy_req, resp);
+            }
+
+            // the block is corrupted in transit, copy it again
+            bool is_retry = false;
+            bool is_valid = false;
+            int retried = 0;
+            if (err == ERR_WRONG_CHECKSUM || err == ERR_INVALID_DATA)
+            {
+                zauto_lock l(reqc->lock);
+                if (reqc->retried < _opts.max_copy_block_retry)
+                {
+                    is_retry = true;
+                    is_valid = reqc->is_valid;
+                    retried = ++reqc->retried;
+                }
+            }
+
+            if (is_retry)
+            {
+                if (is_valid)
+                {
+                    dwarn("nfs: copy %s [%" PRId64 ", %" PRId64 ") again for %s, retried = %d",
+                        reqc->copy_req.file_name.c_str(),
+                        reqc->copy_req.offset,
+                        reqc->copy_req.offset + reqc->copy_req.size,
+                        err.to_string(),
+                        retried
+                        );
+                    _recent_copy_retry_count.increment();
+                    {
+                        zauto_lock l(_copy_requests_lock);
+                        _copy_requests.push(::dsn::ref_ptr<copy_request_ex>(reqc));
+                    }
+                    continue_copy(0);
+                }
+                return;
+            }
+
+            if (err == ERR_OK)
+                _copy_window.on_success(dsn_now_us() - reqc->copy_start_us);
+            else
+                _copy_window.on_failure();
+            _copy_concurrency.set(_copy_window.get());
+
             if (err != ::dsn::ERR_OK)
             {
+                _recent_copy_fail_count.increment();
                 handle_completion(reqc->file_ctx->user_req, err);
                 return;
             }
             
+            if (resp.is_same)
+                _recent_copy_skip_size.add(resp.size);
+            else
+                _recent_copy_data_size.add(resp.size);
             reqc->response = resp;
             reqc->response.error.end_tracking(); // always ERR_OK
             reqc->is_ready_for_write = true;
@@ -272,7 +538,7 @@ namespace dsn {
         void nfs_client_impl::continue_write()
         {
             // check write quota
-            if (++_concurrent_local_write_count > _opts.max_concurrent_local_writes)
+            if (++_concurrent_local_write_count > _write_window.get())
             {
                 --_concurrent_local_write_count;
                 return;
@@ -296,11 +562,19 @@ namespace dsn {
                     }   
                 }
 
+                bool is_same;
                 {
                     zauto_lock l(reqc->lock);
-                    if (reqc->is_valid)
-                        break;
+                    if (!reqc->is_valid)
+                        continue;
+                    is_same = reqc->response.is_same;
                 }
+
+                if (!is_same)
+                    break;
+
+                // unchanged block at the destination, nothing to write
+                end_write_segment(ERR_OK, std::move(reqc));
             }
 
             if (nullptr == reqc)
@@ -342,6 +616,7 @@ namespace dsn {
             {
                 zauto_lock l(reqc->lock);
                 auto& reqc_save = *reqc.get();
+                reqc_save.write_start_us = dsn_now_us();
                 reqc_save.local_write_task = file::write(
                     hfile,
                     reqc_save.response.file_content.data(),
@@ -362,26 +637,69 @@ namespace dsn {
             //dassert(reqc->local_write_task == task::get_current_task(), "");
             --_concurrent_local_write_count;
 
+            if (err == ERR_OK)
+                _write_window.on_success(dsn_now_us() - reqc->write_start_us);
+            else
+                _write_window.on_failure();
+            _write_concurrency.set(_write_window.get());
+
             // clear all content to release memory quickly
             reqc->response.file_content = blob();
 
             continue_write();
 
+            end_write_segment(err, std::move(reqc));
+        }
+
+        void nfs_client_impl::end_write_segment(error_code err, dsn::ref_ptr<copy_request_ex> reqc)
+        {
             bool completed = false;
+            int saved_segments = 0;
+            std::string file_path, source, source_path;
+            uint64_t file_size = 0;
             if (err != ERR_OK)
             {
                 completed = true;
             }
             else
             {
-                zauto_lock l(reqc->file_ctx->user_req->user_req_lock);
-                if (++reqc->file_ctx->finished_segments == (int)reqc->file_ctx->copy_requests.size())
+                auto fc = reqc->file_ctx;
+                zauto_lock l(fc->user_req->user_req_lock);
+
+                int written_segments = fc->written_segments;
+                fc->segment_written[reqc->index] = true;
+                while (fc->written_segments < (int)fc->segment_written.size() 
+                    && fc->segment_written[fc->written_segments])
                 {
-                    if (++reqc->file_ctx->user_req->finished_files == (int)reqc->file_ctx->user_req->file_context_map.size())
+                    fc->written_segments++;
+                }
+
+                file_path = utils::filesystem::path_combine(fc->user_req->file_size_req.dst_dir, fc->file_name);
+                if (++fc->finished_segments == (int)fc->copy_requests.size())
+                {
+                    if (_opts.resume_copy)
+                    {
+                        _resume.clear(file_path);
+                    }
+
+                    if (++fc->user_req->finished_files == (int)fc->user_req->file_context_map.size())
                     {
                         completed = true;
                     }
                 }
+                else if (_opts.resume_copy && written_segments != fc->written_segments)
+                {
+                    // saved after the lock is released, as it is synchronous file io
+                    saved_segments = fc->written_segments;
+                    source = fc->user_req->file_size_req.source.to_string();
+                    source_path = utils::filesystem::path_combine(fc->user_req->file_size_req.source_dir, fc->file_name);
+                    file_size = fc->file_size;
+                }
+            }
+
+            if (saved_segments > 0)
+            {
+                _resume.save(file_path, source, source_path, file_size, saved_segments);
             }
 
             if (completed)
@@ -389,7 +707,7 @@ namespace dsn {
                 handle_completion(reqc->file_ctx->user_req, err);
             }
         }
-        
+
         void nfs_client_impl::handle_completion(user_request *req, error_code err)
         {
             {
@@ -446,10 +764,16 @@ namespace dsn {
 
                     f.second->file = nullptr;
 
+                    // partial files are removed from the destination directory,
+                    // or moved to the resume directory for resuming on retry
                     if (f.second->finished_segments != (int)f.second->copy_requests.size())
                     {
-                        ::remove((f.second->user_req->file_size_req.dst_dir 
-                            + f.second->file_name).c_str());
+                        std::string file_path = utils::filesystem::path_combine(
+                            f.second->user_req->file_size_req.dst_dir, f.second->file_name);
+                        if (_opts.resume_copy)
+                            _resume.stash(file_path);
+                        else
+                            ::remove(file_path.c_str());
                     }
 
                     f.second->copy_requests.clear();
@@ -36,6 +36,9 @@
 # include "nfs_client.h"
 # include <queue>
 # include <dsn/tool-api/nfs.h>
+# include <dsn/cpp/perf_counter_.h>
+# include "nfs_flow_control.h"
+# include "nfs_resume_store.h"
 
 namespace dsn {
     namespace service {
@@ -49,6 +52,17 @@ namespace dsn {
             int file_close_expire_time_ms;
             int file_close_timer_interval_ms_on_server;
             int max_file_copy_request_count_per_file;
+            bool append_copy_content;
+            bool verify_copy_checksum;
+            bool resume_copy;
+            std::string resume_dir;
+            bool delta_copy;
+            int max_copy_block_retry;
+
+            bool adaptive_concurrency;
+            double concurrency_latency_tolerance;
+            uint64_t max_copy_bytes_per_second_per_remote;
+            int copy_buffer_pool_size;
 
             void init()
             {
@@ -64,6 +78,29 @@ namespace dsn {
                     30 * 1000, "time interval for checking whether cached file handles need to be closed");
                 max_file_copy_request_count_per_file = (int)dsn_config_get_value_uint64("nfs", "max_file_copy_request_count_per_file", 
                     10, "maximum concurrent remote copy requests for the same file on nfs client"); // limit each file copy speed
+                append_copy_content = dsn_config_get_value_bool("nfs", "append_copy_content",
+                    true, "whether the file content is appended to the copy response by reference instead of being serialized into it");
+                verify_copy_checksum = dsn_config_get_value_bool("nfs", "verify_copy_checksum",
+                    true, "whether to verify the crc64 checksum of each copied block on nfs client");
+                resume_copy = dsn_config_get_value_bool("nfs", "resume_copy",
+                    false, "whether to keep partially copied files on failure and resume them on retry, "
+                    "where the resumed blocks are verified against the source by checksum before being skipped");
+                resume_dir = dsn_config_get_value_string("nfs", "resume_dir",
+                    "./nfs_resume", "where the partially copied files are kept for resume, out of the destination directories");
+                delta_copy = dsn_config_get_value_bool("nfs", "delta_copy",
+                    false, "whether to skip blocks that are already identical at the destination when overwriting existing files (rsync-like)");
+                max_copy_block_retry = (int)dsn_config_get_value_uint64("nfs", "max_copy_block_retry",
+                    2, "how many times a block is copied again when it is corrupted in transit (checksum mismatch or invalid response)");
+
+                adaptive_concurrency = dsn_config_get_value_bool("nfs", "adaptive_concurrency",
+                    false, "whether to adapt the concurrent remote copies and local writes on nfs client to the observed latency, "
+                    "with max_concurrent_remote_copy_requests and max_concurrent_local_writes as the upper bounds");
+                concurrency_latency_tolerance = dsn_config_get_value_double("nfs", "concurrency_latency_tolerance",
+                    2.0, "the concurrency is halved when the latency exceeds this times the base latency");
+                max_copy_bytes_per_second_per_remote = dsn_config_get_value_uint64("nfs", "max_copy_bytes_per_second_per_remote",
+                    0, "maximum copy bandwidth (bytes per second) from each remote server on nfs client, 0 for unlimited");
+                copy_buffer_pool_size = (int)dsn_config_get_value_uint64("nfs", "copy_buffer_pool_size",
+                    16, "maximum number of free nfs_copy_block_bytes buffers cached for reuse");
             }
         };
 
@@ -83,6 +120,11 @@ namespace dsn {
                 ::dsn::task_ptr local_write_task;
                 bool          is_ready_for_write;
                 bool          is_valid;
+                bool          need_dst_checksum; // read the destination block first for delta copy or resume
+                int           retried;
+                uint64_t      copy_start_us;
+                uint64_t      write_start_us;
+                std::shared_ptr<char> dst_buffer;
                 zlock         lock;
 
                 copy_request_ex(file_context* file, int idx)
@@ -93,6 +135,10 @@ namespace dsn {
                     local_write_task = nullptr;
                     is_ready_for_write = false;
                     is_valid = true;
+                    need_dst_checksum = false;
+                    retried = 0;
+                    copy_start_us = 0;
+                    write_start_us = 0;
                 }
             };
 
@@ -108,6 +154,10 @@ namespace dsn {
                 int         finished_segments;
                 std::vector< ::dsn::ref_ptr<copy_request_ex> > copy_requests;
 
+                // for resume, all segments before written_segments are on the disk
+                int         written_segments;
+                std::vector<bool> segment_written;
+
                 file_context(user_request* req, const std::string& file_nm, uint64_t sz)
                 {
                     user_req = req;
@@ -117,6 +167,7 @@ namespace dsn {
 
                     current_write_index = -1;
                     finished_segments = 0;
+                    written_segments = 0;
                 }
             };
 
@@ -142,10 +193,26 @@ namespace dsn {
             {
                 _concurrent_copy_request_count = 0;
                 _concurrent_local_write_count = 0;
+
+                _recent_copy_data_size.init("nfs.client", "recent_copy_data_size", COUNTER_TYPE_RATE, "nfs client copy data size in the recent period");
+                _recent_copy_fail_count.init("nfs.client", "recent_copy_fail_count", COUNTER_TYPE_RATE, "nfs client copy fail count in the recent period");
+                _recent_copy_skip_size.init("nfs.client", "recent_copy_skip_size", COUNTER_TYPE_RATE, "nfs client copy data size skipped by resume or delta copy in the recent period");
+                _recent_copy_retry_count.init("nfs.client", "recent_copy_retry_count", COUNTER_TYPE_RATE, "nfs client copy blocks retried for corruption in transit in the recent period");
+                _copy_concurrency.init("nfs.client", "copy_concurrency", COUNTER_TYPE_NUMBER, "current concurrent remote copy limit on nfs client");
+                _write_concurrency.init("nfs.client", "write_concurrency", COUNTER_TYPE_NUMBER, "current concurrent local write limit on nfs client");
+
+                _copy_window.init(1, opts.max_concurrent_remote_copy_requests, opts.concurrency_latency_tolerance, opts.adaptive_concurrency);
+                _write_window.init(1, opts.max_concurrent_local_writes, opts.concurrency_latency_tolerance, opts.adaptive_concurrency);
+                _buffer_pool.init(opts.nfs_copy_block_bytes, opts.copy_buffer_pool_size);
+                _resume.init(opts.resume_dir, opts.nfs_copy_block_bytes);
             }
 
             virtual ~nfs_client_impl() {}
 
+            // check the response of a copy request before it is written, return
+            // ERR_WRONG_CHECKSUM or ERR_INVALID_DATA when it is corrupted in transit
+            static ::dsn::error_code verify_copy_response(const copy_request& req, const copy_response& resp);
+
             void begin_remote_copy(std::shared_ptr<remote_copy_request>& rci, aio_task* nfs_task); // copy file request entry
 
             void local_write_callback(error_code err, size_t sz, ::dsn::ref_ptr<copy_request_ex> reqc); // write file callback
@@ -156,6 +223,9 @@ namespace dsn {
                 const copy_response& resp,
                 void* context); // rewrite end_copy function
 
+            // decode copy_response, taking the appended file content from the message without copying
+            static ::dsn::error_code unmarshall_copy_response(dsn_message_t response, /*out*/ copy_response& resp);
+
             void end_get_file_size(
                 ::dsn::error_code err,
                 const ::dsn::service::get_file_size_response& resp,
@@ -163,6 +233,17 @@ namespace dsn {
 
             void continue_copy(int done_count);
 
+            void start_copy_request(::dsn::ref_ptr<copy_request_ex> req);
+
+            void send_copy_request(::dsn::ref_ptr<copy_request_ex> req);
+
+            // return how long (ms) the copy should be delayed for the bandwidth limit of the remote
+            uint64_t acquire_bandwidth(::dsn::rpc_address remote, uint64_t bytes);
+
+            void end_read_dst_block(error_code err, size_t sz, ::dsn::ref_ptr<copy_request_ex> req);
+
+            void end_write_segment(error_code err, ::dsn::ref_ptr<copy_request_ex> reqc);
+
             void write_copy(::dsn::ref_ptr<copy_request_ex> reqc);
 
             void continue_write();
@@ -180,6 +261,21 @@ namespace dsn {
 
             zlock                            _local_writes_lock;
             std::queue < ::dsn::ref_ptr<copy_request_ex> >    _local_writes;
+
+            perf_counter_ _recent_copy_data_size;
+            perf_counter_ _recent_copy_fail_count;
+            perf_counter_ _recent_copy_skip_size;
+            perf_counter_ _recent_copy_retry_count;
+            perf_counter_ _copy_concurrency;
+            perf_counter_ _write_concurrency;
+
+            aimd_window       _copy_window;
+            aimd_window       _write_window;
+            block_buffer_pool _buffer_pool;
+            nfs_resume_store  _resume;
+
+            zlock _bandwidth_limiters_lock;
+            std::unordered_map< ::dsn::rpc_address, std::unique_ptr<token_bucket> > _bandwidth_limiters;
         };
     }
 }
@@ -53,4 +53,6 @@ namespace dsn { namespace service {
     DEFINE_TASK_CODE_AIO(LPC_NFS_WRITE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 
     DEFINE_TASK_CODE_AIO(LPC_NFS_COPY_FILE, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
+
+    DEFINE_TASK_CODE(LPC_NFS_COPY_THROTTLING, TASK_PRIORITY_COMMON, THREAD_POOL_DEFAULT)
 } } 
@@ -0,0 +1,326 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the checksummed, resumable and delta copy of nfs client.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "nfs_client_impl.h"
+# include "nfs_resume_store.h"
+# include <dsn/tool_api.h>
+# include <dsn/cpp/test_utils.h>
+# include <gtest/gtest.h>
+# include <fstream>
+# include <sys/stat.h>
+# include <utime.h>
+# include <unistd.h>
+
+using namespace ::dsn;
+using namespace ::dsn::service;
+
+static std::string make_content(size_t size, uint32_t seed)
+{
+    std::string content(size, '\0');
+    for (size_t i = 0; i < size; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        content[i] = static_cast<char>(seed >> 16);
+    }
+    return content;
+}
+
+static void write_file(const std::string& path, const std::string& content)
+{
+    std::ofstream os(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    os.write(content.data(), content.length());
+}
+
+static std::string read_file(const std::string& path)
+{
+    std::ifstream is(path, std::ios::in | std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+}
+
+static error_code copy_file(const std::string& file_name, const std::string& dst_dir)
+{
+    std::vector<std::string> files = { file_name };
+    task_ptr t = file::copy_remote_files(rpc_address("localhost", 20101),
+        ".", files, dst_dir, true, LPC_AIO_TEST_NFS, nullptr, [](error_code, size_t) {});
+    if (!t->wait(60000))
+        return ERR_TIMEOUT;
+    return t->error();
+}
+
+TEST(tools_nfs, resume_store)
+{
+    const std::string dir = "nfs_resume_store_test";
+    const std::string dst = "nfs_resume_store_dst/file";
+    utils::filesystem::remove_path(dir);
+    utils::filesystem::remove_path("nfs_resume_store_dst");
+    ASSERT_TRUE(utils::filesystem::create_directory("nfs_resume_store_dst"));
+
+    nfs_resume_store store;
+    store.init(dir, 10);
+
+    // nothing to resume
+    EXPECT_EQ(0, store.restore(dst, "src:1", "./file", 35));
+
+    // failure without any progress recorded removes the partial file
+    write_file(dst, std::string(10, 'a'));
+    store.stash(dst);
+    EXPECT_FALSE(utils::filesystem::file_exists(dst));
+    EXPECT_FALSE(utils::filesystem::file_exists(store.partial_path(dst)));
+
+    // failure with progress moves the partial file out of the destination directory
+    write_file(dst, std::string(25, 'a'));
+    store.save(dst, "src:1", "./file", 35, 1);
+    store.save(dst, "src:1", "./file", 35, 2);
+    store.stash(dst);
+    EXPECT_FALSE(utils::filesystem::file_exists(dst));
+    EXPECT_TRUE(utils::filesystem::file_exists(store.partial_path(dst)));
+    std::vector<std::string> sub;
+    ASSERT_TRUE(utils::filesystem::get_subfiles("nfs_resume_store_dst", sub, true));
+    EXPECT_TRUE(sub.empty());
+    sub.clear();
+    ASSERT_TRUE(utils::filesystem::get_subfiles(dir, sub, true));
+    EXPECT_EQ(2u, sub.size()); // no temporary progress files are left
+
+    // the same source file resumes
+    EXPECT_EQ(2, store.restore(dst, "src:1", "./file", 35));
+    EXPECT_EQ(std::string(25, 'a'), read_file(dst));
+    EXPECT_FALSE(utils::filesystem::file_exists(store.partial_path(dst)));
+    EXPECT_TRUE(utils::filesystem::file_exists(store.progress_path(dst)));
+
+    // any difference of the source drops the resume state
+    store.stash(dst);
+    EXPECT_EQ(0, store.restore(dst, "src:2", "./file", 35));
+    EXPECT_FALSE(utils::filesystem::file_exists(store.partial_path(dst)));
+    EXPECT_FALSE(utils::filesystem::file_exists(store.progress_path(dst)));
+
+    write_file(dst, std::string(25, 'a'));
+    store.save(dst, "src:1", "./file", 35, 2);
+    store.stash(dst);
+    EXPECT_EQ(0, store.restore(dst, "src:1", "./file2", 35));
+
+    write_file(dst, std::string(25, 'a'));
+    store.save(dst, "src:1", "./file", 35, 2);
+    store.stash(dst);
+    EXPECT_EQ(0, store.restore(dst, "src:1", "./file", 36));
+
+    // the recorded segments are not all in the partial file
+    write_file(dst, std::string(15, 'a'));
+    store.save(dst, "src:1", "./file", 35, 2);
+    store.stash(dst);
+    EXPECT_EQ(0, store.restore(dst, "src:1", "./file", 35));
+
+    // the destination is written by others after the failure
+    write_file(dst, std::string(25, 'a'));
+    store.save(dst, "src:1", "./file", 35, 2);
+    store.stash(dst);
+    write_file(dst, std::string(35, 'b'));
+    EXPECT_EQ(0, store.restore(dst, "src:1", "./file", 35));
+    EXPECT_EQ(std::string(35, 'b'), read_file(dst));
+
+    utils::filesystem::remove_path(dir);
+    utils::filesystem::remove_path("nfs_resume_store_dst");
+}
+
+TEST(tools_nfs, verify_copy_response)
+{
+    std::string content = make_content(100, 1);
+
+    copy_request req;
+    req.offset = 200;
+    req.size = 100;
+    req.need_checksum = true;
+    req.has_dst_checksum = false;
+
+    copy_response resp;
+    resp.error = ERR_OK;
+    resp.offset = 200;
+    resp.size = 100;
+    resp.file_content = blob(content.data(), 0, 100);
+    resp.checksum = static_cast<int64_t>(dsn_crc64_compute(content.data(), 100, 0));
+    resp.__isset.checksum = true;
+    resp.is_same = false;
+    EXPECT_EQ(ERR_OK, nfs_client_impl::verify_copy_response(req, resp));
+
+    // corrupted in transit
+    std::string corrupted = content;
+    corrupted[50] ^= 0x1;
+    resp.file_content = blob(corrupted.data(), 0, 100);
+    EXPECT_EQ(ERR_WRONG_CHECKSUM, nfs_client_impl::verify_copy_response(req, resp));
+    resp.file_content = blob(content.data(), 0, 100);
+
+    // responses from old servers carry no checksum
+    resp.__isset.checksum = false;
+    resp.checksum = 0;
+    EXPECT_EQ(ERR_OK, nfs_client_impl::verify_copy_response(req, resp));
+
+    // short read at the end of the file
+    resp.size = 60;
+    resp.file_content = blob(content.data(), 0, 60);
+    EXPECT_EQ(ERR_OK, nfs_client_impl::verify_copy_response(req, resp));
+
+    resp.size = 100;
+    resp.offset = 300;
+    EXPECT_EQ(ERR_INVALID_DATA, nfs_client_impl::verify_copy_response(req, resp));
+    resp.offset = 200;
+
+    resp.file_content = blob(content.data(), 0, 99);
+    EXPECT_EQ(ERR_INVALID_DATA, nfs_client_impl::verify_copy_response(req, resp));
+
+    // is_same is only valid for delta copy
+    resp.file_content = blob();
+    resp.is_same = true;
+    EXPECT_EQ(ERR_INVALID_DATA, nfs_client_impl::verify_copy_response(req, resp));
+    req.has_dst_checksum = true;
+    EXPECT_EQ(ERR_OK, nfs_client_impl::verify_copy_response(req, resp));
+
+    resp.error = ERR_OBJECT_NOT_FOUND;
+    EXPECT_EQ(ERR_OBJECT_NOT_FOUND, nfs_client_impl::verify_copy_response(req, resp));
+}
+
+// see [nfs] in test.config.tools.nfs.ini for the block size and resume dir
+TEST(tools_nfs, copy_resume_after_failure)
+{
+    if (task::get_current_nfs() == nullptr) return;
+
+    const uint32_t block_bytes = 4096;
+    const std::string src = "nfs_resume_src";
+    const std::string dst_dir = "nfs_resume_dst";
+    const std::string dst = utils::filesystem::path_combine(dst_dir, src);
+    const std::string probe = "nfs_resume_probe";
+    utils::filesystem::remove_path(src);
+    utils::filesystem::remove_path(dst_dir);
+    utils::filesystem::remove_path(probe);
+    ASSERT_TRUE(utils::filesystem::create_directory(dst_dir));
+
+    std::string content = make_content(block_bytes * 10 + 100, 2);
+    write_file(src, content);
+
+    // a previous copy failed after 6 blocks, and block 2 is different from the source now
+    std::string partial = content.substr(0, block_bytes * 6);
+    partial[block_bytes * 2 + 10] ^= 0x1;
+    write_file(dst, partial);
+
+    nfs_resume_store store;
+    store.init("./nfs_resume", block_bytes);
+    store.save(dst, rpc_address("localhost", 20101).to_string(), utils::filesystem::path_combine(".", src),
+        content.length(), 6);
+    store.stash(dst);
+    ASSERT_FALSE(utils::filesystem::file_exists(dst));
+    ASSERT_TRUE(utils::filesystem::file_exists(store.partial_path(dst)));
+
+    // the probe is the same file as the partial one, so it sees the writes of a resumed copy
+    ASSERT_EQ(0, ::link(store.partial_path(dst).c_str(), probe.c_str()));
+
+    ASSERT_EQ(ERR_OK, copy_file(src, dst_dir));
+    EXPECT_TRUE(content == read_file(dst));
+    EXPECT_TRUE(content == read_file(probe));
+    EXPECT_FALSE(utils::filesystem::file_exists(store.partial_path(dst)));
+    EXPECT_FALSE(utils::filesystem::file_exists(store.progress_path(dst)));
+
+    std::vector<std::string> sub;
+    ASSERT_TRUE(utils::filesystem::get_subfiles(dst_dir, sub, true));
+    EXPECT_EQ(1u, sub.size());
+
+    utils::filesystem::remove_path(src);
+    utils::filesystem::remove_path(dst_dir);
+    utils::filesystem::remove_path(probe);
+}
+
+TEST(tools_nfs, copy_delta_skip)
+{
+    if (task::get_current_nfs() == nullptr) return;
+
+    const uint32_t block_bytes = 4096;
+    const std::string src = "nfs_delta_src";
+    const std::string dst_dir = "nfs_delta_dst";
+    const std::string dst = utils::filesystem::path_combine(dst_dir, src);
+    utils::filesystem::remove_path(src);
+    utils::filesystem::remove_path(dst_dir);
+    ASSERT_TRUE(utils::filesystem::create_directory(dst_dir));
+
+    std::string content = make_content(block_bytes * 8 + 1, 3);
+    write_file(src, content);
+
+    // identical destination, no block is rewritten
+    write_file(dst, content);
+    struct utimbuf old_time;
+    old_time.actime = old_time.modtime = 1000000000;
+    ASSERT_EQ(0, ::utime(dst.c_str(), &old_time));
+
+    ASSERT_EQ(ERR_OK, copy_file(src, dst_dir));
+    EXPECT_TRUE(content == read_file(dst));
+    struct stat st;
+    ASSERT_EQ(0, ::stat(dst.c_str(), &st));
+    EXPECT_EQ(old_time.modtime, st.st_mtime);
+
+    // only the changed blocks are copied, and the shorter destination is extended
+    std::string changed = content.substr(0, block_bytes * 6);
+    changed[block_bytes * 3] ^= 0x1;
+    write_file(dst, changed);
+
+    ASSERT_EQ(ERR_OK, copy_file(src, dst_dir));
+    EXPECT_TRUE(content == read_file(dst));
+
+    // the longer destination is copied as a whole
+    write_file(dst, content + "tail");
+    ASSERT_EQ(ERR_OK, copy_file(src, dst_dir));
+    EXPECT_TRUE(content == read_file(dst));
+
+    utils::filesystem::remove_path(src);
+    utils::filesystem::remove_path(dst_dir);
+}
+
+// see test.config.tools.nfs.fj.ini, where the copy responses are corrupted by the fault injector
+TEST(tools_nfs_fj, copy_checksum_mismatch_retry)
+{
+    if (task::get_current_nfs() == nullptr) return;
+
+    const uint32_t block_bytes = 1024 * 1024;
+    const std::string src = "nfs_retry_src";
+    const std::string dst_dir = "nfs_retry_dst";
+    const std::string dst = utils::filesystem::path_combine(dst_dir, src);
+    utils::filesystem::remove_path(src);
+    utils::filesystem::remove_path(dst_dir);
+
+    std::string content = make_content(block_bytes * 16, 4);
+    write_file(src, content);
+
+    // corrupted blocks are detected by checksum and copied again, so none is written
+    ASSERT_EQ(ERR_OK, copy_file(src, dst_dir));
+    EXPECT_TRUE(content == read_file(dst));
+
+    utils::filesystem::remove_path(src);
+    utils::filesystem::remove_path(dst_dir);
+}
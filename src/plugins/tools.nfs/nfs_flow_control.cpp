@@ -0,0 +1,194 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     flow control utilities for nfs
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+# include "nfs_flow_control.h"
+# include <algorithm>
+
+namespace dsn {
+    namespace service {
+
+        // base latency is re-sampled periodically so that it follows path changes
+        static const uint64_t s_latency_epoch_us = 10 * 1000 * 1000;
+
+        aimd_window::aimd_window()
+        {
+            init(1, 1, 2.0, false);
+        }
+
+        void aimd_window::init(int min_window, int max_window, double latency_tolerance, bool adaptive)
+        {
+            zauto_lock l(_lock);
+            _adaptive = adaptive;
+            _max_window = std::max(max_window, 1);
+            _min_window = std::max(std::min(min_window, _max_window), 1);
+            _latency_tolerance = latency_tolerance;
+            _window = _max_window;
+            _base_latency_us = 0;
+            _epoch_min_latency_us = 0;
+            _epoch_start_us = 0;
+            _last_decrease_us = 0;
+            _current = static_cast<int>(_window);
+        }
+
+        void aimd_window::on_success(uint64_t latency_us)
+        {
+            if (!_adaptive)
+                return;
+
+            uint64_t now = dsn_now_us();
+            zauto_lock l(_lock);
+
+            if (now - _epoch_start_us > s_latency_epoch_us)
+            {
+                if (_epoch_min_latency_us > 0)
+                    _base_latency_us = _epoch_min_latency_us;
+                _epoch_min_latency_us = latency_us;
+                _epoch_start_us = now;
+            }
+            else if (latency_us < _epoch_min_latency_us)
+            {
+                _epoch_min_latency_us = latency_us;
+            }
+
+            if (_base_latency_us == 0 || latency_us < _base_latency_us)
+                _base_latency_us = latency_us;
+
+            if ((double)latency_us > (double)_base_latency_us * _latency_tolerance)
+            {
+                decrease(now, latency_us);
+                return;
+            }
+
+            _window = std::min(_window + 1.0 / _window, (double)_max_window);
+            _current = static_cast<int>(_window);
+        }
+
+        void aimd_window::on_failure()
+        {
+            if (!_adaptive)
+                return;
+
+            uint64_t now = dsn_now_us();
+            zauto_lock l(_lock);
+            decrease(now, _base_latency_us);
+        }
+
+        void aimd_window::decrease(uint64_t now_us, uint64_t latency_us)
+        {
+            // the requests in flight still see the old congestion, so decrease only once per period
+            if (now_us - _last_decrease_us < latency_us)
+                return;
+
+            _last_decrease_us = now_us;
+            _window = std::max(_window / 2, (double)_min_window);
+            _current = static_cast<int>(_window);
+        }
+
+        token_bucket::token_bucket(uint64_t bytes_per_second)
+            : _rate(bytes_per_second), _tokens((double)bytes_per_second), _last_refill_us(dsn_now_us())
+        {
+            dassert(_rate > 0, "rate must be positive");
+        }
+
+        uint64_t token_bucket::acquire(uint64_t bytes)
+        {
+            uint64_t now = dsn_now_us();
+            zauto_lock l(_lock);
+
+            _tokens += (double)(now - _last_refill_us) * (double)_rate / 1000000.0;
+            _tokens = std::min(_tokens, (double)_rate);
+            _last_refill_us = now;
+
+            // debt is allowed so that blocks larger than the rate still get through
+            _tokens -= (double)bytes;
+            if (_tokens >= 0)
+                return 0;
+
+            return static_cast<uint64_t>(-_tokens * 1000.0 / (double)_rate) + 1;
+        }
+
+        block_buffer_pool::~block_buffer_pool()
+        {
+            zauto_lock l(_state->lock);
+            _state->closed = true;
+            for (auto b : _state->free_blocks)
+                delete[] b;
+            _state->free_blocks.clear();
+        }
+
+        void block_buffer_pool::init(uint32_t block_bytes, int capacity)
+        {
+            zauto_lock l(_state->lock);
+            _state->block_bytes = block_bytes;
+            _state->capacity = capacity;
+        }
+
+        std::shared_ptr<char> block_buffer_pool::get(uint32_t size)
+        {
+            char* buffer = nullptr;
+            {
+                zauto_lock l(_state->lock);
+                if (size != _state->block_bytes || _state->capacity <= 0)
+                {
+                    return dsn::make_shared_array<char>(size);
+                }
+
+                if (!_state->free_blocks.empty())
+                {
+                    buffer = _state->free_blocks.back();
+                    _state->free_blocks.pop_back();
+                }
+            }
+
+            if (buffer == nullptr)
+                buffer = new char[size];
+
+            auto state = _state;
+            return std::shared_ptr<char>(buffer, [state](char* b) { put(state, b); });
+        }
+
+        void block_buffer_pool::put(const std::shared_ptr<pool_state>& state, char* buffer)
+        {
+            {
+                zauto_lock l(state->lock);
+                if (!state->closed && (int)state->free_blocks.size() < state->capacity)
+                {
+                    state->free_blocks.push_back(buffer);
+                    return;
+                }
+            }
+            delete[] buffer;
+        }
+    }
+}
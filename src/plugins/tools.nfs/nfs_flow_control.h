@@ -0,0 +1,130 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     flow control utilities for nfs, i.e., adaptive concurrency window,
+ *     bandwidth limiter, and block buffer pool
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+# pragma once
+# include <dsn/service_api_cpp.h>
+# include <atomic>
+
+namespace dsn {
+    namespace service {
+
+        //
+        // AIMD concurrency window driven by the observed latency:
+        // - start at the max window, so a healthy path copies at full concurrency at once
+        // - halve the window when the latency exceeds tolerance * base latency
+        //   or on failures, at most once per latency period, but not below the min window
+        // - additive increase (+1 per window of successes) back to the max window
+        //
+        class aimd_window
+        {
+        public:
+            aimd_window();
+
+            void init(int min_window, int max_window, double latency_tolerance, bool adaptive);
+
+            int get() const { return _current.load(std::memory_order_relaxed); }
+
+            void on_success(uint64_t latency_us);
+
+            void on_failure();
+
+        private:
+            void decrease(uint64_t now_us, uint64_t latency_us);
+
+        private:
+            zlock    _lock;
+            bool     _adaptive;
+            int      _min_window;
+            int      _max_window;
+            double   _latency_tolerance;
+            double   _window;
+            uint64_t _base_latency_us;
+            uint64_t _epoch_min_latency_us;
+            uint64_t _epoch_start_us;
+            uint64_t _last_decrease_us;
+            std::atomic<int> _current;
+        };
+
+        //
+        // token bucket with one second burst, where acquire() always succeeds
+        // and returns how long the caller should wait before sending
+        //
+        class token_bucket
+        {
+        public:
+            token_bucket(uint64_t bytes_per_second);
+
+            uint64_t acquire(uint64_t bytes); // return delay in milliseconds
+
+        private:
+            zlock    _lock;
+            uint64_t _rate;
+            double   _tokens;
+            uint64_t _last_refill_us;
+        };
+
+        //
+        // bounded pool for nfs_copy_block_bytes sized buffers,
+        // buffers in other sizes are allocated directly
+        //
+        class block_buffer_pool
+        {
+        public:
+            block_buffer_pool() : _state(std::make_shared<pool_state>()) {}
+            ~block_buffer_pool();
+
+            void init(uint32_t block_bytes, int capacity);
+
+            std::shared_ptr<char> get(uint32_t size);
+
+        private:
+            struct pool_state
+            {
+                zlock              lock;
+                uint32_t           block_bytes;
+                int                capacity;
+                bool               closed;
+                std::vector<char*> free_blocks;
+
+                pool_state() : block_bytes(0), capacity(0), closed(false) {}
+            };
+
+            // buffers may be released after the pool is gone (e.g., in flight messages)
+            static void put(const std::shared_ptr<pool_state>& state, char* buffer);
+
+            std::shared_ptr<pool_state> _state;
+        };
+    }
+}
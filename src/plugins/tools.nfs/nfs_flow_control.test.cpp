@@ -0,0 +1,167 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     Unit-test for the flow control of nfs.
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "nfs_flow_control.h"
+# include <gtest/gtest.h>
+# include <thread>
+# include <chrono>
+
+using namespace ::dsn::service;
+
+TEST(tools_nfs, aimd_window)
+{
+    aimd_window w;
+    EXPECT_EQ(1, w.get());
+
+    // fixed window
+    w.init(1, 8, 2.0, false);
+    EXPECT_EQ(8, w.get());
+    w.on_failure();
+    w.on_success(1000 * 1000 * 1000);
+    EXPECT_EQ(8, w.get());
+
+    // adaptive window starts at the max window
+    w.init(1, 8, 2.0, true);
+    EXPECT_EQ(8, w.get());
+    w.on_success(1000 * 1000);
+    EXPECT_EQ(8, w.get());
+
+    // halved when the latency exceeds the tolerance, and only once per latency period
+    w.on_success(3 * 1000 * 1000);
+    EXPECT_EQ(4, w.get());
+    w.on_success(3 * 1000 * 1000);
+    EXPECT_EQ(4, w.get());
+
+    // additive increase, about one per window of successes
+    int successes = 0;
+    while (w.get() == 4 && successes < 100)
+    {
+        w.on_success(1000 * 1000);
+        successes++;
+    }
+    EXPECT_EQ(5, w.get());
+    EXPECT_EQ(5, successes);
+
+    for (int i = 0; i < 1000; i++)
+        w.on_success(1000 * 1000);
+    EXPECT_EQ(8, w.get());
+
+    // failures halve the window down to the min window
+    w.init(3, 8, 2.0, true);
+    w.on_success(1);
+    for (int i = 0; i < 4; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        w.on_failure();
+    }
+    EXPECT_EQ(3, w.get());
+
+    // bad arguments are clamped
+    w.init(10, 0, 2.0, true);
+    EXPECT_EQ(1, w.get());
+}
+
+TEST(tools_nfs, token_bucket)
+{
+    token_bucket b(1000);
+
+    // one second burst
+    EXPECT_EQ(0u, b.acquire(500));
+    EXPECT_EQ(0u, b.acquire(400));
+
+    // then the callers wait for the debt to be paid back
+    uint64_t delay = b.acquire(1100);
+    EXPECT_GE(delay, 900u);
+    EXPECT_LE(delay, 1001u);
+
+    delay = b.acquire(1000);
+    EXPECT_GE(delay, 1900u);
+    EXPECT_LE(delay, 2001u);
+
+    // blocks larger than the rate still get through
+    token_bucket b2(1000);
+    delay = b2.acquire(5000);
+    EXPECT_GE(delay, 3900u);
+    EXPECT_LE(delay, 4001u);
+}
+
+TEST(tools_nfs, block_buffer_pool)
+{
+    std::shared_ptr<char> kept;
+    {
+        block_buffer_pool pool;
+        pool.init(1024, 2);
+
+        // block sized buffers are reused
+        auto b1 = pool.get(1024);
+        char* p1 = b1.get();
+        ASSERT_NE(nullptr, p1);
+        b1 = nullptr;
+        b1 = pool.get(1024);
+        EXPECT_EQ(p1, b1.get());
+
+        // at most capacity buffers are cached, and reused in LIFO order
+        auto b2 = pool.get(1024);
+        auto b3 = pool.get(1024);
+        char* q1 = b1.get();
+        char* q2 = b2.get();
+        EXPECT_NE(q1, q2);
+        EXPECT_NE(q2, b3.get());
+        b1 = nullptr;
+        b2 = nullptr;
+        b3 = nullptr;
+        b1 = pool.get(1024);
+        b2 = pool.get(1024);
+        EXPECT_EQ(q2, b1.get());
+        EXPECT_EQ(q1, b2.get());
+
+        // other sizes are allocated directly
+        auto s = pool.get(100);
+        ASSERT_NE(nullptr, s.get());
+        memset(s.get(), 0, 100);
+
+        // buffers may outlive the pool
+        kept = pool.get(1024);
+        memset(kept.get(), 0, 1024);
+    }
+    memset(kept.get(), 1, 1024);
+    kept = nullptr;
+
+    // no pooling when the capacity is zero
+    block_buffer_pool pool2;
+    pool2.init(1024, 0);
+    auto b = pool2.get(1024);
+    ASSERT_NE(nullptr, b.get());
+}
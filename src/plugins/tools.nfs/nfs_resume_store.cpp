@@ -0,0 +1,199 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     resume states of the partially copied files on nfs client
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# include "nfs_resume_store.h"
+# include <dsn/cpp/utils.h>
+# include <algorithm>
+# include <cinttypes>
+# include <fstream>
+
+# ifdef __TITLE__
+# undef __TITLE__
+# endif
+# define __TITLE__ "nfs.resume"
+
+namespace dsn {
+    namespace service {
+
+        void nfs_resume_store::init(const std::string& resume_dir, uint32_t block_bytes)
+        {
+            _dir = resume_dir;
+            _block_bytes = block_bytes;
+        }
+
+        std::string nfs_resume_store::key_path(const std::string& dst_path) const
+        {
+            // the same file may be copied with different relative paths
+            std::string path = dst_path;
+            std::string cwd;
+            if (!path.empty() && path[0] != '/' && utils::filesystem::get_current_directory(cwd))
+                path = utils::filesystem::path_combine(cwd, path);
+            std::string npath;
+            if (utils::filesystem::get_normalized_path(path, npath) == 0)
+                path = npath;
+
+            char hash[32];
+            sprintf(hash, ".%016" PRIx64, dsn_crc64_compute(path.c_str(), path.length(), 0));
+            return utils::filesystem::path_combine(_dir, utils::filesystem::get_file_name(dst_path) + hash);
+        }
+
+        std::string nfs_resume_store::progress_path(const std::string& dst_path) const
+        {
+            return key_path(dst_path) + ".nfs_progress";
+        }
+
+        std::string nfs_resume_store::partial_path(const std::string& dst_path) const
+        {
+            return key_path(dst_path) + ".nfs_partial";
+        }
+
+        int nfs_resume_store::restore(
+            const std::string& dst_path,
+            const std::string& source,
+            const std::string& source_path,
+            uint64_t file_size
+            )
+        {
+            std::string progress = progress_path(dst_path);
+            std::string partial = partial_path(dst_path);
+            if (!utils::filesystem::file_exists(progress))
+            {
+                utils::filesystem::remove_path(partial);
+                return 0;
+            }
+
+            std::string saved_source, saved_source_path;
+            uint64_t saved_file_size = 0, saved_block_bytes = 0;
+            int written_segments = 0;
+            {
+                std::ifstream is(progress);
+                std::getline(is, saved_source);
+                std::getline(is, saved_source_path);
+                is >> saved_file_size >> saved_block_bytes >> written_segments;
+                if (is.fail())
+                    written_segments = 0;
+            }
+
+            // the destination is written by others after the failure, or the progress
+            // is for another source file, copy again from the beginning
+            int64_t partial_size = 0;
+            if (written_segments <= 0
+                || saved_source != source
+                || saved_source_path != source_path
+                || saved_file_size != file_size
+                || saved_block_bytes != _block_bytes
+                || utils::filesystem::file_exists(dst_path)
+                || !utils::filesystem::file_size(partial, partial_size)
+                || (uint64_t)partial_size < std::min(file_size, (uint64_t)written_segments * saved_block_bytes)
+                || (uint64_t)partial_size > file_size)
+            {
+                clear(dst_path);
+                return 0;
+            }
+
+            std::string dir = utils::filesystem::remove_file_name(dst_path);
+            if ((!dir.empty() && !utils::filesystem::create_directory(dir))
+                || !utils::filesystem::rename_path(partial, dst_path))
+            {
+                derror("nfs: move %s back to %s failed, copy from the beginning", partial.c_str(), dst_path.c_str());
+                clear(dst_path);
+                return 0;
+            }
+
+            ddebug("nfs: resume copy of %s from segment %d", dst_path.c_str(), written_segments);
+            return written_segments;
+        }
+
+        void nfs_resume_store::save(
+            const std::string& dst_path,
+            const std::string& source,
+            const std::string& source_path,
+            uint64_t file_size,
+            int written_segments
+            )
+        {
+            if (!utils::filesystem::create_directory(_dir))
+            {
+                derror("nfs: create resume directory %s failed", _dir.c_str());
+                return;
+            }
+
+            // write a new file and rename it, so that concurrent saves never interleave
+            std::string progress = progress_path(dst_path);
+            std::string tmp = progress + "." + std::to_string(written_segments) + ".tmp";
+            {
+                std::ofstream os(tmp, std::ios::out | std::ios::trunc);
+                os << source << std::endl
+                    << source_path << std::endl
+                    << file_size << " " << _block_bytes << " " << written_segments << std::endl;
+                if (os.fail())
+                {
+                    os.close();
+                    utils::filesystem::remove_path(tmp);
+                    return;
+                }
+            }
+
+            if (!utils::filesystem::rename_path(tmp, progress))
+                utils::filesystem::remove_path(tmp);
+        }
+
+        void nfs_resume_store::stash(const std::string& dst_path)
+        {
+            if (!utils::filesystem::file_exists(dst_path))
+            {
+                clear(dst_path);
+                return;
+            }
+
+            std::string partial = partial_path(dst_path);
+            if (utils::filesystem::file_exists(progress_path(dst_path))
+                && utils::filesystem::rename_path(dst_path, partial))
+            {
+                ddebug("nfs: partial file %s is moved to %s for resume", dst_path.c_str(), partial.c_str());
+                return;
+            }
+
+            utils::filesystem::remove_path(dst_path);
+            clear(dst_path);
+        }
+
+        void nfs_resume_store::clear(const std::string& dst_path)
+        {
+            utils::filesystem::remove_path(progress_path(dst_path));
+            utils::filesystem::remove_path(partial_path(dst_path));
+        }
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Microsoft Corporation
+ * 
+ * -=- Robust Distributed System Nucleus (rDSN) -=- 
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * Description:
+ *     resume states of the partially copied files on nfs client
+ *
+ * Revision history:
+ *     xxxx-xx-xx, author, first version
+ *     xxxx-xx-xx, author, fix bug about xxx
+ */
+
+# pragma once
+# include <dsn/service_api_cpp.h>
+# include <string>
+
+namespace dsn {
+    namespace service {
+
+        //
+        // when a copy fails, the partial destination file is moved into the resume
+        // directory together with a progress file, so that the destination directory
+        // looks the same as if the copy never happened:
+        //   <resume dir>/<file name>.<hash of dst path>.nfs_partial
+        //   <resume dir>/<file name>.<hash of dst path>.nfs_progress, i.e.,
+        //      <source address>
+        //      <source file path>
+        //      <file size> <block bytes> <written segments>
+        //
+        // the next copy of the same file from the same source moves the partial file
+        // back and re-verifies the written segments against the source by checksum,
+        // so a changed source is never silently spliced in
+        //
+        class nfs_resume_store
+        {
+        public:
+            nfs_resume_store() : _block_bytes(0) {}
+
+            void init(const std::string& resume_dir, uint32_t block_bytes);
+
+            // move the partial file back to dst_path if its progress is for the same
+            // source file, and return the number of segments to be verified
+            int restore(
+                const std::string& dst_path,
+                const std::string& source,
+                const std::string& source_path,
+                uint64_t file_size
+                );
+
+            // record that the first written_segments segments of dst_path are written
+            void save(
+                const std::string& dst_path,
+                const std::string& source,
+                const std::string& source_path,
+                uint64_t file_size,
+                int written_segments
+                );
+
+            // on copy failure, move the partial file out of the destination directory
+            // if any progress is recorded for it, or remove it otherwise
+            void stash(const std::string& dst_path);
+
+            // remove all the resume state of dst_path
+            void clear(const std::string& dst_path);
+
+            std::string progress_path(const std::string& dst_path) const;
+            std::string partial_path(const std::string& dst_path) const;
+
+        private:
+            std::string key_path(const std::string& dst_path) const;
+
+        private:
+            std::string _dir;
+            uint32_t    _block_bytes;
+        };
+    }
+}
@@ -33,6 +33,7 @@
  *     xxxx-xx-xx, author, fix bug about xxx
  */
 # include "nfs_server_impl.h"
+# include <dsn/tool-api/rpc_message.h>
 # include <cstdlib>
 # include <sys/stat.h>
 
@@ -43,6 +44,21 @@ namespace dsn {
         {
             //dinfo(">>> on call RPC_COPY end, exec RPC_NFS_COPY");
 
+            // the read buffer is sized by the request, so reject the sizes no client would send
+            // (empty files are copied with a single request of size 0)
+            if (request.size < 0 || static_cast<uint32_t>(request.size) > _opts.nfs_copy_block_bytes)
+            {
+                derror("nfs: invalid copy size %d for %s, the limit is %u",
+                    request.size,
+                    request.file_name.c_str(),
+                    _opts.nfs_copy_block_bytes
+                    );
+                ::dsn::service::copy_response resp;
+                resp.error = ERR_INVALID_PARAMETERS;
+                reply(resp);
+                return;
+            }
+
             std::string file_path = dsn::utils::filesystem::path_combine(request.source_dir, request.file_name);
             dsn_handle_t hfile;
 
@@ -87,12 +103,16 @@ namespace dsn {
             }
 
             callback_para cp(reply);
-            cp.bb = blob(dsn::make_shared_array<char>(_opts.nfs_copy_block_bytes), _opts.nfs_copy_block_bytes);
+            cp.bb = blob(_buffer_pool.get(request.size), request.size);
             cp.dst_dir = std::move(request.dst_dir);
             cp.file_path = std::move(file_path);
             cp.hfile = hfile;
             cp.offset = request.offset;
             cp.size = request.size;
+            cp.append_content = request.append_content;
+            cp.need_checksum = request.need_checksum;
+            cp.has_dst_checksum = request.has_dst_checksum;
+            cp.dst_checksum = request.dst_checksum;
 
             auto buffer_save = cp.bb.buffer().get();
             file::read(
@@ -123,11 +143,45 @@ namespace dsn {
 
             ::dsn::service::copy_response resp;
             resp.error = err;
-            resp.file_content = cp.bb;
             resp.offset = cp.offset;
-            resp.size = cp.size;
+            resp.size = static_cast<int32_t>(sz); // may be short at the end of the file
+
+            if (err != ERR_OK)
+            {
+                _recent_copy_fail_count.increment();
+                cp.replier(resp);
+                return;
+            }
+
+            if (cp.need_checksum || cp.has_dst_checksum)
+            {
+                resp.checksum = static_cast<int64_t>(dsn_crc64_compute(cp.bb.data(), sz, 0));
+            }
+
+            if (cp.has_dst_checksum && sz == cp.size && resp.checksum == cp.dst_checksum)
+            {
+                _recent_copy_skip_size.add(sz);
+                resp.is_same = true;
+                cp.replier(resp);
+                return;
+            }
+
+            _recent_copy_data_size.add(sz);
+            auto content = cp.bb.range(0, static_cast<int>(sz));
+            if (!cp.append_content || cp.replier.is_empty())
+            {
+                resp.file_content = std::move(content);
+                cp.replier(resp);
+                return;
+            }
 
-            cp.replier(resp);
+            // the header-only response is followed by the content buffer itself, which the
+            // network layer sends out with the other buffers of the message without copying;
+            // nfs_client_impl::end_copy slices it out of the received message in the same way
+            auto msg = cp.replier.response_message();
+            ::dsn::marshall(msg, resp);
+            ((::dsn::message_ex*)msg)->write_append(content);
+            dsn_rpc_reply(msg);
         }
 
         // RPC_NFS_NEW_NFS_GET_FILE_SIZE 
@@ -35,6 +35,7 @@
 # pragma once
 # include "nfs_server.h"
 # include "nfs_client_impl.h"
+# include <dsn/cpp/perf_counter_.h>
 
 namespace dsn {
     namespace service {
@@ -50,6 +51,12 @@ namespace dsn {
                     this,
                     [this] {close_file();},
                     std::chrono::milliseconds(opts.file_close_timer_interval_ms_on_server));
+
+                _recent_copy_data_size.init("nfs.server", "recent_copy_data_size", COUNTER_TYPE_RATE, "nfs server copy data size in the recent period");
+                _recent_copy_fail_count.init("nfs.server", "recent_copy_fail_count", COUNTER_TYPE_RATE, "nfs server copy fail count in the recent period");
+                _recent_copy_skip_size.init("nfs.server", "recent_copy_skip_size", COUNTER_TYPE_RATE, "nfs server copy data size not sent as it is unchanged at the destination");
+
+                _buffer_pool.init(opts.nfs_copy_block_bytes, opts.copy_buffer_pool_size);
             }
             virtual ~nfs_service_impl() {}
 
@@ -68,9 +75,15 @@ namespace dsn {
                 blob bb;
                 uint64_t offset;
                 uint32_t size;
+                bool append_content;
+                bool need_checksum;
+                bool has_dst_checksum;
+                int64_t dst_checksum;
                 rpc_replier<copy_response> replier;
 
-                callback_para(const rpc_replier<copy_response>& r) : hfile(nullptr), offset(0), size(0), replier(r){}
+                callback_para(const rpc_replier<copy_response>& r) 
+                    : hfile(nullptr), offset(0), size(0), append_content(false), 
+                    need_checksum(false), has_dst_checksum(false), dst_checksum(0), replier(r){}
             };
 
             struct file_handle_info_on_server
@@ -93,6 +106,12 @@ namespace dsn {
             std::unordered_map <std::string, file_handle_info_on_server*> _handles_map; // cache file handles
 
             ::dsn::task_ptr _file_close_timer;
+
+            perf_counter_ _recent_copy_data_size;
+            perf_counter_ _recent_copy_fail_count;
+            perf_counter_ _recent_copy_skip_size;
+
+            block_buffer_pool _buffer_pool;
         };
 
     }
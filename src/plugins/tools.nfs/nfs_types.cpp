@@ -50,6 +50,22 @@ void copy_request::__set_overwrite(const bool val) {
   this->overwrite = val;
 }
 
+void copy_request::__set_append_content(const bool val) {
+  this->append_content = val;
+}
+
+void copy_request::__set_need_checksum(const bool val) {
+  this->need_checksum = val;
+}
+
+void copy_request::__set_has_dst_checksum(const bool val) {
+  this->has_dst_checksum = val;
+}
+
+void copy_request::__set_dst_checksum(const int64_t val) {
+  this->dst_checksum = val;
+}
+
 uint32_t copy_request::read(::apache::thrift::protocol::TProtocol* iprot) {
 
   apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
@@ -135,6 +151,38 @@ uint32_t copy_request::read(::apache::thrift::protocol::TProtocol* iprot) {
           xfer += iprot->skip(ftype);
         }
         break;
+      case 9:
+        if (ftype == ::apache::thrift::protocol::T_BOOL) {
+          xfer += iprot->readBool(this->append_content);
+          this->__isset.append_content = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 10:
+        if (ftype == ::apache::thrift::protocol::T_BOOL) {
+          xfer += iprot->readBool(this->need_checksum);
+          this->__isset.need_checksum = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 11:
+        if (ftype == ::apache::thrift::protocol::T_BOOL) {
+          xfer += iprot->readBool(this->has_dst_checksum);
+          this->__isset.has_dst_checksum = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 12:
+        if (ftype == ::apache::thrift::protocol::T_I64) {
+          xfer += iprot->readI64(this->dst_checksum);
+          this->__isset.dst_checksum = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
       default:
         xfer += iprot->skip(ftype);
         break;
@@ -184,6 +232,22 @@ uint32_t copy_request::write(::apache::thrift::protocol::TProtocol* oprot) const
   xfer += oprot->writeBool(this->overwrite);
   xfer += oprot->writeFieldEnd();
 
+  xfer += oprot->writeFieldBegin("append_content", ::apache::thrift::protocol::T_BOOL, 9);
+  xfer += oprot->writeBool(this->append_content);
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("need_checksum", ::apache::thrift::protocol::T_BOOL, 10);
+  xfer += oprot->writeBool(this->need_checksum);
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("has_dst_checksum", ::apache::thrift::protocol::T_BOOL, 11);
+  xfer += oprot->writeBool(this->has_dst_checksum);
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("dst_checksum", ::apache::thrift::protocol::T_I64, 12);
+  xfer += oprot->writeI64(this->dst_checksum);
+  xfer += oprot->writeFieldEnd();
+
   xfer += oprot->writeFieldStop();
   xfer += oprot->writeStructEnd();
   return xfer;
@@ -199,6 +263,10 @@ void swap(copy_request &a, copy_request &b) {
   swap(a.size, b.size);
   swap(a.is_last, b.is_last);
   swap(a.overwrite, b.overwrite);
+  swap(a.append_content, b.append_content);
+  swap(a.need_checksum, b.need_checksum);
+  swap(a.has_dst_checksum, b.has_dst_checksum);
+  swap(a.dst_checksum, b.dst_checksum);
   swap(a.__isset, b.__isset);
 }
 
@@ -211,6 +279,10 @@ copy_request::copy_request(const copy_request& other0) {
   size = other0.size;
   is_last = other0.is_last;
   overwrite = other0.overwrite;
+  append_content = other0.append_content;
+  need_checksum = other0.need_checksum;
+  has_dst_checksum = other0.has_dst_checksum;
+  dst_checksum = other0.dst_checksum;
   __isset = other0.__isset;
 }
 copy_request::copy_request( copy_request&& other1) {
@@ -222,6 +294,10 @@ copy_request::copy_request( copy_request&& other1) {
   size = std::move(other1.size);
   is_last = std::move(other1.is_last);
   overwrite = std::move(other1.overwrite);
+  append_content = std::move(other1.append_content);
+  need_checksum = std::move(other1.need_checksum);
+  has_dst_checksum = std::move(other1.has_dst_checksum);
+  dst_checksum = std::move(other1.dst_checksum);
   __isset = std::move(other1.__isset);
 }
 copy_request& copy_request::operator=(const copy_request& other2) {
@@ -233,6 +309,10 @@ copy_request& copy_request::operator=(const copy_request& other2) {
   size = other2.size;
   is_last = other2.is_last;
   overwrite = other2.overwrite;
+  append_content = other2.append_content;
+  need_checksum = other2.need_checksum;
+  has_dst_checksum = other2.has_dst_checksum;
+  dst_checksum = other2.dst_checksum;
   __isset = other2.__isset;
   return *this;
 }
@@ -245,6 +325,10 @@ copy_request& copy_request::operator=(copy_request&& other3) {
   size = std::move(other3.size);
   is_last = std::move(other3.is_last);
   overwrite = std::move(other3.overwrite);
+  append_content = std::move(other3.append_content);
+  need_checksum = std::move(other3.need_checksum);
+  has_dst_checksum = std::move(other3.has_dst_checksum);
+  dst_checksum = std::move(other3.dst_checksum);
   __isset = std::move(other3.__isset);
   return *this;
 }
@@ -259,6 +343,10 @@ void copy_request::printTo(std::ostream& out) const {
   out << ", " << "size=" << to_string(size);
   out << ", " << "is_last=" << to_string(is_last);
   out << ", " << "overwrite=" << to_string(overwrite);
+  out << ", " << "append_content=" << to_string(append_content);
+  out << ", " << "need_checksum=" << to_string(need_checksum);
+  out << ", " << "has_dst_checksum=" << to_string(has_dst_checksum);
+  out << ", " << "dst_checksum=" << to_string(dst_checksum);
   out << ")";
 }
 
@@ -283,6 +371,14 @@ void copy_response::__set_size(const int32_t val) {
   this->size = val;
 }
 
+void copy_response::__set_checksum(const int64_t val) {
+  this->checksum = val;
+}
+
+void copy_response::__set_is_same(const bool val) {
+  this->is_same = val;
+}
+
 uint32_t copy_response::read(::apache::thrift::protocol::TProtocol* iprot) {
 
   apache::thrift::protocol::TInputRecursionTracker tracker(*iprot);
@@ -336,6 +432,22 @@ uint32_t copy_response::read(::apache::thrift::protocol::TProtocol* iprot) {
           xfer += iprot->skip(ftype);
         }
         break;
+      case 5:
+        if (ftype == ::apache::thrift::protocol::T_I64) {
+          xfer += iprot->readI64(this->checksum);
+          this->__isset.checksum = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
+      case 6:
+        if (ftype == ::apache::thrift::protocol::T_BOOL) {
+          xfer += iprot->readBool(this->is_same);
+          this->__isset.is_same = true;
+        } else {
+          xfer += iprot->skip(ftype);
+        }
+        break;
       default:
         xfer += iprot->skip(ftype);
         break;
@@ -369,6 +481,14 @@ uint32_t copy_response::write(::apache::thrift::protocol::TProtocol* oprot) cons
   xfer += oprot->writeI32(this->size);
   xfer += oprot->writeFieldEnd();
 
+  xfer += oprot->writeFieldBegin("checksum", ::apache::thrift::protocol::T_I64, 5);
+  xfer += oprot->writeI64(this->checksum);
+  xfer += oprot->writeFieldEnd();
+
+  xfer += oprot->writeFieldBegin("is_same", ::apache::thrift::protocol::T_BOOL, 6);
+  xfer += oprot->writeBool(this->is_same);
+  xfer += oprot->writeFieldEnd();
+
   xfer += oprot->writeFieldStop();
   xfer += oprot->writeStructEnd();
   return xfer;
@@ -380,6 +500,8 @@ void swap(copy_response &a, copy_response &b) {
   swap(a.file_content, b.file_content);
   swap(a.offset, b.offset);
   swap(a.size, b.size);
+  swap(a.checksum, b.checksum);
+  swap(a.is_same, b.is_same);
   swap(a.__isset, b.__isset);
 }
 
@@ -388,6 +510,8 @@ copy_response::copy_response(const copy_response& other4) {
   file_content = other4.file_content;
   offset = other4.offset;
   size = other4.size;
+  checksum = other4.checksum;
+  is_same = other4.is_same;
   __isset = other4.__isset;
 }
 copy_response::copy_response( copy_response&& other5) {
@@ -395,6 +519,8 @@ copy_response::copy_response( copy_response&& other5) {
   file_content = std::move(other5.file_content);
   offset = std::move(other5.offset);
   size = std::move(other5.size);
+  checksum = std::move(other5.checksum);
+  is_same = std::move(other5.is_same);
   __isset = std::move(other5.__isset);
 }
 copy_response& copy_response::operator=(const copy_response& other6) {
@@ -402,6 +528,8 @@ copy_response& copy_response::operator=(const copy_response& other6) {
   file_content = other6.file_content;
   offset = other6.offset;
   size = other6.size;
+  checksum = other6.checksum;
+  is_same = other6.is_same;
   __isset = other6.__isset;
   return *this;
 }
@@ -410,6 +538,8 @@ copy_response& copy_response::operator=(copy_response&& other7) {
   file_content = std::move(other7.file_content);
   offset = std::move(other7.offset);
   size = std::move(other7.size);
+  checksum = std::move(other7.checksum);
+  is_same = std::move(other7.is_same);
   __isset = std::move(other7.__isset);
   return *this;
 }
@@ -420,6 +550,8 @@ void copy_response::printTo(std::ostream& out) const {
   out << ", " << "file_content=" << to_string(file_content);
   out << ", " << "offset=" << to_string(offset);
   out << ", " << "size=" << to_string(size);
+  out << ", " << "checksum=" << to_string(checksum);
+  out << ", " << "is_same=" << to_string(is_same);
   out << ")";
 }
 
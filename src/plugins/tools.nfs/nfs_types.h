@@ -29,7 +29,7 @@ class get_file_size_request;
 class get_file_size_response;
 
 typedef struct _copy_request__isset {
-  _copy_request__isset() : source(false), source_dir(false), dst_dir(false), file_name(false), offset(false), size(false), is_last(false), overwrite(false) {}
+  _copy_request__isset() : source(false), source_dir(false), dst_dir(false), file_name(false), offset(false), size(false), is_last(false), overwrite(false), append_content(false), need_checksum(false), has_dst_checksum(false), dst_checksum(false) {}
   bool source :1;
   bool source_dir :1;
   bool dst_dir :1;
@@ -38,6 +38,10 @@ typedef struct _copy_request__isset {
   bool size :1;
   bool is_last :1;
   bool overwrite :1;
+  bool append_content :1;
+  bool need_checksum :1;
+  bool has_dst_checksum :1;
+  bool dst_checksum :1;
 } _copy_request__isset;
 
 class copy_request {
@@ -47,7 +51,7 @@ class copy_request {
   copy_request(copy_request&&);
   copy_request& operator=(const copy_request&);
   copy_request& operator=(copy_request&&);
-  copy_request() : source_dir(), dst_dir(), file_name(), offset(0), size(0), is_last(0), overwrite(0) {
+  copy_request() : source_dir(), dst_dir(), file_name(), offset(0), size(0), is_last(0), overwrite(0), append_content(0), need_checksum(0), has_dst_checksum(0), dst_checksum(0) {
   }
 
   virtual ~copy_request() throw();
@@ -59,6 +63,10 @@ class copy_request {
   int32_t size;
   bool is_last;
   bool overwrite;
+  bool append_content;
+  bool need_checksum;
+  bool has_dst_checksum;
+  int64_t dst_checksum;
 
   _copy_request__isset __isset;
 
@@ -78,6 +86,14 @@ class copy_request {
 
   void __set_overwrite(const bool val);
 
+  void __set_append_content(const bool val);
+
+  void __set_need_checksum(const bool val);
+
+  void __set_has_dst_checksum(const bool val);
+
+  void __set_dst_checksum(const int64_t val);
+
   bool operator == (const copy_request & rhs) const
   {
     if (!(source == rhs.source))
@@ -96,6 +112,14 @@ class copy_request {
       return false;
     if (!(overwrite == rhs.overwrite))
       return false;
+    if (!(append_content == rhs.append_content))
+      return false;
+    if (!(need_checksum == rhs.need_checksum))
+      return false;
+    if (!(has_dst_checksum == rhs.has_dst_checksum))
+      return false;
+    if (!(dst_checksum == rhs.dst_checksum))
+      return false;
     return true;
   }
   bool operator != (const copy_request &rhs) const {
@@ -119,11 +143,13 @@ inline std::ostream& operator<<(std::ostream& out, const copy_request& obj)
 }
 
 typedef struct _copy_response__isset {
-  _copy_response__isset() : error(false), file_content(false), offset(false), size(false) {}
+  _copy_response__isset() : error(false), file_content(false), offset(false), size(false), checksum(false), is_same(false) {}
   bool error :1;
   bool file_content :1;
   bool offset :1;
   bool size :1;
+  bool checksum :1;
+  bool is_same :1;
 } _copy_response__isset;
 
 class copy_response {
@@ -133,7 +159,7 @@ class copy_response {
   copy_response(copy_response&&);
   copy_response& operator=(const copy_response&);
   copy_response& operator=(copy_response&&);
-  copy_response() : offset(0), size(0) {
+  copy_response() : offset(0), size(0), checksum(0), is_same(0) {
   }
 
   virtual ~copy_response() throw();
@@ -141,6 +167,8 @@ class copy_response {
    ::dsn::blob file_content;
   int64_t offset;
   int32_t size;
+  int64_t checksum;
+  bool is_same;
 
   _copy_response__isset __isset;
 
@@ -152,6 +180,10 @@ class copy_response {
 
   void __set_size(const int32_t val);
 
+  void __set_checksum(const int64_t val);
+
+  void __set_is_same(const bool val);
+
   bool operator == (const copy_response & rhs) const
   {
     if (!(error == rhs.error))
@@ -162,6 +194,10 @@ class copy_response {
       return false;
     if (!(size == rhs.size))
       return false;
+    if (!(checksum == rhs.checksum))
+      return false;
+    if (!(is_same == rhs.is_same))
+      return false;
     return true;
   }
   bool operator != (const copy_response &rhs) const {
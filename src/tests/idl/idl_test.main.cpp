@@ -41,6 +41,7 @@
 
 # include <iostream>
 # include <vector>
+# include <chrono>
 # include "stdlib.h"
 
 //#define DSN_IDL_TESTS_DEBUG
@@ -312,6 +313,201 @@ void test_thrift_generated_type_serialization(Format fmt)
     check_thrift_generated_type_serialization(item, fmt);
 }
 
+// the previous binary path: TBinaryProtocol over binary_writer_transport/binary_reader_transport
+template<typename T>
+void marshall_thrift_binary_transport(dsn::binary_writer& writer, const T& val)
+{
+    ::dsn::binary_writer_transport trans(writer);
+    boost::shared_ptr< ::dsn::binary_writer_transport> transport(&trans, [](::dsn::binary_writer_transport*) {});
+    ::apache::thrift::protocol::TBinaryProtocol proto(transport);
+    dsn::marshall_thrift_internal(val, &proto);
+}
+
+template<typename T>
+void unmarshall_thrift_binary_transport(dsn::binary_reader& reader, T& val)
+{
+    ::dsn::binary_reader_transport trans(reader);
+    boost::shared_ptr< ::dsn::binary_reader_transport> transport(&trans, [](::dsn::binary_reader_transport*) {});
+    ::apache::thrift::protocol::TBinaryProtocol proto(transport);
+    dsn::unmarshall_thrift_internal(val, &proto);
+}
+
+void make_thrift_item(dsn::idl::test::test_thrift_item& item, int container_n, int string_bytes)
+{
+    item.bool_item = true;
+    item.byte_item = std::numeric_limits<int8_t>::min();
+    item.i16_item = std::numeric_limits<int16_t>::min();
+    item.i32_item = std::numeric_limits<int32_t>::min();
+    item.i64_item = std::numeric_limits<int64_t>::min();
+    item.double_item = -123.321;
+    item.string_item = std::string(string_bytes, 'x');
+    item.list_i32_item.clear();
+    item.set_i32_item.clear();
+    item.map_i32_item.clear();
+    for (int i = 0; i < container_n; i++)
+    {
+        item.list_i32_item.push_back(-i);
+        item.set_i32_item.insert(i);
+        item.map_i32_item[i] = -i * 2;
+    }
+}
+
+void test_thrift_buffer_protocol_compatibility(int reserved_buffer_size)
+{
+    dsn::idl::test::test_thrift_item item;
+    make_thrift_item(item, 100, 1000);
+
+    dsn::binary_writer writer1(reserved_buffer_size), writer2(reserved_buffer_size);
+    dsn::marshall_thrift_binary(writer1, item);
+    marshall_thrift_binary_transport(writer2, item);
+
+    // byte-identical
+    dsn::blob b1 = writer1.get_buffer();
+    dsn::blob b2 = writer2.get_buffer();
+    ASSERT_EQ(b2.length(), b1.length());
+    EXPECT_EQ(0, memcmp(b1.data(), b2.data(), b1.length()));
+
+    // decoded by each other
+    dsn::idl::test::test_thrift_item output1, output2;
+    dsn::binary_reader reader1(b2), reader2(b1);
+    dsn::unmarshall_thrift_binary(reader1, output1);
+    unmarshall_thrift_binary_transport(reader2, output2);
+    EXPECT_TRUE(item == output1);
+    EXPECT_TRUE(item == output2);
+    EXPECT_EQ(0, reader1.get_remaining_size());
+    EXPECT_EQ(0, reader2.get_remaining_size());
+}
+
+TEST(thrift_helper, cpp_binary_buffer_protocol_compatibility)
+{
+    // with large and small (crossing buffers) write buffers
+    test_thrift_buffer_protocol_compatibility(64 * 1024);
+    test_thrift_buffer_protocol_compatibility(16);
+
+    // truncated input
+    dsn::idl::test::test_thrift_item item, output;
+    make_thrift_item(item, 10, 10);
+    dsn::binary_writer writer;
+    dsn::marshall_thrift_binary(writer, item);
+    dsn::blob bb = writer.get_buffer();
+    dsn::binary_reader reader(bb.range(0, bb.length() - 1));
+    EXPECT_THROW(dsn::unmarshall_thrift_binary(reader, output), ::apache::thrift::transport::TTransportException);
+}
+
+// like rpc_read_stream, which takes a message reference only when a blob is sliced
+class lazy_holding_reader : public dsn::binary_reader
+{
+public:
+    lazy_holding_reader(const dsn::blob& bb) : dsn::binary_reader(bb), hold_count(0) {}
+
+    virtual bool hold_buffer() override
+    {
+        if (!get_buffer().has_holder())
+        {
+            hold_count++;
+            set_buffer_holder(std::shared_ptr<char>((char*)get_buffer().data(), [](char*) {}));
+        }
+        return true;
+    }
+
+    int hold_count;
+};
+
+TEST(thrift_helper, cpp_binary_blob_zero_copy)
+{
+    std::string s(1000, 'y');
+    std::shared_ptr<char> buffer(dsn::make_shared_array<char>(s.length()));
+    memcpy(buffer.get(), s.c_str(), s.length());
+    dsn::blob input(buffer, static_cast<int>(s.length()));
+
+    dsn::binary_writer writer;
+    dsn::marshall_thrift_binary(writer, input);
+    dsn::blob bb = writer.get_buffer();
+
+    // sliced from the input buffer when it has a holder
+    dsn::blob output;
+    dsn::binary_reader reader(bb);
+    dsn::unmarshall_thrift_binary(reader, output);
+    ASSERT_EQ(s.length(), output.length());
+    EXPECT_EQ(bb.buffer_ptr(), output.buffer_ptr());
+    EXPECT_TRUE(output.data() > bb.data() && output.data() < bb.data() + bb.length());
+    EXPECT_EQ(s, std::string(output.data(), output.length()));
+
+    // copied otherwise
+    dsn::blob output2;
+    dsn::binary_reader reader2(dsn::blob(bb.data(), 0, bb.length()));
+    dsn::unmarshall_thrift_binary(reader2, output2);
+    ASSERT_EQ(s.length(), output2.length());
+    EXPECT_NE(bb.buffer_ptr(), output2.buffer_ptr());
+    EXPECT_EQ(s, std::string(output2.data(), output2.length()));
+
+    // held lazily on the first blob by readers that can hold their buffers
+    lazy_holding_reader reader3(dsn::blob(bb.data(), 0, bb.length()));
+    dsn::blob output3;
+    dsn::unmarshall_thrift_binary(reader3, output3);
+    EXPECT_EQ(1, reader3.hold_count);
+    EXPECT_EQ(bb.data(), output3.buffer_ptr());
+    EXPECT_EQ(s, std::string(output3.data(), output3.length()));
+
+    // and not at all without blobs
+    dsn::idl::test::test_thrift_item item, item_output;
+    make_thrift_item(item, 10, 10);
+    dsn::binary_writer writer2;
+    dsn::marshall_thrift_binary(writer2, item);
+    dsn::blob bb2 = writer2.get_buffer();
+    lazy_holding_reader reader4(dsn::blob(bb2.data(), 0, bb2.length()));
+    dsn::unmarshall_thrift_binary(reader4, item_output);
+    EXPECT_EQ(0, reader4.hold_count);
+    EXPECT_FALSE(reader4.get_buffer().has_holder());
+}
+
+template<typename TMarshaller, typename TUnmarshaller>
+void thrift_binary_serialization_benchmark(const char* name, const dsn::idl::test::test_thrift_item& item, int count, TMarshaller&& m, TUnmarshaller&& u)
+{
+    dsn::blob bb;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        dsn::binary_writer writer;
+        m(writer, item);
+        bb = writer.get_buffer();
+    }
+    auto mid = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        dsn::idl::test::test_thrift_item output;
+        dsn::binary_reader reader(bb);
+        u(reader, output);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    std::cout << name << ": bytes = " << bb.length()
+        << ", encode = " << std::chrono::duration_cast<std::chrono::nanoseconds>(mid - start).count() / count << " ns/op"
+        << ", decode = " << std::chrono::duration_cast<std::chrono::nanoseconds>(end - mid).count() / count << " ns/op"
+        << std::endl;
+}
+
+TEST(thrift_helper, cpp_binary_serialization_benchmark)
+{
+    const int count = 100000;
+    const int sizes[][2] = { { 0, 0 }, { 10, 16 }, { 100, 1024 } }; // container size, string bytes
+    for (auto& sz : sizes)
+    {
+        dsn::idl::test::test_thrift_item item;
+        make_thrift_item(item, sz[0], sz[1]);
+        
+        std::cout << "test_thrift_item with container_n = " << sz[0] << ", string_bytes = " << sz[1] << std::endl;
+        thrift_binary_serialization_benchmark("  TBinaryProtocol + transport", item, count,
+            [](dsn::binary_writer& w, const dsn::idl::test::test_thrift_item& v) { marshall_thrift_binary_transport(w, v); },
+            [](dsn::binary_reader& r, dsn::idl::test::test_thrift_item& v) { unmarshall_thrift_binary_transport(r, v); }
+            );
+        thrift_binary_serialization_benchmark("  thrift_binary_buffer_protocol", item, count,
+            [](dsn::binary_writer& w, const dsn::idl::test::test_thrift_item& v) { dsn::marshall_thrift_binary(w, v); },
+            [](dsn::binary_reader& r, dsn::idl::test::test_thrift_item& v) { dsn::unmarshall_thrift_binary(r, v); }
+            );
+    }
+}
+
 void check_protobuf_generated_type_serialization(const dsn::idl::test::test_protobuf_item &input, Format fmt)
 {
     const int bufsize = 2000;